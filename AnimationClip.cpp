@@ -0,0 +1,669 @@
+#include "AnimationClip.h"
+#include "Parallel.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ANIMATION_CLIP_SSE2
+#include <emmintrin.h>
+#endif
+
+static const float kSqrtHalf = 0.70710678f;
+
+// -- Quantization
+
+static void quantizeRotation(const glm::vec4& rotation, uint16_t* out)
+{
+	float components[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+
+	int largest = 0;
+	for (int i = 1; i < 4; i++)
+	{
+		if (std::fabs(components[i]) > std::fabs(components[largest]))
+		{
+			largest = i;
+		}
+	}
+
+	// q and -q are the same rotation, the dropped component is always rebuilt positive
+	float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+	int written = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		if (i != largest)
+		{
+			float value = glm::clamp(components[i] * sign / kSqrtHalf * 0.5f + 0.5f, 0.0f, 1.0f);
+			out[written++] = (uint16_t)(value * 32767.0f + 0.5f);
+		}
+	}
+
+	out[0] |= (uint16_t)((largest & 1) << 15);
+	out[1] |= (uint16_t)((largest >> 1) << 15);
+}
+
+static glm::vec4 dequantizeRotation(const uint16_t* in)
+{
+	int largest = (in[0] >> 15) | ((in[1] >> 15) << 1);
+
+	float a = ((in[0] & 0x7fff) * (2.0f / 32767.0f) - 1.0f) * kSqrtHalf;
+	float b = ((in[1] & 0x7fff) * (2.0f / 32767.0f) - 1.0f) * kSqrtHalf;
+	float c = ((in[2] & 0x7fff) * (2.0f / 32767.0f) - 1.0f) * kSqrtHalf;
+	float d = std::sqrt(std::max(0.0f, 1.0f - a * a - b * b - c * c));
+
+	switch (largest)
+	{
+	case 0: return glm::vec4(d, a, b, c);
+	case 1: return glm::vec4(a, d, b, c);
+	case 2: return glm::vec4(a, b, d, c);
+	default: return glm::vec4(a, b, c, d);
+	}
+}
+
+static void quantizeVector(const glm::vec4& value, const float* rangeMin, const float* rangeStep, uint16_t* out)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		float steps = rangeStep[i] > 0.0f ? (value[i] - rangeMin[i]) / rangeStep[i] : 0.0f;
+		out[i] = (uint16_t)(glm::clamp(steps, 0.0f, 65535.0f) + 0.5f);
+	}
+}
+
+static glm::vec4 dequantizeVector(const uint16_t* in, const float* rangeMin, const float* rangeStep)
+{
+	return glm::vec4(rangeMin[0] + in[0] * rangeStep[0], rangeMin[1] + in[1] * rangeStep[1], rangeMin[2] + in[2] * rangeStep[2], 0.0f);
+}
+
+static glm::vec4 nlerpRotation(const glm::vec4& a, glm::vec4 b, float alpha)
+{
+	if (glm::dot(a, b) < 0.0f)
+	{
+		b = -b;
+	}
+	return glm::normalize(a + (b - a) * alpha);
+}
+
+// angle of the rotation between a and b, from the chord instead of acos of the dot product,
+// acos can't tell anything under about 0.0007 radians apart in single precision
+static float getRotationError(const glm::vec4& a, const glm::vec4& b)
+{
+	float chord = std::min(glm::length(a - b), glm::length(a + b));
+	return 4.0f * std::asin(std::min(1.0f, chord * 0.5f));
+}
+
+// -- Animation clip
+
+AnimationClip::AnimationClip()
+{ }
+
+AnimationClip::~AnimationClip()
+{ }
+
+void AnimationClip::build(const Skeleton& skeleton, const RawAnimationClip& raw, const AnimationCompressionSettings& settings)
+{
+	if (raw.joints.size() != skeleton.getJointCount())
+	{
+		throw std::runtime_error("animation clip: clip and skeleton have different joint counts");
+	}
+
+	if (raw.frameCount == 0 || raw.frameCount > 0x10000 || raw.sampleRate <= 0.0f)
+	{
+		throw std::runtime_error("animation clip: bad frame count or sample rate");
+	}
+
+	for (const RawJointTrack& joint : raw.joints)
+	{
+		if (joint.rotations.size() != raw.frameCount || joint.translations.size() != raw.frameCount || joint.scales.size() != raw.frameCount)
+		{
+			throw std::runtime_error("animation clip: track lengths don't match the frame count");
+		}
+	}
+
+	jointCount = skeleton.getJointCount();
+	sampleRate = raw.sampleRate;
+	duration = (raw.frameCount - 1) / raw.sampleRate;
+
+	uint32_t groupCount = (jointCount + 3) / 4;
+
+	tracks.assign(groupCount * 4 * kAnimationChannelCount, AnimationTrack());
+	ranges.assign(groupCount, AnimationRanges4());
+	keys.clear();
+	fittedKeyCount = 0;
+
+	maxRotationError = 0.0f;
+	maxTranslationError = 0.0f;
+	rawSize = (size_t)jointCount * raw.frameCount * (sizeof(glm::quat) + 2 * sizeof(glm::vec3));
+
+	float maxScaleError = 0.0f;
+	std::vector<glm::vec4> samples(raw.frameCount);
+
+	// keys are stored in skeleton order, sampling walks them front to back
+	std::vector<uint32_t> jointToSource(jointCount);
+	for (uint32_t i = 0; i < jointCount; i++)
+	{
+		jointToSource[skeleton.sourceToJoint[i]] = i;
+	}
+
+	for (uint32_t joint = 0; joint < groupCount * 4; joint++)
+	{
+		const RawJointTrack* source = joint < jointCount ? &raw.joints[jointToSource[joint]] : nullptr;
+		AnimationTrack* jointTracks = &tracks[joint * kAnimationChannelCount];
+		AnimationRanges4& range = ranges[joint / 4];
+		uint32_t lane = joint % 4;
+
+		float rangeMin[3], rangeStep[3];
+
+		// the padding joints get constant identity tracks
+		for (uint32_t frame = 0; frame < raw.frameCount; frame++)
+		{
+			glm::quat rotation = source ? source->rotations[frame] : glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+			samples[frame] = glm::normalize(glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w));
+		}
+		fitTrack(samples, kAnimationChannelRotation, settings.rotationTolerance, rangeMin, rangeStep, jointTracks[kAnimationChannelRotation], maxRotationError);
+
+		for (uint32_t frame = 0; frame < raw.frameCount; frame++)
+		{
+			samples[frame] = glm::vec4(source ? source->translations[frame] : glm::vec3(0.0f), 0.0f);
+		}
+		fitTrack(samples, kAnimationChannelTranslation, settings.translationTolerance, rangeMin, rangeStep, jointTracks[kAnimationChannelTranslation], maxTranslationError);
+
+		for (int i = 0; i < 3; i++)
+		{
+			range.translationMin[i][lane] = rangeMin[i];
+			range.translationStep[i][lane] = rangeStep[i];
+		}
+
+		for (uint32_t frame = 0; frame < raw.frameCount; frame++)
+		{
+			samples[frame] = glm::vec4(source ? source->scales[frame] : glm::vec3(1.0f), 0.0f);
+		}
+		fitTrack(samples, kAnimationChannelScale, settings.scaleTolerance, rangeMin, rangeStep, jointTracks[kAnimationChannelScale], maxScaleError);
+
+		for (int i = 0; i < 3; i++)
+		{
+			range.scaleMin[i][lane] = rangeMin[i];
+			range.scaleStep[i][lane] = rangeStep[i];
+		}
+	}
+}
+
+void AnimationClip::fitTrack(const std::vector<glm::vec4>& samples, AnimationChannel channel, float tolerance, float* rangeMin, float* rangeStep, AnimationTrack& track, float& maxError)
+{
+	uint32_t frameCount = static_cast<uint32_t>(samples.size());
+	bool rotation = channel == kAnimationChannelRotation;
+
+	track.firstKey = static_cast<uint32_t>(keys.size());
+
+	for (int i = 0; i < 3; i++)
+	{
+		float low = samples[0][i];
+		float high = samples[0][i];
+
+		for (const glm::vec4& sample : samples)
+		{
+			low = std::min(low, sample[i]);
+			high = std::max(high, sample[i]);
+		}
+
+		rangeMin[i] = rotation ? 0.0f : low;
+		rangeStep[i] = rotation ? 0.0f : (high - low) / 65535.0f;
+	}
+
+	// every sample quantized up front, the fit only ever interpolates stored values
+	std::vector<AnimationKey> quantized(frameCount);
+	std::vector<glm::vec4> decoded(frameCount);
+
+	for (uint32_t i = 0; i < frameCount; i++)
+	{
+		quantized[i].frame = (uint16_t)i;
+
+		if (rotation)
+		{
+			quantizeRotation(samples[i], quantized[i].value);
+			decoded[i] = dequantizeRotation(quantized[i].value);
+		}
+		else
+		{
+			quantizeVector(samples[i], rangeMin, rangeStep, quantized[i].value);
+			decoded[i] = dequantizeVector(quantized[i].value, rangeMin, rangeStep);
+		}
+	}
+
+	auto getError = [&](uint32_t frame, uint32_t first, uint32_t last) -> float
+	{
+		float alpha = last > first ? (frame - first) / (float)(last - first) : 0.0f;
+
+		if (rotation)
+		{
+			return getRotationError(nlerpRotation(decoded[first], decoded[last], alpha), samples[frame]);
+		}
+		return glm::length(decoded[first] + (decoded[last] - decoded[first]) * alpha - samples[frame]);
+	};
+
+	std::vector<uint32_t> kept;
+	kept.push_back(0);
+
+	bool constant = true;
+	for (uint32_t frame = 1; frame < frameCount && constant; frame++)
+	{
+		constant = getError(frame, 0, 0) <= tolerance;
+	}
+
+	if (!constant)
+	{
+		// greedy, each segment grows until one of the samples it skips is off by more than tolerance
+		uint32_t start = 0;
+
+		for (uint32_t end = start + 2; end < frameCount; end++)
+		{
+			bool fits = true;
+			for (uint32_t frame = start + 1; frame < end && fits; frame++)
+			{
+				fits = getError(frame, start, end) <= tolerance;
+			}
+
+			if (!fits)
+			{
+				start = end - 1;
+				kept.push_back(start);
+			}
+		}
+
+		if (kept.back() != frameCount - 1)
+		{
+			kept.push_back(frameCount - 1);
+		}
+	}
+
+	// the error of what was kept, including the quantization of the keys
+	for (uint32_t k = 0; k < kept.size(); k++)
+	{
+		uint32_t first = kept[k];
+		uint32_t last = k + 1 < kept.size() ? kept[k + 1] : first;
+
+		for (uint32_t frame = first; frame <= (kept.size() == 1 ? frameCount - 1 : last); frame++)
+		{
+			maxError = std::max(maxError, getError(frame, first, last));
+		}
+	}
+
+	for (uint32_t key : kept)
+	{
+		keys.push_back(quantized[key]);
+	}
+
+	// sampling always reads a pair
+	if (kept.size() == 1)
+	{
+		keys.push_back(quantized[0]);
+	}
+
+	track.keyCount = static_cast<uint32_t>(kept.size());
+	fittedKeyCount += track.keyCount;
+}
+
+// -- Sampling
+
+#ifdef ANIMATION_CLIP_SSE2
+
+// key k and k + 1 of four tracks, transposed so every register holds one field of all four
+// frame, a, b, c of the first key then the same of the second
+static inline void loadKeyPairs(const AnimationKey* const pairs[4], __m128i fields[8])
+{
+	__m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pairs[0]));
+	__m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pairs[1]));
+	__m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pairs[2]));
+	__m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pairs[3]));
+
+	__m128i t0 = _mm_unpacklo_epi16(r0, r1);
+	__m128i t1 = _mm_unpacklo_epi16(r2, r3);
+	__m128i t2 = _mm_unpackhi_epi16(r0, r1);
+	__m128i t3 = _mm_unpackhi_epi16(r2, r3);
+
+	__m128i first0 = _mm_unpacklo_epi32(t0, t1);
+	__m128i first1 = _mm_unpackhi_epi32(t0, t1);
+	__m128i second0 = _mm_unpacklo_epi32(t2, t3);
+	__m128i second1 = _mm_unpackhi_epi32(t2, t3);
+
+	const __m128i zero = _mm_setzero_si128();
+	fields[0] = _mm_unpacklo_epi16(first0, zero);
+	fields[1] = _mm_unpackhi_epi16(first0, zero);
+	fields[2] = _mm_unpacklo_epi16(first1, zero);
+	fields[3] = _mm_unpackhi_epi16(first1, zero);
+	fields[4] = _mm_unpacklo_epi16(second0, zero);
+	fields[5] = _mm_unpackhi_epi16(second0, zero);
+	fields[6] = _mm_unpacklo_epi16(second1, zero);
+	fields[7] = _mm_unpackhi_epi16(second1, zero);
+}
+
+static inline __m128 select4(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// smallest three back to xyzw for four keys
+static inline void decodeRotations(__m128i a, __m128i b, __m128i c, float* x, float* y, float* z, float* w)
+{
+	__m128i largest = _mm_or_si128(_mm_srli_epi32(a, 15), _mm_slli_epi32(_mm_srli_epi32(b, 15), 1));
+
+	const __m128i valueMask = _mm_set1_epi32(0x7fff);
+	const __m128 scale = _mm_set1_ps(2.0f / 32767.0f * kSqrtHalf);
+	const __m128 offset = _mm_set1_ps(-kSqrtHalf);
+
+	__m128 fa = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(a, valueMask)), scale), offset);
+	__m128 fb = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(b, valueMask)), scale), offset);
+	__m128 fc = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(c, valueMask)), scale), offset);
+
+	__m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(fa, fa), _mm_mul_ps(fb, fb)), _mm_mul_ps(fc, fc));
+	__m128 fd = _mm_sqrt_ps(_mm_max_ps(_mm_setzero_ps(), _mm_sub_ps(_mm_set1_ps(1.0f), sum)));
+
+	__m128 is0 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_setzero_si128()));
+	__m128 is1 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_set1_epi32(1)));
+	__m128 is2 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_set1_epi32(2)));
+	__m128 is3 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_set1_epi32(3)));
+
+	_mm_storeu_ps(x, select4(is0, fd, fa));
+	_mm_storeu_ps(y, select4(is0, fa, select4(is1, fd, fb)));
+	_mm_storeu_ps(z, select4(_mm_or_ps(is0, is1), fb, select4(is2, fd, fc)));
+	_mm_storeu_ps(w, select4(is3, fd, fc));
+}
+
+static inline void decodeVectors(const __m128i* fields, const float (*rangeMin)[4], const float (*rangeStep)[4], float* x, float* y, float* z)
+{
+	_mm_storeu_ps(x, _mm_add_ps(_mm_loadu_ps(rangeMin[0]), _mm_mul_ps(_mm_cvtepi32_ps(fields[0]), _mm_loadu_ps(rangeStep[0]))));
+	_mm_storeu_ps(y, _mm_add_ps(_mm_loadu_ps(rangeMin[1]), _mm_mul_ps(_mm_cvtepi32_ps(fields[1]), _mm_loadu_ps(rangeStep[1]))));
+	_mm_storeu_ps(z, _mm_add_ps(_mm_loadu_ps(rangeMin[2]), _mm_mul_ps(_mm_cvtepi32_ps(fields[2]), _mm_loadu_ps(rangeStep[2]))));
+}
+
+// where frame sits between the two keys, a constant track's pair is zero frames long
+static inline void getAlpha(const __m128i* fields, __m128 frame, float* alpha)
+{
+	__m128 first = _mm_cvtepi32_ps(fields[0]);
+	__m128 length = _mm_max_ps(_mm_sub_ps(_mm_cvtepi32_ps(fields[4]), first), _mm_set1_ps(1.0f));
+	__m128 value = _mm_div_ps(_mm_sub_ps(frame, first), length);
+	_mm_storeu_ps(alpha, _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f)));
+}
+
+#else
+
+// one lane of the above, the key pair of a single track
+static inline void decodeKeyPair(const AnimationKey* pair, uint32_t channel, const AnimationRanges4& range, uint32_t lane, float frame, float* alpha, JointTransforms4& from, JointTransforms4& to)
+{
+	float first = pair[0].frame;
+	float length = std::max((float)pair[1].frame - first, 1.0f);
+	alpha[lane] = glm::clamp((frame - first) / length, 0.0f, 1.0f);
+
+	JointTransforms4* outputs[2] = { &from, &to };
+
+	for (int k = 0; k < 2; k++)
+	{
+		JointTransforms4& out = *outputs[k];
+		const uint16_t* value = pair[k].value;
+
+		if (channel == kAnimationChannelRotation)
+		{
+			glm::vec4 rotation = dequantizeRotation(value);
+			out.rotationX[lane] = rotation.x;
+			out.rotationY[lane] = rotation.y;
+			out.rotationZ[lane] = rotation.z;
+			out.rotationW[lane] = rotation.w;
+		}
+		else if (channel == kAnimationChannelTranslation)
+		{
+			out.translationX[lane] = range.translationMin[0][lane] + value[0] * range.translationStep[0][lane];
+			out.translationY[lane] = range.translationMin[1][lane] + value[1] * range.translationStep[1][lane];
+			out.translationZ[lane] = range.translationMin[2][lane] + value[2] * range.translationStep[2][lane];
+		}
+		else
+		{
+			out.scaleX[lane] = range.scaleMin[0][lane] + value[0] * range.scaleStep[0][lane];
+			out.scaleY[lane] = range.scaleMin[1][lane] + value[1] * range.scaleStep[1][lane];
+			out.scaleZ[lane] = range.scaleMin[2][lane] + value[2] * range.scaleStep[2][lane];
+		}
+	}
+}
+
+#endif
+
+void AnimationClip::sample(float time, AnimationCursor& cursor, Pose& pose, uint32_t jointLimit) const
+{
+	if (pose.jointCount != jointCount)
+	{
+		pose.resize(jointCount);
+	}
+
+	if (cursor.keys.size() != tracks.size())
+	{
+		cursor.keys.assign(tracks.size(), 0);
+		cursor.frame = 0.0f;
+	}
+
+	float frame = 0.0f;
+	if (duration > 0.0f)
+	{
+		frame = std::fmod(time, duration);
+		frame = (frame < 0.0f ? frame + duration : frame) * sampleRate;
+	}
+
+	// looped or jumped back, the cursors only ever move forward
+	if (frame < cursor.frame)
+	{
+		std::fill(cursor.keys.begin(), cursor.keys.end(), 0);
+	}
+	cursor.frame = frame;
+
+#ifdef ANIMATION_CLIP_SSE2
+	__m128 frames = _mm_set1_ps(frame);
+#endif
+
+	JointTransforms4 from, to;
+	float alpha[kAnimationChannelCount][4];
+
+	size_t groupCount = std::min<size_t>(pose.groups.size(), (std::min(jointLimit, jointCount) + 3) / 4);
+
+	for (size_t group = 0; group < groupCount; group++)
+	{
+		const AnimationRanges4& range = ranges[group];
+
+		for (uint32_t channel = 0; channel < kAnimationChannelCount; channel++)
+		{
+			const AnimationKey* pairs[4];
+
+			for (uint32_t lane = 0; lane < 4; lane++)
+			{
+				uint32_t trackIndex = (uint32_t)(group * 4 + lane) * kAnimationChannelCount + channel;
+				const AnimationTrack& track = tracks[trackIndex];
+				const AnimationKey* trackKeys = &keys[track.firstKey];
+
+				uint32_t key = cursor.keys[trackIndex];
+				while (key + 2 < track.keyCount && trackKeys[key + 1].frame <= frame)
+				{
+					key++;
+				}
+				cursor.keys[trackIndex] = key;
+
+				pairs[lane] = trackKeys + key;
+			}
+
+#ifdef ANIMATION_CLIP_SSE2
+			__m128i fields[8];
+			loadKeyPairs(pairs, fields);
+			getAlpha(fields, frames, alpha[channel]);
+
+			switch (channel)
+			{
+			case kAnimationChannelRotation:
+				decodeRotations(fields[1], fields[2], fields[3], from.rotationX, from.rotationY, from.rotationZ, from.rotationW);
+				decodeRotations(fields[5], fields[6], fields[7], to.rotationX, to.rotationY, to.rotationZ, to.rotationW);
+				break;
+			case kAnimationChannelTranslation:
+				decodeVectors(fields + 1, range.translationMin, range.translationStep, from.translationX, from.translationY, from.translationZ);
+				decodeVectors(fields + 5, range.translationMin, range.translationStep, to.translationX, to.translationY, to.translationZ);
+				break;
+			case kAnimationChannelScale:
+				decodeVectors(fields + 1, range.scaleMin, range.scaleStep, from.scaleX, from.scaleY, from.scaleZ);
+				decodeVectors(fields + 5, range.scaleMin, range.scaleStep, to.scaleX, to.scaleY, to.scaleZ);
+				break;
+			}
+#else
+			for (uint32_t lane = 0; lane < 4; lane++)
+			{
+				decodeKeyPair(pairs[lane], channel, range, lane, frame, alpha[channel], from, to);
+			}
+#endif
+		}
+
+		PoseBlending::nlerpGroup(from, to, alpha[kAnimationChannelRotation], alpha[kAnimationChannelTranslation], alpha[kAnimationChannelScale], pose.groups[group]);
+	}
+}
+
+size_t AnimationClip::getCompressedSize() const
+{
+	return tracks.size() * sizeof(AnimationTrack) + keys.size() * sizeof(AnimationKey) + ranges.size() * sizeof(AnimationRanges4);
+}
+
+// -- Benchmark
+
+void AnimationClip::benchmark()
+{
+	const uint32_t kJointCount = 60;
+	const uint32_t kCharacterCount = 1000;
+	const uint32_t kFrameCount = 61;
+	const float kSampleRate = 30.0f;
+	const float kBudgetMs = 1.0f;
+
+	// a random tree, listed children first so create() has to do the flattening
+	uint32_t seed = 12345;
+	auto random = [&]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+
+	std::vector<int32_t> treeParents(kJointCount, -1);
+	for (uint32_t i = 1; i < kJointCount; i++)
+	{
+		// mostly chains, like limbs and fingers
+		treeParents[i] = random() < 0.7f ? (int32_t)i - 1 : (int32_t)(random() * i);
+	}
+
+	std::vector<JointDesc> joints(kJointCount);
+	for (uint32_t i = 0; i < kJointCount; i++)
+	{
+		uint32_t source = kJointCount - 1 - i;
+		JointDesc& joint = joints[source];
+		joint.name = "joint" + std::to_string(i);
+		joint.parent = treeParents[i] < 0 ? -1 : (int32_t)(kJointCount - 1 - treeParents[i]);
+		joint.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		joint.translation = glm::vec3(0.0f, 0.1f, 0.0f);
+		joint.scale = glm::vec3(1.0f);
+		joint.inverseBind = glm::mat4(1.0f);
+	}
+
+	Skeleton skeleton;
+	skeleton.create(joints);
+
+	// swinging joints, a few of them still, the root walking along z
+	auto makeClip = [&](float speed) -> RawAnimationClip
+	{
+		RawAnimationClip raw;
+		raw.sampleRate = kSampleRate;
+		raw.frameCount = kFrameCount;
+		raw.joints.resize(kJointCount);
+
+		for (uint32_t j = 0; j < kJointCount; j++)
+		{
+			glm::vec3 axis = glm::normalize(glm::vec3(random() - 0.5f, random() - 0.5f, random() - 0.5f));
+			float amplitude = j % 7 == 3 ? 0.0f : 0.2f + random() * 0.6f;
+			float phase = random() * 6.28318f;
+
+			for (uint32_t f = 0; f < kFrameCount; f++)
+			{
+				// whole cycles over the clip so it loops
+				float t = f / (float)(kFrameCount - 1) * 6.28318f;
+				float angle = amplitude * std::sin(t * speed + phase);
+
+				raw.joints[j].rotations.push_back(glm::angleAxis(angle, axis));
+				raw.joints[j].translations.push_back(j == 0 ? glm::vec3(0.0f, 0.05f * std::sin(2.0f * t), 1.5f * speed * f / (float)(kFrameCount - 1)) : glm::vec3(0.0f, 0.1f, 0.0f));
+				raw.joints[j].scales.push_back(glm::vec3(1.0f));
+			}
+		}
+
+		return raw;
+	};
+
+	AnimationCompressionSettings settings;
+	AnimationClip walk, run;
+	walk.build(skeleton, makeClip(1.0f), settings);
+	run.build(skeleton, makeClip(2.0f), settings);
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "AnimationClip: " << kJointCount << " joints, " << kFrameCount << " frames, "
+		<< walk.rawSize / 1024.0 << " KB -> " << walk.getCompressedSize() / 1024.0 << " KB (" << (double)walk.rawSize / walk.getCompressedSize() << "x), "
+		<< walk.fittedKeyCount << " keys of " << kJointCount * kFrameCount * 3 << ", "
+		<< std::setprecision(4) << "max error " << walk.maxRotationError * 57.29578f << " deg, " << walk.maxTranslationError << " units" << std::endl;
+
+	struct Character
+	{
+		AnimationCursor walkCursor;
+		AnimationCursor runCursor;
+		Pose walkPose;
+		Pose runPose;
+		Pose pose;
+		std::vector<glm::mat4> model;
+		std::vector<glm::mat4> skinning;
+		float phase;
+		float blend;
+	};
+
+	std::vector<Character> characters(kCharacterCount);
+	for (Character& character : characters)
+	{
+		character.phase = random() * walk.duration;
+		character.blend = random();
+	}
+
+	// small jobs, the work per character is the same so the queue overhead is what matters
+	const uint32_t kCharactersPerJob = 25;
+
+	auto runFrames = [&](uint32_t threadCount, float& time) -> double
+	{
+		const int kFrames = 60;
+		double best = 1e30;
+
+		for (int frame = 0; frame < kFrames; frame++)
+		{
+			time += 1.0f / 60.0f;
+			auto start = std::chrono::high_resolution_clock::now();
+
+			parallelFor(kCharacterCount / kCharactersPerJob, [&](uint32_t job)
+			{
+				for (uint32_t i = job * kCharactersPerJob; i < (job + 1) * kCharactersPerJob; i++)
+				{
+					Character& character = characters[i];
+
+					walk.sample(time + character.phase, character.walkCursor, character.walkPose);
+					run.sample(time + character.phase, character.runCursor, character.runPose);
+					PoseBlending::slerp(character.walkPose, character.runPose, character.blend, character.pose);
+					PoseBlending::localToModel(skeleton, character.pose, character.model);
+					PoseBlending::getSkinningMatrices(skeleton, character.model, character.skinning);
+				}
+			}, threadCount);
+
+			best = std::min(best, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+		}
+
+		return best * 1000.0;
+	};
+
+	float time = 0.0f;
+	double singleMs = runFrames(1, time);
+	double parallelMs = runFrames(0, time);
+
+	std::cout << std::fixed << std::setprecision(3)
+		<< "Animation: " << kCharacterCount << " characters x " << kJointCount << " joints, "
+		<< "1 thread " << singleMs << " ms, " << getWorkerThreadCount() << " threads " << parallelMs << " ms per frame, "
+		<< "budget " << kBudgetMs << " ms " << (parallelMs <= kBudgetMs ? "met" : "missed") << ", "
+		<< std::setprecision(1) << singleMs * 1e6 / (kCharacterCount * kJointCount) << " ns per joint" << std::endl;
+}
\ No newline at end of file
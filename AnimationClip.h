@@ -0,0 +1,113 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "Skeleton.h"
+
+// one joint sampled at the clip's rate, as it comes out of an exporter
+struct RawJointTrack
+{
+	std::vector<glm::quat> rotations;
+	std::vector<glm::vec3> translations;
+	std::vector<glm::vec3> scales;
+};
+
+// joints in the order they were given to Skeleton::create, frameCount samples each
+// the last frame is the end of the clip, a looping clip repeats its first frame there
+struct RawAnimationClip
+{
+	float sampleRate;
+	uint32_t frameCount;
+	std::vector<RawJointTrack> joints;
+};
+
+// how far the compressed clip may drift from the raw samples
+struct AnimationCompressionSettings
+{
+	float rotationTolerance = 0.0005f;		// radians
+	float translationTolerance = 0.0001f;	// model units
+	float scaleTolerance = 0.0001f;
+};
+
+enum AnimationChannel
+{
+	kAnimationChannelRotation = 0,
+	kAnimationChannelTranslation = 1,
+	kAnimationChannelScale = 2,
+	kAnimationChannelCount = 3
+};
+
+// a key and the one after it are read with a single 16 byte load
+struct AnimationKey
+{
+	uint16_t frame;
+	uint16_t value[3];
+};
+
+struct AnimationTrack
+{
+	uint32_t firstKey;
+	uint32_t keyCount;	// a constant track stores its key twice but counts it once
+};
+
+// translation and scale keys are 16 bit steps up from a per track minimum, [component][lane]
+struct AnimationRanges4
+{
+	float translationMin[3][4];
+	float translationStep[3][4];
+	float scaleMin[3][4];
+	float scaleStep[3][4];
+};
+
+// playback state of one instance of a clip, the clip itself is shared and stays in cache
+// every track remembers its last key, playing forward never searches
+struct AnimationCursor
+{
+	std::vector<uint32_t> keys;
+	float frame = 0.0f;
+};
+
+// -- Animation clip
+// Compressed in two steps:
+//	- curve fitting: a track keeps only the keys that linear interpolation ( nlerp for rotations )
+//	  can't rebuild the dropped samples from within tolerance, a track that doesn't move keeps one key
+//	- quantization: rotations as the smallest three components in 15 bits each with the index of
+//	  the dropped one in the spare bits, translations and scales as 16 bits of the track's range
+// The fit runs against quantized keys, so the tolerance holds for what is actually stored.
+// Sampling works on four joints at a time like Pose, keys are transposed, decoded and blended with SSE.
+class AnimationClip
+{
+public:
+	AnimationClip();
+	~AnimationClip();
+
+	float duration;
+	float sampleRate;
+	uint32_t jointCount;
+
+	// joint * kAnimationChannelCount + channel, joints in skeleton order
+	// padded to whole groups of four with still identity tracks
+	std::vector<AnimationTrack> tracks;
+	std::vector<AnimationKey> keys;
+	std::vector<AnimationRanges4> ranges;
+	uint32_t fittedKeyCount;	// without the second copies of constant keys
+
+	// what the fit measured against the raw samples
+	float maxRotationError;
+	float maxTranslationError;
+	size_t rawSize;
+
+	void build(const Skeleton& skeleton, const RawAnimationClip& raw, const AnimationCompressionSettings& settings);
+
+	// time wraps around duration, poses of the skeleton the clip was built for
+	// only the groups holding the first jointLimit joints are written, the rest of pose is left alone
+	void sample(float time, AnimationCursor& cursor, Pose& pose, uint32_t jointLimit = UINT32_MAX) const;
+
+	size_t getCompressedSize() const;
+
+	// 1000 characters of 60 joints: two clips sampled, blended and turned into skinning matrices per character
+	static void benchmark();
+
+private:
+	void fitTrack(const std::vector<glm::vec4>& samples, AnimationChannel channel, float tolerance, float* rangeMin, float* rangeStep, AnimationTrack& track, float& maxError);
+};
\ No newline at end of file
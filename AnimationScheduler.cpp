@@ -0,0 +1,407 @@
+#include "AnimationScheduler.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ANIMATION_SCHEDULER_SSE2
+#include <emmintrin.h>
+#endif
+
+AnimationScheduler::AnimationScheduler()
+	: msPerFullJoint(0.0), evaluateMs(0.0), fullEvaluateMs(0.0), fullEvaluateJoints(0), finishedJoints(0)
+{
+	// full rate up close, then fewer updates, then fingers and face joints drop out
+	levels.push_back({ 250.0f, 1, UINT32_MAX });
+	levels.push_back({ 100.0f, 2, UINT32_MAX });
+	levels.push_back({ 40.0f, 4, 4 });
+	levels.push_back({ 0.0f, 8, 2 });
+}
+
+AnimationScheduler::~AnimationScheduler()
+{ }
+
+uint32_t AnimationScheduler::addCharacter(const Skeleton* skeleton, const AnimationClip* clip, float startTime, float playbackRate)
+{
+	Character character;
+	character.skeleton = skeleton;
+	character.clip = clip;
+	character.time = startTime;
+	character.playbackRate = playbackRate;
+	character.boundingSphere = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	// the bind pose until the first evaluation
+	character.pose = skeleton->bindPose;
+	character.skinning.assign(skeleton->getJointCount(), glm::mat4(1.0f));
+	character.previousTime = startTime;
+	character.nextTime = startTime;
+
+	character.lod = 0;
+	character.framesUntilUpdate = 0;
+	character.valid = false;
+
+	characters.push_back(character);
+	return static_cast<uint32_t>(characters.size() - 1);
+}
+
+void AnimationScheduler::setClip(uint32_t characterId, const AnimationClip* clip, float startTime)
+{
+	Character& character = characters[characterId];
+	character.clip = clip;
+	character.time = startTime;
+	character.cursor = AnimationCursor();
+
+	// the next update samples right away instead of blending into the old clip's target
+	character.valid = false;
+	character.framesUntilUpdate = 0;
+}
+
+void AnimationScheduler::setBounds(uint32_t characterId, glm::vec4 worldBoundingSphere)
+{
+	characters[characterId].boundingSphere = worldBoundingSphere;
+}
+
+uint32_t AnimationScheduler::selectLod(const Character& character, Camera& camera, const glm::vec4 planes[6], float viewportHeight)
+{
+	glm::vec3 center = glm::vec3(character.boundingSphere);
+	float radius = character.boundingSphere.w;
+
+	for (int p = 0; p < 6; p++)
+	{
+		if (glm::dot(glm::vec3(planes[p]), center) + planes[p].w < -radius)
+		{
+			return UINT32_MAX;
+		}
+	}
+
+	// projected diameter in pixels, proj[1][1] is 1 / tan(fov / 2)
+	float distance = std::max(-(camera.getViewMatrix() * glm::vec4(center, 1.0f)).z, 1e-3f);
+	float screenHeight = radius * camera.getprojectionMatrix()[1][1] / distance * viewportHeight;
+
+	for (uint32_t i = 0; i < levels.size(); i++)
+	{
+		if (screenHeight >= levels[i].minScreenHeight)
+		{
+			return i;
+		}
+	}
+
+	return static_cast<uint32_t>(levels.size() - 1);
+}
+
+// the clip at time into skinning matrices, joints the level leaves out keep the bind pose
+void AnimationScheduler::samplePose(Character& character, float time, uint32_t jointLimit, std::vector<glm::mat4>& skinning)
+{
+	const Skeleton& skeleton = *character.skeleton;
+
+	character.clip->sample(time, character.cursor, character.pose, jointLimit);
+
+	for (size_t group = (jointLimit + 3) / 4; group < character.pose.groups.size(); group++)
+	{
+		character.pose.groups[group] = skeleton.bindPose.groups[group];
+	}
+
+	PoseBlending::localToModel(skeleton, character.pose, model);
+	PoseBlending::getSkinningMatrices(skeleton, model, skinning);
+
+	stats.jointsSampled += jointLimit;
+	finishedJoints += skeleton.getJointCount();
+}
+
+void AnimationScheduler::evaluate(Character& character, const AnimationLodLevel& level, float deltaTime)
+{
+	const Skeleton& skeleton = *character.skeleton;
+	uint32_t jointLimit = std::min(skeleton.getJointCountToDepth(level.maxJointDepth), skeleton.getJointCount());
+	float step = deltaTime * character.playbackRate;
+
+	if (!character.valid || level.updateInterval <= 1)
+	{
+		// nothing to blend from, this frame's pose as it is
+		samplePose(character, character.time, jointLimit, character.skinning);
+		character.previousSkinning = character.skinning;
+		character.previousTime = character.time;
+	}
+	else
+	{
+		// blend on from what was on screen last frame
+		character.previousSkinning.swap(character.skinning);
+		character.previousTime = character.time - step;
+	}
+
+	character.nextTime = character.previousTime;
+
+	// the pose at the last frame before the next evaluation
+	if (character.framesUntilUpdate > 0)
+	{
+		character.nextTime = character.time + step * character.framesUntilUpdate;
+		samplePose(character, character.nextTime, jointLimit, character.nextSkinning);
+	}
+
+	character.valid = true;
+}
+
+// out = a + (b - a) * weight, four floats at a time
+static void lerpMatrices(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& b, float weight, std::vector<glm::mat4>& out)
+{
+	out.resize(a.size());
+
+	const float* pa = &a[0][0][0];
+	const float* pb = &b[0][0][0];
+	float* po = &out[0][0][0];
+
+#ifdef ANIMATION_SCHEDULER_SSE2
+	__m128 w = _mm_set1_ps(weight);
+
+	for (size_t i = 0; i < a.size() * 16; i += 4)
+	{
+		__m128 va = _mm_loadu_ps(pa + i);
+		__m128 vb = _mm_loadu_ps(pb + i);
+		_mm_storeu_ps(po + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), w)));
+	}
+#else
+	for (size_t i = 0; i < a.size() * 16; i++)
+	{
+		po[i] = pa[i] + (pb[i] - pa[i]) * weight;
+	}
+#endif
+}
+
+void AnimationScheduler::update(Camera camera, float viewportHeight, float deltaTime)
+{
+	auto updateStart = std::chrono::high_resolution_clock::now();
+
+	stats = {};
+	evaluateMs = 0.0;
+	fullEvaluateMs = 0.0;
+	fullEvaluateJoints = 0;
+	finishedJoints = 0;
+
+	glm::vec4 planes[6];
+	camera.getFrustumPlanes(planes);
+
+	uint64_t visibleJoints = 0;
+	double blendMs = 0.0;
+
+	for (uint32_t i = 0; i < characters.size(); i++)
+	{
+		Character& character = characters[i];
+		character.time += deltaTime * character.playbackRate;
+
+		uint32_t lod = selectLod(character, camera, planes, viewportHeight);
+
+		// the clock keeps going, the pose is resampled when it's back in view
+		if (lod == UINT32_MAX)
+		{
+			character.valid = false;
+			character.framesUntilUpdate = 0;
+			stats.offscreen++;
+			continue;
+		}
+
+		visibleJoints += character.skeleton->getJointCount();
+
+		const AnimationLodLevel& level = levels[lod];
+		uint32_t interval = std::max(level.updateInterval, 1u);
+
+		// a finer level never waits longer than its own interval
+		character.lod = lod;
+		character.framesUntilUpdate = std::min(character.framesUntilUpdate, interval - 1);
+		stats.charactersPerLod[std::min(lod, 3u)]++;
+
+		if (!character.valid || character.framesUntilUpdate == 0)
+		{
+			// staggered by index, characters on the same interval take turns
+			character.framesUntilUpdate = character.valid ? interval - 1 : i % interval;
+
+			auto start = std::chrono::high_resolution_clock::now();
+
+			evaluate(character, level, deltaTime);
+			stats.evaluated++;
+
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			evaluateMs += ms;
+
+			// only an every frame, every joint evaluation costs what full rate pays for one
+			const Skeleton& skeleton = *character.skeleton;
+			if (interval == 1 && skeleton.getJointCountToDepth(level.maxJointDepth) >= skeleton.getJointCount())
+			{
+				fullEvaluateMs += ms;
+				fullEvaluateJoints += skeleton.getJointCount();
+			}
+		}
+		else
+		{
+			character.framesUntilUpdate--;
+			stats.interpolated++;
+		}
+
+		// this frame's point between the two evaluations
+		if (character.nextTime > character.previousTime)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+
+			float alpha = std::min((character.time - character.previousTime) / (character.nextTime - character.previousTime), 1.0f);
+			lerpMatrices(character.previousSkinning, character.nextSkinning, alpha, character.skinning);
+
+			blendMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+	}
+
+	// running average, a frame with few full evaluations would swing it otherwise
+	if (fullEvaluateJoints > 0)
+	{
+		double frameMs = fullEvaluateMs / fullEvaluateJoints;
+		msPerFullJoint = msPerFullJoint > 0.0 ? msPerFullJoint * 0.9 + frameMs * 0.1 : frameMs;
+	}
+
+	// until some character is close enough for a full evaluation, the partial ones are all there is
+	double msPerJoint = msPerFullJoint > 0.0 ? msPerFullJoint : (finishedJoints > 0 ? evaluateMs / finishedJoints : 0.0);
+
+	stats.characters = static_cast<uint32_t>(characters.size());
+	stats.updateMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - updateStart).count();
+
+	// full rate keeps the lod selection and bookkeeping, drops the blends and evaluates every visible joint every frame
+	double overheadMs = std::max(stats.updateMs - evaluateMs - blendMs, 0.0);
+	stats.fullRateMs = overheadMs + msPerJoint * (double)visibleJoints;
+	stats.savedMs = std::max(stats.fullRateMs - stats.updateMs, 0.0);
+}
+
+void AnimationScheduler::benchmark()
+{
+	const uint32_t kCharacterCount = 1000;
+	const uint32_t kJointCount = 60;
+	const uint32_t kFrameCount = 61;
+	const int kFrames = 120;
+	const float kViewportHeight = 720.0f;
+
+	uint32_t seed = 4321;
+	auto random = [&]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+
+	// mostly chains, like AnimationClip::benchmark
+	std::vector<JointDesc> joints(kJointCount);
+	for (uint32_t i = 0; i < kJointCount; i++)
+	{
+		joints[i].name = "joint" + std::to_string(i);
+		joints[i].parent = i == 0 ? -1 : (random() < 0.7f ? (int32_t)i - 1 : (int32_t)(random() * i));
+		joints[i].rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		joints[i].translation = glm::vec3(0.0f, 0.1f, 0.0f);
+		joints[i].scale = glm::vec3(1.0f);
+		joints[i].inverseBind = glm::mat4(1.0f);
+	}
+
+	Skeleton skeleton;
+	skeleton.create(joints);
+
+	RawAnimationClip raw;
+	raw.sampleRate = 30.0f;
+	raw.frameCount = kFrameCount;
+	raw.joints.resize(kJointCount);
+
+	for (uint32_t j = 0; j < kJointCount; j++)
+	{
+		glm::vec3 axis = glm::normalize(glm::vec3(random() - 0.5f, random() - 0.5f, random() - 0.5f));
+		float phase = random() * 6.28318f;
+
+		for (uint32_t f = 0; f < kFrameCount; f++)
+		{
+			float t = f / (float)(kFrameCount - 1) * 6.28318f;
+			raw.joints[j].rotations.push_back(glm::angleAxis(0.5f * std::sin(t + phase), axis));
+			raw.joints[j].translations.push_back(glm::vec3(0.0f, 0.1f, 0.0f));
+			raw.joints[j].scales.push_back(glm::vec3(1.0f));
+		}
+	}
+
+	AnimationClip clip;
+	clip.build(skeleton, raw, AnimationCompressionSettings());
+
+	Camera camera;
+	camera.init(glm::radians(45.0f), 1280.0f, kViewportHeight, 0.1f, 1000.0f);
+
+	// a crowd in front of the camera, denser close up like a street seen from eye height
+	std::vector<glm::vec4> bounds(kCharacterCount);
+	std::vector<float> startTimes(kCharacterCount);
+	for (uint32_t i = 0; i < kCharacterCount; i++)
+	{
+		float distance = 4.0f + 250.0f * random() * random();
+		float side = (random() - 0.5f) * distance * 0.7f;
+		bounds[i] = glm::vec4(side, 0.0f, 4.0f - distance, 1.0f);
+		startTimes[i] = random() * clip.duration;
+	}
+
+	auto run = [&](const std::vector<AnimationLodLevel>& levels, AnimationSchedulerStats& average) -> double
+	{
+		AnimationScheduler scheduler;
+		scheduler.levels = levels;
+
+		for (uint32_t i = 0; i < kCharacterCount; i++)
+		{
+			scheduler.addCharacter(&skeleton, &clip, startTimes[i]);
+			scheduler.setBounds(i, bounds[i]);
+		}
+
+		average = {};
+		double totalMs = 0.0;
+
+		for (int frame = 0; frame < kFrames; frame++)
+		{
+			scheduler.update(camera, kViewportHeight, 1.0f / 60.0f);
+
+			// the first frames sample everyone, they aren't what the steady state costs
+			if (frame < kFrames / 2)
+			{
+				continue;
+			}
+
+			AnimationSchedulerStats stats = scheduler.getStats();
+			average.evaluated += stats.evaluated;
+			average.interpolated += stats.interpolated;
+			average.offscreen += stats.offscreen;
+			for (int l = 0; l < 4; l++)
+			{
+				average.charactersPerLod[l] += stats.charactersPerLod[l];
+			}
+			average.updateMs += stats.updateMs;
+			average.fullRateMs += stats.fullRateMs;
+			average.savedMs += stats.savedMs;
+			totalMs += stats.updateMs;
+		}
+
+		return totalMs / (kFrames / 2);
+	};
+
+	// alternated and the fastest of each kept, so a noisy moment doesn't land on only one side
+	AnimationSchedulerStats fullStats, lodStats;
+	double fullMs = std::numeric_limits<double>::max();
+	double lodMs = std::numeric_limits<double>::max();
+
+	for (int repeat = 0; repeat < 3; repeat++)
+	{
+		AnimationSchedulerStats stats;
+
+		fullMs = std::min(fullMs, run({ { 0.0f, 1, UINT32_MAX } }, fullStats));
+
+		double ms = run(AnimationScheduler().levels, stats);
+		if (ms < lodMs)
+		{
+			lodMs = ms;
+			lodStats = stats;
+		}
+	}
+
+	uint32_t frames = kFrames / 2;
+
+	// the stat only sees the scheduled run, how far its full rate guess is from the real one
+	double estimateError = (lodStats.fullRateMs / frames - fullMs) / fullMs * 100.0;
+
+	std::cout << std::fixed << std::setprecision(3)
+		<< "AnimationScheduler: " << kCharacterCount << " characters x " << kJointCount << " joints, lods "
+		<< lodStats.charactersPerLod[0] / frames << "/" << lodStats.charactersPerLod[1] / frames << "/"
+		<< lodStats.charactersPerLod[2] / frames << "/" << lodStats.charactersPerLod[3] / frames << ", "
+		<< lodStats.evaluated / frames << " evaluated " << lodStats.interpolated / frames << " interpolated per frame, "
+		<< "full rate " << fullMs << " ms, scheduled " << lodMs << " ms, saved " << fullMs - lodMs << " ms, "
+		<< "stat says " << lodStats.savedMs / frames << " ms saved of " << lodStats.fullRateMs / frames << " ms"
+		<< std::setprecision(1) << " (" << estimateError << "% off)" << std::endl;
+}
\ No newline at end of file
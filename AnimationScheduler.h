@@ -0,0 +1,109 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "AnimationClip.h"
+#include "Camera.h"
+
+// one step of animation LOD, picked by how tall the character is on screen
+struct AnimationLodLevel
+{
+	float minScreenHeight;	// pixels, the first level the character reaches is used
+	uint32_t updateInterval;	// frames between evaluations, interpolated in between
+	uint32_t maxJointDepth;		// joints deeper than this hold their bind pose
+};
+
+struct AnimationSchedulerStats
+{
+	uint32_t characters;
+	uint32_t evaluated;			// clip sampled this frame
+	uint32_t interpolated;		// blended between two evaluations
+	uint32_t offscreen;			// only their clock moved
+	uint32_t jointsSampled;
+	uint32_t charactersPerLod[4];
+
+	// the whole of update measured this frame, and what it would have been with every visible
+	// character evaluated with all its joints, the same per character overhead plus the measured
+	// cost per joint of evaluations that had all of them
+	double updateMs;
+	double fullRateMs;
+	double savedMs;
+};
+
+// -- Animation scheduler
+// Small and distant characters are evaluated less often and with fewer joints. Evaluations are
+// staggered so characters on the same interval don't all land on the same frame.
+// An evaluation samples the clip where the character will be at its next evaluation and builds
+// its skinning matrices, the frames until then lerp the matrices towards those, so nothing lags
+// behind the clip and a frame in between costs a blend of 12 floats per joint. Lerped rotations
+// shrink a little halfway between very different poses, which the long intervals only get on
+// characters too small to show it.
+class AnimationScheduler
+{
+public:
+	AnimationScheduler();
+	~AnimationScheduler();
+
+	// ordered from the largest minScreenHeight down, defaults are set by the constructor
+	std::vector<AnimationLodLevel> levels;
+
+	uint32_t addCharacter(const Skeleton* skeleton, const AnimationClip* clip, float startTime, float playbackRate = 1.0f);
+	void setClip(uint32_t characterId, const AnimationClip* clip, float startTime);
+
+	// world space center xyz and radius w
+	void setBounds(uint32_t characterId, glm::vec4 worldBoundingSphere);
+
+	void update(Camera camera, float viewportHeight, float deltaTime);
+
+	// model * inverse bind of every joint, what GpuSkinning::setPose takes
+	const std::vector<glm::mat4>& getSkinningMatrices(uint32_t characterId) const { return characters[characterId].skinning; }
+	uint32_t getLod(uint32_t characterId) const { return characters[characterId].lod; }
+
+	AnimationSchedulerStats getStats() { return stats; }
+
+	// 1000 characters of 60 joints spread out in front of the camera
+	static void benchmark();
+
+private:
+	struct Character
+	{
+		const Skeleton* skeleton;
+		const AnimationClip* clip;
+		float time;
+		float playbackRate;
+		glm::vec4 boundingSphere;
+
+		AnimationCursor cursor;
+		Pose pose;
+
+		// what is shown blends from previous to next as time goes from previousTime to nextTime
+		std::vector<glm::mat4> previousSkinning;
+		std::vector<glm::mat4> nextSkinning;
+		std::vector<glm::mat4> skinning;
+		float previousTime;
+		float nextTime;
+
+		uint32_t lod;
+		uint32_t framesUntilUpdate;
+		bool valid;
+	};
+
+	std::vector<Character> characters;
+	AnimationSchedulerStats stats = {};
+
+	// scratch for localToModel
+	std::vector<glm::mat4> model;
+
+	// running average of what a joint costs in an every frame evaluation of all joints, what full rate does
+	double msPerFullJoint;
+
+	// this frame's evaluate timings, and the joints samplePose finished
+	double evaluateMs;
+	double fullEvaluateMs;
+	uint64_t fullEvaluateJoints;
+	uint64_t finishedJoints;
+
+	uint32_t selectLod(const Character& character, Camera& camera, const glm::vec4 planes[6], float viewportHeight);
+	void evaluate(Character& character, const AnimationLodLevel& level, float deltaTime);
+	void samplePose(Character& character, float time, uint32_t jointLimit, std::vector<glm::mat4>& skinning);
+};
\ No newline at end of file
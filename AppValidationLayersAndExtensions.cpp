@@ -44,15 +44,19 @@ bool AppValidationLayersAndExtensions::checkValidationLayerSupport()
 	return true;
 }
 
-std::vector<const char*> AppValidationLayersAndExtensions::getRequiredExtensions(bool isValidationLayersEnabled)
+std::vector<const char*> AppValidationLayersAndExtensions::getRequiredExtensions(bool isValidationLayersEnabled, bool windowed)
 {
-	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions;
+	std::vector<const char*> extensions;
 
-	// get extensions
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-	auto a = glfwExtensions + glfwExtensionCount;
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);  // ? (const char**) as result ? address offset
+	if (windowed)
+	{
+		uint32_t glfwExtensionCount = 0;
+		const char** glfwExtensions;
+
+		// get extensions
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);  // ? (const char**) as result ? address offset
+	}
 
 	// debug report extension is added.
 	if (isValidationLayersEnabled)
@@ -68,6 +72,11 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugReportFlagsEXT flags,
 {
 	std::cerr << "validation layer: " << msg << std::endl;
 
+	if (flags & VK_DEBUG_REPORT_ERROR_BIT_EXT)
+	{
+		static_cast<AppValidationLayersAndExtensions*>(userData)->errorCount++;
+	}
+
 	return false;
 }
 
@@ -83,6 +92,7 @@ void AppValidationLayersAndExtensions::setupDebugCallback(bool isValidationLayer
 	info.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CALLBACK_CREATE_INFO_EXT;
 	info.flags = VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT;
 	info.pfnCallback = debugCallback;
+	info.pUserData = this;
 
 	// vulkan will take care of memory allocation by itself.
 	if (createDebugReportCallbackEXT(instance,   &info, nullptr, &callback) != VK_SUCCESS)
@@ -18,13 +18,18 @@ public:
 	};
 
 	bool checkValidationLayerSupport();
-	std::vector<const char*> getRequiredExtensions(bool isValidationLayersEnabled);
+	// headless instances present nothing and skip the glfw surface extensions
+	std::vector<const char*> getRequiredExtensions(bool isValidationLayersEnabled, bool windowed = true);
 
 	// debug callback
 	VkDebugReportCallbackEXT callback;
 	void setupDebugCallback(bool isValidationLayersEnabled, VkInstance instance);
 	void destroy(VkInstance instance, bool isValidationLayersEnabled);
 
+	// errors reported through the callback so far, checked by tests running under validation
+	uint32_t getErrorCount() { return errorCount; }
+	uint32_t errorCount = 0;
+
 	// callback
 	VkResult createDebugReportCallbackEXT(VkInstance instance, const VkDebugReportCallbackCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugReportCallbackEXT* pCallback)
 	{
@@ -0,0 +1,210 @@
+#include "BindlessResources.h"
+#include <array>
+#include <algorithm>
+#include "VulkanContext.h"
+#include "Texture.h"
+
+BindlessResources::BindlessResources()
+	: descriptorSetLayout(VK_NULL_HANDLE), descriptorPool(VK_NULL_HANDLE), descriptorSet(VK_NULL_HANDLE),
+	maxTextures(0), maxBuffers(0), textureCount(0), bufferCount(0)
+{ }
+
+BindlessResources::~BindlessResources()
+{ }
+
+void BindlessResources::create(uint32_t _maxTextures, uint32_t _maxBuffers)
+{
+	Device* device = VulkanContext::getInstance()->getDevice();
+
+	if (!device->isBindlessSupported())
+	{
+		throw std::runtime_error("bindless resources need VK_EXT_descriptor_indexing!");
+	}
+
+	// update after bind sets have their own limits, usually far above the classic ones
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = {};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+	VkPhysicalDeviceProperties2 properties2 = {};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &indexingProperties;
+	device->getPhysicalDeviceProperties2(device->physicalDevice, &properties2);
+
+	maxTextures = std::min(_maxTextures, std::min(indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages));
+	maxBuffers = std::min(_maxBuffers, std::min(indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers, indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers));
+
+	textureCount = 0;
+	bufferCount = 0;
+	freeTextures.clear();
+	freeBuffers.clear();
+
+	createDescriptorSetLayout();
+	createDescriptorPoolAndAllocateSet();
+}
+
+void BindlessResources::createDescriptorSetLayout()
+{
+	VkSampler sampler = VulkanContext::getInstance()->getSamplerCache()->getTrilinearSampler();
+
+	// immutable sampler, textures, buffers
+	std::array<VkDescriptorSetLayoutBinding, 3> bindings = {};
+
+	bindings[0].binding = kBindlessSamplerBinding;
+	bindings[0].descriptorCount = 1;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+	bindings[0].pImmutableSamplers = &sampler;
+	bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	bindings[1].binding = kBindlessTextureBinding;
+	bindings[1].descriptorCount = maxTextures;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	bindings[2].binding = kBindlessBufferBinding;
+	bindings[2].descriptorCount = maxBuffers;
+	bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[2].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorBindingFlagsEXT arrayFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+		VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+	std::array<VkDescriptorBindingFlagsEXT, 3> bindingFlags = { 0, arrayFlags, arrayFlags };
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+	bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.pNext = &bindingFlagsInfo;
+	layoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutCreateInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(VulkanContext::getInstance()->getDevice()->logicalDevice, &layoutCreateInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create bindless descriptor set layout!!");
+	}
+}
+
+void BindlessResources::createDescriptorPoolAndAllocateSet()
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	std::array<VkDescriptorPoolSize, 3> poolSizes = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+	poolSizes[0].descriptorCount = 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	poolSizes[1].descriptorCount = maxTextures;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[2].descriptorCount = maxBuffers;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = 1;
+
+	if (vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create bindless descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &descriptorSetLayout;
+
+	// nothing is written up front, partially bound arrays can stay empty
+	if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &descriptorSet) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate bindless descriptor set!");
+	}
+}
+
+uint32_t BindlessResources::allocateSlot(std::vector<uint32_t>& freeSlots, uint32_t& count, uint32_t max, const char* error)
+{
+	if (!freeSlots.empty())
+	{
+		uint32_t slot = freeSlots.back();
+		freeSlots.pop_back();
+		return slot;
+	}
+
+	if (count >= max)
+	{
+		throw std::runtime_error(error);
+	}
+
+	return count++;
+}
+
+uint32_t BindlessResources::addTexture(const Texture& texture)
+{
+	uint32_t index = allocateSlot(freeTextures, textureCount, maxTextures, "the bindless texture array is full!");
+	updateTexture(index, texture);
+	return index;
+}
+
+void BindlessResources::updateTexture(uint32_t index, const Texture& texture)
+{
+	// the sampler is immutable, only the view goes in
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.imageView = texture.imageView;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = descriptorSet;
+	write.dstBinding = kBindlessTextureBinding;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	write.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(VulkanContext::getInstance()->getDevice()->logicalDevice, 1, &write, 0, nullptr);
+}
+
+void BindlessResources::removeTexture(uint32_t index)
+{
+	// the stale descriptor stays, partially bound only asks that shaders don't read it
+	freeTextures.push_back(index);
+}
+
+uint32_t BindlessResources::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	uint32_t index = allocateSlot(freeBuffers, bufferCount, maxBuffers, "the bindless buffer array is full!");
+
+	VkDescriptorBufferInfo bufferInfo = {};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = offset;
+	bufferInfo.range = range;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = descriptorSet;
+	write.dstBinding = kBindlessBufferBinding;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(VulkanContext::getInstance()->getDevice()->logicalDevice, 1, &write, 0, nullptr);
+
+	return index;
+}
+
+void BindlessResources::removeBuffer(uint32_t index)
+{
+	freeBuffers.push_back(index);
+}
+
+void BindlessResources::destroy()
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+}
\ No newline at end of file
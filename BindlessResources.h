@@ -0,0 +1,81 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <glm\glm.hpp>
+
+class Texture;
+
+// requested sizes, create clamps them to the device's update after bind limits
+static const uint32_t kBindlessMaxTextures = 16384;
+static const uint32_t kBindlessMaxBuffers = 4096;
+
+// bindings of the bindless set, see Shaders/bindless.vert and bindless.frag
+static const uint32_t kBindlessSamplerBinding = 0;
+static const uint32_t kBindlessTextureBinding = 1;
+static const uint32_t kBindlessBufferBinding = 2;
+
+// matches BindlessInstance in Shaders/bindless.vert (std430)
+// one per drawn instance, read at gl_InstanceIndex so instanced and indirect draws address it through firstInstance
+struct BindlessInstance
+{
+	glm::mat4 model;
+	uint32_t textureIndex;
+	uint32_t padding[3];
+};
+
+// matches DrawConstants in Shaders/bindless.vert
+struct BindlessDrawConstants
+{
+	uint32_t instanceBuffer;	// buffer index of the BindlessInstance array
+};
+
+// -- Bindless resources
+// One descriptor set with a large array of sampled images and one of storage buffers that every
+// bindless pipeline binds as is. Draws address resources by index, so a texture change is a
+// different number in an instance record and draws with different textures can be merged.
+// The arrays are partially bound and update after bind, slots are written while command buffers
+// that use the set are being recorded, and only slots that are actually in use have to be valid.
+// Textures go through the immutable trilinear sampler of the cache, shaders combine the two.
+// Needs Device::isBindlessSupported.
+class BindlessResources
+{
+public:
+	BindlessResources();
+	~BindlessResources();
+
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet descriptorSet;
+
+	void create(uint32_t _maxTextures = kBindlessMaxTextures, uint32_t _maxBuffers = kBindlessMaxBuffers);
+
+	// returns the index shaders use, it stays valid until removed
+	uint32_t addTexture(const Texture& texture);
+	// for textures recreated under the same index, like TextureStreamer rebuilds
+	void updateTexture(uint32_t index, const Texture& texture);
+	void removeTexture(uint32_t index);
+
+	uint32_t addBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	void removeBuffer(uint32_t index);
+
+	uint32_t getTextureCount() const { return textureCount - static_cast<uint32_t>(freeTextures.size()); }
+	uint32_t getBufferCount() const { return bufferCount - static_cast<uint32_t>(freeBuffers.size()); }
+
+	void destroy();
+
+private:
+	uint32_t maxTextures;
+	uint32_t maxBuffers;
+
+	// slots are handed out in order, removed ones are reused first
+	// drawEnd waits for the queue, so a slot removed this frame is free to reuse the next
+	uint32_t textureCount;
+	uint32_t bufferCount;
+	std::vector<uint32_t> freeTextures;
+	std::vector<uint32_t> freeBuffers;
+
+	void createDescriptorSetLayout();
+	void createDescriptorPoolAndAllocateSet();
+
+	static uint32_t allocateSlot(std::vector<uint32_t>& freeSlots, uint32_t& count, uint32_t max, const char* error);
+};
\ No newline at end of file
@@ -26,4 +26,33 @@ glm::mat4 Camera::getprojectionMatrix()
 void Camera::setCameraPosition(glm::vec3 position)
 {
 	cameraPos = position;
+}
+
+void Camera::lookAt(glm::vec3 position, glm::vec3 target)
+{
+	cameraPos = position;
+	viewMatrix = glm::lookAt(cameraPos, target, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+void Camera::getFrustumPlanes(glm::vec4 planes[6])
+{
+	// Gribb / Hartmann plane extraction, glm is column major so rows are m[0][i], m[1][i] ...
+	glm::mat4 m = projectionMatrix * viewMatrix;
+
+	glm::vec4 row0 = glm::vec4(m[0][0], m[1][0], m[2][0], m[3][0]);
+	glm::vec4 row1 = glm::vec4(m[0][1], m[1][1], m[2][1], m[3][1]);
+	glm::vec4 row2 = glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]);
+	glm::vec4 row3 = glm::vec4(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	planes[0] = row3 + row0; // left
+	planes[1] = row3 - row0; // right
+	planes[2] = row3 + row1; // bottom
+	planes[3] = row3 - row1; // top
+	planes[4] = row3 + row2; // near
+	planes[5] = row3 - row2; // far
+
+	for (int i = 0; i < 6; i++)
+	{
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
 }
\ No newline at end of file
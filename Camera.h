@@ -9,9 +9,14 @@ class Camera
 public:
 	void init(float FOV, float width, float height, float nearplane, float farPlane);
 	void setCameraPosition(glm::vec3 position);
+	// moves the camera and points it at target, y up
+	void lookAt(glm::vec3 position, glm::vec3 target);
 	glm::mat4 getViewMatrix();
 	glm::mat4 getprojectionMatrix();
 
+	// world space planes ( xyz normal pointing inside, w distance ), left right bottom top near far
+	void getFrustumPlanes(glm::vec4 planes[6]);
+
 private:
 	glm::mat4 projectionMatrix;
 	glm::mat4 viewMatrix;
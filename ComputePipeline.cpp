@@ -0,0 +1,69 @@
+#include "ComputePipeline.h"
+#include "VulkanContext.h"
+#include "Tools.h"
+
+ComputePipeline::ComputePipeline()
+{ }
+
+ComputePipeline::~ComputePipeline()
+{ }
+
+void ComputePipeline::createComputePipelineLayoutAndPipeline(const std::string& shaderFile, VkDescriptorSetLayout descriptorSetLayout, uint32_t pushConstantSize)
+{
+	createComputePipelineLayout(descriptorSetLayout, pushConstantSize);
+	createComputePipeline(shaderFile);
+}
+
+void ComputePipeline::createComputePipelineLayout(VkDescriptorSetLayout descriptorSetLayout, uint32_t pushConstantSize)
+{
+	// small per dispatch parameters go through push constants
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = pushConstantSize;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+	pipelineLayoutInfo.pPushConstantRanges = pushConstantSize > 0 ? &pushConstantRange : nullptr;
+
+	if (vkCreatePipelineLayout(VulkanContext::getInstance()->getDevice()->logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error(" failed to create compute pipeline layout !");
+	}
+}
+
+void ComputePipeline::createComputePipeline(const std::string& shaderFile)
+{
+	auto computeShaderCode = vkTools::readFile(shaderFile);
+	VkShaderModule computeShaderModule = vkTools::createShaderModule(computeShaderCode);
+
+	// a compute pipeline is a single shader stage and the layout, no fixed function state
+	VkPipelineShaderStageCreateInfo compShaderStageCreateInfo = {};
+	compShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	compShaderStageCreateInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	compShaderStageCreateInfo.module = computeShaderModule;
+	compShaderStageCreateInfo.pName = "main";
+
+	VkComputePipelineCreateInfo cpInfo = {};
+	cpInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	cpInfo.stage = compShaderStageCreateInfo;
+	cpInfo.layout = pipelineLayout;
+	cpInfo.basePipelineHandle = VK_NULL_HANDLE;
+	cpInfo.basePipelineIndex = -1;
+
+	if (vkCreateComputePipelines(VulkanContext::getInstance()->getDevice()->logicalDevice, VK_NULL_HANDLE, 1, &cpInfo, nullptr, &computePipeline) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create compute pipeline !!");
+	}
+
+	vkDestroyShaderModule(VulkanContext::getInstance()->getDevice()->logicalDevice, computeShaderModule, nullptr);
+}
+
+void ComputePipeline::destroy()
+{
+	vkDestroyPipeline(VulkanContext::getInstance()->getDevice()->logicalDevice, computePipeline, nullptr);
+	vkDestroyPipelineLayout(VulkanContext::getInstance()->getDevice()->logicalDevice, pipelineLayout, nullptr);
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+
+class ComputePipeline
+{
+public:
+	ComputePipeline();
+	~ComputePipeline();
+
+	VkPipelineLayout pipelineLayout;
+	VkPipeline computePipeline;
+
+	// pushConstantSize of 0 means the shader has no push constant block
+	void createComputePipelineLayoutAndPipeline(const std::string& shaderFile, VkDescriptorSetLayout descriptorSetLayout, uint32_t pushConstantSize = 0);
+
+	void destroy();
+
+private:
+
+	void createComputePipelineLayout(VkDescriptorSetLayout descriptorSetLayout, uint32_t pushConstantSize);
+	void createComputePipeline(const std::string& shaderFile);
+};
@@ -0,0 +1,353 @@
+#include "CookedMesh.h"
+#include "MeshCodec.h"
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+static uint64_t alignOffset(uint64_t offset)
+{
+	return (offset + kCookedMeshAlignment - 1) & ~(uint64_t)(kCookedMeshAlignment - 1);
+}
+
+static bool indicesInRange(const void* indices, uint32_t indexCount, uint32_t indexType, uint32_t vertexCount)
+{
+	uint32_t largest = 0;
+
+	if (indexType == VK_INDEX_TYPE_UINT16)
+	{
+		const uint16_t* data = static_cast<const uint16_t*>(indices);
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			largest = std::max(largest, (uint32_t)data[i]);
+		}
+	}
+	else
+	{
+		const uint32_t* data = static_cast<const uint32_t*>(indices);
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			largest = std::max(largest, data[i]);
+		}
+	}
+
+	return indexCount == 0 || largest < vertexCount;
+}
+
+CookedMesh::CookedMesh()
+	: header(nullptr)
+{ }
+
+CookedMesh::~CookedMesh()
+{ }
+
+void CookedMesh::writeFile(const std::string& path, const CookedMeshSource& source)
+{
+	CookedMeshHeader fileHeader = {};
+	fileHeader.magic = kCookedMeshMagic;
+	fileHeader.version = kCookedMeshVersion;
+	fileHeader.headerSize = sizeof(CookedMeshHeader);
+	fileHeader.indexType = source.indexType;
+
+	fileHeader.vertexCount = static_cast<uint32_t>(source.positions->size());
+	fileHeader.indexCount = static_cast<uint32_t>(source.indices->size());
+	fileHeader.streamCount = kVertexStreamCount;
+	fileHeader.lodCount = static_cast<uint32_t>(source.lods->size());
+	fileHeader.meshletCount = static_cast<uint32_t>(source.meshlets->meshlets.size());
+	fileHeader.meshletVertexCount = static_cast<uint32_t>(source.meshlets->vertices.size());
+	fileHeader.meshletTriangleByteCount = static_cast<uint32_t>(source.meshlets->triangles.size());
+
+	memcpy(fileHeader.boundingSphere, &source.boundingSphere, sizeof(float) * 4);
+	memcpy(fileHeader.boundsMin, &source.boundsMin, sizeof(float) * 3);
+	memcpy(fileHeader.boundsMax, &source.boundsMax, sizeof(float) * 3);
+
+	fileHeader.flags = source.compress ? kCookedMeshCompressed : 0;
+
+	uint32_t indexSize = source.indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+	// streams in the same layout ObjectBuffers uses for its vertex buffer
+	CookedMeshStream streams[kVertexStreamCount] = {};
+	const void* streamData[kVertexStreamCount] = { source.positions->data(), source.attributes->data() };
+
+	streams[kVertexStreamPosition].stream = kVertexStreamPosition;
+	streams[kVertexStreamPosition].stride = sizeof(PositionStreamVertex);
+	streams[kVertexStreamPosition].offset = 0;
+	streams[kVertexStreamPosition].size = sizeof(PositionStreamVertex) * source.positions->size();
+
+	streams[kVertexStreamAttributes].stream = kVertexStreamAttributes;
+	streams[kVertexStreamAttributes].stride = sizeof(AttributeStreamVertex);
+	streams[kVertexStreamAttributes].offset = alignOffset(streams[kVertexStreamPosition].size);
+	streams[kVertexStreamAttributes].size = sizeof(AttributeStreamVertex) * source.attributes->size();
+
+	// what actually goes into the file, raw or encoded
+	std::vector<uint8_t> storedStreams[kVertexStreamCount];
+	std::vector<uint8_t> storedIndices;
+
+	for (uint32_t i = 0; i < kVertexStreamCount; i++)
+	{
+		if (source.compress)
+		{
+			MeshCodec::encodeVertexBuffer(storedStreams[i], streamData[i], fileHeader.vertexCount, streams[i].stride);
+		}
+		else
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(streamData[i]);
+			storedStreams[i].assign(bytes, bytes + streams[i].size);
+		}
+	}
+
+	if (source.compress)
+	{
+		MeshCodec::encodeIndexBuffer(storedIndices, source.indices->data(), fileHeader.indexCount);
+	}
+	else if (source.indexType == VK_INDEX_TYPE_UINT16)
+	{
+		storedIndices.resize((size_t)indexSize * fileHeader.indexCount);
+		uint16_t* indices16 = reinterpret_cast<uint16_t*>(storedIndices.data());
+		for (uint32_t i = 0; i < fileHeader.indexCount; i++)
+		{
+			indices16[i] = static_cast<uint16_t>((*source.indices)[i]);
+		}
+	}
+	else
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(source.indices->data());
+		storedIndices.assign(bytes, bytes + (size_t)indexSize * fileHeader.indexCount);
+	}
+
+	// uncompressed streams are stored where they go in the vertex buffer
+	streams[kVertexStreamPosition].storedOffset = 0;
+	streams[kVertexStreamPosition].storedSize = storedStreams[kVertexStreamPosition].size();
+	streams[kVertexStreamAttributes].storedOffset = source.compress ? alignOffset(storedStreams[kVertexStreamPosition].size()) : streams[kVertexStreamAttributes].offset;
+	streams[kVertexStreamAttributes].storedSize = storedStreams[kVertexStreamAttributes].size();
+
+	// section offsets
+	uint64_t offset = alignOffset(sizeof(CookedMeshHeader));
+	fileHeader.streamTableOffset = offset;
+	offset = alignOffset(offset + sizeof(streams));
+	fileHeader.lodTableOffset = offset;
+	offset = alignOffset(offset + sizeof(MeshLod) * fileHeader.lodCount);
+	fileHeader.meshletTableOffset = offset;
+	offset = alignOffset(offset + sizeof(Meshlet) * fileHeader.meshletCount);
+	fileHeader.meshletVerticesOffset = offset;
+	offset = alignOffset(offset + sizeof(uint32_t) * fileHeader.meshletVertexCount);
+	fileHeader.meshletTrianglesOffset = offset;
+	offset = alignOffset(offset + fileHeader.meshletTriangleByteCount);
+	fileHeader.vertexDataOffset = offset;
+	fileHeader.vertexDataSize = streams[kVertexStreamAttributes].storedOffset + streams[kVertexStreamAttributes].storedSize;
+	offset = alignOffset(offset + fileHeader.vertexDataSize);
+	fileHeader.indexDataOffset = offset;
+	fileHeader.indexDataSize = storedIndices.size();
+	fileHeader.fileSize = alignOffset(offset + fileHeader.indexDataSize);
+
+	// cooking is offline, build the whole file in memory and write it once
+	std::vector<uint8_t> bytes((size_t)fileHeader.fileSize, 0);
+
+	auto writeSection = [&](uint64_t sectionOffset, const void* data, uint64_t size)
+	{
+		if (size > 0)
+		{
+			memcpy(bytes.data() + sectionOffset, data, (size_t)size);
+		}
+	};
+
+	writeSection(0, &fileHeader, sizeof(fileHeader));
+	writeSection(fileHeader.streamTableOffset, streams, sizeof(streams));
+	writeSection(fileHeader.lodTableOffset, source.lods->data(), sizeof(MeshLod) * fileHeader.lodCount);
+	writeSection(fileHeader.meshletTableOffset, source.meshlets->meshlets.data(), sizeof(Meshlet) * fileHeader.meshletCount);
+	writeSection(fileHeader.meshletVerticesOffset, source.meshlets->vertices.data(), sizeof(uint32_t) * fileHeader.meshletVertexCount);
+	writeSection(fileHeader.meshletTrianglesOffset, source.meshlets->triangles.data(), fileHeader.meshletTriangleByteCount);
+
+	for (uint32_t i = 0; i < kVertexStreamCount; i++)
+	{
+		writeSection(fileHeader.vertexDataOffset + streams[i].storedOffset, storedStreams[i].data(), streams[i].storedSize);
+	}
+
+	writeSection(fileHeader.indexDataOffset, storedIndices.data(), fileHeader.indexDataSize);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to create cooked mesh " + path);
+	}
+
+	file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+	if (!file)
+	{
+		throw std::runtime_error("failed to write cooked mesh " + path);
+	}
+}
+
+void CookedMesh::open(const std::string& path)
+{
+	file.open(path);
+	header = reinterpret_cast<const CookedMeshHeader*>(file.data);
+
+	if (file.size < sizeof(CookedMeshHeader) || header->magic != kCookedMeshMagic)
+	{
+		close();
+		throw std::runtime_error("not a cooked mesh " + path);
+	}
+
+	if (header->version != kCookedMeshVersion || header->headerSize != sizeof(CookedMeshHeader))
+	{
+		close();
+		throw std::runtime_error("cooked mesh version mismatch, recook " + path);
+	}
+
+	// every section has to be inside the file, a truncated file must not be read past its end
+	struct Section
+	{
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	uint64_t indexSize = header->indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+	Section sections[] = {
+		{ header->streamTableOffset, sizeof(CookedMeshStream) * (uint64_t)header->streamCount },
+		{ header->lodTableOffset, sizeof(MeshLod) * (uint64_t)header->lodCount },
+		{ header->meshletTableOffset, sizeof(Meshlet) * (uint64_t)header->meshletCount },
+		{ header->meshletVerticesOffset, sizeof(uint32_t) * (uint64_t)header->meshletVertexCount },
+		{ header->meshletTrianglesOffset, (uint64_t)header->meshletTriangleByteCount },
+		{ header->vertexDataOffset, header->vertexDataSize },
+		{ header->indexDataOffset, header->indexDataSize },
+	};
+
+	bool valid = header->fileSize <= file.size && header->streamCount == kVertexStreamCount && header->indexCount % 3 == 0;
+
+	// raw data is uploaded as it is, so it has to be exactly the size the buffers get
+	if (!isCompressed())
+	{
+		valid = valid && header->indexDataSize == indexSize * header->indexCount;
+	}
+
+	for (const Section& section : sections)
+	{
+		valid = valid && section.offset % kCookedMeshAlignment == 0 && section.offset <= file.size && section.size <= file.size - section.offset;
+	}
+
+	for (uint32_t i = 0; valid && i < header->streamCount; i++)
+	{
+		const CookedMeshStream& stream = getStreams()[i];
+		valid = stream.stream == i && stream.storedOffset <= header->vertexDataSize && stream.storedSize <= header->vertexDataSize - stream.storedOffset;
+
+		// the vertex buffer layout is fixed, streams back to back on aligned offsets
+		uint64_t expectedOffset = i == 0 ? 0 : alignOffset(getStreams()[i - 1].offset + getStreams()[i - 1].size);
+		valid = valid && stream.offset == expectedOffset;
+
+		// decoding needs whole vertices, a raw stream is copied to its place in the vertex buffer
+		if (isCompressed())
+		{
+			valid = valid && stream.stride != 0 && stream.size == (uint64_t)stream.stride * header->vertexCount;
+		}
+		else
+		{
+			valid = valid && stream.storedOffset == stream.offset && stream.storedSize == stream.size;
+		}
+	}
+
+	// the tables index into each other and into the index buffer, a bad range would draw or read out of bounds
+	for (uint32_t i = 0; valid && i < header->lodCount; i++)
+	{
+		const MeshLod& lod = getLods()[i];
+		valid = (uint64_t)lod.firstIndex + lod.indexCount <= header->indexCount;
+	}
+
+	for (uint32_t i = 0; valid && i < header->meshletCount; i++)
+	{
+		const Meshlet& meshlet = getMeshlets()[i];
+		valid = (uint64_t)meshlet.vertexOffset + meshlet.vertexCount <= header->meshletVertexCount
+			&& (uint64_t)meshlet.triangleOffset + (uint64_t)meshlet.triangleCount * 3 <= header->meshletTriangleByteCount
+			&& (uint64_t)meshlet.firstIndex + meshlet.indexCount <= header->indexCount;
+
+		const uint8_t* triangles = getMeshletTriangles() + meshlet.triangleOffset;
+		for (uint32_t j = 0; valid && j < meshlet.triangleCount * 3; j++)
+		{
+			valid = triangles[j] < meshlet.vertexCount;
+		}
+	}
+
+	for (uint32_t i = 0; valid && i < header->meshletVertexCount; i++)
+	{
+		valid = getMeshletVertices()[i] < header->vertexCount;
+	}
+
+	// compressed indices are only known once decoded, readIndexData checks those
+	if (valid && !isCompressed())
+	{
+		valid = indicesInRange(file.data + header->indexDataOffset, header->indexCount, header->indexType, header->vertexCount);
+	}
+
+	if (!valid)
+	{
+		close();
+		throw std::runtime_error("cooked mesh is corrupt " + path);
+	}
+}
+
+void CookedMesh::close()
+{
+	file.close();
+	header = nullptr;
+}
+
+
+uint64_t CookedMesh::getVertexBufferSize() const
+{
+	uint64_t size = 0;
+	for (uint32_t i = 0; i < header->streamCount; i++)
+	{
+		size = std::max(size, getStreams()[i].offset + getStreams()[i].size);
+	}
+	return size;
+}
+
+uint64_t CookedMesh::getIndexBufferSize() const
+{
+	uint64_t indexSize = header->indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	return indexSize * header->indexCount;
+}
+
+void CookedMesh::readVertexData(void* destination) const
+{
+	const uint8_t* vertexData = file.data + header->vertexDataOffset;
+	uint8_t* output = static_cast<uint8_t*>(destination);
+
+	// the gap between streams is padding, zero it so staging memory never holds stale data
+	memset(output, 0, (size_t)getVertexBufferSize());
+
+	for (uint32_t i = 0; i < header->streamCount; i++)
+	{
+		const CookedMeshStream& stream = getStreams()[i];
+
+		if (isCompressed())
+		{
+			MeshCodec::decodeVertexBuffer(output + stream.offset, header->vertexCount, stream.stride, vertexData + stream.storedOffset, (size_t)stream.storedSize);
+		}
+		else
+		{
+			memcpy(output + stream.offset, vertexData + stream.storedOffset, (size_t)stream.size);
+		}
+	}
+}
+
+void CookedMesh::readIndexData(void* destination) const
+{
+	const uint8_t* indexData = file.data + header->indexDataOffset;
+
+	if (isCompressed())
+	{
+		size_t indexSize = header->indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+		MeshCodec::decodeIndexBuffer(destination, header->indexCount, indexSize, indexData, (size_t)header->indexDataSize);
+
+		if (!indicesInRange(destination, header->indexCount, header->indexType, header->vertexCount))
+		{
+			throw std::runtime_error("cooked mesh has indices past its vertex count!");
+		}
+	}
+	else
+	{
+		memcpy(destination, indexData, (size_t)header->indexDataSize);
+	}
+}
\ No newline at end of file
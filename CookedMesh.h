@@ -0,0 +1,138 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+
+#include "Mesh.h"
+#include "Meshlet.h"
+#include "MappedFile.h"
+
+// -- Cooked mesh file
+// Everything the renderer needs, laid out so the vertex and index sections can be
+// copied into staging memory as they are. Sections start on kCookedMeshAlignment.
+//
+//	CookedMeshHeader
+//	CookedMeshStream[streamCount]
+//	MeshLod[lodCount]
+//	Meshlet[meshletCount]
+//	uint32_t meshletVertices[meshletVertexCount]
+//	uint8_t meshletTriangles[meshletTriangleByteCount]
+//	vertex data, the streams back to back in the same layout as the gpu vertex buffer
+//	index data, 16 or 32 bit as indexType says
+//
+// With kCookedMeshCompressed the vertex streams and the indices are stored with MeshCodec,
+// each stream on its own, and decoded straight into staging memory on load.
+//
+// The tables are the engine's own structs, so the version goes up whenever one of them changes.
+
+static const uint32_t kCookedMeshMagic = 0x4d454755; // "UGEM"
+static const uint32_t kCookedMeshVersion = 3;
+static const uint32_t kCookedMeshAlignment = 16;
+
+// CookedMeshHeader::flags
+static const uint32_t kCookedMeshCompressed = 1;
+
+struct CookedMeshHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t indexType;		// VkIndexType
+
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t streamCount;
+	uint32_t lodCount;
+
+	uint32_t meshletCount;
+	uint32_t meshletVertexCount;
+	uint32_t meshletTriangleByteCount;
+	uint32_t flags;
+
+	float boundingSphere[4];
+	float boundsMin[4];
+	float boundsMax[4];
+
+	// byte offsets from the start of the file
+	uint64_t streamTableOffset;
+	uint64_t lodTableOffset;
+	uint64_t meshletTableOffset;
+	uint64_t meshletVerticesOffset;
+	uint64_t meshletTrianglesOffset;
+	// sizes of the data as stored, decoded sizes follow from the streams and the index count
+	uint64_t vertexDataOffset;
+	uint64_t vertexDataSize;
+	uint64_t indexDataOffset;
+	uint64_t indexDataSize;
+	uint64_t fileSize;
+};
+
+struct CookedMeshStream
+{
+	uint32_t stream;	// VertexStream
+	uint32_t stride;
+	uint64_t offset;	// offset inside the vertex buffer
+	uint64_t size;
+
+	// where the stream is stored, from the start of the vertex data
+	// the same as offset and size unless the mesh is compressed
+	uint64_t storedOffset;
+	uint64_t storedSize;
+};
+
+// what gets written, the importer and ObjectBuffers both fill one in
+struct CookedMeshSource
+{
+	const std::vector<PositionStreamVertex>* positions;
+	const std::vector<AttributeStreamVertex>* attributes;
+	const std::vector<uint32_t>* indices;
+	VkIndexType indexType;
+	const std::vector<MeshLod>* lods;
+	const MeshletData* meshlets;
+	glm::vec4 boundingSphere;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	bool compress;
+};
+
+class CookedMesh
+{
+public:
+	CookedMesh();
+	~CookedMesh();
+
+	static void writeFile(const std::string& path, const CookedMeshSource& source);
+
+	// maps the file and checks the header, every section against the file size and every
+	// table range and raw index against the counts it refers to, throws if anything is off
+	void open(const std::string& path);
+	void close();
+
+	const CookedMeshHeader& getHeader() const { return *header; }
+	const CookedMeshStream* getStreams() const { return sectionAt<CookedMeshStream>(header->streamTableOffset); }
+	const MeshLod* getLods() const { return sectionAt<MeshLod>(header->lodTableOffset); }
+	const Meshlet* getMeshlets() const { return sectionAt<Meshlet>(header->meshletTableOffset); }
+	const uint32_t* getMeshletVertices() const { return sectionAt<uint32_t>(header->meshletVerticesOffset); }
+	const uint8_t* getMeshletTriangles() const { return sectionAt<uint8_t>(header->meshletTrianglesOffset); }
+
+	bool isCompressed() const { return (header->flags & kCookedMeshCompressed) != 0; }
+
+	// size of the gpu buffers
+	uint64_t getVertexBufferSize() const;
+	uint64_t getIndexBufferSize() const;
+
+	// decode or copy into memory of the sizes above, usually mapped staging memory
+	// decoded indices are range checked, readIndexData throws on a corrupt compressed section
+	void readVertexData(void* destination) const;
+	void readIndexData(void* destination) const;
+
+private:
+	MappedFile file;
+	const CookedMeshHeader* header;
+
+	template<typename T>
+	const T* sectionAt(uint64_t offset) const
+	{
+		return reinterpret_cast<const T*>(file.data + offset);
+	}
+};
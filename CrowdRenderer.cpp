@@ -0,0 +1,324 @@
+#include "CrowdRenderer.h"
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include "VulkanContext.h"
+#include "Tools.h"
+
+// matches CrowdConstants in Shaders/crowd.vert
+struct CrowdConstants
+{
+	glm::mat4 viewProj;
+	float time;
+	uint32_t vertexCount;
+};
+
+CrowdRenderer::CrowdRenderer()
+{ }
+
+CrowdRenderer::~CrowdRenderer()
+{ }
+
+void CrowdRenderer::createCrowdRenderer(const BakedVertexAnimation& animation, const std::vector<uint32_t>& indices, uint32_t _maxInstances)
+{
+	if (animation.clips.empty() || animation.clips.size() > kMaxCrowdClips)
+	{
+		throw std::runtime_error("a crowd needs between 1 and kMaxCrowdClips clips!");
+	}
+
+	maxInstances = _maxInstances;
+	vertexCount = animation.vertexCount;
+	indexCount = static_cast<uint32_t>(indices.size());
+	clipCount = static_cast<uint32_t>(animation.clips.size());
+	boundingSphere = animation.boundingSphere;
+
+	createAnimationTexture(animation.positions.data(), sizeof(uint16_t) * 4, VK_FORMAT_R16G16B16A16_SFLOAT, animation.textureHeight, positionImage, positionImageMemory, positionImageView);
+	createAnimationTexture(animation.normals.data(), sizeof(uint32_t), VK_FORMAT_R8G8B8A8_SNORM, animation.textureHeight, normalImage, normalImageMemory, normalImageView);
+
+	// texelFetch only, the sampler never filters
+	sampler = VulkanContext::getInstance()->getSamplerCache()->getPointClampSampler();
+
+	createBuffers(animation, indices);
+	createDescriptorSetLayout();
+	createDescriptorPoolAndSet();
+
+	VertexInputDescription vertexInput = CrowdInstanceFormat::getInputDescription(0, VK_VERTEX_INPUT_RATE_INSTANCE);
+
+	gPipeline.createGraphicsPipelineLayoutAndPipeline(VulkanContext::getInstance()->getSwapChain()->swapChainImageExtent, descriptorSetLayout,
+		VulkanContext::getInstance()->getRenderPass()->renderPass, "Shaders/SPIRV/crowd.vert.spv", "Shaders/SPIRV/basic.frag.spv", vertexInput, sizeof(CrowdConstants));
+}
+
+void CrowdRenderer::createAnimationTexture(const void* texels, VkDeviceSize texelSize, VkFormat format, uint32_t height, VkImage& image, VkDeviceMemory& imageMemory, VkImageView& imageView)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(VulkanContext::getInstance()->getDevice()->physicalDevice, &properties);
+
+	if (height > properties.limits.maxImageDimension2D)
+	{
+		throw std::runtime_error("vertex animation is too long for one texture, bake fewer frames!");
+	}
+
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+	VkDeviceSize size = texelSize * kVertexAnimationTextureWidth * height;
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	vkTools::createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+	void* mapped;
+	vkMapMemory(logicalDevice, stagingBufferMemory, 0, size, 0, &mapped);
+	memcpy(mapped, texels, (size_t)size);
+	vkUnmapMemory(logicalDevice, stagingBufferMemory);
+
+	vkTools::createImage(kVertexAnimationTextureWidth, height, 1, format, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+	vkTools::transitionImageLayout(image, VK_IMAGE_ASPECT_COLOR_BIT, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	vkTools::copyBufferToImage(stagingBuffer, image, kVertexAnimationTextureWidth, height);
+	vkTools::transitionImageLayout(image, VK_IMAGE_ASPECT_COLOR_BIT, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
+	vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
+
+	imageView = vkTools::createImageView(image, format, VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
+void CrowdRenderer::createBuffers(const BakedVertexAnimation& animation, const std::vector<uint32_t>& indices)
+{
+	// 16 bit indices whenever the vertices fit, same as ObjectBuffers
+	if (vertexCount <= 0xffff)
+	{
+		std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+		indexType = VK_INDEX_TYPE_UINT16;
+		vkTools::createDeviceLocalBuffer(shortIndices.data(), sizeof(uint16_t) * shortIndices.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer, indexBufferMemory);
+	}
+	else
+	{
+		indexType = VK_INDEX_TYPE_UINT32;
+		vkTools::createDeviceLocalBuffer(indices.data(), sizeof(uint32_t) * indices.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer, indexBufferMemory);
+	}
+
+	// the whole std140 array, unused clips stay zero
+	std::array<VertexAnimationClip, kMaxCrowdClips> clips = {};
+	std::copy(animation.clips.begin(), animation.clips.end(), clips.begin());
+
+	vkTools::createDeviceLocalBuffer(clips.data(), sizeof(clips), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, clipBuffer, clipBufferMemory);
+
+	uint32_t sliceCount = static_cast<uint32_t>(VulkanContext::getInstance()->getSwapChain()->swapChainImages.size());
+
+	vkTools::createBuffer(sizeof(CrowdInstance) * maxInstances * sliceCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, instanceBuffer, instanceBufferMemory);
+}
+
+void CrowdRenderer::createDescriptorSetLayout()
+{
+	// crowd.vert: clip table, positions, normals
+	std::array<VkDescriptorSetLayoutBinding, 3> bindings = {};
+	VkDescriptorType types[] = {
+		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+	};
+
+	for (uint32_t i = 0; i < bindings.size(); i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorCount = 1;
+		bindings[i].descriptorType = types[i];
+		bindings[i].pImmutableSamplers = types[i] == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ? &sampler : nullptr;
+		bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutCreateInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(VulkanContext::getInstance()->getDevice()->logicalDevice, &layoutCreateInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create crowd descriptor set layout!!");
+	}
+}
+
+void CrowdRenderer::createDescriptorPoolAndSet()
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].descriptorCount = 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[1].descriptorCount = 2;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = 1;
+
+	if (vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create crowd descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &descriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &descriptorSet) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate crowd descriptor set!");
+	}
+
+	// nothing here changes after creation, written once
+	VkDescriptorBufferInfo clipInfo = { clipBuffer, 0, VK_WHOLE_SIZE };
+
+	std::array<VkDescriptorImageInfo, 2> imageInfos = {};
+	imageInfos[0] = { sampler, positionImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	imageInfos[1] = { sampler, normalImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+	std::array<VkWriteDescriptorSet, 3> descWrites = {};
+
+	for (uint32_t i = 0; i < descWrites.size(); i++)
+	{
+		descWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descWrites[i].dstSet = descriptorSet;
+		descWrites[i].dstBinding = i;
+		descWrites[i].dstArrayElement = 0;
+		descWrites[i].descriptorCount = 1;
+	}
+
+	descWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	descWrites[0].pBufferInfo = &clipInfo;
+	descWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descWrites[1].pImageInfo = &imageInfos[0];
+	descWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descWrites[2].pImageInfo = &imageInfos[1];
+
+	vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(descWrites.size()), descWrites.data(), 0, nullptr);
+}
+
+uint32_t CrowdRenderer::addAgent(const CrowdInstance& agent)
+{
+	if (agents.size() >= maxInstances)
+	{
+		throw std::runtime_error("crowd is full!");
+	}
+
+	agents.push_back(agent);
+	agents.back().clip = std::min(agent.clip, clipCount - 1);
+
+	return static_cast<uint32_t>(agents.size() - 1);
+}
+
+void CrowdRenderer::setAgent(uint32_t agentId, const CrowdInstance& agent)
+{
+	agents[agentId] = agent;
+	agents[agentId].clip = std::min(agent.clip, clipCount - 1);
+}
+
+void CrowdRenderer::update(Camera camera, float time)
+{
+	glm::mat4 proj = camera.getprojectionMatrix();
+	proj[1][1] *= -1; // same flip as ObjectRenderer
+
+	viewProj = proj * camera.getViewMatrix();
+	currentTime = time;
+
+	glm::vec4 planes[6];
+	camera.getFrustumPlanes(planes);
+
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	// this image's fence has been waited on, its slice is free
+	instanceOffset = sizeof(CrowdInstance) * maxInstances * VulkanContext::getInstance()->getCurrentImageIndex();
+
+	CrowdInstance* visible;
+	vkMapMemory(logicalDevice, instanceBufferMemory, instanceOffset, sizeof(CrowdInstance) * maxInstances, 0, reinterpret_cast<void**>(&visible));
+
+	uint32_t visibleCount = 0;
+
+	for (const CrowdInstance& agent : agents)
+	{
+		// the baked bounds hold every frame, so the pose doesn't matter here
+		float s = std::sin(agent.heading);
+		float c = std::cos(agent.heading);
+		glm::vec3 local = glm::vec3(boundingSphere) * agent.positionScale.w;
+		glm::vec3 center = glm::vec3(agent.positionScale) + glm::vec3(c * local.x + s * local.z, local.y, -s * local.x + c * local.z);
+		float radius = boundingSphere.w * std::abs(agent.positionScale.w);
+
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++)
+		{
+			inside = glm::dot(glm::vec3(planes[p]), center) + planes[p].w >= -radius;
+		}
+
+		if (inside)
+		{
+			visible[visibleCount++] = agent;
+		}
+	}
+
+	vkUnmapMemory(logicalDevice, instanceBufferMemory);
+
+	stats.agentCount = static_cast<uint32_t>(agents.size());
+	stats.visibleAgents = visibleCount;
+	stats.drawCalls = visibleCount > 0 ? 1 : 0;
+}
+
+void CrowdRenderer::draw()
+{
+	if (stats.visibleAgents == 0)
+	{
+		return;
+	}
+
+	VkCommandBuffer cBuffer = VulkanContext::getInstance()->getCurrentCommandBuffer();
+
+	vkCmdBindPipeline(cBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, gPipeline.graphicsPipeline);
+
+	vkCmdBindVertexBuffers(cBuffer, 0, 1, &instanceBuffer, &instanceOffset);
+	vkCmdBindIndexBuffer(cBuffer, indexBuffer, 0, indexType);
+	vkCmdBindDescriptorSets(cBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, gPipeline.pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+	CrowdConstants constants;
+	constants.viewProj = viewProj;
+	constants.time = currentTime;
+	constants.vertexCount = vertexCount;
+
+	vkCmdPushConstants(cBuffer, gPipeline.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+
+	// the whole visible crowd in one draw
+	vkCmdDrawIndexed(cBuffer, indexCount, stats.visibleAgents, 0, 0, 0);
+}
+
+void CrowdRenderer::destroy()
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	gPipeline.destroy();
+
+	vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+
+	vkDestroyImageView(logicalDevice, positionImageView, nullptr);
+	vkDestroyImage(logicalDevice, positionImage, nullptr);
+	vkFreeMemory(logicalDevice, positionImageMemory, nullptr);
+
+	vkDestroyImageView(logicalDevice, normalImageView, nullptr);
+	vkDestroyImage(logicalDevice, normalImage, nullptr);
+	vkFreeMemory(logicalDevice, normalImageMemory, nullptr);
+
+	vkDestroyBuffer(logicalDevice, instanceBuffer, nullptr);
+	vkFreeMemory(logicalDevice, instanceBufferMemory, nullptr);
+
+	vkDestroyBuffer(logicalDevice, indexBuffer, nullptr);
+	vkFreeMemory(logicalDevice, indexBufferMemory, nullptr);
+
+	vkDestroyBuffer(logicalDevice, clipBuffer, nullptr);
+	vkFreeMemory(logicalDevice, clipBufferMemory, nullptr);
+
+	agents.clear();
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "GraphicsPipeline.h"
+#include "Camera.h"
+#include "VertexAnimation.h"
+
+// one agent as the crowd vertex shader reads it, per instance vertex input
+struct CrowdInstance
+{
+	glm::vec4 positionScale;	// world position xyz, uniform scale w
+	float heading;				// radians around +y
+	uint32_t clip;				// into BakedVertexAnimation::clips
+	float timeOffset;			// seconds, added to the crowd's time so agents don't march in step
+	float playbackRate;
+	uint32_t color;				// rgba8 tint
+	uint32_t padding[3];
+};
+
+typedef VertexFormat<CrowdInstance,
+	VertexAttribute<0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(CrowdInstance, positionScale)>,
+	VertexAttribute<1, VK_FORMAT_R32_SFLOAT, offsetof(CrowdInstance, heading)>,
+	VertexAttribute<2, VK_FORMAT_R32_UINT, offsetof(CrowdInstance, clip)>,
+	VertexAttribute<3, VK_FORMAT_R32_SFLOAT, offsetof(CrowdInstance, timeOffset)>,
+	VertexAttribute<4, VK_FORMAT_R32_SFLOAT, offsetof(CrowdInstance, playbackRate)>,
+	VertexAttribute<5, VK_FORMAT_R8G8B8A8_UNORM, offsetof(CrowdInstance, color)>> CrowdInstanceFormat;
+
+// clip table size in Shaders/crowd.vert
+static const uint32_t kMaxCrowdClips = 64;
+
+struct CrowdStats
+{
+	uint32_t agentCount;
+	uint32_t visibleAgents;
+	uint32_t drawCalls;
+};
+
+// -- Crowd renderer
+// Every agent of a crowd is one instance of the same mesh, animated by crowd.vert from vertex
+// animation textures. The cpu only frustum culls the agents and copies the visible ones into
+// this frame's slice of the instance buffer, the whole crowd is then a single instanced draw.
+// Call update() after VulkanContext::drawBegin, then draw() inside the render pass.
+class CrowdRenderer
+{
+public:
+	CrowdRenderer();
+	~CrowdRenderer();
+
+	// baked positions and normals
+	VkImage positionImage;
+	VkDeviceMemory positionImageMemory;
+	VkImageView positionImageView;
+	VkImage normalImage;
+	VkDeviceMemory normalImageMemory;
+	VkImageView normalImageView;
+	VkSampler sampler;	// from the sampler cache, immutable in the layout
+
+	// one slice of maxInstances per swapchain image
+	VkBuffer instanceBuffer;
+	VkDeviceMemory instanceBufferMemory;
+
+	VkBuffer indexBuffer;
+	VkDeviceMemory indexBufferMemory;
+
+	VkBuffer clipBuffer;
+	VkDeviceMemory clipBufferMemory;
+
+	// indices into the baked vertices, the vertex order has to be the one the animation was baked in
+	void createCrowdRenderer(const BakedVertexAnimation& animation, const std::vector<uint32_t>& indices, uint32_t _maxInstances);
+
+	uint32_t addAgent(const CrowdInstance& agent);
+	void setAgent(uint32_t agentId, const CrowdInstance& agent);
+	CrowdInstance& getAgent(uint32_t agentId) { return agents[agentId]; }
+
+	// time in seconds, every agent plays at time * playbackRate + timeOffset
+	void update(Camera camera, float time);
+	void draw();
+
+	CrowdStats getStats() { return stats; }
+
+	void destroy();
+
+private:
+	GraphicsPipeline gPipeline;
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet descriptorSet;
+
+	std::vector<CrowdInstance> agents;
+	uint32_t maxInstances;
+
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	VkIndexType indexType;
+	uint32_t clipCount;
+	glm::vec4 boundingSphere;
+
+	// what draw() uses, filled in by update()
+	glm::mat4 viewProj;
+	float currentTime;
+	VkDeviceSize instanceOffset;
+
+	CrowdStats stats = {};
+
+	void createAnimationTexture(const void* texels, VkDeviceSize texelSize, VkFormat format, uint32_t height, VkImage& image, VkDeviceMemory& imageMemory, VkImageView& imageView);
+	void createBuffers(const BakedVertexAnimation& animation, const std::vector<uint32_t>& indices);
+	void createDescriptorSetLayout();
+	void createDescriptorPoolAndSet();
+};
\ No newline at end of file
@@ -1,7 +1,9 @@
 #include "Descriptor.h"
 #include <array>
+#include <cstring>
 #include "VulkanContext.h"
 #include "Mesh.h"
+#include "Texture.h"
 
 Descriptor::Descriptor()
 { }
@@ -9,10 +11,20 @@ Descriptor::Descriptor()
 Descriptor::~Descriptor()
 { }
 
-void Descriptor::createDescriptorLayoutSetPoolAndAllocate(uint32_t _swapChainImageCount)
+void Descriptor::createDescriptorLayoutSetPoolAndAllocate(bool _textured)
 { 
+	textured = _textured;
+
 	createDescriptorSetLayout();
-	createDescriptorPoolAndAllocateSets(_swapChainImageCount);
+	createDescriptorPoolAndAllocateSets();
+
+	std::vector<VkDescriptorUpdateTemplateEntry> entries = { descriptorTemplateEntry(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, offsetof(ObjectDescriptorData, uniforms)) };
+	if (textured)
+	{
+		entries.push_back(descriptorTemplateEntry(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(ObjectDescriptorData, texture)));
+	}
+
+	descriptorTemplate.create(descriptorSetLayout, entries, sizeof(ObjectDescriptorData));
 }
 
 void Descriptor::createDescriptorSetLayout()
@@ -26,11 +38,21 @@ void Descriptor::createDescriptorSetLayout()
 	uboLayoutBinding.pImmutableSamplers = nullptr; // only for image sampling descriptors
 	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // which shader stage the ubo needs to be bound to
 
-	std::array<VkDescriptorSetLayoutBinding, 1> layoutBindings = { uboLayoutBinding };
+	// every texture samples the same way, the sampler is baked into the layout
+	VkSampler textureSampler = VulkanContext::getInstance()->getSamplerCache()->getTrilinearSampler();
+
+	VkDescriptorSetLayoutBinding textureLayoutBinding = {};
+	textureLayoutBinding.binding = 1;
+	textureLayoutBinding.descriptorCount = 1;
+	textureLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	textureLayoutBinding.pImmutableSamplers = &textureSampler;
+	textureLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	std::array<VkDescriptorSetLayoutBinding, 2> layoutBindings = { uboLayoutBinding, textureLayoutBinding };
 
 	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
 	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutCreateInfo.bindingCount = static_cast<uint32_t> (layoutBindings.size());
+	layoutCreateInfo.bindingCount = textured ? 2 : 1;
 	layoutCreateInfo.pBindings = layoutBindings.data(); //&uboLayoutBinding;
 
 	if (vkCreateDescriptorSetLayout(VulkanContext::getInstance()->getDevice()->logicalDevice, &layoutCreateInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
@@ -39,38 +61,34 @@ void Descriptor::createDescriptorSetLayout()
 	}
 }
 
-void Descriptor::createDescriptorPoolAndAllocateSets(uint32_t _swapChainImageCount)
+void Descriptor::createDescriptorPoolAndAllocateSets()
 {
-	// Create a new pool depending upon the data
-	// Set pool size
-	// And max set count
-	std::array<VkDescriptorPoolSize, 1> poolSizes = {};
+	// a single set, the uniform buffer behind it is single too
+	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
 
 	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = _swapChainImageCount;
+	poolSizes[0].descriptorCount = 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[1].descriptorCount = 1;
 
 	VkDescriptorPoolCreateInfo poolInfo = {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size()); // pool count 
+	poolInfo.poolSizeCount = textured ? 2 : 1; // pool count 
 	poolInfo.pPoolSizes = poolSizes.data();
 
-	poolInfo.maxSets = _swapChainImageCount;
+	poolInfo.maxSets = 1;
 
 	if (vkCreateDescriptorPool(VulkanContext::getInstance()->getDevice()->logicalDevice, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create descriptor pool!");
 	}
 
-	// create vector of 2 decriptorSetLayout with the layouts 
-	std::vector<VkDescriptorSetLayout> layouts(_swapChainImageCount, descriptorSetLayout);
-
 	VkDescriptorSetAllocateInfo allocInfo = {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.descriptorSetCount = _swapChainImageCount;
-	allocInfo.pSetLayouts = layouts.data();
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &descriptorSetLayout;
 
-	// DescriptorSets.resize(swapChainImages.size());
 	// Descriptor sets dont have to be cleared as they will be destroyed along with the pool
 
 	// allocate descriptor sets
@@ -80,40 +98,38 @@ void Descriptor::createDescriptorPoolAndAllocateSets(uint32_t _swapChainImageCou
 	}
 }
 
-// requires texture!!! 
-void Descriptor::populateDescriptorSets(uint32_t _swapChainImageCount, VkBuffer uniformBuffers)
+// texture is only read when the layout was created textured
+void Descriptor::populateDescriptorSets(VkBuffer uniformBuffers, const Texture* texture)
 {
-	// populate the descriptor
-	for (size_t i = 0; i < _swapChainImageCount; i++) {
-
-		// Uniform buffer info
-		VkDescriptorBufferInfo uboBufferDescInfo = {};
-		uboBufferDescInfo.buffer = uniformBuffers;
-		uboBufferDescInfo.offset = 0;
-		uboBufferDescInfo.range = sizeof(UniformBufferObject);
-
-		VkWriteDescriptorSet uboDescWrites;
-		uboDescWrites.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		uboDescWrites.pNext = NULL;
-		uboDescWrites.dstSet = descriptorSet;
-		uboDescWrites.dstBinding = 0; // binding index of 0 
-		uboDescWrites.dstArrayElement = 0; // we are not using any arrays
-		uboDescWrites.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		uboDescWrites.descriptorCount = 1; //how many array elements you want to update
-		uboDescWrites.pBufferInfo = &uboBufferDescInfo; // uniforms buffers
-		uboDescWrites.pImageInfo = nullptr;
-		uboDescWrites.pTexelBufferView = nullptr;
-
-		// The configuration of the descriptors is updated using the vkUpdateDescriptorSets function
-		std::array<VkWriteDescriptorSet, 1> descWrites = { uboDescWrites };
-
-		vkUpdateDescriptorSets(VulkanContext::getInstance()->getDevice()->logicalDevice, static_cast<uint32_t>(descWrites.size()), descWrites.data(), 0, nullptr);
+	if (textured && texture == nullptr)
+	{
+		throw std::runtime_error("a textured descriptor needs a texture!");
+	}
+
+	// zeroed padding included, the template compares the bytes
+	ObjectDescriptorData data;
+	memset(&data, 0, sizeof(data));
+
+	// Uniform buffer info
+	data.uniforms.buffer = uniformBuffers;
+	data.uniforms.offset = 0;
+	data.uniforms.range = sizeof(UniformBufferObject);
+
+	// Texture info, the view covers every mip, the sampler is immutable and ignored here
+	if (textured)
+	{
+		VkDescriptorImageInfo textureInfo = texture->getDescriptorInfo();
+		data.texture.sampler = textureInfo.sampler;
+		data.texture.imageView = textureInfo.imageView;
+		data.texture.imageLayout = textureInfo.imageLayout;
 	}
 
+	descriptorTemplate.update(descriptorSet, data);
 }
 
 void Descriptor::destroy()
 {
+	descriptorTemplate.destroy();
 	vkDestroyDescriptorPool(VulkanContext::getInstance()->getDevice()->logicalDevice, descriptorPool, nullptr);
 	vkDestroyDescriptorSetLayout(VulkanContext::getInstance()->getDevice()->logicalDevice, descriptorSetLayout, nullptr);
 }
@@ -3,6 +3,17 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 
+#include "DescriptorTemplate.h"
+
+class Texture;
+
+// what the object set holds, written in one go through the template
+struct ObjectDescriptorData
+{
+	VkDescriptorBufferInfo uniforms;
+	VkDescriptorImageInfo texture;	// only with textured
+};
+
 class Descriptor
 {
 public:
@@ -14,13 +25,17 @@ public:
 	VkDescriptorPool descriptorPool;
 	VkDescriptorSet descriptorSet;
 
-	void createDescriptorLayoutSetPoolAndAllocate(uint32_t _swapChainImageCount);
-	void populateDescriptorSets(uint32_t _swapChainImageCount, VkBuffer uniformBuffers);
+	// textured adds a combined image sampler at binding 1 for the fragment shader, with the trilinear sampler immutable
+	void createDescriptorLayoutSetPoolAndAllocate(bool _textured = false);
+	// cheap to call every frame, nothing is written unless the buffer or the texture's view changed
+	void populateDescriptorSets(VkBuffer uniformBuffers, const Texture* texture = nullptr);
 
 	void destroy();
 
 private:
-	void createDescriptorSetLayout();
-	void createDescriptorPoolAndAllocateSets(uint32_t _swapChainImageCount);
-};
+	bool textured = false;
+	DescriptorTemplate descriptorTemplate;
 
+	void createDescriptorSetLayout();
+	void createDescriptorPoolAndAllocateSets();
+};
\ No newline at end of file
@@ -0,0 +1,356 @@
+#include "DescriptorTemplate.h"
+#include <array>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include "VulkanContext.h"
+#include "Tools.h"
+
+DescriptorTemplate::DescriptorTemplate()
+	: updateTemplate(VK_NULL_HANDLE), dataSize(0), updateDescriptorSetWithTemplate(nullptr), destroyDescriptorUpdateTemplate(nullptr), writeCount(0), skippedCount(0)
+{ }
+
+DescriptorTemplate::~DescriptorTemplate()
+{ }
+
+void DescriptorTemplate::create(VkDescriptorSetLayout descriptorSetLayout, const std::vector<VkDescriptorUpdateTemplateEntry>& _entries, size_t _dataSize)
+{
+	Device* device = VulkanContext::getInstance()->getDevice();
+
+	dataSize = _dataSize;
+	entries = _entries;
+	written.clear();
+	writeCount = 0;
+	skippedCount = 0;
+
+	updateTemplate = VK_NULL_HANDLE;
+	updateDescriptorSetWithTemplate = nullptr;
+	destroyDescriptorUpdateTemplate = nullptr;
+
+	// looked up rather than linked, so a 1.0 loader and driver still run
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device->physicalDevice, &properties);
+
+	PFN_vkCreateDescriptorUpdateTemplateKHR createDescriptorUpdateTemplate = nullptr;
+
+	if (properties.apiVersion >= VK_API_VERSION_1_1 && VulkanContext::getInstance()->getApiVersion() >= VK_API_VERSION_1_1)
+	{
+		createDescriptorUpdateTemplate = (PFN_vkCreateDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(device->logicalDevice, "vkCreateDescriptorUpdateTemplate");
+		updateDescriptorSetWithTemplate = (PFN_vkUpdateDescriptorSetWithTemplateKHR)vkGetDeviceProcAddr(device->logicalDevice, "vkUpdateDescriptorSetWithTemplate");
+		destroyDescriptorUpdateTemplate = (PFN_vkDestroyDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(device->logicalDevice, "vkDestroyDescriptorUpdateTemplate");
+	}
+	else if (device->isExtensionEnabled(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME))
+	{
+		createDescriptorUpdateTemplate = (PFN_vkCreateDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(device->logicalDevice, "vkCreateDescriptorUpdateTemplateKHR");
+		updateDescriptorSetWithTemplate = (PFN_vkUpdateDescriptorSetWithTemplateKHR)vkGetDeviceProcAddr(device->logicalDevice, "vkUpdateDescriptorSetWithTemplateKHR");
+		destroyDescriptorUpdateTemplate = (PFN_vkDestroyDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(device->logicalDevice, "vkDestroyDescriptorUpdateTemplateKHR");
+	}
+
+	if (!createDescriptorUpdateTemplate || !updateDescriptorSetWithTemplate || !destroyDescriptorUpdateTemplate)
+	{
+		// plain descriptor writes, set up once so update only copies the infos
+		updateDescriptorSetWithTemplate = nullptr;
+		destroyDescriptorUpdateTemplate = nullptr;
+
+		writes.assign(entries.size(), VkWriteDescriptorSet());
+		imageInfos.clear();
+		bufferInfos.clear();
+		texelBufferViews.clear();
+
+		for (const auto& entry : entries)
+		{
+			switch (entry.descriptorType)
+			{
+			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+				bufferInfos.resize(bufferInfos.size() + entry.descriptorCount);
+				break;
+			case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+			case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+				texelBufferViews.resize(texelBufferViews.size() + entry.descriptorCount);
+				break;
+			default:
+				imageInfos.resize(imageInfos.size() + entry.descriptorCount);
+				break;
+			}
+		}
+		return;
+	}
+
+	VkDescriptorUpdateTemplateCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+	createInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+	createInfo.pDescriptorUpdateEntries = entries.data();
+	createInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	createInfo.descriptorSetLayout = descriptorSetLayout;
+
+	if (createDescriptorUpdateTemplate(device->logicalDevice, &createInfo, nullptr, &updateTemplate) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create descriptor update template!");
+	}
+}
+
+// what the template would have done, one VkWriteDescriptorSet per entry
+void DescriptorTemplate::writeWithoutTemplate(VkDescriptorSet set, const void* data)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	size_t image = 0, buffer = 0, texelBuffer = 0;
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const VkDescriptorUpdateTemplateEntry& entry = entries[i];
+
+		VkWriteDescriptorSet& write = writes[i];
+		write = {};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = entry.dstBinding;
+		write.dstArrayElement = entry.dstArrayElement;
+		write.descriptorCount = entry.descriptorCount;
+		write.descriptorType = entry.descriptorType;
+
+		for (uint32_t element = 0; element < entry.descriptorCount; element++)
+		{
+			const uint8_t* source = bytes + entry.offset + element * entry.stride;
+
+			switch (entry.descriptorType)
+			{
+			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+				write.pBufferInfo = element == 0 ? &bufferInfos[buffer] : write.pBufferInfo;
+				memcpy(&bufferInfos[buffer++], source, sizeof(VkDescriptorBufferInfo));
+				break;
+			case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+			case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+				write.pTexelBufferView = element == 0 ? &texelBufferViews[texelBuffer] : write.pTexelBufferView;
+				memcpy(&texelBufferViews[texelBuffer++], source, sizeof(VkBufferView));
+				break;
+			default:
+				write.pImageInfo = element == 0 ? &imageInfos[image] : write.pImageInfo;
+				memcpy(&imageInfos[image++], source, sizeof(VkDescriptorImageInfo));
+				break;
+			}
+		}
+	}
+
+	vkUpdateDescriptorSets(VulkanContext::getInstance()->getDevice()->logicalDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+bool DescriptorTemplate::update(VkDescriptorSet set, const void* data)
+{
+	std::vector<uint8_t>& last = written[set];
+
+	if (last.size() == dataSize && memcmp(last.data(), data, dataSize) == 0)
+	{
+		skippedCount++;
+		return false;
+	}
+
+	last.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + dataSize);
+
+	if (updateTemplate != VK_NULL_HANDLE)
+	{
+		updateDescriptorSetWithTemplate(VulkanContext::getInstance()->getDevice()->logicalDevice, set, updateTemplate, data);
+	}
+	else
+	{
+		writeWithoutTemplate(set, data);
+	}
+	writeCount++;
+	return true;
+}
+
+void DescriptorTemplate::forget(VkDescriptorSet set)
+{
+	written.erase(set);
+}
+
+void DescriptorTemplate::destroy()
+{
+	if (updateTemplate != VK_NULL_HANDLE)
+	{
+		destroyDescriptorUpdateTemplate(VulkanContext::getInstance()->getDevice()->logicalDevice, updateTemplate, nullptr);
+		updateTemplate = VK_NULL_HANDLE;
+	}
+	written.clear();
+}
+
+void DescriptorTemplate::benchmark()
+{
+	const uint32_t kSetCount = 1024;
+	const uint32_t kFrames = 100;
+	const uint32_t kChangedPercent = 5;
+
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	// the shape of an object set, a uniform buffer and a storage buffer, both slices of one buffer
+	struct BenchmarkData
+	{
+		VkDescriptorBufferInfo uniforms;
+		VkDescriptorBufferInfo storage;
+	};
+
+	const VkDeviceSize kSliceSize = 256;
+
+	VkBuffer buffer;
+	VkDeviceMemory bufferMemory;
+	vkTools::createBuffer(kSliceSize * 4, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, buffer, bufferMemory);
+
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings = {};
+	bindings[0].binding = 0;
+	bindings[0].descriptorCount = 1;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	bindings[1].binding = 1;
+	bindings[1].descriptorCount = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutCreateInfo.pBindings = bindings.data();
+
+	VkDescriptorSetLayout layout;
+	if (vkCreateDescriptorSetLayout(logicalDevice, &layoutCreateInfo, nullptr, &layout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create benchmark descriptor set layout!!");
+	}
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].descriptorCount = kSetCount;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = kSetCount;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = kSetCount;
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create benchmark descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(kSetCount, layout);
+	std::vector<VkDescriptorSet> sets(kSetCount);
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = pool;
+	allocInfo.descriptorSetCount = kSetCount;
+	allocInfo.pSetLayouts = layouts.data();
+
+	if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, sets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate benchmark descriptor sets!");
+	}
+
+	// which slice a set points at in a frame, changed sets move to the next one
+	auto fill = [&](BenchmarkData& data, uint32_t set, uint32_t frame, bool everyFrame)
+	{
+		bool changed = everyFrame || (set * 7 + frame * 13) % 100 < kChangedPercent;
+		uint32_t slice = (set + (changed ? frame : 0)) & 3;
+
+		memset(&data, 0, sizeof(data));
+		data.uniforms = { buffer, slice * kSliceSize, kSliceSize };
+		data.storage = { buffer, ((slice + 1) & 3) * kSliceSize, kSliceSize };
+	};
+
+	auto report = [&](const std::string& name, uint64_t writes, double seconds)
+	{
+		std::cout << std::fixed << std::setprecision(1)
+			<< "DescriptorTemplate: " << name << ", " << kSetCount << " sets x " << kFrames << " frames, "
+			<< writes / (seconds * 1000.0) << " set writes per ms, " << seconds * 1000.0 / kFrames << " ms per frame" << std::endl;
+	};
+
+	// before, VkWriteDescriptorSets built by hand, one vkUpdateDescriptorSets per set like Descriptor used to
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t frame = 0; frame < kFrames; frame++)
+		{
+			for (uint32_t i = 0; i < kSetCount; i++)
+			{
+				BenchmarkData data;
+				fill(data, i, frame, true);
+
+				std::array<VkWriteDescriptorSet, 2> writes = {};
+				for (uint32_t b = 0; b < writes.size(); b++)
+				{
+					writes[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+					writes[b].dstSet = sets[i];
+					writes[b].dstBinding = b;
+					writes[b].descriptorCount = 1;
+					writes[b].descriptorType = bindings[b].descriptorType;
+					writes[b].pBufferInfo = b == 0 ? &data.uniforms : &data.storage;
+				}
+
+				vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+			}
+		}
+
+		report("vkUpdateDescriptorSets", (uint64_t)kSetCount * kFrames, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+	}
+
+	std::vector<VkDescriptorUpdateTemplateEntry> entries = {
+		descriptorTemplateEntry(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, offsetof(BenchmarkData, uniforms)),
+		descriptorTemplateEntry(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, offsetof(BenchmarkData, storage))
+	};
+
+	// after, the template with every set changing every frame and then with a few changing
+	for (int everyFrame = 1; everyFrame >= 0; everyFrame--)
+	{
+		DescriptorTemplate descriptorTemplate;
+		descriptorTemplate.create(layout, entries, sizeof(BenchmarkData));
+
+		// the first frame writes everything either way, it isn't timed
+		for (uint32_t i = 0; i < kSetCount; i++)
+		{
+			BenchmarkData data;
+			fill(data, i, 0, true);
+			descriptorTemplate.update(sets[i], data);
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t frame = 1; frame <= kFrames; frame++)
+		{
+			for (uint32_t i = 0; i < kSetCount; i++)
+			{
+				BenchmarkData data;
+				fill(data, i, frame, everyFrame != 0);
+				descriptorTemplate.update(sets[i], data);
+			}
+		}
+
+		double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		if (everyFrame)
+		{
+			report("template, every set changed", (uint64_t)kSetCount * kFrames, seconds);
+		}
+		else
+		{
+			// counted as requested writes, the skipped ones are what the dedup saves
+			report("template, " + std::to_string(kChangedPercent) + "% of sets changed", (uint64_t)kSetCount * kFrames, seconds);
+			std::cout << "DescriptorTemplate: " << descriptorTemplate.getWriteCount() - kSetCount << " written, " << descriptorTemplate.getSkippedCount() << " skipped" << std::endl;
+		}
+
+		descriptorTemplate.destroy();
+	}
+
+	vkDestroyDescriptorPool(logicalDevice, pool, nullptr);
+	vkDestroyDescriptorSetLayout(logicalDevice, layout, nullptr);
+	vkDestroyBuffer(logicalDevice, buffer, nullptr);
+	vkFreeMemory(logicalDevice, bufferMemory, nullptr);
+}
\ No newline at end of file
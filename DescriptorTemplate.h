@@ -0,0 +1,81 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <unordered_map>
+#include <type_traits>
+
+// -- Descriptor update template
+// Writes every binding of a set from one packed struct with vkUpdateDescriptorSetWithTemplate,
+// entries say where in the struct each binding's VkDescriptorBufferInfo / VkDescriptorImageInfo sits.
+// The driver walks a precompiled list instead of validating and decoding VkWriteDescriptorSets.
+// The last bytes written to every set are kept and a write of the same bytes is skipped, so
+// callers can write every frame and only pay when something changed.
+// Core in Vulkan 1.1, VK_KHR_descriptor_update_template before that. A device with neither gets
+// VkWriteDescriptorSets built from the same entries, behind the same skip.
+class DescriptorTemplate
+{
+public:
+	DescriptorTemplate();
+	~DescriptorTemplate();
+
+	// VK_NULL_HANDLE when the device has no templates
+	VkDescriptorUpdateTemplate updateTemplate;
+
+	// the struct is dataSize bytes, zero it before filling so padding compares equal
+	void create(VkDescriptorSetLayout descriptorSetLayout, const std::vector<VkDescriptorUpdateTemplateEntry>& _entries, size_t _dataSize);
+
+	// returns false when set already holds exactly this
+	bool update(VkDescriptorSet set, const void* data);
+
+	template<typename T>
+	bool update(VkDescriptorSet set, const T& data)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "descriptor template data is compared as bytes");
+		return update(set, static_cast<const void*>(&data));
+	}
+
+	// before freeing a set or writing it some other way
+	void forget(VkDescriptorSet set);
+
+	uint64_t getWriteCount() const { return writeCount; }
+	uint64_t getSkippedCount() const { return skippedCount; }
+
+	void destroy();
+
+	// descriptor writes per millisecond, hand built VkWriteDescriptorSets against the template with and
+	// without unchanged data, needs VulkanContext initialized
+	static void benchmark();
+
+private:
+	size_t dataSize;
+	std::unordered_map<VkDescriptorSet, std::vector<uint8_t>> written;
+
+	// core or KHR, null without either
+	PFN_vkUpdateDescriptorSetWithTemplateKHR updateDescriptorSetWithTemplate;
+	PFN_vkDestroyDescriptorUpdateTemplateKHR destroyDescriptorUpdateTemplate;
+
+	// the fallback writes, infos are copied out of the struct since entries can have any stride
+	std::vector<VkDescriptorUpdateTemplateEntry> entries;
+	std::vector<VkWriteDescriptorSet> writes;
+	std::vector<VkDescriptorImageInfo> imageInfos;
+	std::vector<VkDescriptorBufferInfo> bufferInfos;
+	std::vector<VkBufferView> texelBufferViews;
+
+	void writeWithoutTemplate(VkDescriptorSet set, const void* data);
+
+	uint64_t writeCount;
+	uint64_t skippedCount;
+};
+
+// one entry of a packed struct, offset is offsetof the member
+inline VkDescriptorUpdateTemplateEntry descriptorTemplateEntry(uint32_t binding, VkDescriptorType type, size_t offset, uint32_t count = 1, size_t stride = 0)
+{
+	VkDescriptorUpdateTemplateEntry entry = {};
+	entry.dstBinding = binding;
+	entry.dstArrayElement = 0;
+	entry.descriptorCount = count;
+	entry.descriptorType = type;
+	entry.offset = offset;
+	entry.stride = stride;
+	return entry;
+}
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "Device.h"
+#include <cstring>
+#include "VulkanContext.h"
 
 Device::Device()
 { }
@@ -19,6 +21,12 @@ void Device::pickPhysicalDevice(VulkanInstance* vInstance, VkSurfaceKHR surface)
 
 	std::cout << "Device Count: " << deviceCount << std::endl;
 
+	// headless, nothing is presented so the swapchain isn't needed
+	if (surface == VK_NULL_HANDLE)
+	{
+		deviceExtensions.clear();
+	}
+
 	std::vector<VkPhysicalDevice> devices(deviceCount);
 	vkEnumeratePhysicalDevices(vInstance->vkInstance, &deviceCount, devices.data());
 
@@ -45,6 +53,12 @@ void Device::pickPhysicalDevice(VulkanInstance* vInstance, VkSurfaceKHR surface)
 	{
 		throw std::runtime_error("failed to find suitable GPU!");
 	}
+
+	if (vInstance->apiVersion >= VK_API_VERSION_1_1)
+	{
+		getPhysicalDeviceFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2)vkGetInstanceProcAddr(vInstance->vkInstance, "vkGetPhysicalDeviceFeatures2");
+		getPhysicalDeviceProperties2 = (PFN_vkGetPhysicalDeviceProperties2)vkGetInstanceProcAddr(vInstance->vkInstance, "vkGetPhysicalDeviceProperties2");
+	}
 }
 
 bool Device::isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface) 
@@ -54,11 +68,11 @@ bool Device::isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface)
 
 	// check device extensions supported
 	bool extensionSupported = checkDeviceExtensionSupported(device);
-	bool swapChainAdequate = false;
+	bool swapChainAdequate = surface == VK_NULL_HANDLE;
 	
 	// if swapchain extension is present
 	// Check surface formats and presentation modes are supported
-	if (extensionSupported)
+	if (extensionSupported && surface != VK_NULL_HANDLE)
 	{
 		swapchainSupport = querySwapChainSupport(device, surface);
 		swapChainAdequate = !swapchainSupport.surfaceFormats.empty() && !swapchainSupport.presentModes.empty();
@@ -67,7 +81,8 @@ bool Device::isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface)
 	VkPhysicalDeviceFeatures supportedFeatures;
 	vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-	return qFamilyIndices.arePresent() && extensionSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+	// gpu culled indirect draws carry the instance id in firstInstance
+	return qFamilyIndices.arePresent() && extensionSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy && supportedFeatures.drawIndirectFirstInstance;
 }
 
 bool Device::checkDeviceExtensionSupported(VkPhysicalDevice device) 
@@ -135,13 +150,22 @@ QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device, VkSurfaceK
 		}
 
 		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+		if (surface != VK_NULL_HANDLE)
+		{
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+		}
 
 		if (queueFamily.queueCount > 0 && presentSupport)
 		{
 			queueFamilyIndices.presentFamily = i;
 		}
 
+		// headless, the graphics queue stands in for the present queue
+		if (surface == VK_NULL_HANDLE && queueFamilyIndices.graphicsFamily >= 0)
+		{
+			queueFamilyIndices.presentFamily = queueFamilyIndices.graphicsFamily;
+		}
+
 		if (queueFamilyIndices.arePresent())
 		{
 			break;
@@ -181,17 +205,91 @@ void Device::createLogicalDevice(VkSurfaceKHR surface, bool isValidationLayersEn
 	}
 
 	// specify device features
-	VkPhysicalDeviceFeatures deviceFeatures = {};
-	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+	enabledFeatures = {};
+	enabledFeatures.samplerAnisotropy = VK_TRUE;
+
+	// gpu driven draws: per draw instance ids are required, many indirect draws per call when the gpu has it
+	enabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	enabledFeatures.drawIndirectFirstInstance = VK_TRUE;
+
+	// cooked textures are BCn, every desktop gpu has it
+	enabledFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
+	// bindless, the buffer array is indexed with a push constant
+	enabledFeatures.shaderStorageBufferArrayDynamicIndexing = supportedFeatures.shaderStorageBufferArrayDynamicIndexing;
+
+	// descriptor indexing features can only be queried through vkGetPhysicalDeviceFeatures2, a 1.1 instance and device are needed
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	bool version11 = properties.apiVersion >= VK_API_VERSION_1_1 && VulkanContext::getInstance()->getApiVersion() >= VK_API_VERSION_1_1 &&
+		getPhysicalDeviceFeatures2 && getPhysicalDeviceProperties2;
+
+	// required extensions plus whichever optional ones the device has
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+	enabledDeviceExtensions = deviceExtensions;
+
+	for (const char* optionalExtension : optionalDeviceExtensions)
+	{
+		// both depend on VK_KHR_get_physical_device_properties2, core from 1.1, and only serve descriptor indexing
+		if (!version11 && (strcmp(optionalExtension, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0 || strcmp(optionalExtension, VK_KHR_MAINTENANCE3_EXTENSION_NAME) == 0))
+		{
+			continue;
+		}
+
+		for (const auto& extension : availableExtensions)
+		{
+			if (strcmp(optionalExtension, extension.extensionName) == 0)
+			{
+				enabledDeviceExtensions.push_back(optionalExtension);
+				break;
+			}
+		}
+	}
+
+	enabledDescriptorIndexingFeatures = {};
+	enabledDescriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+	if (isExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+	{
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT supportedIndexing = {};
+		supportedIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+		VkPhysicalDeviceFeatures2 features2 = {};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &supportedIndexing;
+		getPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+		// partially bound, update after bind arrays of images and buffers, images indexed per pixel
+		enabledDescriptorIndexingFeatures.runtimeDescriptorArray = supportedIndexing.runtimeDescriptorArray;
+		enabledDescriptorIndexingFeatures.descriptorBindingPartiallyBound = supportedIndexing.descriptorBindingPartiallyBound;
+		enabledDescriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = supportedIndexing.descriptorBindingSampledImageUpdateAfterBind;
+		enabledDescriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = supportedIndexing.descriptorBindingStorageBufferUpdateAfterBind;
+		enabledDescriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = supportedIndexing.descriptorBindingUpdateUnusedWhilePending;
+		enabledDescriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = supportedIndexing.shaderSampledImageArrayNonUniformIndexing;
+
+		bindlessSupported = supportedIndexing.runtimeDescriptorArray && supportedIndexing.descriptorBindingPartiallyBound &&
+			supportedIndexing.descriptorBindingSampledImageUpdateAfterBind && supportedIndexing.descriptorBindingStorageBufferUpdateAfterBind &&
+			supportedIndexing.descriptorBindingUpdateUnusedWhilePending && supportedIndexing.shaderSampledImageArrayNonUniformIndexing &&
+			supportedFeatures.shaderStorageBufferArrayDynamicIndexing;
+	}
 
 	VkDeviceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = isExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) ? &enabledDescriptorIndexingFeatures : nullptr;
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
-	createInfo.pEnabledFeatures = &deviceFeatures;
+	createInfo.pEnabledFeatures = &enabledFeatures;
 
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledDeviceExtensions.size());
+	createInfo.ppEnabledExtensionNames = enabledDeviceExtensions.data();
 
 	if (isValidationLayersEnabled)
 	{
@@ -216,6 +314,18 @@ void Device::createLogicalDevice(VkSurfaceKHR surface, bool isValidationLayersEn
 	vkGetDeviceQueue(logicalDevice, indices.presentFamily, 0, &presentQueue);
 }
 
+bool Device::isExtensionEnabled(const char* extensionName)
+{
+	for (const char* extension : enabledDeviceExtensions)
+	{
+		if (strcmp(extension, extensionName) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 void Device::destroy()
 { 
 	vkDestroyDevice(logicalDevice, nullptr);
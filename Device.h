@@ -46,6 +46,16 @@ public:
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME
 	};
 
+	// enabled only when the gpu exposes them, check with isExtensionEnabled
+	std::vector<const char*> optionalDeviceExtensions =
+	{
+		VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME,
+		VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME,
+		VK_KHR_MAINTENANCE3_EXTENSION_NAME,
+		VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME
+	};
+
+	// surface is VK_NULL_HANDLE for a headless device, no swapchain and no presentation
 	void pickPhysicalDevice(VulkanInstance* vInstance, VkSurfaceKHR surface);
 	bool isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface);
 	bool checkDeviceExtensionSupported(VkPhysicalDevice device);
@@ -53,17 +63,33 @@ public:
 	QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface);
 	QueueFamilyIndices getQueueFamiliesIndicesOfCurrentDevice();
 
+	// 1.1 entry points from vkGetInstanceProcAddr, a 1.0 loader doesn't export them and a static import
+	// would keep the app from starting at all, null on a 1.0 instance
+	PFN_vkGetPhysicalDeviceFeatures2 getPhysicalDeviceFeatures2 = nullptr;
+	PFN_vkGetPhysicalDeviceProperties2 getPhysicalDeviceProperties2 = nullptr;
+
 	// ++++++++++++++
 	// Logical device
 	// ++++++++++++++
 
 	void createLogicalDevice(VkSurfaceKHR surface, bool isValidationLayersEnabled, AppValidationLayersAndExtensions* appValLayersAndExtensions);
+	bool isExtensionEnabled(const char* extensionName);
 	VkDevice logicalDevice;
 
+	std::vector<const char*> enabledDeviceExtensions;
+	VkPhysicalDeviceFeatures enabledFeatures;
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT enabledDescriptorIndexingFeatures;
+
+	// VK_EXT_descriptor_indexing with everything BindlessResources needs
+	bool isBindlessSupported() { return bindlessSupported; }
+
 	// handle to the graphics queue from the queue families fo the gpu
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
 
 	void destroy();
+
+private:
+	bool bindlessSupported = false;
 };
 
@@ -0,0 +1,663 @@
+#include "GpuCulling.h"
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <iostream>
+#include "VulkanContext.h"
+#include "Tools.h"
+
+GpuCulling::GpuCulling()
+{ }
+
+GpuCulling::~GpuCulling()
+{ }
+
+void GpuCulling::createCullingBuffersAndPipelines(uint32_t _maxInstances, VkExtent2D depthExtent)
+{
+	maxInstances = _maxInstances;
+	instancesDirty = true;
+	occlusionEnabled = false;
+
+	Device* device = VulkanContext::getInstance()->getDevice();
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device->physicalDevice, &properties);
+
+	// without multiDrawIndirect the limit is 1 and every draw call takes a single command
+	maxDrawIndirectCount = device->enabledFeatures.multiDrawIndirect ? properties.limits.maxDrawIndirectCount : 1;
+
+	// the count path issues one call for every survivor, it needs multi draw and a limit that covers all instances
+	useDrawIndirectCount = device->isExtensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) &&
+		device->enabledFeatures.multiDrawIndirect && maxInstances <= maxDrawIndirectCount;
+	cmdDrawIndexedIndirectCount = nullptr;
+
+	if (useDrawIndirectCount)
+	{
+		cmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(device->logicalDevice, "vkCmdDrawIndexedIndirectCountKHR");
+		useDrawIndirectCount = cmdDrawIndexedIndirectCount != nullptr;
+	}
+
+	createBuffers();
+	createHiZPyramid(depthExtent);
+	createDescriptorSetLayouts();
+	createDescriptorPoolAndAllocateSets();
+
+	std::vector<VkDescriptorUpdateTemplateEntry> hiZEntries = {
+		descriptorTemplateEntry(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(HiZDescriptorData, source)),
+		descriptorTemplateEntry(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(HiZDescriptorData, destination))
+	};
+	hiZTemplate.create(hiZDescriptorSetLayout, hiZEntries, sizeof(HiZDescriptorData));
+
+	populateDescriptorSets();
+
+	cullPipeline.createComputePipelineLayoutAndPipeline("Shaders/SPIRV/cull.comp.spv", cullDescriptorSetLayout);
+	hiZPipeline.createComputePipelineLayoutAndPipeline("Shaders/SPIRV/hiz_reduce.comp.spv", hiZDescriptorSetLayout, sizeof(int32_t) * 2);
+}
+
+void GpuCulling::createBuffers()
+{
+	// bounds are rewritten from the cpu when objects move, keep them host visible
+	vkTools::createBuffer(sizeof(CullInstance) * maxInstances, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, instanceBuffer, instanceBufferMemory);
+
+	// written and read by the gpu, copied out only by validate()
+	vkTools::createBuffer(sizeof(VkDrawIndexedIndirectCommand) * maxInstances, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawCommandBuffer, drawCommandBufferMemory);
+	vkTools::createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawCountBuffer, drawCountBufferMemory);
+
+	vkTools::createBuffer(sizeof(CullUniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffer, uniformBufferMemory);
+}
+
+static uint32_t previousPowerOfTwo(uint32_t value)
+{
+	uint32_t power = 1;
+	while (power <= value / 2)
+	{
+		power *= 2;
+	}
+	return power;
+}
+
+void GpuCulling::createHiZPyramid(VkExtent2D depthExtent)
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	// level 0 is the largest power of two that fits in the depth buffer, every level after halves
+	// exactly down to 1x1, so a uv lands in the texel whose footprint holds that uv's depth
+	hiZExtent.width = previousPowerOfTwo(std::max(1u, depthExtent.width));
+	hiZExtent.height = previousPowerOfTwo(std::max(1u, depthExtent.height));
+
+	hiZMipCount = 1;
+	for (uint32_t size = std::max(hiZExtent.width, hiZExtent.height); size > 1; size /= 2)
+	{
+		hiZMipCount++;
+	}
+
+	vkTools::createImage(hiZExtent.width, hiZExtent.height, hiZMipCount, VK_FORMAT_R32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, hiZImage, hiZImageMemory);
+
+	// written and sampled from compute only, so it lives in the general layout
+	vkTools::transitionImageLayout(hiZImage, VK_IMAGE_ASPECT_COLOR_BIT, hiZMipCount, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+	// full mip chain view for the culling shader, one view per mip for the reduction
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = hiZImage;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R32_SFLOAT;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = hiZMipCount;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(logicalDevice, &viewInfo, nullptr, &hiZImageView) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create hi-z image view!");
+	}
+
+	hiZMipViews.resize(hiZMipCount);
+
+	for (uint32_t i = 0; i < hiZMipCount; i++)
+	{
+		viewInfo.subresourceRange.baseMipLevel = i;
+		viewInfo.subresourceRange.levelCount = 1;
+
+		if (vkCreateImageView(logicalDevice, &viewInfo, nullptr, &hiZMipViews[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create hi-z mip image view!");
+		}
+	}
+
+	// point sampling, the pyramid values must not be blended
+	hiZSampler = VulkanContext::getInstance()->getSamplerCache()->getPointClampSampler();
+}
+
+void GpuCulling::createDescriptorSetLayouts()
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	// cull.comp: cull data, instances, draw commands, draw count, hi-z pyramid
+	std::array<VkDescriptorSetLayoutBinding, 5> cullBindings = {};
+	VkDescriptorType cullTypes[] = {
+		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+	};
+
+	for (uint32_t i = 0; i < cullBindings.size(); i++)
+	{
+		cullBindings[i].binding = i;
+		cullBindings[i].descriptorCount = 1;
+		cullBindings[i].descriptorType = cullTypes[i];
+		cullBindings[i].pImmutableSamplers = cullTypes[i] == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ? &hiZSampler : nullptr;
+		cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(cullBindings.size());
+	layoutCreateInfo.pBindings = cullBindings.data();
+
+	if (vkCreateDescriptorSetLayout(logicalDevice, &layoutCreateInfo, nullptr, &cullDescriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create cull descriptor set layout!!");
+	}
+
+	// hiz_reduce.comp: source level, destination level
+	std::array<VkDescriptorSetLayoutBinding, 2> hiZBindings = {};
+	hiZBindings[0].binding = 0;
+	hiZBindings[0].descriptorCount = 1;
+	hiZBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	hiZBindings[0].pImmutableSamplers = &hiZSampler;
+	hiZBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	hiZBindings[1].binding = 1;
+	hiZBindings[1].descriptorCount = 1;
+	hiZBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	hiZBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(hiZBindings.size());
+	layoutCreateInfo.pBindings = hiZBindings.data();
+
+	if (vkCreateDescriptorSetLayout(logicalDevice, &layoutCreateInfo, nullptr, &hiZDescriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create hi-z descriptor set layout!!");
+	}
+}
+
+void GpuCulling::createDescriptorPoolAndAllocateSets()
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	// one cull set and one reduction set per pyramid level
+	std::array<VkDescriptorPoolSize, 4> poolSizes = {};
+
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].descriptorCount = 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = 3;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[2].descriptorCount = 1 + hiZMipCount;
+	poolSizes[3].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[3].descriptorCount = hiZMipCount;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = 1 + hiZMipCount;
+
+	if (vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create cull descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &cullDescriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &cullDescriptorSet) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate cull descriptor set!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(hiZMipCount, hiZDescriptorSetLayout);
+	hiZDescriptorSets.resize(hiZMipCount);
+
+	allocInfo.descriptorSetCount = hiZMipCount;
+	allocInfo.pSetLayouts = layouts.data();
+
+	if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, hiZDescriptorSets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate hi-z descriptor sets!");
+	}
+}
+
+void GpuCulling::populateDescriptorSets()
+{
+	std::array<VkDescriptorBufferInfo, 4> bufferInfos = {};
+	bufferInfos[0] = { uniformBuffer, 0, sizeof(CullUniformBufferObject) };
+	bufferInfos[1] = { instanceBuffer, 0, VK_WHOLE_SIZE };
+	bufferInfos[2] = { drawCommandBuffer, 0, VK_WHOLE_SIZE };
+	bufferInfos[3] = { drawCountBuffer, 0, VK_WHOLE_SIZE };
+
+	VkDescriptorImageInfo hiZInfo = {};
+	hiZInfo.sampler = hiZSampler;
+	hiZInfo.imageView = hiZImageView;
+	hiZInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	std::array<VkWriteDescriptorSet, 5> descWrites = {};
+
+	for (uint32_t i = 0; i < descWrites.size(); i++)
+	{
+		descWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descWrites[i].dstSet = cullDescriptorSet;
+		descWrites[i].dstBinding = i;
+		descWrites[i].dstArrayElement = 0;
+		descWrites[i].descriptorCount = 1;
+
+		if (i < bufferInfos.size())
+		{
+			descWrites[i].descriptorType = (i == 0) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descWrites[i].pBufferInfo = &bufferInfos[i];
+		}
+		else
+		{
+			descWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			descWrites[i].pImageInfo = &hiZInfo;
+		}
+	}
+
+	vkUpdateDescriptorSets(VulkanContext::getInstance()->getDevice()->logicalDevice, static_cast<uint32_t>(descWrites.size()), descWrites.data(), 0, nullptr);
+
+	// every level after the first reads the level above it
+	// level 0 reads the depth buffer and is written once buildHiZ gets a depth view
+	for (uint32_t level = 1; level < hiZMipCount; level++)
+	{
+		writeHiZSource(level, hiZMipViews[level - 1], VK_IMAGE_LAYOUT_GENERAL);
+	}
+}
+
+void GpuCulling::writeHiZSource(uint32_t level, VkImageView srcView, VkImageLayout srcLayout)
+{
+	// zeroed padding included, the template compares the bytes
+	HiZDescriptorData data;
+	memset(&data, 0, sizeof(data));
+
+	data.source.imageView = srcView;
+	data.source.imageLayout = srcLayout;
+
+	data.destination.imageView = hiZMipViews[level];
+	data.destination.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	hiZTemplate.update(hiZDescriptorSets[level], data);
+}
+
+uint32_t GpuCulling::addInstance(glm::vec4 boundingSphere, uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset)
+{
+	if (instances.size() >= maxInstances)
+	{
+		throw std::runtime_error("gpu culling instance buffer is full!");
+	}
+
+	CullInstance instance = {};
+	instance.boundingSphere = boundingSphere;
+	instance.indexCount = indexCount;
+	instance.firstIndex = firstIndex;
+	instance.vertexOffset = vertexOffset;
+	instance.instanceId = static_cast<uint32_t>(instances.size());
+
+	instances.push_back(instance);
+	instancesDirty = true;
+
+	return instance.instanceId;
+}
+
+void GpuCulling::setInstanceBounds(uint32_t instanceId, glm::vec4 boundingSphere)
+{
+	instances[instanceId].boundingSphere = boundingSphere;
+	instancesDirty = true;
+}
+
+void GpuCulling::clearInstances()
+{
+	instances.clear();
+	instancesDirty = true;
+}
+
+void GpuCulling::uploadInstances()
+{
+	if (!instancesDirty || instances.empty())
+	{
+		return;
+	}
+
+	VkDeviceSize size = sizeof(CullInstance) * instances.size();
+
+	void* data;
+	vkMapMemory(VulkanContext::getInstance()->getDevice()->logicalDevice, instanceBufferMemory, 0, size, 0, &data);
+	memcpy(data, instances.data(), (size_t)size);
+	vkUnmapMemory(VulkanContext::getInstance()->getDevice()->logicalDevice, instanceBufferMemory);
+
+	instancesDirty = false;
+}
+
+void GpuCulling::buildHiZ(VkCommandBuffer commandBuffer, VkImageView depthImageView)
+{
+	// only written when the depth view is a different one
+	writeHiZSource(0, depthImageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hiZPipeline.computePipeline);
+
+	// make the depth writes of the last frame visible to the first reduction
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	int32_t levelSize[2] = { (int32_t)hiZExtent.width, (int32_t)hiZExtent.height };
+
+	for (uint32_t level = 0; level < hiZMipCount; level++)
+	{
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hiZPipeline.pipelineLayout, 0, 1, &hiZDescriptorSets[level], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, hiZPipeline.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(levelSize), levelSize);
+
+		vkCmdDispatch(commandBuffer, (levelSize[0] + 7) / 8, (levelSize[1] + 7) / 8, 1);
+
+		// the next level reads what this one wrote, the last one is read by cull.comp
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		levelSize[0] = std::max(1, levelSize[0] / 2);
+		levelSize[1] = std::max(1, levelSize[1] / 2);
+	}
+
+	occlusionEnabled = true;
+}
+
+void GpuCulling::dispatch(VkCommandBuffer commandBuffer, Camera camera)
+{
+	uploadInstances();
+
+	CullUniformBufferObject cullData = {};
+
+	glm::mat4 proj = camera.getprojectionMatrix();
+	proj[1][1] *= -1; // same flip as ObjectRenderer so the rect matches the framebuffer
+
+	cullData.viewProj = proj * camera.getViewMatrix();
+
+	// the y flip only swaps top and bottom, the planes are the same either way
+	camera.getFrustumPlanes(cullData.frustumPlanes);
+
+	cullData.hiZParams = glm::vec4((float)hiZExtent.width, (float)hiZExtent.height, (float)hiZMipCount, occlusionEnabled ? 1.0f : 0.0f);
+	cullData.instanceCount = static_cast<uint32_t>(instances.size());
+	cullData.compact = useDrawIndirectCount ? 1 : 0;
+
+	void* data;
+	vkMapMemory(VulkanContext::getInstance()->getDevice()->logicalDevice, uniformBufferMemory, 0, sizeof(cullData), 0, &data);
+	memcpy(data, &cullData, sizeof(cullData));
+	vkUnmapMemory(VulkanContext::getInstance()->getDevice()->logicalDevice, uniformBufferMemory);
+
+	// reset the append counter
+	vkCmdFillBuffer(commandBuffer, drawCountBuffer, 0, sizeof(uint32_t), 0);
+
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline.computePipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline.pipelineLayout, 0, 1, &cullDescriptorSet, 0, nullptr);
+
+	vkCmdDispatch(commandBuffer, (cullData.instanceCount + 63) / 64, 1, 1);
+
+	// draw commands and count are consumed by the indirect draw
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuCulling::drawIndirect(VkCommandBuffer commandBuffer)
+{
+	uint32_t drawCount = static_cast<uint32_t>(instances.size());
+
+	if (drawCount == 0)
+	{
+		return;
+	}
+
+	if (useDrawIndirectCount)
+	{
+		cmdDrawIndexedIndirectCount(commandBuffer, drawCommandBuffer, 0, drawCountBuffer, 0, std::min(drawCount, maxDrawIndirectCount), sizeof(VkDrawIndexedIndirectCommand));
+		return;
+	}
+
+	// every slot is drawn, as many per call as the device allows
+	for (uint32_t first = 0; first < drawCount; first += maxDrawIndirectCount)
+	{
+		uint32_t count = std::min(drawCount - first, maxDrawIndirectCount);
+		vkCmdDrawIndexedIndirect(commandBuffer, drawCommandBuffer, first * sizeof(VkDrawIndexedIndirectCommand), count, sizeof(VkDrawIndexedIndirectCommand));
+	}
+}
+
+void GpuCulling::destroy()
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	cullPipeline.destroy();
+	hiZPipeline.destroy();
+
+	hiZTemplate.destroy();
+
+	vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(logicalDevice, cullDescriptorSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(logicalDevice, hiZDescriptorSetLayout, nullptr);
+
+	for (auto mipView : hiZMipViews)
+	{
+		vkDestroyImageView(logicalDevice, mipView, nullptr);
+	}
+	vkDestroyImageView(logicalDevice, hiZImageView, nullptr);
+	vkDestroyImage(logicalDevice, hiZImage, nullptr);
+	vkFreeMemory(logicalDevice, hiZImageMemory, nullptr);
+
+	vkDestroyBuffer(logicalDevice, uniformBuffer, nullptr);
+	vkFreeMemory(logicalDevice, uniformBufferMemory, nullptr);
+
+	vkDestroyBuffer(logicalDevice, drawCountBuffer, nullptr);
+	vkFreeMemory(logicalDevice, drawCountBufferMemory, nullptr);
+
+	vkDestroyBuffer(logicalDevice, drawCommandBuffer, nullptr);
+	vkFreeMemory(logicalDevice, drawCommandBufferMemory, nullptr);
+
+	vkDestroyBuffer(logicalDevice, instanceBuffer, nullptr);
+	vkFreeMemory(logicalDevice, instanceBufferMemory, nullptr);
+}
+
+
+bool GpuCulling::validate(uint32_t instanceCount)
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	Camera camera;
+	camera.init(45.0f, 1280.0f, 720.0f, 0.1f, 1000.0f);
+	camera.lookAt(glm::vec3(0.0f, 10.0f, 60.0f), glm::vec3(0.0f));
+
+	GpuCulling culling;
+	culling.createCullingBuffersAndPipelines(instanceCount, { 64, 64 });
+
+	// fixed seed, spheres all around the camera so every plane culls some
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 4.0f);
+
+	for (uint32_t i = 0; i < instanceCount; i++)
+	{
+		glm::vec4 sphere(position(random), position(random), position(random), radius(random));
+		culling.addInstance(sphere, 3 * (i % 7 + 1), 3 * i, static_cast<int32_t>(i % 11) - 5);
+	}
+
+	VkDeviceSize commandsSize = sizeof(VkDrawIndexedIndirectCommand) * instanceCount;
+
+	VkBuffer readbackBuffer;
+	VkDeviceMemory readbackBufferMemory;
+	vkTools::createBuffer(commandsSize + sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffer, readbackBufferMemory);
+
+	VkCommandPoolCreateInfo cpInfo = {};
+	cpInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	cpInfo.queueFamilyIndex = VulkanContext::getInstance()->getDevice()->getQueueFamiliesIndicesOfCurrentDevice().graphicsFamily;
+
+	VkCommandPool commandPool;
+	if (vkCreateCommandPool(logicalDevice, &cpInfo, nullptr, &commandPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create command pool!!");
+	}
+
+	// cull, then copy the commands and the count out in the same submit
+	VkCommandBuffer commandBuffer = vkTools::beginSingleTimeCommands(commandPool);
+
+	culling.dispatch(commandBuffer, camera);
+
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	VkBufferCopy region = {};
+	region.size = commandsSize;
+	vkCmdCopyBuffer(commandBuffer, culling.drawCommandBuffer, readbackBuffer, 1, &region);
+
+	region.dstOffset = commandsSize;
+	region.size = sizeof(uint32_t);
+	vkCmdCopyBuffer(commandBuffer, culling.drawCountBuffer, readbackBuffer, 1, &region);
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	vkTools::endSingleTimeCommands(commandBuffer, commandPool);
+
+	std::vector<VkDrawIndexedIndirectCommand> commands(instanceCount);
+	uint32_t drawCount;
+
+	void* data;
+	vkMapMemory(logicalDevice, readbackBufferMemory, 0, commandsSize + sizeof(uint32_t), 0, &data);
+	memcpy(commands.data(), data, (size_t)commandsSize);
+	memcpy(&drawCount, static_cast<uint8_t*>(data) + commandsSize, sizeof(uint32_t));
+	vkUnmapMemory(logicalDevice, readbackBufferMemory);
+
+	// the cpu reference, same planes and the same test as cull.comp
+	// spheres within a hair of a plane can land either way in float, those aren't compared
+	glm::vec4 planes[6];
+	camera.getFrustumPlanes(planes);
+
+	std::vector<int> expected(instanceCount);
+	uint32_t expectedCount = 0;
+	uint32_t borderline = 0;
+
+	for (uint32_t i = 0; i < instanceCount; i++)
+	{
+		glm::vec4 sphere = culling.instances[i].boundingSphere;
+		float margin = std::numeric_limits<float>::max();
+
+		for (int p = 0; p < 6; p++)
+		{
+			margin = std::min(margin, glm::dot(glm::vec3(planes[p]), glm::vec3(sphere)) + planes[p].w + sphere.w);
+		}
+
+		if (std::abs(margin) < 1e-3f)
+		{
+			expected[i] = -1;
+			borderline++;
+		}
+		else
+		{
+			expected[i] = margin >= 0.0f ? 1 : 0;
+			expectedCount += expected[i];
+		}
+	}
+
+	uint32_t mismatches = 0;
+	uint32_t visibleCount = 0;
+
+	auto matchesInstance = [&](const VkDrawIndexedIndirectCommand& command, uint32_t id)
+	{
+		const CullInstance& instance = culling.instances[id];
+		return command.indexCount == instance.indexCount && command.firstIndex == instance.firstIndex &&
+			command.vertexOffset == instance.vertexOffset && command.firstInstance == instance.instanceId;
+	};
+
+	if (culling.useDrawIndirectCount)
+	{
+		// compacted, survivors in any order, each exactly once
+		std::vector<int> drawn(instanceCount, 0);
+
+		for (uint32_t slot = 0; slot < std::min(drawCount, instanceCount); slot++)
+		{
+			uint32_t id = commands[slot].firstInstance;
+
+			if (id >= instanceCount || commands[slot].instanceCount != 1 || !matchesInstance(commands[slot], id) || drawn[id]++ > 0)
+			{
+				mismatches++;
+			}
+		}
+
+		for (uint32_t i = 0; i < instanceCount; i++)
+		{
+			if (expected[i] >= 0 && (drawn[i] > 0) != (expected[i] > 0))
+			{
+				mismatches++;
+			}
+		}
+
+		if (drawCount > instanceCount)
+		{
+			mismatches++;
+		}
+
+		visibleCount = drawCount;
+	}
+	else
+	{
+		// every slot written in place, culled ones with 0 instances
+		for (uint32_t i = 0; i < instanceCount; i++)
+		{
+			if (!matchesInstance(commands[i], i) || (expected[i] >= 0 && commands[i].instanceCount != (uint32_t)expected[i]))
+			{
+				mismatches++;
+			}
+
+			visibleCount += commands[i].instanceCount;
+		}
+	}
+
+	uint32_t validationErrors = VulkanContext::getInstance()->getValidationErrorCount();
+
+	std::cout << "GpuCulling: " << instanceCount << " instances, " << (culling.useDrawIndirectCount ? "compacted" : "in place")
+		<< ", expected " << expectedCount << " visible (" << borderline << " on a plane, not compared)"
+		<< ", gpu drew " << visibleCount
+		<< ", " << mismatches << " mismatches, " << validationErrors << " validation errors" << std::endl;
+
+	vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+	vkDestroyBuffer(logicalDevice, readbackBuffer, nullptr);
+	vkFreeMemory(logicalDevice, readbackBufferMemory, nullptr);
+
+	culling.destroy();
+
+	return mismatches == 0 && validationErrors == 0;
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "ComputePipeline.h"
+#include "Camera.h"
+#include "DescriptorTemplate.h"
+
+// matches CullInstance in Shaders/cull.comp (std430)
+struct CullInstance
+{
+	glm::vec4 boundingSphere; // world space center xyz, radius w
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t instanceId;      // becomes firstInstance of the draw, read it with gl_InstanceIndex
+};
+
+// matches CullData in Shaders/cull.comp (std140)
+struct CullUniformBufferObject
+{
+	glm::mat4 viewProj;
+	glm::vec4 frustumPlanes[6];
+	glm::vec4 hiZParams; // pyramid width, height, mip count, occlusion enabled
+	uint32_t instanceCount;
+	uint32_t compact;
+	uint32_t padding[2];
+};
+
+// what a hi-z reduction set holds, the source's sampler is immutable
+struct HiZDescriptorData
+{
+	VkDescriptorImageInfo source;
+	VkDescriptorImageInfo destination;
+};
+
+// GPU driven visibility
+// per instance bounds live in a storage buffer, cull.comp tests them against the frustum
+// and the Hi-Z pyramid and appends the survivors to an indirect draw buffer.
+// Record dispatch() between VulkanContext::frameBegin and renderPassBegin,
+// then drawIndirect() inside the render pass with the mesh pipeline and buffers bound.
+class GpuCulling
+{
+public:
+	GpuCulling();
+	~GpuCulling();
+
+	VkBuffer instanceBuffer;
+	VkDeviceMemory instanceBufferMemory;
+
+	VkBuffer drawCommandBuffer;
+	VkDeviceMemory drawCommandBufferMemory;
+
+	VkBuffer drawCountBuffer;
+	VkDeviceMemory drawCountBufferMemory;
+
+	VkBuffer uniformBuffer;
+	VkDeviceMemory uniformBufferMemory;
+
+	// Hi-Z pyramid, every mip keeps the farthest depth of its footprint
+	VkImage hiZImage;
+	VkDeviceMemory hiZImageMemory;
+	VkImageView hiZImageView;
+	std::vector<VkImageView> hiZMipViews;
+	VkSampler hiZSampler;	// from the sampler cache, immutable in both layouts
+	VkExtent2D hiZExtent;
+	uint32_t hiZMipCount;
+
+	void createCullingBuffersAndPipelines(uint32_t _maxInstances, VkExtent2D depthExtent);
+
+	uint32_t addInstance(glm::vec4 boundingSphere, uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset);
+	void setInstanceBounds(uint32_t instanceId, glm::vec4 boundingSphere);
+	void clearInstances();
+
+	// depth must be in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+	// occlusion stays off until the pyramid has been built once
+	void buildHiZ(VkCommandBuffer commandBuffer, VkImageView depthImageView);
+	void dispatch(VkCommandBuffer commandBuffer, Camera camera);
+	void drawIndirect(VkCommandBuffer commandBuffer);
+
+	void destroy();
+
+	// dispatches cull.comp once over instanceCount random spheres, reads the draw commands and count back
+	// and compares them with the cpu frustum test, false on any mismatch or validation error
+	// needs VulkanContext initialized, headless is enough, and the compiled culling shaders
+	static bool validate(uint32_t instanceCount);
+
+private:
+	std::vector<CullInstance> instances;
+	uint32_t maxInstances;
+	bool instancesDirty;
+	bool occlusionEnabled;
+
+	// without VK_KHR_draw_indirect_count and multiDrawIndirect every slot is drawn and culled ones have 0 instances
+	bool useDrawIndirectCount;
+	uint32_t maxDrawIndirectCount;
+	PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount;
+
+	ComputePipeline cullPipeline;
+	VkDescriptorSetLayout cullDescriptorSetLayout;
+	VkDescriptorSet cullDescriptorSet;
+
+	ComputePipeline hiZPipeline;
+	VkDescriptorSetLayout hiZDescriptorSetLayout;
+	std::vector<VkDescriptorSet> hiZDescriptorSets;
+	DescriptorTemplate hiZTemplate;
+
+	VkDescriptorPool descriptorPool;
+
+	void createBuffers();
+	void createHiZPyramid(VkExtent2D depthExtent);
+	void createDescriptorSetLayouts();
+	void createDescriptorPoolAndAllocateSets();
+	void populateDescriptorSets();
+	void writeHiZSource(uint32_t level, VkImageView srcView, VkImageLayout srcLayout);
+	void uploadInstances();
+};
@@ -0,0 +1,577 @@
+#include "GpuSkinning.h"
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include "VulkanContext.h"
+#include "Tools.h"
+#include "VertexFormat.h"
+
+// matches SkinningConstants in Shaders/skinning.comp
+struct SkinningConstants
+{
+	uint32_t vertexCount;
+	uint32_t attributeOffset;	// in 32 bit words
+	uint32_t morphEnabled;
+};
+
+// matches MorphConstants in Shaders/morph.comp
+struct MorphConstants
+{
+	uint32_t activeOffset;		// first ActiveMorphTarget of the instance in this frame's slice
+	uint32_t activeCount;
+	uint32_t deltaCount;		// over all of the instance's active targets
+};
+
+// matches ActiveTarget in Shaders/morph.comp
+struct ActiveMorphTarget
+{
+	uint32_t firstDelta;
+	uint32_t deltaCount;
+	float weight;
+	uint32_t firstThread;		// sum of deltaCount of the entries before it
+};
+
+GpuSkinning::GpuSkinning()
+{ }
+
+GpuSkinning::~GpuSkinning()
+{ }
+
+void GpuSkinning::createSkinningBuffersAndPipeline(uint32_t _maxInstances, uint32_t maxJoints, uint32_t _maxActiveMorphTargets)
+{
+	maxInstances = _maxInstances;
+	maxActiveMorphTargets = std::max(_maxActiveMorphTargets, 1u);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(VulkanContext::getInstance()->getDevice()->physicalDevice, &properties);
+
+	// every instance's matrices start on an offset a storage descriptor can point at
+	jointAlignment = std::max<VkDeviceSize>(properties.limits.minStorageBufferOffsetAlignment, sizeof(glm::mat4));
+	jointSliceSize = (maxJoints * sizeof(glm::mat4) + maxInstances * jointAlignment + jointAlignment - 1) / jointAlignment * jointAlignment;
+	nextJointOffset = 0;
+
+	uint32_t sliceCount = static_cast<uint32_t>(VulkanContext::getInstance()->getSwapChain()->swapChainImages.size());
+
+	// rewritten from the cpu every frame an instance moves
+	vkTools::createBuffer(jointSliceSize * sliceCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, jointBuffer, jointBufferMemory);
+
+	activeMorphSliceSize = (maxActiveMorphTargets * sizeof(ActiveMorphTarget) + jointAlignment - 1) / jointAlignment * jointAlignment;
+	vkTools::createBuffer(activeMorphSliceSize * sliceCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, activeMorphBuffer, activeMorphBufferMemory);
+
+	// never read, morphEnabled is 0 whenever it is bound
+	vkTools::createBuffer(sizeof(int32_t) * 6, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, emptyMorphBuffer, emptyMorphBufferMemory);
+
+	createDescriptorSetLayouts();
+	createDescriptorPool();
+
+	skinningPipeline.createComputePipelineLayoutAndPipeline("Shaders/SPIRV/skinning.comp.spv", descriptorSetLayout, sizeof(SkinningConstants));
+	morphPipeline.createComputePipelineLayoutAndPipeline("Shaders/SPIRV/morph.comp.spv", morphDescriptorSetLayout, sizeof(MorphConstants));
+}
+
+void GpuSkinning::createDescriptorSetLayouts()
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	// skinning.comp: joint matrices ( offset by the frame's slice ), bind pose vertices, skinned output, morph deltas
+	std::array<VkDescriptorSetLayoutBinding, 4> bindings = {};
+	VkDescriptorType types[] = {
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+	};
+
+	for (uint32_t i = 0; i < bindings.size(); i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorCount = 1;
+		bindings[i].descriptorType = types[i];
+		bindings[i].pImmutableSamplers = nullptr;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutCreateInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(logicalDevice, &layoutCreateInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create skinning descriptor set layout!!");
+	}
+
+	// morph.comp: the mesh's deltas, the instance's morph buffer, active targets ( offset by the frame's slice )
+	std::array<VkDescriptorSetLayoutBinding, 3> morphBindings = {};
+	VkDescriptorType morphTypes[] = {
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC
+	};
+
+	for (uint32_t i = 0; i < morphBindings.size(); i++)
+	{
+		morphBindings[i].binding = i;
+		morphBindings[i].descriptorCount = 1;
+		morphBindings[i].descriptorType = morphTypes[i];
+		morphBindings[i].pImmutableSamplers = nullptr;
+		morphBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(morphBindings.size());
+	layoutCreateInfo.pBindings = morphBindings.data();
+
+	if (vkCreateDescriptorSetLayout(logicalDevice, &layoutCreateInfo, nullptr, &morphDescriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create morph descriptor set layout!!");
+	}
+}
+
+void GpuSkinning::createDescriptorPool()
+{
+	// a skinning and a morph set per instance
+	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	poolSizes[0].descriptorCount = maxInstances * 2;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = maxInstances * 5;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = maxInstances * 2;
+
+	if (vkCreateDescriptorPool(VulkanContext::getInstance()->getDevice()->logicalDevice, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create skinning descriptor pool!");
+	}
+}
+
+SkinningVertex GpuSkinning::packVertex(const Vertex& vertex, const uint8_t joints[4], const float weights[4])
+{
+	// the attribute bits come from the same packing as static meshes
+	CompactVertex compact = VertexPacking::packVertex(vertex);
+
+	glm::quat frame = VertexPacking::packTangentFrame(vertex.normal, vertex.tangent);
+
+	SkinningVertex packed;
+	packed.position = glm::vec4(vertex.pos, 1.0f);
+	packed.tangentFrame = glm::vec4(frame.x, frame.y, frame.z, frame.w);
+	packed.joints = joints[0] | (joints[1] << 8) | (joints[2] << 16) | ((uint32_t)joints[3] << 24);
+	memcpy(&packed.color, compact.color, sizeof(uint32_t));
+	memcpy(&packed.texCoords, compact.texCoords, sizeof(uint32_t));
+
+	// weights that add up to exactly 255, the rounding error goes to the largest one
+	float sum = weights[0] + weights[1] + weights[2] + weights[3];
+	uint32_t quantized[4];
+	uint32_t total = 0;
+	uint32_t largest = 0;
+
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		quantized[i] = sum > 0.0f ? (uint32_t)std::lround(std::max(weights[i], 0.0f) / sum * 255.0f) : (i == 0 ? 255 : 0);
+		total += quantized[i];
+		largest = weights[i] > weights[largest] ? i : largest;
+	}
+
+	quantized[largest] = (uint32_t)std::max(0, (int32_t)quantized[largest] + 255 - (int32_t)total);
+
+	packed.weights = quantized[0] | (quantized[1] << 8) | (quantized[2] << 16) | (quantized[3] << 24);
+	return packed;
+}
+
+uint32_t GpuSkinning::addMesh(const std::vector<SkinningVertex>& vertices)
+{
+	SkinnedMesh mesh;
+	mesh.vertexCount = static_cast<uint32_t>(vertices.size());
+
+	// never changes, read by every instance of the mesh
+	vkTools::createDeviceLocalBuffer(vertices.data(), sizeof(SkinningVertex) * vertices.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, mesh.vertexBuffer, mesh.vertexBufferMemory);
+
+	mesh.morphDeltaBuffer = VK_NULL_HANDLE;
+	mesh.morphDeltaBufferMemory = VK_NULL_HANDLE;
+
+	meshes.push_back(mesh);
+	return static_cast<uint32_t>(meshes.size() - 1);
+}
+
+void GpuSkinning::setMorphTargets(uint32_t meshId, const MorphTargetSet& morphTargets)
+{
+	SkinnedMesh& mesh = meshes[meshId];
+
+	if (morphTargets.vertexCount != mesh.vertexCount || !mesh.morphTargets.empty() || morphTargets.deltas.empty())
+	{
+		throw std::runtime_error("morph targets don't fit the skinned mesh!");
+	}
+
+	for (const SkinnedInstance& instance : instances)
+	{
+		if (instance.meshId == meshId)
+		{
+			throw std::runtime_error("morph targets have to be set before the mesh has instances!");
+		}
+	}
+
+	mesh.morphTargets = morphTargets.targets;
+
+	vkTools::createDeviceLocalBuffer(morphTargets.deltas.data(), sizeof(MorphDelta) * morphTargets.deltas.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, mesh.morphDeltaBuffer, mesh.morphDeltaBufferMemory);
+}
+
+uint32_t GpuSkinning::addInstance(uint32_t meshId, uint32_t jointCount)
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	VkDeviceSize jointSize = jointCount * sizeof(glm::mat4);
+
+	if (instances.size() >= maxInstances || nextJointOffset + jointSize > jointSliceSize)
+	{
+		throw std::runtime_error("gpu skinning is out of instances or joints!");
+	}
+
+	SkinnedInstance instance;
+	instance.meshId = meshId;
+	instance.jointCount = jointCount;
+	instance.jointOffset = nextJointOffset;
+	instance.joints.assign(jointCount, glm::mat4(1.0f));
+	instance.boundingSphere = glm::vec4(0.0f);
+
+	// the bind pose until the first setPose
+	instance.poseVersion = 1;
+	instance.skinnedVersion = 0;
+
+	nextJointOffset = (nextJointOffset + jointSize + jointAlignment - 1) / jointAlignment * jointAlignment;
+
+	// the position stream then the attribute stream, bound like ObjectBuffers' vertex buffer
+	uint32_t vertexCount = meshes[meshId].vertexCount;
+	VkDeviceSize outputSize = vertexCount * (VkDeviceSize)(sizeof(PositionStreamVertex) + sizeof(AttributeStreamVertex));
+
+	vkTools::createBuffer(outputSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, instance.outputBuffer, instance.outputBufferMemory);
+
+	instance.morphBuffer = VK_NULL_HANDLE;
+	instance.morphBufferMemory = VK_NULL_HANDLE;
+	instance.morphDescriptorSet = VK_NULL_HANDLE;
+
+	VkDescriptorSetLayout layouts[] = { descriptorSetLayout, morphDescriptorSetLayout };
+	bool hasMorphs = !meshes[meshId].morphTargets.empty();
+
+	if (hasMorphs)
+	{
+		// starts out zero, skinning.comp clears whatever morph.comp adds
+		VkDeviceSize morphSize = sizeof(int32_t) * 6 * (VkDeviceSize)vertexCount;
+		vkTools::createDeviceLocalBuffer(morphSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, [&](void* mapped) { memset(mapped, 0, (size_t)morphSize); }, instance.morphBuffer, instance.morphBufferMemory);
+
+		instance.morphWeights.assign(meshes[meshId].morphTargets.size(), 0.0f);
+	}
+
+	VkDescriptorSet sets[2];
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = hasMorphs ? 2 : 1;
+	allocInfo.pSetLayouts = layouts;
+
+	if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, sets) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate skinning descriptor set!");
+	}
+
+	instance.descriptorSet = sets[0];
+	instance.morphDescriptorSet = hasMorphs ? sets[1] : VK_NULL_HANDLE;
+
+	writeInstanceDescriptorSets(instance);
+
+	instances.push_back(instance);
+	return static_cast<uint32_t>(instances.size() - 1);
+}
+
+void GpuSkinning::writeInstanceDescriptorSets(const SkinnedInstance& instance)
+{
+	const SkinnedMesh& mesh = meshes[instance.meshId];
+	bool hasMorphs = instance.morphDescriptorSet != VK_NULL_HANDLE;
+
+	// skinning set then morph set
+	std::array<VkDescriptorBufferInfo, 7> bufferInfos = {};
+	bufferInfos[0] = { jointBuffer, instance.jointOffset, instance.jointCount * sizeof(glm::mat4) };
+	bufferInfos[1] = { mesh.vertexBuffer, 0, VK_WHOLE_SIZE };
+	bufferInfos[2] = { instance.outputBuffer, 0, VK_WHOLE_SIZE };
+	bufferInfos[3] = { hasMorphs ? instance.morphBuffer : emptyMorphBuffer, 0, VK_WHOLE_SIZE };
+	bufferInfos[4] = { mesh.morphDeltaBuffer, 0, VK_WHOLE_SIZE };
+	bufferInfos[5] = { instance.morphBuffer, 0, VK_WHOLE_SIZE };
+	bufferInfos[6] = { activeMorphBuffer, 0, activeMorphSliceSize };
+
+	VkDescriptorType types[] = {
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC
+	};
+
+	std::array<VkWriteDescriptorSet, 7> descWrites = {};
+
+	for (uint32_t i = 0; i < descWrites.size(); i++)
+	{
+		descWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descWrites[i].dstSet = i < 4 ? instance.descriptorSet : instance.morphDescriptorSet;
+		descWrites[i].dstBinding = i < 4 ? i : i - 4;
+		descWrites[i].dstArrayElement = 0;
+		descWrites[i].descriptorCount = 1;
+		descWrites[i].descriptorType = types[i];
+		descWrites[i].pBufferInfo = &bufferInfos[i];
+	}
+
+	uint32_t writeCount = hasMorphs ? 7 : 4;
+	vkUpdateDescriptorSets(VulkanContext::getInstance()->getDevice()->logicalDevice, writeCount, descWrites.data(), 0, nullptr);
+}
+
+void GpuSkinning::setPose(uint32_t instanceId, const std::vector<glm::mat4>& skinningMatrices, glm::vec4 worldBoundingSphere)
+{
+	SkinnedInstance& instance = instances[instanceId];
+	instance.boundingSphere = worldBoundingSphere;
+
+	size_t size = std::min<size_t>(skinningMatrices.size(), instance.jointCount) * sizeof(glm::mat4);
+
+	// idle characters and paused animations hand in the same matrices every frame
+	if (memcmp(instance.joints.data(), skinningMatrices.data(), size) != 0)
+	{
+		memcpy(instance.joints.data(), skinningMatrices.data(), size);
+		instance.poseVersion++;
+	}
+}
+
+void GpuSkinning::setMorphWeights(uint32_t instanceId, const std::vector<float>& weights)
+{
+	SkinnedInstance& instance = instances[instanceId];
+
+	size_t count = std::min(weights.size(), instance.morphWeights.size());
+
+	if (memcmp(instance.morphWeights.data(), weights.data(), count * sizeof(float)) != 0)
+	{
+		memcpy(instance.morphWeights.data(), weights.data(), count * sizeof(float));
+		instance.poseVersion++;
+	}
+}
+
+void GpuSkinning::dispatch(VkCommandBuffer commandBuffer, Camera camera)
+{
+	stats = {};
+
+	glm::vec4 planes[6];
+	camera.getFrustumPlanes(planes);
+
+	std::vector<uint32_t> pending;
+
+	for (uint32_t i = 0; i < instances.size(); i++)
+	{
+		const SkinnedInstance& instance = instances[i];
+
+		if (instance.skinnedVersion == instance.poseVersion)
+		{
+			stats.skippedUnchanged++;
+			continue;
+		}
+
+		bool visible = true;
+		for (int p = 0; p < 6 && visible; p++)
+		{
+			visible = glm::dot(glm::vec3(planes[p]), glm::vec3(instance.boundingSphere)) + planes[p].w >= -instance.boundingSphere.w;
+		}
+
+		// stays pending, skinned on the first frame it is back in view
+		if (!visible)
+		{
+			stats.skippedOffscreen++;
+			continue;
+		}
+
+		pending.push_back(i);
+	}
+
+	if (pending.empty())
+	{
+		return;
+	}
+
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+	uint32_t imageIndex = VulkanContext::getInstance()->getCurrentImageIndex();
+	VkDeviceSize sliceOffset = jointSliceSize * imageIndex;
+
+	// the fence of this image has been waited on, nothing reads this slice any more
+	uint8_t* slice;
+	vkMapMemory(logicalDevice, jointBufferMemory, sliceOffset, jointSliceSize, 0, reinterpret_cast<void**>(&slice));
+
+	for (uint32_t i : pending)
+	{
+		const SkinnedInstance& instance = instances[i];
+		memcpy(slice + instance.jointOffset, instance.joints.data(), instance.jointCount * sizeof(glm::mat4));
+	}
+
+	vkUnmapMemory(logicalDevice, jointBufferMemory);
+
+	// active morph targets of every pending instance, zero weights never get here
+	std::vector<ActiveMorphTarget> activeTargets;
+	std::vector<MorphConstants> morphConstants(pending.size(), MorphConstants{ 0, 0, 0 });
+
+	for (size_t p = 0; p < pending.size(); p++)
+	{
+		const SkinnedInstance& instance = instances[pending[p]];
+		const std::vector<MorphTarget>& targets = meshes[instance.meshId].morphTargets;
+
+		MorphConstants& constants = morphConstants[p];
+		constants.activeOffset = static_cast<uint32_t>(activeTargets.size());
+
+		for (size_t t = 0; t < targets.size(); t++)
+		{
+			float weight = instance.morphWeights[t];
+			if (std::abs(weight) <= kMorphWeightEpsilon || targets[t].deltaCount == 0)
+			{
+				continue;
+			}
+
+			if (activeTargets.size() >= maxActiveMorphTargets)
+			{
+				throw std::runtime_error("too many active morph targets, raise maxActiveMorphTargets!");
+			}
+
+			activeTargets.push_back({ targets[t].firstDelta, targets[t].deltaCount, weight, constants.deltaCount });
+			constants.deltaCount += targets[t].deltaCount;
+		}
+
+		constants.activeCount = static_cast<uint32_t>(activeTargets.size()) - constants.activeOffset;
+
+		stats.morphTargets += constants.activeCount;
+		stats.morphDeltas += constants.deltaCount;
+	}
+
+	VkDeviceSize morphSliceOffset = activeMorphSliceSize * imageIndex;
+
+	if (!activeTargets.empty())
+	{
+		void* data;
+		vkMapMemory(logicalDevice, activeMorphBufferMemory, morphSliceOffset, activeMorphSliceSize, 0, &data);
+		memcpy(data, activeTargets.data(), activeTargets.size() * sizeof(ActiveMorphTarget));
+		vkUnmapMemory(logicalDevice, activeMorphBufferMemory);
+	}
+
+	// the last frame's passes may still be fetching the buffers about to be overwritten
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	// -- Morph targets, one thread per active delta
+	if (!activeTargets.empty())
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, morphPipeline.computePipeline);
+
+		uint32_t morphDynamicOffset = static_cast<uint32_t>(morphSliceOffset);
+
+		for (size_t p = 0; p < pending.size(); p++)
+		{
+			const MorphConstants& constants = morphConstants[p];
+			if (constants.deltaCount == 0)
+			{
+				continue;
+			}
+
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, morphPipeline.pipelineLayout, 0, 1, &instances[pending[p]].morphDescriptorSet, 1, &morphDynamicOffset);
+			vkCmdPushConstants(commandBuffer, morphPipeline.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+			vkCmdDispatch(commandBuffer, (constants.deltaCount + 63) / 64, 1, 1);
+		}
+
+		// skinning reads and clears what was accumulated
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	// -- Skinning, one thread per vertex
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, skinningPipeline.computePipeline);
+
+	uint32_t dynamicOffset = static_cast<uint32_t>(sliceOffset);
+
+	for (size_t p = 0; p < pending.size(); p++)
+	{
+		SkinnedInstance& instance = instances[pending[p]];
+		uint32_t vertexCount = meshes[instance.meshId].vertexCount;
+
+		SkinningConstants constants;
+		constants.vertexCount = vertexCount;
+		constants.attributeOffset = vertexCount * sizeof(PositionStreamVertex) / sizeof(uint32_t);
+		constants.morphEnabled = morphConstants[p].deltaCount > 0 ? 1 : 0;
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, skinningPipeline.pipelineLayout, 0, 1, &instance.descriptorSet, 1, &dynamicOffset);
+		vkCmdPushConstants(commandBuffer, skinningPipeline.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+		vkCmdDispatch(commandBuffer, (vertexCount + 63) / 64, 1, 1);
+
+		instance.skinnedVersion = instance.poseVersion;
+
+		stats.skinnedInstances++;
+		stats.skinnedVertices += vertexCount;
+	}
+
+	// every later pass fetches the output as vertices
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuSkinning::bindVertexBuffers(VkCommandBuffer commandBuffer, uint32_t instanceId)
+{
+	const SkinnedInstance& instance = instances[instanceId];
+
+	VkBuffer buffers[kVertexStreamCount] = { instance.outputBuffer, instance.outputBuffer };
+	VkDeviceSize offsets[kVertexStreamCount] = { 0, meshes[instance.meshId].vertexCount * sizeof(PositionStreamVertex) };
+
+	vkCmdBindVertexBuffers(commandBuffer, 0, kVertexStreamCount, buffers, offsets);
+}
+
+void GpuSkinning::destroy()
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	skinningPipeline.destroy();
+	morphPipeline.destroy();
+
+	vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(logicalDevice, morphDescriptorSetLayout, nullptr);
+
+	// null handles of meshes and instances without morph targets are fine to destroy
+	for (SkinnedInstance& instance : instances)
+	{
+		vkDestroyBuffer(logicalDevice, instance.outputBuffer, nullptr);
+		vkFreeMemory(logicalDevice, instance.outputBufferMemory, nullptr);
+		vkDestroyBuffer(logicalDevice, instance.morphBuffer, nullptr);
+		vkFreeMemory(logicalDevice, instance.morphBufferMemory, nullptr);
+	}
+
+	for (SkinnedMesh& mesh : meshes)
+	{
+		vkDestroyBuffer(logicalDevice, mesh.vertexBuffer, nullptr);
+		vkFreeMemory(logicalDevice, mesh.vertexBufferMemory, nullptr);
+		vkDestroyBuffer(logicalDevice, mesh.morphDeltaBuffer, nullptr);
+		vkFreeMemory(logicalDevice, mesh.morphDeltaBufferMemory, nullptr);
+	}
+
+	vkDestroyBuffer(logicalDevice, jointBuffer, nullptr);
+	vkFreeMemory(logicalDevice, jointBufferMemory, nullptr);
+	vkDestroyBuffer(logicalDevice, activeMorphBuffer, nullptr);
+	vkFreeMemory(logicalDevice, activeMorphBufferMemory, nullptr);
+	vkDestroyBuffer(logicalDevice, emptyMorphBuffer, nullptr);
+	vkFreeMemory(logicalDevice, emptyMorphBufferMemory, nullptr);
+
+	instances.clear();
+	meshes.clear();
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "ComputePipeline.h"
+#include "Camera.h"
+#include "Mesh.h"
+#include "MorphTargets.h"
+
+// bind pose vertex as Shaders/skinning.comp reads it (std430)
+struct SkinningVertex
+{
+	glm::vec4 position;		// w unused
+	glm::vec4 tangentFrame;	// quaternion, see VertexPacking::packTangentFrame
+	uint32_t joints;		// four 8 bit joint indices
+	uint32_t weights;		// four unorm8 weights, they add up to 255
+	uint32_t color;			// same bits as AttributeStreamVertex
+	uint32_t texCoords;		// same bits as AttributeStreamVertex
+};
+
+struct SkinningStats
+{
+	uint32_t skinnedInstances;
+	uint32_t skinnedVertices;
+	uint32_t skippedOffscreen;
+	uint32_t skippedUnchanged;
+	uint32_t morphTargets;		// active targets accumulated
+	uint32_t morphDeltas;		// deltas they touched
+};
+
+// morph.comp adds weighted deltas into a per instance buffer of ints with atomicAdd,
+// so targets that share vertices can be accumulated in one dispatch
+static const float kMorphFixedPointScale = 1048576.0f;
+
+// Compute skinning
+// skinning.comp skins an instance once per frame into its own vertex buffer, laid out like
+// the mesh streams ( positions, then attributes ), so the depth, shadow and main passes all
+// draw it as ordinary static geometry with the mesh's own index buffer.
+// Instances whose pose didn't change keep last frame's output, instances outside the
+// frustum aren't skinned until they come back in view.
+// Meshes can have morph targets, morph.comp accumulates the deltas of the targets with a
+// weight right before skinning, and skinning.comp adds them to the bind pose and clears them.
+// Record dispatch() between VulkanContext::frameBegin and renderPassBegin.
+class GpuSkinning
+{
+public:
+	GpuSkinning();
+	~GpuSkinning();
+
+	// joint matrices, one slice per swapchain image so the cpu never writes what the gpu is reading
+	VkBuffer jointBuffer;
+	VkDeviceMemory jointBufferMemory;
+
+	// active morph targets, one entry per target with a weight, per swapchain image like the joints
+	VkBuffer activeMorphBuffer;
+	VkDeviceMemory activeMorphBufferMemory;
+
+	// maxActiveMorphTargets is the total over every instance skinned in a frame
+	void createSkinningBuffersAndPipeline(uint32_t _maxInstances, uint32_t maxJoints, uint32_t _maxActiveMorphTargets = 1024);
+
+	static SkinningVertex packVertex(const Vertex& vertex, const uint8_t joints[4], const float weights[4]);
+
+	uint32_t addMesh(const std::vector<SkinningVertex>& vertices);
+	// before any instance of the mesh is added, deltas index the mesh's vertices
+	void setMorphTargets(uint32_t meshId, const MorphTargetSet& morphTargets);
+	uint32_t addInstance(uint32_t meshId, uint32_t jointCount);
+
+	// skinning matrices ( model * inverse bind ) and world bounds for the frustum test
+	// a pose equal to the last one doesn't count as a change
+	void setPose(uint32_t instanceId, const std::vector<glm::mat4>& skinningMatrices, glm::vec4 worldBoundingSphere);
+	// one weight per target of the mesh's MorphTargetSet, unchanged weights don't count as a change
+	void setMorphWeights(uint32_t instanceId, const std::vector<float>& weights);
+
+	void dispatch(VkCommandBuffer commandBuffer, Camera camera);
+
+	// binds the skinned streams to the kVertexStreamPosition and kVertexStreamAttributes bindings
+	void bindVertexBuffers(VkCommandBuffer commandBuffer, uint32_t instanceId);
+
+	SkinningStats getStats() { return stats; }
+
+	void destroy();
+
+private:
+	struct SkinnedMesh
+	{
+		VkBuffer vertexBuffer;
+		VkDeviceMemory vertexBufferMemory;
+		uint32_t vertexCount;
+
+		// empty without morph targets
+		std::vector<MorphTarget> morphTargets;
+		VkBuffer morphDeltaBuffer;
+		VkDeviceMemory morphDeltaBufferMemory;
+	};
+
+	struct SkinnedInstance
+	{
+		uint32_t meshId;
+		uint32_t jointCount;
+		VkDeviceSize jointOffset;
+
+		VkBuffer outputBuffer;
+		VkDeviceMemory outputBufferMemory;
+		VkDescriptorSet descriptorSet;
+
+		// six fixed point ints per vertex, position then normal delta, zero outside of dispatch
+		VkBuffer morphBuffer;
+		VkDeviceMemory morphBufferMemory;
+		VkDescriptorSet morphDescriptorSet;
+		std::vector<float> morphWeights;
+
+		std::vector<glm::mat4> joints;
+		glm::vec4 boundingSphere;
+
+		// output is up to date while they match
+		uint32_t poseVersion;
+		uint32_t skinnedVersion;
+	};
+
+	std::vector<SkinnedMesh> meshes;
+	std::vector<SkinnedInstance> instances;
+	uint32_t maxInstances;
+
+	VkDeviceSize jointSliceSize;
+	VkDeviceSize jointAlignment;
+	VkDeviceSize nextJointOffset;
+
+	uint32_t maxActiveMorphTargets;
+	VkDeviceSize activeMorphSliceSize;
+
+	// bound in place of the morph buffer of instances without morph targets
+	VkBuffer emptyMorphBuffer;
+	VkDeviceMemory emptyMorphBufferMemory;
+
+	ComputePipeline skinningPipeline;
+	VkDescriptorSetLayout descriptorSetLayout;
+	ComputePipeline morphPipeline;
+	VkDescriptorSetLayout morphDescriptorSetLayout;
+	VkDescriptorPool descriptorPool;
+
+	SkinningStats stats = {};
+
+	void createDescriptorSetLayouts();
+	void createDescriptorPool();
+	void writeInstanceDescriptorSets(const SkinnedInstance& instance);
+};
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "GraphicsPipeline.h"
 #include "VulkanContext.h"
+#include "Tools.h"
 
 #include "Mesh.h"
 
@@ -9,13 +10,23 @@ GraphicsPipeline::GraphicsPipeline()
 GraphicsPipeline::~GraphicsPipeline()
 { }
 
-void GraphicsPipeline::createGraphicsPipelineLayoutAndPipeline(VkExtent2D swapChainImageExtent, VkDescriptorSetLayout descriptorSetLayout, VkRenderPass renderPass)
+void GraphicsPipeline::createGraphicsPipelineLayoutAndPipeline(VkExtent2D swapChainImageExtent, VkDescriptorSetLayout descriptorSetLayout, VkRenderPass renderPass,
+	const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const VertexInputDescription& vertexInput, uint32_t pushConstantSize)
 {
-	createGraphicsPipelineLayout(descriptorSetLayout);
-	createGraphicsPipeline(swapChainImageExtent, renderPass);
+	createGraphicsPipelineLayoutAndPipeline(swapChainImageExtent, std::vector<VkDescriptorSetLayout>(1, descriptorSetLayout), renderPass,
+		vertexShaderFile, fragmentShaderFile, vertexInput, pushConstantSize);
 }
 
-void GraphicsPipeline::createGraphicsPipelineLayout(VkDescriptorSetLayout descriptorSetLayout)
+void GraphicsPipeline::createGraphicsPipelineLayoutAndPipeline(VkExtent2D swapChainImageExtent, const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts, VkRenderPass renderPass,
+	const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const VertexInputDescription& vertexInput, uint32_t pushConstantSize)
+{
+	vertexStreamMask = vertexInput.streamMask;
+
+	createGraphicsPipelineLayout(descriptorSetLayouts, pushConstantSize);
+	createGraphicsPipeline(swapChainImageExtent, renderPass, vertexShaderFile, fragmentShaderFile, vertexInput);
+}
+
+void GraphicsPipeline::createGraphicsPipelineLayout(const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts, uint32_t pushConstantSize)
 {
 	// pipeline layout
 	
@@ -24,49 +35,22 @@ void GraphicsPipeline::createGraphicsPipelineLayout(VkDescriptorSetLayout descri
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 
 	// used for passing uniform objects and images to the shader
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-
-	if (vkCreatePipelineLayout(VulkanContext::getInstance()->getDevice()->logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
-	{
-		throw std::runtime_error(" failed to create pieline layout !");
-	}
-}
-
-std::vector<char> GraphicsPipeline::readfile(const std::string& filename)
-{
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
 
-	if (!file.is_open())
-	{
-		throw std::runtime_error("failed to open shader file!");
-	}
-	size_t filesize = (size_t)file.tellg();
-	std::vector<char> buffer(filesize);
-
-	file.seekg(0);
-	file.read(buffer.data(), filesize);
-
-	file.close();
-
-	return buffer;
-}
+	// per draw data for the vertex shader
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = pushConstantSize;
 
-VkShaderModule GraphicsPipeline::createShaderModule(const std::vector<char>& code)
-{
-	VkShaderModuleCreateInfo cInfo = {};
-
-	cInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	cInfo.codeSize = code.size();
-	cInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+	pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+	pipelineLayoutInfo.pPushConstantRanges = pushConstantSize > 0 ? &pushConstantRange : nullptr;
 
-	VkShaderModule shaderModule;
-	if (vkCreateShaderModule(VulkanContext::getInstance()->getDevice()->logicalDevice, &cInfo, nullptr, &shaderModule) != VK_SUCCESS)
+	if (vkCreatePipelineLayout(VulkanContext::getInstance()->getDevice()->logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
 	{
-		throw std::runtime_error(" failed to create shader module !");
+		throw std::runtime_error(" failed to create pieline layout !");
 	}
-
-	return shaderModule;
 }
 
 void GraphicsPipeline::destroy()
@@ -75,13 +59,13 @@ void GraphicsPipeline::destroy()
 	vkDestroyPipelineLayout(VulkanContext::getInstance()->getDevice()->logicalDevice, pipelineLayout, nullptr);
 }
 
-void GraphicsPipeline::createGraphicsPipeline(VkExtent2D swapChainImageExtent, VkRenderPass renderPass)
+void GraphicsPipeline::createGraphicsPipeline(VkExtent2D swapChainImageExtent, VkRenderPass renderPass, const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const VertexInputDescription& vertexInput)
 {
 	// vertex and fragment shader stage
 	// vertex
-	auto vertexShaderCode = readfile("Shaders/SPIRV/basic.vert.spv");
+	auto vertexShaderCode = vkTools::readFile(vertexShaderFile);
 
-	VkShaderModule vertexShadeModule = createShaderModule(vertexShaderCode);
+	VkShaderModule vertexShadeModule = vkTools::createShaderModule(vertexShaderCode);
 
 	VkPipelineShaderStageCreateInfo vertShaderStageCreateInfo = {};
 	vertShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -90,8 +74,8 @@ void GraphicsPipeline::createGraphicsPipeline(VkExtent2D swapChainImageExtent, V
 	vertShaderStageCreateInfo.pName = "main";
 
 	// fragment 
-	auto fragmentShaderCode = readfile("Shaders/SPIRV/basic.frag.spv");
-	VkShaderModule fragShaderModule = createShaderModule(fragmentShaderCode);
+	auto fragmentShaderCode = vkTools::readFile(fragmentShaderFile);
+	VkShaderModule fragShaderModule = vkTools::createShaderModule(fragmentShaderCode);
 
 	VkPipelineShaderStageCreateInfo fragShaderStageCreateInfo = {};
 
@@ -103,17 +87,14 @@ void GraphicsPipeline::createGraphicsPipeline(VkExtent2D swapChainImageExtent, V
 	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageCreateInfo, fragShaderStageCreateInfo };
 
 	// Vertex input State
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attribiteDescriptions = Vertex::getAttributeDescriptions();
-
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-	vertexInputInfo.vertexBindingDescriptionCount = 1; // intially was 0 as vertex data was hardcoded in the shader
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t> (vertexInput.bindings.size()); // intially was 0 as vertex data was hardcoded in the shader
+	vertexInputInfo.pVertexBindingDescriptions = vertexInput.bindings.data();
 
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t> (attribiteDescriptions.size());
-	vertexInputInfo.pVertexAttributeDescriptions = attribiteDescriptions.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t> (vertexInput.attributes.size());
+	vertexInputInfo.pVertexAttributeDescriptions = vertexInput.attributes.data();
 
 	// Vertex Input assembly State
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = {};
@@ -1,7 +1,8 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include <vector>
-#include <fstream>
+#include <string>
+#include "VertexFormat.h"
 
 class GraphicsPipeline
 {
@@ -12,15 +13,21 @@ public:
 	VkPipelineLayout pipelineLayout;
 	VkPipeline graphicsPipeline;
 
-	void createGraphicsPipelineLayoutAndPipeline(VkExtent2D swapChainImageExtent, VkDescriptorSetLayout descriptorSetLayout, VkRenderPass renderPass);
+	// mesh streams the vertex input reads, bit (1 << VertexStream) per stream
+	uint32_t vertexStreamMask;
+
+	// shader files are the compiled SPIRV, vertexInput has to match what the vertex shader declares
+	// an empty vertexInput is fine for shaders that pull their vertices from a storage buffer
+	void createGraphicsPipelineLayoutAndPipeline(VkExtent2D swapChainImageExtent, VkDescriptorSetLayout descriptorSetLayout, VkRenderPass renderPass,
+		const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const VertexInputDescription& vertexInput, uint32_t pushConstantSize = 0);
+	// set n uses descriptorSetLayouts[n]
+	void createGraphicsPipelineLayoutAndPipeline(VkExtent2D swapChainImageExtent, const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts, VkRenderPass renderPass,
+		const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const VertexInputDescription& vertexInput, uint32_t pushConstantSize = 0);
 
 	void destroy();
 
 private:
 
-	std::vector<char> readfile(const std::string& filename);
-	VkShaderModule createShaderModule(const std::vector<char>& code);
-
-	void createGraphicsPipelineLayout(VkDescriptorSetLayout descriptorSetLayout);
-	void createGraphicsPipeline(VkExtent2D swapChainImageExtent, VkRenderPass renderPass);
+	void createGraphicsPipelineLayout(const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts, uint32_t pushConstantSize);
+	void createGraphicsPipeline(VkExtent2D swapChainImageExtent, VkRenderPass renderPass, const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const VertexInputDescription& vertexInput);
 };
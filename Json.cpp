@@ -0,0 +1,376 @@
+#include "Json.h"
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+
+// recursive descent over the raw text
+class JsonParser
+{
+public:
+	JsonParser(const char* _text, size_t _length)
+		: text(_text), end(_text + _length), cursor(_text)
+	{ }
+
+	JsonValue parseDocument()
+	{
+		JsonValue value = parseValue(0);
+		skipWhitespace();
+
+		if (cursor != end)
+		{
+			fail("trailing characters");
+		}
+
+		return value;
+	}
+
+private:
+	// deep enough for any real file, shallow enough that a hostile one can't blow the stack
+	static const int kMaxDepth = 128;
+
+	const char* text;
+	const char* end;
+	const char* cursor;
+
+	void fail(const char* message)
+	{
+		throw std::runtime_error(std::string("json: ") + message + " at offset " + std::to_string(cursor - text));
+	}
+
+	void skipWhitespace()
+	{
+		while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r'))
+		{
+			cursor++;
+		}
+	}
+
+	bool consume(const char* literal)
+	{
+		size_t length = strlen(literal);
+		if ((size_t)(end - cursor) >= length && memcmp(cursor, literal, length) == 0)
+		{
+			cursor += length;
+			return true;
+		}
+		return false;
+	}
+
+	JsonValue parseValue(int depth)
+	{
+		if (depth > kMaxDepth)
+		{
+			fail("nested too deep");
+		}
+
+		skipWhitespace();
+		if (cursor >= end)
+		{
+			fail("unexpected end");
+		}
+
+		JsonValue value;
+
+		switch (*cursor)
+		{
+		case '{':
+			parseObject(value, depth);
+			break;
+		case '[':
+			parseArray(value, depth);
+			break;
+		case '"':
+			value.type = JsonValue::kString;
+			value.string = parseString();
+			break;
+		case 't':
+		case 'f':
+			value.type = JsonValue::kBool;
+			value.boolean = *cursor == 't';
+			if (!consume(value.boolean ? "true" : "false"))
+			{
+				fail("bad literal");
+			}
+			break;
+		case 'n':
+			if (!consume("null"))
+			{
+				fail("bad literal");
+			}
+			break;
+		default:
+			value.type = JsonValue::kNumber;
+			value.number = parseNumber();
+			break;
+		}
+
+		return value;
+	}
+
+	void parseObject(JsonValue& value, int depth)
+	{
+		value.type = JsonValue::kObject;
+		cursor++;
+
+		skipWhitespace();
+		if (cursor < end && *cursor == '}')
+		{
+			cursor++;
+			return;
+		}
+
+		for (;;)
+		{
+			skipWhitespace();
+			if (cursor >= end || *cursor != '"')
+			{
+				fail("expected key");
+			}
+
+			std::string key = parseString();
+
+			skipWhitespace();
+			if (cursor >= end || *cursor != ':')
+			{
+				fail("expected ':'");
+			}
+			cursor++;
+
+			value.object.emplace_back(std::move(key), parseValue(depth + 1));
+
+			skipWhitespace();
+			if (cursor < end && *cursor == ',')
+			{
+				cursor++;
+				continue;
+			}
+			if (cursor < end && *cursor == '}')
+			{
+				cursor++;
+				return;
+			}
+
+			fail("expected ',' or '}'");
+		}
+	}
+
+	void parseArray(JsonValue& value, int depth)
+	{
+		value.type = JsonValue::kArray;
+		cursor++;
+
+		skipWhitespace();
+		if (cursor < end && *cursor == ']')
+		{
+			cursor++;
+			return;
+		}
+
+		for (;;)
+		{
+			value.array.push_back(parseValue(depth + 1));
+
+			skipWhitespace();
+			if (cursor < end && *cursor == ',')
+			{
+				cursor++;
+				continue;
+			}
+			if (cursor < end && *cursor == ']')
+			{
+				cursor++;
+				return;
+			}
+
+			fail("expected ',' or ']'");
+		}
+	}
+
+	static void appendUtf8(std::string& out, uint32_t codePoint)
+	{
+		if (codePoint < 0x80)
+		{
+			out += (char)codePoint;
+		}
+		else if (codePoint < 0x800)
+		{
+			out += (char)(0xc0 | (codePoint >> 6));
+			out += (char)(0x80 | (codePoint & 0x3f));
+		}
+		else if (codePoint < 0x10000)
+		{
+			out += (char)(0xe0 | (codePoint >> 12));
+			out += (char)(0x80 | ((codePoint >> 6) & 0x3f));
+			out += (char)(0x80 | (codePoint & 0x3f));
+		}
+		else
+		{
+			out += (char)(0xf0 | (codePoint >> 18));
+			out += (char)(0x80 | ((codePoint >> 12) & 0x3f));
+			out += (char)(0x80 | ((codePoint >> 6) & 0x3f));
+			out += (char)(0x80 | (codePoint & 0x3f));
+		}
+	}
+
+	uint32_t parseHex4()
+	{
+		if (end - cursor < 4)
+		{
+			fail("bad unicode escape");
+		}
+
+		uint32_t value = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			char c = *cursor++;
+			value <<= 4;
+
+			if (c >= '0' && c <= '9') value |= c - '0';
+			else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+			else fail("bad unicode escape");
+		}
+
+		return value;
+	}
+
+	std::string parseString()
+	{
+		cursor++; // opening quote
+		std::string out;
+
+		for (;;)
+		{
+			if (cursor >= end)
+			{
+				fail("unterminated string");
+			}
+
+			char c = *cursor++;
+
+			if (c == '"')
+			{
+				return out;
+			}
+
+			if (c != '\\')
+			{
+				out += c;
+				continue;
+			}
+
+			if (cursor >= end)
+			{
+				fail("unterminated string");
+			}
+
+			char escape = *cursor++;
+			switch (escape)
+			{
+			case '"': out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/': out += '/'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u':
+			{
+				uint32_t codePoint = parseHex4();
+
+				// surrogate pair
+				if (codePoint >= 0xd800 && codePoint < 0xdc00 && consume("\\u"))
+				{
+					uint32_t low = parseHex4();
+					codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+				}
+
+				appendUtf8(out, codePoint);
+				break;
+			}
+			default:
+				fail("bad escape");
+			}
+		}
+	}
+
+	double parseNumber()
+	{
+		// strtod needs a terminator, numbers are short so copy into a local buffer
+		char buffer[64];
+		size_t length = 0;
+
+		while (cursor + length < end && length < sizeof(buffer) - 1 && strchr("+-0123456789.eE", cursor[length]) != nullptr)
+		{
+			length++;
+		}
+
+		if (length == 0)
+		{
+			fail("unexpected character");
+		}
+
+		memcpy(buffer, cursor, length);
+		buffer[length] = 0;
+
+		char* parsedEnd;
+		double value = strtod(buffer, &parsedEnd);
+
+		if (parsedEnd != buffer + length)
+		{
+			fail("bad number");
+		}
+
+		cursor += length;
+		return value;
+	}
+};
+
+JsonValue JsonValue::parse(const char* text, size_t length)
+{
+	JsonParser parser(text, length);
+	return parser.parseDocument();
+}
+
+const JsonValue* JsonValue::find(const std::string& key) const
+{
+	if (type != kObject)
+	{
+		return nullptr;
+	}
+
+	for (const auto& member : object)
+	{
+		if (member.first == key)
+		{
+			return &member.second;
+		}
+	}
+
+	return nullptr;
+}
+
+double JsonValue::getNumber(const std::string& key, double fallback) const
+{
+	const JsonValue* value = find(key);
+	return value != nullptr && value->type == kNumber ? value->number : fallback;
+}
+
+int64_t JsonValue::getInt(const std::string& key, int64_t fallback) const
+{
+	const JsonValue* value = find(key);
+	return value != nullptr && value->type == kNumber ? (int64_t)value->number : fallback;
+}
+
+bool JsonValue::getBool(const std::string& key, bool fallback) const
+{
+	const JsonValue* value = find(key);
+	return value != nullptr && value->type == kBool ? value->boolean : fallback;
+}
+
+std::string JsonValue::getString(const std::string& key, const std::string& fallback) const
+{
+	const JsonValue* value = find(key);
+	return value != nullptr && value->type == kString ? value->string : fallback;
+}
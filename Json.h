@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+// Minimal JSON DOM, enough for glTF
+// Numbers are doubles, objects keep their keys in file order. Parse errors throw.
+class JsonValue
+{
+public:
+	enum Type
+	{
+		kNull,
+		kBool,
+		kNumber,
+		kString,
+		kArray,
+		kObject
+	};
+
+	Type type = kNull;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> array;
+	std::vector<std::pair<std::string, JsonValue>> object;
+
+	static JsonValue parse(const char* text, size_t length);
+
+	// null when the key is missing or this isn't an object
+	const JsonValue* find(const std::string& key) const;
+
+	bool isNull() const { return type == kNull; }
+	size_t size() const { return type == kArray ? array.size() : object.size(); }
+	const JsonValue& operator[](size_t index) const { return array[index]; }
+
+	// typed lookups with a fallback for missing or mistyped members
+	double getNumber(const std::string& key, double fallback) const;
+	int64_t getInt(const std::string& key, int64_t fallback) const;
+	bool getBool(const std::string& key, bool fallback) const;
+	std::string getString(const std::string& key, const std::string& fallback) const;
+};
@@ -0,0 +1,333 @@
+#include "Ktx2.h"
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+// khr_df.h values the writer needs
+static const uint8_t kDfModelRgbsda = 1;
+static const uint8_t kDfModelBc1a = 128;
+static const uint8_t kDfModelBc3 = 130;
+static const uint8_t kDfModelBc4 = 131;
+static const uint8_t kDfModelBc5 = 132;
+static const uint8_t kDfModelBc7 = 134;
+static const uint8_t kDfPrimariesBt709 = 1;
+static const uint8_t kDfTransferLinear = 1;
+static const uint8_t kDfTransferSrgb = 2;
+static const uint8_t kDfChannelRed = 0;
+static const uint8_t kDfChannelGreen = 1;
+static const uint8_t kDfChannelBlue = 2;
+static const uint8_t kDfChannelAlpha = 15;
+static const uint8_t kDfSampleLinear = 0x10;	// alpha of an sRGB format
+static const uint32_t kDfVersion = 2;
+
+struct DfdSample
+{
+	uint8_t channel;
+	uint16_t bitOffset;
+	uint16_t bitCount;
+	uint32_t upper;
+};
+
+// basic data format descriptor, the total size followed by one descriptor block
+static std::vector<uint32_t> buildDataFormatDescriptor(VkFormat format)
+{
+	TextureFormatInfo info;
+	getTextureFormatInfo(format, info);
+
+	bool srgb = format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC3_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+	uint8_t model = 0;
+	std::vector<DfdSample> samples;
+
+	switch (format)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		model = kDfModelRgbsda;
+		samples = { { kDfChannelRed, 0, 8, 255 }, { kDfChannelGreen, 8, 8, 255 }, { kDfChannelBlue, 16, 8, 255 }, { kDfChannelAlpha, 24, 8, 255 } };
+		break;
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		model = kDfModelBc1a;
+		samples = { { kDfChannelRed, 0, 64, UINT32_MAX } };
+		break;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+		model = kDfModelBc3;
+		samples = { { kDfChannelAlpha, 0, 64, UINT32_MAX }, { kDfChannelRed, 64, 64, UINT32_MAX } };
+		break;
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		model = kDfModelBc4;
+		samples = { { kDfChannelRed, 0, 64, UINT32_MAX } };
+		break;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+		model = kDfModelBc5;
+		samples = { { kDfChannelRed, 0, 64, UINT32_MAX }, { kDfChannelGreen, 64, 64, UINT32_MAX } };
+		break;
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		model = kDfModelBc7;
+		samples = { { kDfChannelRed, 0, 128, UINT32_MAX } };
+		break;
+	default:
+		throw std::runtime_error("no KTX2 data format descriptor for this format!");
+	}
+
+	uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+	std::vector<uint32_t> words;
+
+	words.push_back(4 + blockSize);
+	words.push_back(0); // khronos vendor, basic descriptor type
+	words.push_back(kDfVersion | (blockSize << 16));
+	words.push_back(model | (kDfPrimariesBt709 << 8) | ((srgb ? kDfTransferSrgb : kDfTransferLinear) << 16));
+	words.push_back((info.blockWidth - 1) | ((info.blockHeight - 1) << 8));
+	words.push_back(info.blockSize);
+	words.push_back(0);
+
+	for (const DfdSample& sample : samples)
+	{
+		uint8_t channelType = sample.channel | (srgb && sample.channel == kDfChannelAlpha ? kDfSampleLinear : 0);
+
+		words.push_back(sample.bitOffset | ((sample.bitCount - 1) << 16) | (channelType << 24));
+		words.push_back(0); // sample position
+		words.push_back(0);
+		words.push_back(sample.upper);
+	}
+
+	return words;
+}
+
+bool getTextureFormatInfo(VkFormat format, TextureFormatInfo& info)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R8_UNORM:
+		info = { 1, 1, 1 };
+		return true;
+	case VK_FORMAT_R8G8_UNORM:
+		info = { 1, 1, 2 };
+		return true;
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_R8G8B8A8_SNORM:
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+		info = { 1, 1, 4 };
+		return true;
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+		info = { 1, 1, 8 };
+		return true;
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		info = { 4, 4, 8 };
+		return true;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		info = { 4, 4, 16 };
+		return true;
+	default:
+		return false;
+	}
+}
+
+uint64_t getTextureLevelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+	TextureFormatInfo info;
+	if (!getTextureFormatInfo(format, info))
+	{
+		throw std::runtime_error("unsupported texture format!");
+	}
+
+	// partial blocks at the edges are stored whole
+	uint64_t blocksX = (width + info.blockWidth - 1) / info.blockWidth;
+	uint64_t blocksY = (height + info.blockHeight - 1) / info.blockHeight;
+	return blocksX * blocksY * info.blockSize;
+}
+
+uint32_t getTextureMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	while ((width | height) > 1)
+	{
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+		count++;
+	}
+	return count;
+}
+
+uint64_t layoutTextureLevels(VkFormat format, uint32_t width, uint32_t height, uint32_t levelCount, std::vector<TextureLevel>& levels)
+{
+	levels.resize(levelCount);
+
+	uint64_t offset = 0;
+	for (uint32_t i = 0; i < levelCount; i++)
+	{
+		levels[i].width = std::max(width >> i, 1u);
+		levels[i].height = std::max(height >> i, 1u);
+		levels[i].offset = offset;
+		levels[i].size = getTextureLevelSize(format, levels[i].width, levels[i].height);
+
+		offset = (offset + levels[i].size + kTextureLevelAlignment - 1) & ~(uint64_t)(kTextureLevelAlignment - 1);
+	}
+
+	return offset;
+}
+
+Ktx2File::Ktx2File()
+	: header(nullptr), levels(nullptr), levelCount(0)
+{ }
+
+Ktx2File::~Ktx2File()
+{ }
+
+void Ktx2File::writeFile(const std::string& path, const TextureImage& image)
+{
+	TextureFormatInfo info;
+	if (!getTextureFormatInfo(image.format, info))
+	{
+		throw std::runtime_error("unsupported texture format!");
+	}
+
+	std::vector<uint32_t> dfd = buildDataFormatDescriptor(image.format);
+	uint32_t levelCount = static_cast<uint32_t>(image.levels.size());
+
+	Ktx2Header header = {};
+	memcpy(header.identifier, kKtx2Identifier, sizeof(kKtx2Identifier));
+	header.vkFormat = image.format;
+	header.typeSize = 1;
+	header.pixelWidth = image.width;
+	header.pixelHeight = image.height;
+	header.faceCount = 1;
+	header.levelCount = levelCount;
+	header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + sizeof(Ktx2Level) * levelCount);
+	header.dfdByteLength = static_cast<uint32_t>(sizeof(uint32_t) * dfd.size());
+
+	// smallest mip first, aligned to the block size which is already a multiple of 4 or a power of 2 below it
+	uint64_t alignment = std::max(info.blockSize, 4u);
+	uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+
+	std::vector<Ktx2Level> levels(levelCount);
+	for (uint32_t i = levelCount; i-- > 0;)
+	{
+		offset = (offset + alignment - 1) & ~(alignment - 1);
+		levels[i].byteOffset = offset;
+		levels[i].byteLength = image.levels[i].size;
+		levels[i].uncompressedByteLength = image.levels[i].size;
+		offset += image.levels[i].size;
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to open " + path + " for writing!");
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(levels.data()), sizeof(Ktx2Level) * levels.size());
+	file.write(reinterpret_cast<const char*>(dfd.data()), sizeof(uint32_t) * dfd.size());
+
+	uint64_t written = header.dfdByteOffset + header.dfdByteLength;
+	const char padding[16] = {};
+
+	for (uint32_t i = levelCount; i-- > 0;)
+	{
+		file.write(padding, (std::streamsize)(levels[i].byteOffset - written));
+		file.write(reinterpret_cast<const char*>(image.data.data() + image.levels[i].offset), (std::streamsize)image.levels[i].size);
+		written = levels[i].byteOffset + levels[i].byteLength;
+	}
+
+	if (!file.good())
+	{
+		throw std::runtime_error("failed to write " + path);
+	}
+}
+
+void Ktx2File::open(const std::string& path)
+{
+	file.open(path);
+
+	try
+	{
+		if (file.size < sizeof(Ktx2Header) || memcmp(file.data, kKtx2Identifier, sizeof(kKtx2Identifier)) != 0)
+		{
+			throw std::runtime_error("not a KTX2 file: " + path);
+		}
+
+		header = reinterpret_cast<const Ktx2Header*>(file.data);
+
+		if (header->pixelHeight == 0 || header->pixelDepth != 0 || header->layerCount > 1 || header->faceCount != 1)
+		{
+			throw std::runtime_error("only single 2D textures are supported: " + path);
+		}
+
+		if (header->supercompressionScheme != 0)
+		{
+			throw std::runtime_error("supercompressed KTX2 files are not supported: " + path);
+		}
+
+		TextureFormatInfo info;
+		if (!getTextureFormatInfo(getFormat(), info))
+		{
+			throw std::runtime_error("unsupported KTX2 format: " + path);
+		}
+
+		levelCount = std::max(header->levelCount, 1u);
+
+		if (levelCount > getTextureMipCount(header->pixelWidth, header->pixelHeight)
+			|| sizeof(Ktx2Header) + sizeof(Ktx2Level) * (uint64_t)levelCount > file.size)
+		{
+			throw std::runtime_error("corrupt KTX2 level index: " + path);
+		}
+
+		levels = reinterpret_cast<const Ktx2Level*>(file.data + sizeof(Ktx2Header));
+
+		for (uint32_t i = 0; i < levelCount; i++)
+		{
+			uint32_t width = std::max(header->pixelWidth >> i, 1u);
+			uint32_t height = std::max(header->pixelHeight >> i, 1u);
+
+			// the offset is checked on its own first so the sum can't wrap
+			if (levels[i].byteOffset > file.size || levels[i].byteLength > file.size - levels[i].byteOffset
+				|| levels[i].byteLength != getTextureLevelSize(getFormat(), width, height))
+			{
+				throw std::runtime_error("corrupt KTX2 level " + std::to_string(i) + ": " + path);
+			}
+		}
+	}
+	catch (...)
+	{
+		close();
+		throw;
+	}
+}
+
+void Ktx2File::close()
+{
+	file.close();
+	header = nullptr;
+	levels = nullptr;
+	levelCount = 0;
+}
+
+void Ktx2File::read(TextureImage& image) const
+{
+	image.format = getFormat();
+	image.width = header->pixelWidth;
+	image.height = header->pixelHeight;
+
+	uint64_t size = layoutTextureLevels(image.format, image.width, image.height, levelCount, image.levels);
+
+	image.data.assign(size, 0);
+
+	for (uint32_t i = 0; i < levelCount; i++)
+	{
+		memcpy(image.data.data() + image.levels[i].offset, getLevelData(i), (size_t)image.levels[i].size);
+	}
+}
\ No newline at end of file
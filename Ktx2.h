@@ -0,0 +1,119 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "MappedFile.h"
+
+// -- Textures on the cpu
+// A mip chain with its levels back to back, level 0 first. Every level starts on
+// kTextureLevelAlignment so the whole thing can be copied into staging memory as it is
+// and each level used as a buffer to image copy region.
+
+static const uint32_t kTextureLevelAlignment = 16;
+
+struct TextureLevel
+{
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset;	// into TextureImage::data
+	uint64_t size;
+};
+
+struct TextureImage
+{
+	VkFormat format;
+	uint32_t width;
+	uint32_t height;
+	std::vector<TextureLevel> levels;
+	std::vector<uint8_t> data;
+};
+
+// texel blocks of a format, 1x1 for the uncompressed ones
+struct TextureFormatInfo
+{
+	uint32_t blockWidth;
+	uint32_t blockHeight;
+	uint32_t blockSize;		// bytes
+};
+
+// false for formats the texture code doesn't handle
+bool getTextureFormatInfo(VkFormat format, TextureFormatInfo& info);
+uint64_t getTextureLevelSize(VkFormat format, uint32_t width, uint32_t height);
+uint32_t getTextureMipCount(uint32_t width, uint32_t height);
+// the first levelCount mips back to back on kTextureLevelAlignment, returns the total size
+uint64_t layoutTextureLevels(VkFormat format, uint32_t width, uint32_t height, uint32_t levelCount, std::vector<TextureLevel>& levels);
+
+// -- KTX2 container
+// Only what the engine uses: single 2D images, no array layers or cube faces, no supercompression.
+// A file with levelCount 0 asks for the mips to be generated on load.
+//
+//	Ktx2Header
+//	Ktx2Level[max(levelCount, 1)]
+//	data format descriptor, key / value data
+//	mip levels, the smallest first, each aligned to lcm(texel block size, 4)
+//
+// writeFile only knows the data format descriptors of RGBA8 and the BC formats, what the cooker makes.
+
+static const uint8_t kKtx2Identifier[12] = { 0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a };
+
+struct Ktx2Header
+{
+	uint8_t identifier[12];
+	uint32_t vkFormat;
+	uint32_t typeSize;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t layerCount;
+	uint32_t faceCount;
+	uint32_t levelCount;
+	uint32_t supercompressionScheme;
+
+	uint32_t dfdByteOffset;
+	uint32_t dfdByteLength;
+	uint32_t kvdByteOffset;
+	uint32_t kvdByteLength;
+	uint64_t sgdByteOffset;
+	uint64_t sgdByteLength;
+};
+
+struct Ktx2Level
+{
+	uint64_t byteOffset;
+	uint64_t byteLength;
+	uint64_t uncompressedByteLength;
+};
+
+class Ktx2File
+{
+public:
+	Ktx2File();
+	~Ktx2File();
+
+	static void writeFile(const std::string& path, const TextureImage& image);
+
+	// maps the file and checks the header and every level against the file size and format
+	void open(const std::string& path);
+	void close();
+
+	const Ktx2Header& getHeader() const { return *header; }
+	VkFormat getFormat() const { return static_cast<VkFormat>(header->vkFormat); }
+
+	// levels stored in the file, 1 when levelCount is 0
+	uint32_t getLevelCount() const { return levelCount; }
+	bool wantsGeneratedMips() const { return header->levelCount == 0; }
+
+	const uint8_t* getLevelData(uint32_t level) const { return file.data + levels[level].byteOffset; }
+	uint64_t getLevelSize(uint32_t level) const { return levels[level].byteLength; }
+
+	// copies every level into a TextureImage, for tools, the renderer reads the mapped levels directly
+	void read(TextureImage& image) const;
+
+private:
+	MappedFile file;
+	const Ktx2Header* header;
+	const Ktx2Level* levels;
+	uint32_t levelCount;
+};
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// read only memory mapped file, CreateFileMapping on Windows and mmap everywhere else
+// pages are only read from disk when they are touched
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	const uint8_t* data;
+	size_t size;
+
+	// throws when the file can't be opened or mapped
+	void open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return data != nullptr; }
+
+private:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+};
@@ -1,4 +1,5 @@
 #include "Mesh.h"
+#include "ProceduralMesh.h"
 
 void Mesh::setTriData(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
 {
@@ -117,63 +118,10 @@ void Mesh::setCubeData(std::vector<Vertex>& vertices, std::vector<uint32_t>& ind
 
 void Mesh::setSphereData(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
 
-	std::vector<Vertex> _vertices;
-	std::vector<uint32_t> _indices;
+	ProceduralMesh::generate(ProceduralMeshDesc::sphere(1.0f, 20, 20), vertices, indices);
 
-	float latitudeBands = 20.0f;
-	float longitudeBands = 20.0f;
-	float radius = 1.0f;
-
-	for (float latNumber = 0; latNumber <= latitudeBands; latNumber++) {
-		float theta = latNumber * 3.14 / latitudeBands;
-		float sinTheta = sin(theta);
-		float cosTheta = cos(theta);
-
-		for (float longNumber = 0; longNumber <= longitudeBands; longNumber++) {
-
-			float phi = longNumber * 2 * 3.147 / longitudeBands;
-			float sinPhi = sin(phi);
-			float cosPhi = cos(phi);
-
-			Vertex vs;
-
-			vs.texCoords.x = (longNumber / longitudeBands); // u
-			vs.texCoords.y = (latNumber / latitudeBands);   // v
-
-			vs.normal.x = cosPhi * sinTheta;   // normal x
-			vs.normal.y = cosTheta;            // normal y
-			vs.normal.z = sinPhi * sinTheta;   // normal z
-
-			vs.color.r = vs.normal.x;
-			vs.color.g = vs.normal.y;
-			vs.color.b = vs.normal.z;
-
-			vs.pos.x = radius * vs.normal.x; // x
-			vs.pos.y = radius * vs.normal.y; // y
-			vs.pos.z = radius * vs.normal.z; // z
-
-			_vertices.push_back(vs);
-		}
+	// the sphere has always been colored by its normals
+	for (Vertex& vertex : vertices) {
+		vertex.color = vertex.normal;
 	}
-
-	for (uint32_t latNumber = 0; latNumber < latitudeBands; latNumber++) {
-		for (uint32_t longNumber = 0; longNumber < longitudeBands; longNumber++) {
-			uint32_t first = (latNumber * (longitudeBands + 1)) + longNumber;
-			uint32_t second = first + longitudeBands + 1;
-
-			_indices.push_back(first);
-			_indices.push_back(second);
-			_indices.push_back(first + 1);
-
-			_indices.push_back(second);
-			_indices.push_back(second + 1);
-			_indices.push_back(first + 1);
-
-		}
-	}
-
-	vertices.clear(); indices.clear();
-	vertices = _vertices;
-	indices = _indices;
-
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <vector>
 #include <array>
 #include "Dependencies\glm\glm\glm.hpp"
+#include "VertexFormat.h"
 
 #define GLM_FORCE_RADIAN
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -30,47 +31,37 @@ struct Vertex
 	glm::vec3 color;
 	glm::vec2 texCoords;
 
-	// --Describes the rate at which rate to load data from memory
-	//-- Specifies Number of bytes 
-	//-- Whether to move to next data entry after each vertex or instance
-	static VkVertexInputBindingDescription getBindingDescription()
-	{
-		VkVertexInputBindingDescription bindingDescription = {};
+	// xyz along +u, w is the bitangent sign, filled in by TangentGenerator
+	glm::vec4 tangent = glm::vec4(0.0f);
 
-		bindingDescription.binding = 0; // binding location index
-		bindingDescription.stride = sizeof(Vertex);
-		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-		return bindingDescription;
-	}
-
-	//-- How to handle vertex input
-	static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions()
-	{
-		std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions = {};
-
-		attributeDescriptions[0].binding = 0; // from which binding the vertex comes --> it is 0 above
-		attributeDescriptions[0].location = 0; // location layout in the vertex shader --> has 32 bit float components 
-		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT; // 
-		attributeDescriptions[0].offset = offsetof(Vertex, pos); // number of bytes since the start of the per vertex data
+	static VkVertexInputBindingDescription getBindingDescription();
+	static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions();
+};
 
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, normal);
+// full precision layout, what the generators produce and the CPU side works on
+typedef VertexFormat<Vertex,
+	VertexAttribute<0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, pos)>,
+	VertexAttribute<1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal)>,
+	VertexAttribute<2, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color)>,
+	VertexAttribute<3, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, texCoords)>> FullVertexFormat;
 
-		attributeDescriptions[2].binding = 0;
-		attributeDescriptions[2].location = 2;
-		attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[2].offset = offsetof(Vertex, color);
+inline VkVertexInputBindingDescription Vertex::getBindingDescription()
+{
+	return FullVertexFormat::getBindingDescription();
+}
 
-		attributeDescriptions[3].binding = 0;
-		attributeDescriptions[3].location = 3;
-		attributeDescriptions[3].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[3].offset = offsetof(Vertex, texCoords);
+inline std::array<VkVertexInputAttributeDescription, 4> Vertex::getAttributeDescriptions()
+{
+	return FullVertexFormat::getAttributeDescriptions();
+}
 
-		return attributeDescriptions;
-	}
+// a range of the index buffer drawn at one level of detail
+// error is the geometric deviation from LOD 0, relative to the mesh extent
+struct MeshLod
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error;
 };
 
 class Mesh
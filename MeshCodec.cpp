@@ -0,0 +1,703 @@
+#include "MeshCodec.h"
+#include "MeshOptimizer.h"
+#include "VertexFormat.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESH_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+// -- Vertex codec
+
+// bytes of lane data for each 2 bit mode
+static const uint32_t kLaneModeBytes[4] = { 0, 4, 8, 16 };
+
+// lane data behind one header byte, all four lanes are used since strides are multiples of 4
+static inline uint32_t getHeaderDataSize(uint8_t modes)
+{
+	return kLaneModeBytes[modes & 3] + kLaneModeBytes[(modes >> 2) & 3] + kLaneModeBytes[(modes >> 4) & 3] + kLaneModeBytes[modes >> 6];
+}
+
+static inline uint8_t zigzagEncode(uint8_t delta)
+{
+	// shift the unsigned bits, a left shift of a negative value is undefined
+	int8_t value = (int8_t)delta;
+	return (uint8_t)((uint8_t)(delta << 1) ^ (uint8_t)(value >> 7));
+}
+
+static inline uint8_t zigzagDecode(uint8_t value)
+{
+	return (uint8_t)((value >> 1) ^ (0 - (value & 1)));
+}
+
+size_t MeshCodec::getVertexEncodeBound(size_t vertexCount, size_t stride)
+{
+	size_t blockCount = (vertexCount + kVertexBlockSize - 1) / kVertexBlockSize;
+	return blockCount * ((stride + 3) / 4 + stride * kVertexBlockSize);
+}
+
+void MeshCodec::encodeVertexBuffer(std::vector<uint8_t>& out, const void* vertices, size_t vertexCount, size_t stride)
+{
+	if (stride == 0 || stride % 4 != 0 || stride > kMaxVertexStride)
+	{
+		throw std::runtime_error("mesh codec: vertex stride has to be a multiple of 4 up to 256");
+	}
+
+	const uint8_t* data = static_cast<const uint8_t*>(vertices);
+
+	out.clear();
+	out.reserve(getVertexEncodeBound(vertexCount, stride));
+
+	uint8_t last[kMaxVertexStride] = {};
+	uint8_t values[kVertexBlockSize];
+
+	for (size_t blockStart = 0; blockStart < vertexCount; blockStart += kVertexBlockSize)
+	{
+		size_t blockCount = std::min<size_t>(kVertexBlockSize, vertexCount - blockStart);
+
+		size_t headerOffset = out.size();
+		out.resize(out.size() + (stride + 3) / 4, 0);
+
+		for (size_t lane = 0; lane < stride; lane++)
+		{
+			uint8_t previous = last[lane];
+			uint8_t maxValue = 0;
+
+			// a short last block repeats its last vertex, the padding deltas are zero
+			for (size_t i = 0; i < kVertexBlockSize; i++)
+			{
+				uint8_t current = i < blockCount ? data[(blockStart + i) * stride + lane] : previous;
+				values[i] = zigzagEncode((uint8_t)(current - previous));
+				maxValue = std::max(maxValue, values[i]);
+				previous = current;
+			}
+			last[lane] = previous;
+
+			uint32_t mode = maxValue == 0 ? 0 : maxValue < 4 ? 1 : maxValue < 16 ? 2 : 3;
+			out[headerOffset + lane / 4] |= (uint8_t)(mode << ((lane % 4) * 2));
+
+			if (mode == 1)
+			{
+				// byte i holds values i, i + 4, i + 8, i + 12
+				for (size_t i = 0; i < 4; i++)
+				{
+					out.push_back((uint8_t)(values[i] | (values[i + 4] << 2) | (values[i + 8] << 4) | (values[i + 12] << 6)));
+				}
+			}
+			else if (mode == 2)
+			{
+				// byte i holds value i in the low nibble and i + 8 in the high one
+				for (size_t i = 0; i < 8; i++)
+				{
+					out.push_back((uint8_t)(values[i] | (values[i + 8] << 4)));
+				}
+			}
+			else if (mode == 3)
+			{
+				out.insert(out.end(), values, values + kVertexBlockSize);
+			}
+		}
+	}
+}
+
+#ifdef MESH_CODEC_SSE2
+
+// 16 zigzagged deltas of one lane, unpacked from whatever mode they were stored in
+static inline __m128i unpackLane(const uint8_t* data, uint32_t mode)
+{
+	switch (mode)
+	{
+	case 1:
+	{
+		uint32_t packed;
+		memcpy(&packed, data, 4);
+
+		__m128i bits = _mm_cvtsi32_si128((int)packed);
+		__m128i mask = _mm_set1_epi8(3);
+
+		__m128i v0 = _mm_and_si128(bits, mask);
+		__m128i v1 = _mm_and_si128(_mm_srli_epi16(bits, 2), mask);
+		__m128i v2 = _mm_and_si128(_mm_srli_epi16(bits, 4), mask);
+		__m128i v3 = _mm_and_si128(_mm_srli_epi16(bits, 6), mask);
+
+		return _mm_unpacklo_epi64(_mm_unpacklo_epi32(v0, v1), _mm_unpacklo_epi32(v2, v3));
+	}
+	case 2:
+	{
+		__m128i bits = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+		__m128i mask = _mm_set1_epi8(15);
+
+		return _mm_unpacklo_epi64(_mm_and_si128(bits, mask), _mm_and_si128(_mm_srli_epi16(bits, 4), mask));
+	}
+	case 3:
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+	default:
+		return _mm_setzero_si128();
+	}
+}
+
+// zigzag decode and running sum across the 16 vertices, starting from the previous block's value
+static inline __m128i decodeLane(__m128i values, __m128i base)
+{
+	__m128i one = _mm_set1_epi8(1);
+	__m128i shifted = _mm_and_si128(_mm_srli_epi16(values, 1), _mm_set1_epi8(0x7f));
+	__m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(values, one));
+	__m128i deltas = _mm_xor_si128(shifted, sign);
+
+	deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 1));
+	deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 2));
+	deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 4));
+	deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 8));
+
+	return _mm_add_epi8(deltas, base);
+}
+
+static inline void storeVertexWord(uint8_t* destination, __m128i value)
+{
+	uint32_t word = (uint32_t)_mm_cvtsi128_si32(value);
+	memcpy(destination, &word, 4);
+}
+
+#endif
+
+void MeshCodec::decodeVertexBuffer(void* destination, size_t vertexCount, size_t stride, const uint8_t* encoded, size_t encodedSize)
+{
+	if (stride == 0 || stride % 4 != 0 || stride > kMaxVertexStride)
+	{
+		throw std::runtime_error("mesh codec: vertex stride has to be a multiple of 4 up to 256");
+	}
+
+	uint8_t* output = static_cast<uint8_t*>(destination);
+	const uint8_t* cursor = encoded;
+	const uint8_t* end = encoded + encodedSize;
+
+	size_t headerSize = (stride + 3) / 4;
+
+	// a short last block is decoded here and copied out, so nothing past vertexCount is written
+	uint8_t tail[kVertexBlockSize * kMaxVertexStride];
+
+#ifdef MESH_CODEC_SSE2
+	__m128i last[kMaxVertexStride / 4][4];
+	for (size_t i = 0; i < stride / 4; i++)
+	{
+		last[i][0] = last[i][1] = last[i][2] = last[i][3] = _mm_setzero_si128();
+	}
+#else
+	uint8_t last[kMaxVertexStride] = {};
+#endif
+
+	for (size_t blockStart = 0; blockStart < vertexCount; blockStart += kVertexBlockSize)
+	{
+		size_t blockCount = std::min<size_t>(kVertexBlockSize, vertexCount - blockStart);
+		uint8_t* block = blockCount == kVertexBlockSize ? output + blockStart * stride : tail;
+
+		if ((size_t)(end - cursor) < headerSize)
+		{
+			throw std::runtime_error("mesh codec: truncated vertex data");
+		}
+
+		const uint8_t* header = cursor;
+		cursor += headerSize;
+
+		// the lane sizes are known from the header, check the whole block once
+		size_t blockDataSize = 0;
+		for (size_t group = 0; group < headerSize; group++)
+		{
+			blockDataSize += getHeaderDataSize(header[group]);
+		}
+
+		if ((size_t)(end - cursor) < blockDataSize)
+		{
+			throw std::runtime_error("mesh codec: truncated vertex data");
+		}
+
+#ifdef MESH_CODEC_SSE2
+		// 4 lanes at a time, transposed from lane order to vertex order in registers
+		for (size_t group = 0; group < stride / 4; group++)
+		{
+			uint8_t modes = header[group];
+			__m128i lanes[4];
+
+			for (int i = 0; i < 4; i++)
+			{
+				uint32_t mode = (modes >> (i * 2)) & 3;
+				lanes[i] = decodeLane(unpackLane(cursor, mode), last[group][i]);
+				cursor += kLaneModeBytes[mode];
+
+				// byte 15 is the value of the last vertex, the next block starts from it
+				__m128i high = _mm_unpackhi_epi8(lanes[i], lanes[i]);
+				last[group][i] = _mm_shuffle_epi32(_mm_unpackhi_epi16(high, high), 0xff);
+			}
+
+			__m128i t0 = _mm_unpacklo_epi8(lanes[0], lanes[1]);
+			__m128i t1 = _mm_unpackhi_epi8(lanes[0], lanes[1]);
+			__m128i t2 = _mm_unpacklo_epi8(lanes[2], lanes[3]);
+			__m128i t3 = _mm_unpackhi_epi8(lanes[2], lanes[3]);
+
+			__m128i rows[4] = {
+				_mm_unpacklo_epi16(t0, t2),
+				_mm_unpackhi_epi16(t0, t2),
+				_mm_unpacklo_epi16(t1, t3),
+				_mm_unpackhi_epi16(t1, t3),
+			};
+
+			uint8_t* column = block + group * 4;
+			for (int r = 0; r < 4; r++)
+			{
+				storeVertexWord(column + (r * 4 + 0) * stride, rows[r]);
+				storeVertexWord(column + (r * 4 + 1) * stride, _mm_srli_si128(rows[r], 4));
+				storeVertexWord(column + (r * 4 + 2) * stride, _mm_srli_si128(rows[r], 8));
+				storeVertexWord(column + (r * 4 + 3) * stride, _mm_srli_si128(rows[r], 12));
+			}
+		}
+#else
+		for (size_t lane = 0; lane < stride; lane++)
+		{
+			uint32_t mode = (header[lane / 4] >> ((lane % 4) * 2)) & 3;
+			uint8_t value = last[lane];
+
+			for (size_t i = 0; i < kVertexBlockSize; i++)
+			{
+				uint8_t packed = 0;
+				switch (mode)
+				{
+				case 1: packed = (cursor[i % 4] >> ((i / 4) * 2)) & 3; break;
+				case 2: packed = (cursor[i % 8] >> ((i / 8) * 4)) & 15; break;
+				case 3: packed = cursor[i]; break;
+				}
+
+				value = (uint8_t)(value + zigzagDecode(packed));
+				block[i * stride + lane] = value;
+			}
+
+			last[lane] = value;
+			cursor += kLaneModeBytes[mode];
+		}
+#endif
+
+		if (block == tail)
+		{
+			memcpy(output + blockStart * stride, tail, blockCount * stride);
+		}
+	}
+}
+
+// -- Index codec
+
+static const uint32_t kEdgeFifoSize = 16;
+static const uint32_t kVertexFifoSize = 16;
+
+// code byte per triangle: high nibble is the edge FIFO entry, low nibble the third vertex
+static const uint32_t kNoEdge = 15;
+static const uint32_t kNextVertex = 0;
+static const uint32_t kExplicitVertex = 15;
+
+// a vertex outside the code nibble is a varint: 0 next, 1..14 FIFO, 15 and up explicit
+static const uint32_t kFifoCodes = 14;
+
+struct IndexCodecState
+{
+	uint32_t edges[kEdgeFifoSize][2];
+	uint32_t edgeHead;
+	uint32_t vertices[kVertexFifoSize];
+	uint32_t vertexHead;
+	uint32_t next;
+	uint32_t last;
+
+	IndexCodecState()
+	{
+		memset(this, 0, sizeof(*this));
+	}
+
+	void pushEdge(uint32_t a, uint32_t b)
+	{
+		edges[edgeHead % kEdgeFifoSize][0] = a;
+		edges[edgeHead % kEdgeFifoSize][1] = b;
+		edgeHead++;
+	}
+
+	void pushVertex(uint32_t v)
+	{
+		vertices[vertexHead % kVertexFifoSize] = v;
+		vertexHead++;
+	}
+
+	// recency 0 is the newest entry
+	const uint32_t* getEdge(uint32_t recency) const { return edges[(edgeHead - 1 - recency) % kEdgeFifoSize]; }
+	uint32_t getVertex(uint32_t recency) const { return vertices[(vertexHead - 1 - recency) % kVertexFifoSize]; }
+
+	// same rules on both sides: next and explicit vertices go into the FIFO, FIFO hits don't
+	uint32_t classifyVertex(uint32_t v) const
+	{
+		if (v == next)
+		{
+			return kNextVertex;
+		}
+
+		for (uint32_t i = 0; i < kFifoCodes && i < vertexHead; i++)
+		{
+			if (getVertex(i) == v)
+			{
+				return 1 + i;
+			}
+		}
+
+		return kExplicitVertex;
+	}
+
+	void useVertex(uint32_t code, uint32_t v)
+	{
+		if (code == kNextVertex)
+		{
+			next++;
+			pushVertex(v);
+		}
+		else if (code == kExplicitVertex)
+		{
+			last = v;
+			pushVertex(v);
+		}
+	}
+};
+
+static void writeVarint(std::vector<uint8_t>& out, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((uint8_t)value);
+}
+
+static uint32_t readVarint(const uint8_t*& cursor, const uint8_t* end)
+{
+	uint32_t value = 0;
+
+	for (uint32_t shift = 0; shift < 35; shift += 7)
+	{
+		if (cursor >= end)
+		{
+			throw std::runtime_error("mesh codec: truncated index data");
+		}
+
+		uint8_t byte = *cursor++;
+		value |= (uint32_t)(byte & 0x7f) << shift;
+
+		if ((byte & 0x80) == 0)
+		{
+			return value;
+		}
+	}
+
+	throw std::runtime_error("mesh codec: bad varint in index data");
+}
+
+static inline uint32_t zigzagEncode32(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t zigzagDecode32(uint32_t value)
+{
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+void MeshCodec::encodeIndexBuffer(std::vector<uint8_t>& out, const uint32_t* indices, size_t indexCount)
+{
+	if (indexCount % 3 != 0)
+	{
+		throw std::runtime_error("mesh codec: index count has to be a multiple of 3");
+	}
+
+	size_t triangleCount = indexCount / 3;
+
+	// codes first, one byte per triangle, the varints after them
+	out.assign(triangleCount, 0);
+	out.reserve(triangleCount + indexCount);
+
+	IndexCodecState state;
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const uint32_t* triangle = indices + t * 3;
+
+		// rotating keeps the winding, look for any of the three edges among the recent ones
+		uint32_t edge = kNoEdge;
+		uint32_t rotation = 0;
+
+		for (uint32_t i = 0; i < kNoEdge && i < state.edgeHead && edge == kNoEdge; i++)
+		{
+			const uint32_t* recent = state.getEdge(i);
+
+			for (uint32_t r = 0; r < 3; r++)
+			{
+				if (recent[0] == triangle[r] && recent[1] == triangle[(r + 1) % 3])
+				{
+					edge = i;
+					rotation = r;
+					break;
+				}
+			}
+		}
+
+		if (edge != kNoEdge)
+		{
+			uint32_t a = triangle[rotation];
+			uint32_t b = triangle[(rotation + 1) % 3];
+			uint32_t c = triangle[(rotation + 2) % 3];
+
+			uint32_t code = state.classifyVertex(c);
+			out[t] = (uint8_t)((edge << 4) | code);
+
+			if (code == kExplicitVertex)
+			{
+				writeVarint(out, zigzagEncode32((int32_t)(c - state.last)));
+			}
+			state.useVertex(code, c);
+
+			// the neighbours across the two new edges walk them the other way round
+			state.pushEdge(c, b);
+			state.pushEdge(a, c);
+		}
+		else
+		{
+			out[t] = (uint8_t)(kNoEdge << 4);
+
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				uint32_t v = triangle[i];
+				uint32_t code = state.classifyVertex(v);
+
+				writeVarint(out, code == kExplicitVertex ? kExplicitVertex + zigzagEncode32((int32_t)(v - state.last)) : code);
+				state.useVertex(code, v);
+			}
+
+			state.pushEdge(triangle[1], triangle[0]);
+			state.pushEdge(triangle[2], triangle[1]);
+			state.pushEdge(triangle[0], triangle[2]);
+		}
+	}
+}
+
+template<typename IndexType>
+static void decodeIndices(IndexType* output, size_t triangleCount, const uint8_t* codes, const uint8_t* cursor, const uint8_t* end)
+{
+	IndexCodecState state;
+
+	auto decodeVertex = [&](uint32_t code) -> uint32_t
+	{
+		uint32_t v;
+
+		if (code == kNextVertex)
+		{
+			v = state.next;
+		}
+		else if (code == kExplicitVertex)
+		{
+			v = state.last + (uint32_t)zigzagDecode32(readVarint(cursor, end));
+		}
+		else
+		{
+			v = state.getVertex(code - 1);
+		}
+
+		state.useVertex(code, v);
+		return v;
+	};
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		uint32_t edge = codes[t] >> 4;
+		uint32_t a, b, c;
+
+		if (edge != kNoEdge)
+		{
+			const uint32_t* recent = state.getEdge(edge);
+			a = recent[0];
+			b = recent[1];
+			c = decodeVertex(codes[t] & 15);
+
+			state.pushEdge(c, b);
+			state.pushEdge(a, c);
+		}
+		else
+		{
+			uint32_t vertexCodes[3];
+
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				uint32_t value = readVarint(cursor, end);
+
+				// explicit ones carry their delta in the same varint
+				if (value >= kExplicitVertex)
+				{
+					vertexCodes[i] = state.last + (uint32_t)zigzagDecode32(value - kExplicitVertex);
+					state.useVertex(kExplicitVertex, vertexCodes[i]);
+				}
+				else
+				{
+					vertexCodes[i] = decodeVertex(value);
+				}
+			}
+
+			a = vertexCodes[0];
+			b = vertexCodes[1];
+			c = vertexCodes[2];
+
+			state.pushEdge(b, a);
+			state.pushEdge(c, b);
+			state.pushEdge(a, c);
+		}
+
+		output[t * 3 + 0] = (IndexType)a;
+		output[t * 3 + 1] = (IndexType)b;
+		output[t * 3 + 2] = (IndexType)c;
+	}
+
+	if (cursor != end)
+	{
+		throw std::runtime_error("mesh codec: trailing index data");
+	}
+}
+
+void MeshCodec::decodeIndexBuffer(void* destination, size_t indexCount, size_t indexSize, const uint8_t* encoded, size_t encodedSize)
+{
+	size_t triangleCount = indexCount / 3;
+
+	if (indexCount % 3 != 0 || encodedSize < triangleCount)
+	{
+		throw std::runtime_error("mesh codec: truncated index data");
+	}
+
+	const uint8_t* data = encoded + triangleCount;
+	const uint8_t* end = encoded + encodedSize;
+
+	if (indexSize == sizeof(uint16_t))
+	{
+		decodeIndices(static_cast<uint16_t*>(destination), triangleCount, encoded, data, end);
+	}
+	else if (indexSize == sizeof(uint32_t))
+	{
+		decodeIndices(static_cast<uint32_t*>(destination), triangleCount, encoded, data, end);
+	}
+	else
+	{
+		throw std::runtime_error("mesh codec: indices are 2 or 4 bytes");
+	}
+}
+
+// -- Benchmark
+
+void MeshCodec::benchmark()
+{
+	// a wavy 512 x 512 grid, optimized like every cooked mesh
+	const uint32_t kGridSize = 512;
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+
+	for (uint32_t y = 0; y < kGridSize; y++)
+	{
+		for (uint32_t x = 0; x < kGridSize; x++)
+		{
+			Vertex vertex;
+			vertex.pos = glm::vec3(x / (float)kGridSize, y / (float)kGridSize, 0.05f * sinf(x * 0.1f) * cosf(y * 0.1f));
+			vertex.normal = glm::normalize(glm::vec3(-0.005f * cosf(x * 0.1f), 0.005f * sinf(y * 0.1f), 1.0f));
+			vertex.color = glm::vec3(1.0f);
+			vertex.texCoords = glm::vec2(x / (float)(kGridSize - 1), y / (float)(kGridSize - 1));
+			vertices.push_back(vertex);
+		}
+	}
+
+	for (uint32_t y = 0; y + 1 < kGridSize; y++)
+	{
+		for (uint32_t x = 0; x + 1 < kGridSize; x++)
+		{
+			uint32_t i = y * kGridSize + x;
+			uint32_t quad[6] = { i, i + kGridSize, i + 1, i + 1, i + kGridSize, i + kGridSize + 1 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	VertexCacheStats before, after;
+	MeshOptimizer::optimizeMesh(vertices, indices, before, after);
+
+	std::vector<PositionStreamVertex> positions;
+	std::vector<AttributeStreamVertex> attributes;
+	VertexPacking::packStreams(vertices, positions, attributes);
+
+	std::vector<uint8_t> encodedPositions, encodedAttributes, encodedIndices;
+	encodeVertexBuffer(encodedPositions, positions.data(), positions.size(), sizeof(PositionStreamVertex));
+	encodeVertexBuffer(encodedAttributes, attributes.data(), attributes.size(), sizeof(AttributeStreamVertex));
+	encodeIndexBuffer(encodedIndices, indices.data(), indices.size());
+
+	std::vector<uint8_t> decodedVertices(sizeof(AttributeStreamVertex) * vertices.size());
+	std::vector<uint32_t> decodedIndices(indices.size());
+
+	auto measure = [](const char* name, size_t rawSize, size_t encodedSize, const std::function<void()>& decode)
+	{
+		const int kRuns = 20;
+		double best = 1e30;
+
+		for (int run = 0; run < kRuns; run++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			decode();
+			best = std::min(best, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+		}
+
+		std::cout << std::fixed << std::setprecision(2)
+			<< "MeshCodec " << name << ": " << rawSize << " -> " << encodedSize << " bytes (" << (double)rawSize / encodedSize << "x), "
+			<< "decode " << best * 1000.0 << " ms, " << rawSize / best / 1e9 << " GB/s" << std::endl;
+	};
+
+	measure("positions", sizeof(PositionStreamVertex) * positions.size(), encodedPositions.size(), [&]()
+	{
+		decodeVertexBuffer(decodedVertices.data(), positions.size(), sizeof(PositionStreamVertex), encodedPositions.data(), encodedPositions.size());
+	});
+
+	if (memcmp(decodedVertices.data(), positions.data(), sizeof(PositionStreamVertex) * positions.size()) != 0)
+	{
+		throw std::runtime_error("mesh codec: position round trip failed");
+	}
+
+	measure("attributes", sizeof(AttributeStreamVertex) * attributes.size(), encodedAttributes.size(), [&]()
+	{
+		decodeVertexBuffer(decodedVertices.data(), attributes.size(), sizeof(AttributeStreamVertex), encodedAttributes.data(), encodedAttributes.size());
+	});
+
+	if (memcmp(decodedVertices.data(), attributes.data(), sizeof(AttributeStreamVertex) * attributes.size()) != 0)
+	{
+		throw std::runtime_error("mesh codec: attribute round trip failed");
+	}
+
+	measure("indices", sizeof(uint32_t) * indices.size(), encodedIndices.size(), [&]()
+	{
+		decodeIndexBuffer(decodedIndices.data(), indices.size(), sizeof(uint32_t), encodedIndices.data(), encodedIndices.size());
+	});
+
+	// triangles may come back rotated, compare them as rotations of each other
+	for (size_t t = 0; t < indices.size(); t += 3)
+	{
+		bool match = false;
+		for (int r = 0; r < 3 && !match; r++)
+		{
+			match = decodedIndices[t] == indices[t + r] && decodedIndices[t + 1] == indices[t + (r + 1) % 3] && decodedIndices[t + 2] == indices[t + (r + 2) % 3];
+		}
+
+		if (!match)
+		{
+			throw std::runtime_error("mesh codec: index round trip failed");
+		}
+	}
+}
\ No newline at end of file
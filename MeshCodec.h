@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// -- Mesh codec
+// Lossless compression for cooked vertex and index data.
+//
+// Vertices: every byte of the vertex is its own lane. A lane stores the delta to the same byte
+// of the previous vertex, zigzagged so small negative deltas stay small. Blocks of 16 vertices
+// store each lane with 0, 2, 4 or 8 bits per value, picked per block by a 2 bit header.
+// Decoding a lane is a handful of SSE2 instructions for all 16 vertices.
+//
+// Indices: triangles are rotated so that one edge matches a recently seen edge whenever
+// possible, that edge is then a 4 bit reference and only the third vertex is encoded, usually
+// as "the next unused vertex" or a reference into a small vertex FIFO. Works best after
+// MeshOptimizer has put the indices in vertex cache and fetch order.
+//
+// Decoders throw on malformed input instead of reading or writing past the buffers.
+class MeshCodec
+{
+public:
+	static const uint32_t kVertexBlockSize = 16;
+	static const uint32_t kMaxVertexStride = 256;
+
+	// stride has to be a multiple of 4
+	static size_t getVertexEncodeBound(size_t vertexCount, size_t stride);
+	static void encodeVertexBuffer(std::vector<uint8_t>& out, const void* vertices, size_t vertexCount, size_t stride);
+	static void decodeVertexBuffer(void* destination, size_t vertexCount, size_t stride, const uint8_t* encoded, size_t encodedSize);
+
+	// indexSize is the size of one decoded index, 2 or 4
+	static void encodeIndexBuffer(std::vector<uint8_t>& out, const uint32_t* indices, size_t indexCount);
+	static void decodeIndexBuffer(void* destination, size_t indexCount, size_t indexSize, const uint8_t* encoded, size_t encodedSize);
+
+	// encodes a synthetic grid and prints compression ratio and decode speed
+	static void benchmark();
+};
\ No newline at end of file
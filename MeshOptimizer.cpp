@@ -0,0 +1,400 @@
+#include "MeshOptimizer.h"
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+
+// overdraw clusters smaller than this don't have a meaningful facing
+static const uint32_t kMinClusterTriangles = 8;
+
+// welding compares whole vertices bit for bit, Vertex has no padding
+struct VertexBitsHash
+{
+	const Vertex* vertices;
+
+	size_t operator()(uint32_t index) const
+	{
+		const uint32_t* words = reinterpret_cast<const uint32_t*>(&vertices[index]);
+		uint32_t hash = 2166136261u;
+
+		for (size_t i = 0; i < sizeof(Vertex) / sizeof(uint32_t); i++)
+		{
+			hash = (hash ^ words[i]) * 16777619u;
+		}
+
+		return hash;
+	}
+};
+
+struct VertexBitsEqual
+{
+	const Vertex* vertices;
+
+	bool operator()(uint32_t a, uint32_t b) const
+	{
+		return memcmp(&vertices[a], &vertices[b], sizeof(Vertex)) == 0;
+	}
+};
+
+void MeshOptimizer::optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, VertexCacheStats& before, VertexCacheStats& after)
+{
+	uint32_t indexCount = static_cast<uint32_t>(indices.size());
+	before = analyzeVertexCache(indices, 0, indexCount, static_cast<uint32_t>(vertices.size()));
+
+	weldVertices(vertices, indices);
+	optimizeVertexCache(indices, 0, indexCount, static_cast<uint32_t>(vertices.size()));
+	optimizeOverdraw(vertices, indices, 0, indexCount, 1.05f);
+	optimizeVertexFetch(vertices, indices);
+
+	after = analyzeVertexCache(indices, 0, indexCount, static_cast<uint32_t>(vertices.size()));
+}
+
+void MeshOptimizer::printStats(const std::string& name, uint32_t triangleCount, uint32_t vertexCount, VertexCacheStats before, VertexCacheStats after)
+{
+	std::cout << std::fixed << std::setprecision(3)
+		<< "MeshOptimizer " << name << ": " << triangleCount << " triangles, " << vertexCount << " vertices, "
+		<< "ACMR " << before.acmr << " -> " << after.acmr << ", "
+		<< "ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
+
+uint32_t MeshOptimizer::weldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	VertexBitsHash hash = { vertices.data() };
+	VertexBitsEqual equal = { vertices.data() };
+
+	std::unordered_map<uint32_t, uint32_t, VertexBitsHash, VertexBitsEqual> unique(vertices.size(), hash, equal);
+	std::vector<uint32_t> remap(vertices.size());
+	std::vector<Vertex> welded;
+	welded.reserve(vertices.size());
+
+	for (uint32_t i = 0; i < vertices.size(); i++)
+	{
+		auto result = unique.emplace(i, static_cast<uint32_t>(welded.size()));
+		if (result.second)
+		{
+			welded.push_back(vertices[i]);
+		}
+
+		remap[i] = result.first->second;
+	}
+
+	for (uint32_t& index : indices)
+	{
+		index = remap[index];
+	}
+
+	vertices.swap(welded);
+	return static_cast<uint32_t>(vertices.size());
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount, uint32_t vertexCount)
+{
+	uint32_t triangleCount = indexCount / 3;
+	const uint32_t* source = &indices[firstIndex];
+
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// vertex -> triangles adjacency and live triangle count per vertex
+	std::vector<uint32_t> liveTriangles(vertexCount, 0);
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+	{
+		liveTriangles[source[i]]++;
+	}
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+	}
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[fill[source[i]]++] = i / 3;
+	}
+
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+
+	std::vector<uint32_t> ordered;
+	ordered.reserve(indexCount);
+
+	uint32_t time = kCacheSize + 1;
+	uint32_t cursor = 0;
+
+	// start from the first vertex the range actually uses
+	int64_t fanning = source[0];
+
+	while (fanning >= 0)
+	{
+		uint32_t f = static_cast<uint32_t>(fanning);
+		candidates.clear();
+
+		// emit every remaining triangle around the fanning vertex
+		for (uint32_t a = adjacencyOffsets[f]; a < adjacencyOffsets[f + 1]; a++)
+		{
+			uint32_t t = adjacency[a];
+			if (emitted[t])
+			{
+				continue;
+			}
+
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				uint32_t v = source[t * 3 + k];
+
+				ordered.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+
+				if (time - cacheTime[v] > kCacheSize)
+				{
+					cacheTime[v] = time++;
+				}
+			}
+
+			emitted[t] = true;
+		}
+
+		// next fan is the candidate that is oldest in the cache but still there after its fan is emitted
+		fanning = -1;
+		int64_t bestPriority = -1;
+
+		for (uint32_t v : candidates)
+		{
+			if (liveTriangles[v] == 0)
+			{
+				continue;
+			}
+
+			int64_t priority = 0;
+			if (time - cacheTime[v] + 2 * liveTriangles[v] <= kCacheSize)
+			{
+				priority = time - cacheTime[v];
+			}
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				fanning = v;
+			}
+		}
+
+		// dead end, go back through recently used vertices, then scan for anything left
+		while (fanning < 0 && !deadEnd.empty())
+		{
+			uint32_t v = deadEnd.back();
+			deadEnd.pop_back();
+
+			if (liveTriangles[v] > 0)
+			{
+				fanning = v;
+			}
+		}
+
+		while (fanning < 0 && cursor < vertexCount)
+		{
+			if (liveTriangles[cursor] > 0)
+			{
+				fanning = cursor;
+			}
+
+			cursor++;
+		}
+	}
+
+	std::copy(ordered.begin(), ordered.end(), indices.begin() + firstIndex);
+}
+
+std::vector<uint32_t> MeshOptimizer::getOverdrawOrder(const std::vector<Vertex>& vertices, const uint32_t* source, const std::vector<uint32_t>& clusterStarts)
+{
+	uint32_t clusterCount = static_cast<uint32_t>(clusterStarts.size()) - 1;
+
+	// area weighted centroid of the mesh and of every cluster
+	glm::vec3 meshCentroid = glm::vec3(0.0f);
+	float meshArea = 0.0f;
+
+	std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+
+	for (uint32_t c = 0; c < clusterCount; c++)
+	{
+		float clusterArea = 0.0f;
+
+		for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+		{
+			glm::vec3 p0 = vertices[source[t * 3 + 0]].pos;
+			glm::vec3 p1 = vertices[source[t * 3 + 1]].pos;
+			glm::vec3 p2 = vertices[source[t * 3 + 2]].pos;
+
+			// clockwise front faces, so this points out of the mesh and its length is twice the area
+			glm::vec3 n = glm::cross(p2 - p0, p1 - p0);
+			float area = glm::length(n);
+			glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+
+			clusterCentroids[c] += centroid * area;
+			clusterNormals[c] += n;
+			clusterArea += area;
+		}
+
+		meshCentroid += clusterCentroids[c];
+		meshArea += clusterArea;
+
+		clusterCentroids[c] = clusterArea > 0.0f ? clusterCentroids[c] / clusterArea : vertices[source[clusterStarts[c] * 3]].pos;
+	}
+
+	if (meshArea > 0.0f)
+	{
+		meshCentroid /= meshArea;
+	}
+
+	// clusters further out along their own normal are more likely to cover the rest, draw them first
+	std::vector<float> sortKeys(clusterCount);
+	std::vector<uint32_t> order(clusterCount);
+
+	for (uint32_t c = 0; c < clusterCount; c++)
+	{
+		float length = glm::length(clusterNormals[c]);
+		glm::vec3 normal = length > 0.0f ? clusterNormals[c] / length : glm::vec3(0.0f);
+
+		sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, normal);
+		order[c] = c;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	return order;
+
+}
+
+void MeshOptimizer::optimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount, float threshold)
+{
+	uint32_t triangleCount = indexCount / 3;
+	const uint32_t* source = &indices[firstIndex];
+
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// split into clusters that each start with a cold cache, a cluster ends as soon as its own ACMR
+	// is within threshold of the whole range, so reordering them can't cost more than that
+	float targetAcmr = analyzeVertexCache(indices, firstIndex, indexCount, static_cast<uint32_t>(vertices.size())).acmr * threshold;
+
+	std::vector<uint32_t> clusterStarts;
+	std::vector<uint32_t> cacheTime(vertices.size(), 0);
+	uint32_t time = kCacheSize + 1;
+	uint32_t clusterMisses = 0;
+	uint32_t clusterTriangles = 0;
+
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		if (clusterTriangles == 0)
+		{
+			clusterStarts.push_back(t);
+
+			// everything already in the cache becomes too old
+			time += kCacheSize + 1;
+			clusterMisses = 0;
+		}
+
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			uint32_t v = source[t * 3 + k];
+			if (time - cacheTime[v] > kCacheSize)
+			{
+				cacheTime[v] = time++;
+				clusterMisses++;
+			}
+		}
+
+		clusterTriangles++;
+
+		if (clusterTriangles >= kMinClusterTriangles && (float)clusterMisses / (float)clusterTriangles <= targetAcmr)
+		{
+			clusterTriangles = 0;
+		}
+	}
+
+	clusterStarts.push_back(triangleCount);
+
+	std::vector<uint32_t> order = getOverdrawOrder(vertices, source, clusterStarts);
+
+	std::vector<uint32_t> ordered;
+	ordered.reserve(indexCount);
+
+	for (uint32_t c : order)
+	{
+		ordered.insert(ordered.end(), source + clusterStarts[c] * 3, source + clusterStarts[c + 1] * 3);
+	}
+
+	std::copy(ordered.begin(), ordered.end(), indices.begin() + firstIndex);
+}
+
+uint32_t MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), ~0u);
+	std::vector<Vertex> ordered;
+	ordered.reserve(vertices.size());
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == ~0u)
+		{
+			remap[index] = static_cast<uint32_t>(ordered.size());
+			ordered.push_back(vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	vertices.swap(ordered);
+	return static_cast<uint32_t>(vertices.size());
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount, uint32_t vertexCount)
+{
+	VertexCacheStats stats = {};
+
+	if (indexCount < 3)
+	{
+		return stats;
+	}
+
+	// same FIFO model as the optimizer, a vertex hits while it is among the last kCacheSize misses
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	uint32_t time = kCacheSize + 1;
+	uint32_t misses = 0;
+	uint32_t uniqueVertices = 0;
+
+	for (uint32_t i = firstIndex; i < firstIndex + indexCount; i++)
+	{
+		uint32_t v = indices[i];
+
+		if (time - cacheTime[v] > kCacheSize)
+		{
+			cacheTime[v] = time++;
+			misses++;
+		}
+
+		if (!referenced[v])
+		{
+			referenced[v] = true;
+			uniqueVertices++;
+		}
+	}
+
+	stats.acmr = (float)misses / (float)(indexCount / 3);
+	stats.atvr = (float)misses / (float)uniqueVertices;
+
+	return stats;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include <string>
+#include "Mesh.h"
+
+struct VertexCacheStats
+{
+	float acmr; // vertex shader runs per triangle, 0.5 is the best a regular grid can get
+	float atvr; // vertex shader runs per vertex, 1.0 means every vertex is transformed once
+};
+
+// Index and vertex order optimizations, none of them change what is drawn
+// Tipsify (Sander et al. 2007) for the post transform cache, clusters sorted
+// outside in for overdraw, then vertices renumbered in the order they are fetched.
+class MeshOptimizer
+{
+public:
+	// FIFO size used for both the simulation and Tipsify, close to most desktop gpus
+	static const uint32_t kCacheSize = 16;
+
+	// full pipeline for a freshly generated or imported mesh, with the ACMR / ATVR it started and ended with
+	static void optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, VertexCacheStats& before, VertexCacheStats& after);
+	static void printStats(const std::string& name, uint32_t triangleCount, uint32_t vertexCount, VertexCacheStats before, VertexCacheStats after);
+
+	// merges bit identical vertices, returns the new vertex count
+	static uint32_t weldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// reorders triangles inside [firstIndex, firstIndex + indexCount)
+	static void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount, uint32_t vertexCount);
+
+	// keeps the cache friendly runs from optimizeVertexCache but draws outward facing ones first
+	// threshold is how much worse ACMR may get, 1.05 allows five percent
+	static void optimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount, float threshold);
+
+	// the order optimizeOverdraw draws clusters in, clusterStarts are the first triangle of every cluster
+	// plus one past the last, counted from source
+	static std::vector<uint32_t> getOverdrawOrder(const std::vector<Vertex>& vertices, const uint32_t* source, const std::vector<uint32_t>& clusterStarts);
+
+	// renumbers vertices by first use and drops unused ones, returns the new vertex count
+	static uint32_t optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	static VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount, uint32_t vertexCount);
+};
@@ -0,0 +1,255 @@
+#include "MeshPool.h"
+#include <array>
+#include "VulkanContext.h"
+#include "Tools.h"
+
+MeshPool::MeshPool()
+{ }
+
+MeshPool::~MeshPool()
+{ }
+
+void MeshPool::create(uint32_t _maxVertices, uint32_t _maxIndices)
+{
+	maxVertices = _maxVertices;
+	maxIndices = _maxIndices;
+	vertexCount = 0;
+	indexCount = 0;
+	meshes.clear();
+
+	// the vertex shader reads this one as a storage buffer, never as a vertex buffer
+	vkTools::createBuffer(sizeof(CompactVertex) * maxVertices, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+	vkTools::createBuffer(sizeof(uint16_t) * maxIndices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+	vkTools::createBuffer(sizeof(PoolUniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffer, uniformBufferMemory);
+
+	createDescriptorSet();
+
+	// no vertex input at all, the model matrix is the only per draw data
+	pipeline.createGraphicsPipelineLayoutAndPipeline(VulkanContext::getInstance()->getSwapChain()->swapChainImageExtent, descriptorSetLayout, VulkanContext::getInstance()->getRenderPass()->renderPass,
+		"Shaders/SPIRV/pulled.vert.spv", "Shaders/SPIRV/basic.frag.spv", VertexInputDescription(), sizeof(glm::mat4));
+}
+
+void MeshPool::createDescriptorSet()
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	// camera uniforms and the pulled vertices
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings = {};
+
+	bindings[0].binding = 0;
+	bindings[0].descriptorCount = 1;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	bindings[1].binding = 1;
+	bindings[1].descriptorCount = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutCreateInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(logicalDevice, &layoutCreateInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create mesh pool descriptor set layout!!");
+	}
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].descriptorCount = 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = 1;
+
+	if (vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create mesh pool descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &descriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &descriptorSet) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate mesh pool descriptor set!");
+	}
+
+	VkDescriptorBufferInfo uboInfo = {};
+	uboInfo.buffer = uniformBuffer;
+	uboInfo.offset = 0;
+	uboInfo.range = sizeof(PoolUniformBufferObject);
+
+	VkDescriptorBufferInfo vertexInfo = {};
+	vertexInfo.buffer = vertexBuffer;
+	vertexInfo.offset = 0;
+	vertexInfo.range = VK_WHOLE_SIZE;
+
+	std::array<VkWriteDescriptorSet, 2> writes = {};
+
+	writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writes[0].dstSet = descriptorSet;
+	writes[0].dstBinding = 0;
+	writes[0].descriptorCount = 1;
+	writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	writes[0].pBufferInfo = &uboInfo;
+
+	writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writes[1].dstSet = descriptorSet;
+	writes[1].dstBinding = 1;
+	writes[1].descriptorCount = 1;
+	writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	writes[1].pBufferInfo = &vertexInfo;
+
+	vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+uint32_t MeshPool::addMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+	if (vertices.size() > 0xffff)
+	{
+		throw std::runtime_error("mesh pool meshes are limited to 65535 vertices!");
+	}
+
+	if (vertexCount + vertices.size() > maxVertices || indexCount + indices.size() > maxIndices)
+	{
+		throw std::runtime_error("mesh pool is full!");
+	}
+
+	PooledMesh mesh;
+	mesh.baseVertex = vertexCount;
+	mesh.vertexCount = static_cast<uint32_t>(vertices.size());
+	mesh.firstIndex = indexCount;
+	mesh.indexCount = static_cast<uint32_t>(indices.size());
+
+	std::vector<CompactVertex> packedVertices;
+	VertexPacking::packVertices(vertices, packedVertices);
+
+	std::vector<uint16_t> indices16(indices.begin(), indices.end());
+
+	uploadToBuffer(vertexBuffer, sizeof(CompactVertex) * mesh.baseVertex, packedVertices.data(), sizeof(CompactVertex) * packedVertices.size());
+	uploadToBuffer(indexBuffer, sizeof(uint16_t) * mesh.firstIndex, indices16.data(), sizeof(uint16_t) * indices16.size());
+
+	vertexCount += mesh.vertexCount;
+	indexCount += mesh.indexCount;
+
+	meshes.push_back(mesh);
+	return static_cast<uint32_t>(meshes.size() - 1);
+}
+
+void MeshPool::uploadToBuffer(VkBuffer buffer, VkDeviceSize offset, const void* source, VkDeviceSize size)
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+
+	vkTools::createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+	void* data;
+	vkMapMemory(logicalDevice, stagingBufferMemory, 0, size, 0, &data);
+	memcpy(data, source, (size_t)size);
+	vkUnmapMemory(logicalDevice, stagingBufferMemory);
+
+	vkTools::copyBuffer(stagingBuffer, buffer, size, offset);
+
+	vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
+	vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
+}
+
+void MeshPool::updateUniformBuffer(Camera camera)
+{
+	PoolUniformBufferObject ubo = {};
+	ubo.view = camera.getViewMatrix();
+	ubo.proj = camera.getprojectionMatrix();
+	ubo.proj[1][1] *= -1; // invert Y as in Opengl it is inverted to begin with
+
+	void* data;
+	vkMapMemory(VulkanContext::getInstance()->getDevice()->logicalDevice, uniformBufferMemory, 0, sizeof(ubo), 0, &data);
+	memcpy(data, &ubo, sizeof(ubo));
+	vkUnmapMemory(VulkanContext::getInstance()->getDevice()->logicalDevice, uniformBufferMemory);
+}
+
+void MeshPool::beginDraw(VkCommandBuffer commandBuffer)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.graphicsPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+}
+
+void MeshPool::drawMesh(VkCommandBuffer commandBuffer, uint32_t meshId, glm::mat4 model)
+{
+	const PooledMesh& mesh = meshes[meshId];
+
+	vkCmdPushConstants(commandBuffer, pipeline.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &model);
+
+	// vertexOffset is the per draw base, it ends up in gl_VertexIndex
+	vkCmdDrawIndexed(commandBuffer, mesh.indexCount, 1, mesh.firstIndex, static_cast<int32_t>(mesh.baseVertex), 0);
+}
+
+void MeshPool::createBindless(BindlessResources* resources)
+{
+	bindless = resources;
+
+	// set 0 stays the pool's, set 1 is the bindless set, the only per draw data is which instance buffer to read
+	std::vector<VkDescriptorSetLayout> setLayouts = { descriptorSetLayout, bindless->descriptorSetLayout };
+
+	bindlessPipeline.createGraphicsPipelineLayoutAndPipeline(VulkanContext::getInstance()->getSwapChain()->swapChainImageExtent, setLayouts, VulkanContext::getInstance()->getRenderPass()->renderPass,
+		"Shaders/SPIRV/bindless.vert.spv", "Shaders/SPIRV/bindless.frag.spv", VertexInputDescription(), sizeof(BindlessDrawConstants));
+}
+
+void MeshPool::beginBindlessDraw(VkCommandBuffer commandBuffer, uint32_t instanceBuffer)
+{
+	std::array<VkDescriptorSet, 2> sets = { descriptorSet, bindless->descriptorSet };
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bindlessPipeline.graphicsPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bindlessPipeline.pipelineLayout, 0, static_cast<uint32_t>(sets.size()), sets.data(), 0, nullptr);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+
+	BindlessDrawConstants constants;
+	constants.instanceBuffer = instanceBuffer;
+
+	vkCmdPushConstants(commandBuffer, bindlessPipeline.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+}
+
+void MeshPool::drawMeshInstances(VkCommandBuffer commandBuffer, uint32_t meshId, uint32_t firstInstance, uint32_t instanceCount)
+{
+	const PooledMesh& mesh = meshes[meshId];
+
+	// nothing to bind, the instance records carry the transform and the texture
+	vkCmdDrawIndexed(commandBuffer, mesh.indexCount, instanceCount, mesh.firstIndex, static_cast<int32_t>(mesh.baseVertex), firstInstance);
+}
+
+void MeshPool::destroy()
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	pipeline.destroy();
+
+	if (bindless != nullptr)
+	{
+		bindlessPipeline.destroy();
+		bindless = nullptr;
+	}
+
+	vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+
+	vkDestroyBuffer(logicalDevice, uniformBuffer, nullptr);
+	vkFreeMemory(logicalDevice, uniformBufferMemory, nullptr);
+
+	vkDestroyBuffer(logicalDevice, indexBuffer, nullptr);
+	vkFreeMemory(logicalDevice, indexBufferMemory, nullptr);
+
+	vkDestroyBuffer(logicalDevice, vertexBuffer, nullptr);
+	vkFreeMemory(logicalDevice, vertexBufferMemory, nullptr);
+}
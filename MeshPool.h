@@ -0,0 +1,85 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "Mesh.h"
+#include "Camera.h"
+#include "GraphicsPipeline.h"
+#include "BindlessResources.h"
+
+// where a mesh lives inside the pool, indices are relative to baseVertex
+struct PooledMesh
+{
+	uint32_t baseVertex;
+	uint32_t vertexCount;
+	uint32_t firstIndex;
+	uint32_t indexCount;
+};
+
+struct PoolUniformBufferObject
+{
+	glm::mat4 view;
+	glm::mat4 proj;
+};
+
+// Vertex pulling
+// Every mesh is packed into one storage buffer of CompactVertex and one 16 bit index buffer.
+// pulled.vert reads its vertex by gl_VertexIndex, which already has the draw's vertexOffset
+// ( the mesh's baseVertex ) added, so there is no vertex input state and no per mesh bind.
+// One pipeline and one descriptor set draw everything, indirect draws included.
+// In bindless mode a second pipeline takes the model matrix and texture of each instance from a
+// BindlessInstance buffer, so meshes with different textures draw without a bind in between and
+// GpuCulling's indirect draws, whose firstInstance is the instance id, come out textured.
+class MeshPool
+{
+public:
+	MeshPool();
+	~MeshPool();
+
+	VkBuffer vertexBuffer;
+	VkDeviceMemory vertexBufferMemory;
+	VkBuffer indexBuffer;
+	VkDeviceMemory indexBufferMemory;
+
+	std::vector<PooledMesh> meshes;
+
+	void create(uint32_t _maxVertices, uint32_t _maxIndices);
+	void destroy();
+
+	// returns the mesh id, a single mesh can have at most 65535 vertices
+	uint32_t addMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+	void updateUniformBuffer(Camera camera);
+
+	// binds the pipeline, descriptor set and index buffer once for any number of drawMesh calls
+	void beginDraw(VkCommandBuffer commandBuffer);
+	void drawMesh(VkCommandBuffer commandBuffer, uint32_t meshId, glm::mat4 model);
+
+	// after create, resources has to outlive the pool
+	void createBindless(BindlessResources* resources);
+	// binds the bindless pipeline and both sets, instanceBuffer is the bindless index of a BindlessInstance array
+	void beginBindlessDraw(VkCommandBuffer commandBuffer, uint32_t instanceBuffer);
+	// instances firstInstance .. firstInstance + instanceCount of the instance buffer
+	void drawMeshInstances(VkCommandBuffer commandBuffer, uint32_t meshId, uint32_t firstInstance, uint32_t instanceCount);
+
+private:
+	uint32_t maxVertices;
+	uint32_t maxIndices;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+
+	VkBuffer uniformBuffer;
+	VkDeviceMemory uniformBufferMemory;
+
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet descriptorSet;
+
+	GraphicsPipeline pipeline;
+
+	BindlessResources* bindless = nullptr;
+	GraphicsPipeline bindlessPipeline;
+
+	void createDescriptorSet();
+	void uploadToBuffer(VkBuffer buffer, VkDeviceSize offset, const void* source, VkDeviceSize size);
+};
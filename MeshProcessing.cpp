@@ -0,0 +1,165 @@
+#include "MeshProcessing.h"
+#include "MeshSimplifier.h"
+#include "TangentGenerator.h"
+#include "Parallel.h"
+#include <algorithm>
+
+// meshlets are handed to the threads in runs of this many, one is far too little work
+static const uint32_t kMeshletChunkSize = 64;
+
+void MeshProcessing::process(ProcessedMesh& mesh, uint32_t threadCount)
+{
+	std::vector<Vertex>& vertices = mesh.vertices;
+	std::vector<uint32_t>& indices = mesh.indices;
+
+	// first, the mirror split adds vertices and welding has to see the final tangents
+	TangentGenerator::generate(vertices, indices, threadCount);
+
+	uint32_t indexCount = static_cast<uint32_t>(indices.size());
+	mesh.cacheStatsBefore = MeshOptimizer::analyzeVertexCache(indices, 0, indexCount, static_cast<uint32_t>(vertices.size()));
+
+	MeshOptimizer::weldVertices(vertices, indices);
+
+	// meshlets decide which triangles go together, the cache, overdraw and fetch orders are
+	// worked out inside that grouping so the meshlet reorder can't undo them
+	MeshletBuilder::build(vertices, indices, 0, indexCount, mesh.meshlets, threadCount);
+	optimizeMeshletVertexCache(mesh, threadCount);
+	orderMeshletsForOverdraw(mesh);
+	MeshOptimizer::optimizeVertexFetch(vertices, indices);
+	MeshletBuilder::rebuildLocalData(indices, static_cast<uint32_t>(vertices.size()), mesh.meshlets);
+
+	// LOD 0 as it is shipped
+	mesh.cacheStatsAfter = MeshOptimizer::analyzeVertexCache(indices, 0, indexCount, static_cast<uint32_t>(vertices.size()));
+
+	// LOD chain is built once at load, selection happens per frame in ObjectRenderer
+	MeshSimplifier::buildLodChain(vertices, indices, mesh.lods);
+
+	// simplification keeps the LOD 0 order with holes in it, reorder the coarser levels on their own
+	// every level has its own index range, so they can go to different threads
+	if (mesh.lods.size() > 1)
+	{
+		parallelFor(static_cast<uint32_t>(mesh.lods.size() - 1), [&](uint32_t i)
+		{
+			const MeshLod& lod = mesh.lods[i + 1];
+			MeshOptimizer::optimizeVertexCache(indices, lod.firstIndex, lod.indexCount, static_cast<uint32_t>(vertices.size()));
+		}, threadCount);
+	}
+
+	computeBounds(mesh);
+
+	// converted last, everything above reorders or welds the full vertices
+	VertexPacking::packStreams(vertices, mesh.positionStream, mesh.attributeStream);
+
+	// 0xffff is left out so it can never be taken for a primitive restart
+	mesh.indexType = vertices.size() <= 0xffff ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+CookedMeshSource MeshProcessing::getCookedSource(const ProcessedMesh& mesh, bool compress)
+{
+	CookedMeshSource source;
+	source.positions = &mesh.positionStream;
+	source.attributes = &mesh.attributeStream;
+	source.indices = &mesh.indices;
+	source.indexType = mesh.indexType;
+	source.lods = &mesh.lods;
+	source.meshlets = &mesh.meshlets;
+	source.boundingSphere = mesh.boundingSphere;
+	source.boundsMin = mesh.boundsMin;
+	source.boundsMax = mesh.boundsMax;
+	source.compress = compress;
+
+	return source;
+}
+
+// each meshlet on its own local vertices, at most kMaxVertices of them, instead of paying
+// for tables the size of the whole mesh once per meshlet
+void MeshProcessing::optimizeMeshletVertexCache(ProcessedMesh& mesh, uint32_t threadCount)
+{
+	const MeshletData& data = mesh.meshlets;
+	uint32_t meshletCount = static_cast<uint32_t>(data.meshlets.size());
+	uint32_t chunkCount = (meshletCount + kMeshletChunkSize - 1) / kMeshletChunkSize;
+
+	parallelFor(chunkCount, [&](uint32_t chunk)
+	{
+		std::vector<uint32_t> local;
+		uint32_t end = std::min(meshletCount, (chunk + 1) * kMeshletChunkSize);
+
+		for (uint32_t m = chunk * kMeshletChunkSize; m < end; m++)
+		{
+			const Meshlet& meshlet = data.meshlets[m];
+
+			const uint8_t* triangles = &data.triangles[meshlet.triangleOffset * 3];
+			local.assign(triangles, triangles + meshlet.triangleCount * 3);
+
+			MeshOptimizer::optimizeVertexCache(local, 0, meshlet.triangleCount * 3, meshlet.vertexCount);
+
+			for (uint32_t i = 0; i < meshlet.triangleCount * 3; i++)
+			{
+				mesh.indices[meshlet.firstIndex + i] = data.vertices[meshlet.vertexOffset + local[i]];
+			}
+		}
+	}, threadCount);
+}
+
+// whole meshlets drawn outside in, same sort optimizeOverdraw does with its clusters
+void MeshProcessing::orderMeshletsForOverdraw(ProcessedMesh& mesh)
+{
+	std::vector<Meshlet>& meshlets = mesh.meshlets.meshlets;
+
+	if (meshlets.size() < 2)
+	{
+		return;
+	}
+
+	// meshlets are contiguous and in index order after build, so their starts are the cluster starts
+	std::vector<uint32_t> clusterStarts;
+	for (const Meshlet& meshlet : meshlets)
+	{
+		clusterStarts.push_back(meshlet.firstIndex / 3);
+	}
+	clusterStarts.push_back((meshlets.back().firstIndex + meshlets.back().indexCount) / 3);
+
+	std::vector<uint32_t> order = MeshOptimizer::getOverdrawOrder(mesh.vertices, mesh.indices.data(), clusterStarts);
+
+	std::vector<uint32_t> ordered;
+	ordered.reserve(clusterStarts.back() * 3 - meshlets[0].firstIndex);
+
+	std::vector<Meshlet> orderedMeshlets;
+	orderedMeshlets.reserve(meshlets.size());
+
+	for (uint32_t m : order)
+	{
+		Meshlet meshlet = meshlets[m];
+		uint32_t firstIndex = meshlets[0].firstIndex + static_cast<uint32_t>(ordered.size());
+
+		ordered.insert(ordered.end(), mesh.indices.begin() + meshlet.firstIndex, mesh.indices.begin() + meshlet.firstIndex + meshlet.indexCount);
+
+		meshlet.firstIndex = firstIndex;
+		orderedMeshlets.push_back(meshlet);
+	}
+
+	std::copy(ordered.begin(), ordered.end(), mesh.indices.begin() + meshlets[0].firstIndex);
+	meshlets.swap(orderedMeshlets);
+}
+
+void MeshProcessing::computeBounds(ProcessedMesh& mesh)
+{
+	mesh.boundsMin = mesh.vertices[0].pos;
+	mesh.boundsMax = mesh.vertices[0].pos;
+
+	for (const Vertex& vertex : mesh.vertices)
+	{
+		mesh.boundsMin = glm::min(mesh.boundsMin, vertex.pos);
+		mesh.boundsMax = glm::max(mesh.boundsMax, vertex.pos);
+	}
+
+	glm::vec3 center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+	float radius = 0.0f;
+
+	for (const Vertex& vertex : mesh.vertices)
+	{
+		radius = std::max(radius, glm::length(vertex.pos - center));
+	}
+
+	mesh.boundingSphere = glm::vec4(center, radius);
+}
\ No newline at end of file
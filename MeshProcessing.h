@@ -0,0 +1,45 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "Mesh.h"
+#include "Meshlet.h"
+#include "MeshOptimizer.h"
+#include "CookedMesh.h"
+
+// a mesh after everything the engine does to it before upload or cooking
+struct ProcessedMesh
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<MeshLod> lods;
+	MeshletData meshlets;
+
+	std::vector<PositionStreamVertex> positionStream;
+	std::vector<AttributeStreamVertex> attributeStream;
+	VkIndexType indexType;
+
+	glm::vec4 boundingSphere;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+	VertexCacheStats cacheStatsBefore;
+	VertexCacheStats cacheStatsAfter;
+};
+
+// one place for the build order, generated meshes and the importer both go through it
+// touches nothing shared, so different meshes can be processed on different threads
+class MeshProcessing
+{
+public:
+	// fill in vertices and indices, the rest is produced here
+	// threadCount splits the work inside this one mesh, 0 uses every core
+	static void process(ProcessedMesh& mesh, uint32_t threadCount = 1);
+
+	static CookedMeshSource getCookedSource(const ProcessedMesh& mesh, bool compress);
+
+private:
+	static void optimizeMeshletVertexCache(ProcessedMesh& mesh, uint32_t threadCount);
+	static void orderMeshletsForOverdraw(ProcessedMesh& mesh);
+	static void computeBounds(ProcessedMesh& mesh);
+};
\ No newline at end of file
@@ -0,0 +1,363 @@
+#include "MeshSimplifier.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+// stop building LODs below this many triangles
+static const uint32_t kMinLodTriangles = 16;
+
+// coarsest LOD may drift this far from LOD 0, relative to the mesh extent
+static const float kMaxLodError = 0.05f;
+
+// error quadric Q(v) = v^T A v + 2 b.v + c of the planes around a vertex
+struct Quadric
+{
+	double a00, a11, a22, a01, a02, a12;
+	double b0, b1, b2;
+	double c;
+
+	void addPlane(glm::dvec3 n, double d)
+	{
+		a00 += n.x * n.x; a11 += n.y * n.y; a22 += n.z * n.z;
+		a01 += n.x * n.y; a02 += n.x * n.z; a12 += n.y * n.z;
+		b0 += n.x * d; b1 += n.y * d; b2 += n.z * d;
+		c += d * d;
+	}
+
+	void add(const Quadric& q)
+	{
+		a00 += q.a00; a11 += q.a11; a22 += q.a22;
+		a01 += q.a01; a02 += q.a02; a12 += q.a12;
+		b0 += q.b0; b1 += q.b1; b2 += q.b2;
+		c += q.c;
+	}
+
+	double evaluate(glm::vec3 v) const
+	{
+		double x = v.x, y = v.y, z = v.z;
+		double result = a00 * x * x + a11 * y * y + a22 * z * z
+			+ 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+			+ 2.0 * (b0 * x + b1 * y + b2 * z)
+			+ c;
+		return result > 0.0 ? result : 0.0;
+	}
+};
+
+struct Collapse
+{
+	uint32_t from;
+	uint32_t to;
+	float error;
+};
+
+struct PositionHash
+{
+	size_t operator()(const glm::vec3& p) const
+	{
+		uint32_t bits[3];
+		memcpy(bits, &p, sizeof(bits));
+		return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+	}
+};
+
+// vertices sharing a position map to the first one of them
+static void buildPositionRemap(const std::vector<Vertex>& vertices, std::vector<uint32_t>& remap)
+{
+	std::unordered_map<glm::vec3, uint32_t, PositionHash> firstVertex;
+	firstVertex.reserve(vertices.size());
+
+	remap.resize(vertices.size());
+
+	for (uint32_t i = 0; i < vertices.size(); i++)
+	{
+		auto it = firstVertex.emplace(vertices[i].pos, i).first;
+		remap[i] = it->second;
+	}
+}
+
+// seam vertices (shared position, different attributes) and open border vertices can't move
+static void findLockedVertices(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& positionRemap, std::vector<bool>& locked)
+{
+	locked.assign(vertices.size(), false);
+
+	std::vector<uint32_t> shareCount(vertices.size(), 0);
+	for (uint32_t i = 0; i < vertices.size(); i++)
+	{
+		shareCount[positionRemap[i]]++;
+	}
+	for (uint32_t i = 0; i < vertices.size(); i++)
+	{
+		locked[i] = shareCount[positionRemap[i]] > 1;
+	}
+
+	// an edge is on the border when no triangle walks it the other way
+	std::unordered_set<uint64_t> edges;
+	edges.reserve(indices.size());
+
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		uint32_t a = positionRemap[indices[i]];
+		uint32_t b = positionRemap[indices[i % 3 == 2 ? i - 2 : i + 1]];
+		edges.insert(((uint64_t)a << 32) | b);
+	}
+
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		uint32_t a = positionRemap[indices[i]];
+		uint32_t b = positionRemap[indices[i % 3 == 2 ? i - 2 : i + 1]];
+
+		if (edges.find(((uint64_t)b << 32) | a) == edges.end())
+		{
+			locked[indices[i]] = true;
+			locked[indices[i % 3 == 2 ? i - 2 : i + 1]] = true;
+		}
+	}
+}
+
+// moving 'from' onto 'to' must not turn any of its remaining triangles over
+static bool collapseFlipsTriangle(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& triangleOffsets, const std::vector<uint32_t>& vertexTriangles, uint32_t from, uint32_t to)
+{
+	for (uint32_t t = triangleOffsets[from]; t < triangleOffsets[from + 1]; t++)
+	{
+		const uint32_t* tri = &indices[vertexTriangles[t] * 3];
+
+		if (tri[0] == to || tri[1] == to || tri[2] == to)
+		{
+			continue; // this one collapses away
+		}
+
+		glm::vec3 p[3];
+		glm::vec3 moved[3];
+		for (int k = 0; k < 3; k++)
+		{
+			p[k] = vertices[tri[k]].pos;
+			moved[k] = (tri[k] == from) ? vertices[to].pos : p[k];
+		}
+
+		glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+		glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+
+		if (glm::dot(before, after) <= 0.0f)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void MeshSimplifier::simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t targetIndexCount, float targetError, std::vector<uint32_t>& outIndices, float& outError)
+{
+	outIndices = indices;
+	outError = 0.0f;
+
+	if (indices.size() <= targetIndexCount || vertices.empty())
+	{
+		return;
+	}
+
+	const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+
+	std::vector<uint32_t> positionRemap;
+	buildPositionRemap(vertices, positionRemap);
+
+	std::vector<bool> locked;
+	findLockedVertices(vertices, indices, positionRemap, locked);
+
+	// errors are reported relative to the bounding box diagonal
+	glm::vec3 boundsMin = vertices[0].pos;
+	glm::vec3 boundsMax = vertices[0].pos;
+	for (const Vertex& vertex : vertices)
+	{
+		boundsMin = glm::min(boundsMin, vertex.pos);
+		boundsMax = glm::max(boundsMax, vertex.pos);
+	}
+	float extent = glm::length(boundsMax - boundsMin);
+	float errorScale = extent > 0.0f ? 1.0f / extent : 0.0f;
+
+	// one quadric per unique position so both sides of a seam agree
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		glm::dvec3 p0 = vertices[indices[i]].pos;
+		glm::dvec3 p1 = vertices[indices[i + 1]].pos;
+		glm::dvec3 p2 = vertices[indices[i + 2]].pos;
+
+		glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+		double length = glm::length(normal);
+
+		if (length == 0.0)
+		{
+			continue;
+		}
+		normal /= length;
+
+		double d = -glm::dot(normal, p0);
+		for (int k = 0; k < 3; k++)
+		{
+			quadrics[positionRemap[indices[i + k]]].addPlane(normal, d);
+		}
+	}
+
+	std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+	std::vector<uint32_t> vertexTriangles;
+	std::vector<Collapse> collapses;
+	std::vector<bool> touched(vertexCount);
+	std::vector<uint32_t> collapseRemap(vertexCount);
+
+	// each pass collapses a batch of the cheapest independent edges
+	while (outIndices.size() > targetIndexCount)
+	{
+		// vertex -> triangle adjacency of the current mesh
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (uint32_t index : outIndices)
+		{
+			triangleOffsets[index + 1]++;
+		}
+		for (uint32_t i = 0; i < vertexCount; i++)
+		{
+			triangleOffsets[i + 1] += triangleOffsets[i];
+		}
+
+		vertexTriangles.resize(outIndices.size());
+		std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (uint32_t i = 0; i < outIndices.size(); i++)
+		{
+			vertexTriangles[fill[outIndices[i]]++] = i / 3;
+		}
+
+		// every edge both ways, sources must be free to move
+		collapses.clear();
+		for (size_t i = 0; i < outIndices.size(); i++)
+		{
+			uint32_t a = outIndices[i];
+			uint32_t b = outIndices[i % 3 == 2 ? i - 2 : i + 1];
+
+			for (int direction = 0; direction < 2; direction++)
+			{
+				uint32_t from = direction == 0 ? a : b;
+				uint32_t to = direction == 0 ? b : a;
+
+				if (locked[from])
+				{
+					continue;
+				}
+
+				Quadric q = quadrics[positionRemap[from]];
+				q.add(quadrics[positionRemap[to]]);
+
+				float error = (float)std::sqrt(q.evaluate(vertices[to].pos)) * errorScale;
+				collapses.push_back({ from, to, error });
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.error < r.error; });
+
+		std::fill(touched.begin(), touched.end(), false);
+		for (uint32_t i = 0; i < vertexCount; i++)
+		{
+			collapseRemap[i] = i;
+		}
+
+		size_t trianglesToRemove = (outIndices.size() - targetIndexCount) / 3;
+		size_t trianglesRemoved = 0;
+		uint32_t collapseCount = 0;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.error > targetError || trianglesRemoved >= trianglesToRemove)
+			{
+				break;
+			}
+
+			if (touched[collapse.from] || touched[collapse.to])
+			{
+				continue;
+			}
+
+			if (collapseFlipsTriangle(vertices, outIndices, triangleOffsets, vertexTriangles, collapse.from, collapse.to))
+			{
+				continue;
+			}
+
+			collapseRemap[collapse.from] = collapse.to;
+			quadrics[positionRemap[collapse.to]].add(quadrics[positionRemap[collapse.from]]);
+			outError = std::max(outError, collapse.error);
+			collapseCount++;
+
+			// the one ring of 'from' changes shape, leave it alone until the next pass
+			for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; t++)
+			{
+				const uint32_t* tri = &outIndices[vertexTriangles[t] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+
+				if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+				{
+					trianglesRemoved++;
+				}
+			}
+		}
+
+		if (collapseCount == 0)
+		{
+			break;
+		}
+
+		// apply the collapses and drop triangles that became degenerate
+		size_t writeIndex = 0;
+		for (size_t i = 0; i + 2 < outIndices.size(); i += 3)
+		{
+			uint32_t a = collapseRemap[outIndices[i]];
+			uint32_t b = collapseRemap[outIndices[i + 1]];
+			uint32_t c = collapseRemap[outIndices[i + 2]];
+
+			if (a == b || b == c || a == c)
+			{
+				continue;
+			}
+
+			outIndices[writeIndex++] = a;
+			outIndices[writeIndex++] = b;
+			outIndices[writeIndex++] = c;
+		}
+		outIndices.resize(writeIndex);
+	}
+}
+
+void MeshSimplifier::buildLodChain(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods)
+{
+	const std::vector<uint32_t> baseIndices = indices;
+
+	lods.clear();
+	lods.push_back({ 0, static_cast<uint32_t>(baseIndices.size()), 0.0f });
+
+	std::vector<uint32_t> lodIndices;
+	uint32_t previousCount = static_cast<uint32_t>(baseIndices.size());
+
+	// every LOD halves the triangle count, always simplified from LOD 0 so errors don't stack
+	for (uint32_t lod = 1; lod < kMaxLods; lod++)
+	{
+		uint32_t targetCount = (previousCount / 6) * 3;
+
+		if (targetCount < kMinLodTriangles * 3)
+		{
+			break;
+		}
+
+		float error;
+		simplify(vertices, baseIndices, targetCount, kMaxLodError, lodIndices, error);
+
+		// not enough saved to be worth a level
+		if (lodIndices.size() * 10 > previousCount * 9)
+		{
+			break;
+		}
+
+		lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lodIndices.size()), error });
+		indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+
+		previousCount = static_cast<uint32_t>(lodIndices.size());
+	}
+}
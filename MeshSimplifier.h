@@ -0,0 +1,20 @@
+#pragma once
+#include <vector>
+#include "Mesh.h"
+
+// Quadric error metric simplification
+// Edges are collapsed onto one of their end points, so every LOD reuses the
+// original vertex buffer and only the index buffer changes.
+// Vertices on open borders or uv / normal seams are kept in place.
+class MeshSimplifier
+{
+public:
+	static const uint32_t kMaxLods = 5;
+
+	// simplifies until the index count reaches targetIndexCount or the error would exceed targetError
+	// errors are relative to the mesh extent, 0.01 is one percent of the bounding box diagonal
+	static void simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t targetIndexCount, float targetError, std::vector<uint32_t>& outIndices, float& outError);
+
+	// appends every coarser LOD after the LOD 0 indices and fills in the ranges
+	static void buildLodChain(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods);
+};
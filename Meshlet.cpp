@@ -0,0 +1,423 @@
+#include "Meshlet.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+
+// candidates scanned for a new seed when the current meshlet has no unused neighbours left
+static const uint32_t kSeedSearchLimit = 1024;
+
+// cones wider than this ( about 84 degrees from the axis ) are never backface culled
+static const float kMinConeDot = 0.1f;
+
+// meshlets are handed to the threads in runs of this many for the bounds
+static const uint32_t kBoundsChunkSize = 64;
+
+// front faces are clockwise ( GraphicsPipeline ), so the outward normal is (p2 - p0) x (p1 - p0)
+static glm::vec3 triangleNormal(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2)
+{
+	glm::vec3 n = glm::cross(p2 - p0, p1 - p0);
+	float length = glm::length(n);
+
+	return length > 0.0f ? n / length : glm::vec3(0.0f);
+}
+
+static void computeMeshletBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, Meshlet& meshlet)
+{
+	// sphere around the box center, same as the whole mesh bounds in ObjectBuffers
+	glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+
+	for (uint32_t i = 0; i < meshlet.indexCount; i++)
+	{
+		glm::vec3 p = vertices[indices[meshlet.firstIndex + i]].pos;
+		boundsMin = glm::min(boundsMin, p);
+		boundsMax = glm::max(boundsMax, p);
+	}
+
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	float radius = 0.0f;
+
+	for (uint32_t i = 0; i < meshlet.indexCount; i++)
+	{
+		radius = std::max(radius, glm::length(vertices[indices[meshlet.firstIndex + i]].pos - center));
+	}
+
+	meshlet.boundingSphere = glm::vec4(center, radius);
+
+	// normal cone, axis is the average triangle normal and the cutoff comes from the widest one
+	glm::vec3 normalSum = glm::vec3(0.0f);
+
+	for (uint32_t i = 0; i < meshlet.indexCount; i += 3)
+	{
+		const uint32_t* tri = &indices[meshlet.firstIndex + i];
+		normalSum += triangleNormal(vertices[tri[0]].pos, vertices[tri[1]].pos, vertices[tri[2]].pos);
+	}
+
+	meshlet.coneApex = center;
+	meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneCutoff = 1.0f;
+
+	float sumLength = glm::length(normalSum);
+	if (sumLength <= 0.0f)
+	{
+		return;
+	}
+
+	glm::vec3 axis = normalSum / sumLength;
+	float minDot = 1.0f;
+
+	for (uint32_t i = 0; i < meshlet.indexCount; i += 3)
+	{
+		const uint32_t* tri = &indices[meshlet.firstIndex + i];
+		glm::vec3 n = triangleNormal(vertices[tri[0]].pos, vertices[tri[1]].pos, vertices[tri[2]].pos);
+
+		// degenerate triangles have no facing
+		if (n != glm::vec3(0.0f))
+		{
+			minDot = std::min(minDot, glm::dot(axis, n));
+		}
+	}
+
+	meshlet.coneAxis = axis;
+
+	if (minDot <= kMinConeDot)
+	{
+		return;
+	}
+
+	// move the apex back along the axis until it is behind every triangle plane,
+	// then a camera inside the cone from the apex sees only back faces
+	float maxT = 0.0f;
+
+	for (uint32_t i = 0; i < meshlet.indexCount; i += 3)
+	{
+		const uint32_t* tri = &indices[meshlet.firstIndex + i];
+		glm::vec3 p0 = vertices[tri[0]].pos;
+		glm::vec3 n = triangleNormal(p0, vertices[tri[1]].pos, vertices[tri[2]].pos);
+
+		if (n == glm::vec3(0.0f))
+		{
+			continue;
+		}
+
+		float t = glm::dot(center - p0, n) / glm::dot(axis, n);
+		maxT = std::max(maxT, t);
+	}
+
+	meshlet.coneApex = center - axis * maxT;
+	meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+void MeshletBuilder::build(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount, MeshletData& out, uint32_t threadCount)
+{
+	out.meshlets.clear();
+	out.vertices.clear();
+	out.triangles.clear();
+
+	uint32_t triangleCount = indexCount / 3;
+	const uint32_t* source = &indices[firstIndex];
+
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// vertex -> triangles adjacency, offsets into one flat list
+	std::vector<uint32_t> adjacencyOffsets(vertices.size() + 1, 0);
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacencyOffsets[source[i] + 1]++;
+	}
+
+	for (size_t v = 0; v < vertices.size(); v++)
+	{
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	}
+
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[fill[source[i]]++] = i / 3;
+	}
+
+	std::vector<glm::vec3> centroids(triangleCount);
+
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		centroids[t] = (vertices[source[t * 3 + 0]].pos + vertices[source[t * 3 + 1]].pos + vertices[source[t * 3 + 2]].pos) / 3.0f;
+	}
+
+	std::vector<bool> triangleUsed(triangleCount, false);
+	uint32_t firstUnused = 0;
+
+	// slot of a mesh vertex in the current meshlet, 0xff when it is not in it
+	std::vector<uint8_t> localSlot(vertices.size(), 0xff);
+
+	std::vector<uint32_t> ordered;
+	ordered.reserve(indexCount);
+
+	Meshlet current = {};
+	glm::vec3 centroidSum = glm::vec3(0.0f);
+
+	auto newVertexCount = [&](uint32_t t)
+	{
+		uint32_t count = 0;
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			count += localSlot[source[t * 3 + k]] == 0xff ? 1 : 0;
+		}
+
+		// a degenerate triangle can name the same new vertex twice
+		if (source[t * 3 + 0] == source[t * 3 + 1] || source[t * 3 + 0] == source[t * 3 + 2] || source[t * 3 + 1] == source[t * 3 + 2])
+		{
+			count = std::min(count, 2u);
+		}
+
+		return count;
+	};
+
+	auto flush = [&]()
+	{
+		for (uint32_t i = 0; i < current.vertexCount; i++)
+		{
+			localSlot[out.vertices[current.vertexOffset + i]] = 0xff;
+		}
+
+		current.firstIndex = firstIndex + static_cast<uint32_t>(ordered.size()) - current.triangleCount * 3;
+		current.indexCount = current.triangleCount * 3;
+		out.meshlets.push_back(current);
+
+		current = {};
+		current.vertexOffset = static_cast<uint32_t>(out.vertices.size());
+		current.triangleOffset = static_cast<uint32_t>(out.triangles.size() / 3);
+		centroidSum = glm::vec3(0.0f);
+	};
+
+	auto addTriangle = [&](uint32_t t)
+	{
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			uint32_t v = source[t * 3 + k];
+
+			if (localSlot[v] == 0xff)
+			{
+				localSlot[v] = static_cast<uint8_t>(current.vertexCount++);
+				out.vertices.push_back(v);
+			}
+
+			out.triangles.push_back(localSlot[v]);
+			ordered.push_back(v);
+		}
+
+		triangleUsed[t] = true;
+		current.triangleCount++;
+		centroidSum += centroids[t];
+	};
+
+	for (uint32_t added = 0; added < triangleCount; added++)
+	{
+		// best neighbour is the one that brings the fewest new vertices,
+		// ties go to the closest one to keep the meshlet round and its bounds tight
+		uint32_t best = ~0u;
+		uint32_t bestNew = 4;
+		float bestDistance = std::numeric_limits<float>::max();
+		glm::vec3 center = current.triangleCount > 0 ? centroidSum / (float)current.triangleCount : glm::vec3(0.0f);
+
+		for (uint32_t i = 0; i < current.vertexCount; i++)
+		{
+			uint32_t v = out.vertices[current.vertexOffset + i];
+
+			for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++)
+			{
+				uint32_t t = adjacency[a];
+				if (triangleUsed[t])
+				{
+					continue;
+				}
+
+				uint32_t extra = newVertexCount(t);
+				glm::vec3 d = centroids[t] - center;
+				float distance = glm::dot(d, d);
+
+				if (extra < bestNew || (extra == bestNew && distance < bestDistance))
+				{
+					best = t;
+					bestNew = extra;
+					bestDistance = distance;
+				}
+			}
+		}
+
+		// nothing connected, continue with the closest unused triangle
+		if (best == ~0u)
+		{
+			while (triangleUsed[firstUnused])
+			{
+				firstUnused++;
+			}
+
+			best = firstUnused;
+
+			if (current.triangleCount > 0)
+			{
+				uint32_t scanned = 0;
+
+				for (uint32_t t = firstUnused; t < triangleCount && scanned < kSeedSearchLimit; t++)
+				{
+					if (triangleUsed[t])
+					{
+						continue;
+					}
+
+					scanned++;
+
+					glm::vec3 d = centroids[t] - center;
+					float distance = glm::dot(d, d);
+					if (distance < bestDistance)
+					{
+						best = t;
+						bestDistance = distance;
+					}
+				}
+			}
+
+			bestNew = newVertexCount(best);
+		}
+
+		if (current.vertexCount + bestNew > kMaxVertices || current.triangleCount + 1 > kMaxTriangles)
+		{
+			flush();
+			bestNew = newVertexCount(best);
+		}
+
+		addTriangle(best);
+	}
+
+	if (current.triangleCount > 0)
+	{
+		flush();
+	}
+
+	// meshlet order becomes the index order of the range
+	std::copy(ordered.begin(), ordered.end(), indices.begin() + firstIndex);
+
+	uint32_t meshletCount = static_cast<uint32_t>(out.meshlets.size());
+
+	parallelFor((meshletCount + kBoundsChunkSize - 1) / kBoundsChunkSize, [&](uint32_t chunk)
+	{
+		for (uint32_t m = chunk * kBoundsChunkSize; m < std::min(meshletCount, (chunk + 1) * kBoundsChunkSize); m++)
+		{
+			computeMeshletBounds(vertices, indices, out.meshlets[m]);
+		}
+	}, threadCount);
+}
+
+void MeshletBuilder::rebuildLocalData(const std::vector<uint32_t>& indices, uint32_t vertexCount, MeshletData& data)
+{
+	data.vertices.clear();
+	data.triangles.clear();
+
+	std::vector<uint8_t> localSlot(vertexCount, 0xff);
+
+	for (Meshlet& meshlet : data.meshlets)
+	{
+		meshlet.vertexOffset = static_cast<uint32_t>(data.vertices.size());
+		meshlet.vertexCount = 0;
+		meshlet.triangleOffset = static_cast<uint32_t>(data.triangles.size() / 3);
+		meshlet.triangleCount = meshlet.indexCount / 3;
+
+		for (uint32_t i = 0; i < meshlet.indexCount; i++)
+		{
+			uint32_t v = indices[meshlet.firstIndex + i];
+
+			if (localSlot[v] == 0xff)
+			{
+				localSlot[v] = static_cast<uint8_t>(meshlet.vertexCount++);
+				data.vertices.push_back(v);
+			}
+
+			data.triangles.push_back(localSlot[v]);
+		}
+
+		for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		{
+			localSlot[data.vertices[meshlet.vertexOffset + i]] = 0xff;
+		}
+	}
+}
+
+void MeshletCuller::cull(const MeshletData& data, glm::mat4 model, Camera& camera, SoftwareOcclusion* occlusion, std::vector<IndexRange>& outRanges, MeshletCullStats* stats)
+{
+	outRanges.clear();
+
+	MeshletCullStats counts = {};
+	counts.total = static_cast<uint32_t>(data.meshlets.size());
+
+	glm::vec4 planes[6];
+	camera.getFrustumPlanes(planes);
+
+	glm::vec3 cameraPos = glm::vec3(glm::inverse(camera.getViewMatrix())[3]);
+
+	// cones only survive a uniform scale, with anything else the backface test is skipped
+	glm::vec3 axisScale = glm::vec3(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])));
+	float maxScale = std::max(axisScale.x, std::max(axisScale.y, axisScale.z));
+	float minScale = std::min(axisScale.x, std::min(axisScale.y, axisScale.z));
+	bool uniformScale = maxScale - minScale <= maxScale * 1e-3f;
+
+	for (const Meshlet& meshlet : data.meshlets)
+	{
+		// backface cone
+		if (uniformScale && meshlet.coneCutoff < 1.0f)
+		{
+			glm::vec3 apex = glm::vec3(model * glm::vec4(meshlet.coneApex, 1.0f));
+			glm::vec3 axis = glm::normalize(glm::mat3(model) * meshlet.coneAxis);
+
+			if (glm::dot(glm::normalize(apex - cameraPos), axis) >= meshlet.coneCutoff)
+			{
+				counts.backface++;
+				continue;
+			}
+		}
+
+		glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(meshlet.boundingSphere), 1.0f));
+		float radius = meshlet.boundingSphere.w * maxScale;
+
+		// frustum
+		bool inside = true;
+		for (int i = 0; i < 6 && inside; i++)
+		{
+			inside = glm::dot(glm::vec3(planes[i]), center) + planes[i].w >= -radius;
+		}
+
+		if (!inside)
+		{
+			counts.frustum++;
+			continue;
+		}
+
+		// occlusion
+		if (occlusion != nullptr && !occlusion->isVisible(center - glm::vec3(radius), center + glm::vec3(radius)))
+		{
+			counts.occluded++;
+			continue;
+		}
+
+		// meshlets are back to back in the index buffer, so visible neighbours share one draw
+		if (!outRanges.empty() && outRanges.back().firstIndex + outRanges.back().indexCount == meshlet.firstIndex)
+		{
+			outRanges.back().indexCount += meshlet.indexCount;
+		}
+		else
+		{
+			outRanges.push_back({ meshlet.firstIndex, meshlet.indexCount });
+		}
+	}
+
+	if (stats != nullptr)
+	{
+		*stats = counts;
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+#include "Mesh.h"
+#include "Camera.h"
+#include "SoftwareOcclusion.h"
+
+// small cluster of triangles that is culled as a whole
+// its triangles are contiguous in the index buffer, firstIndex / indexCount is its draw range
+struct Meshlet
+{
+	uint32_t vertexOffset;		// into MeshletData::vertices
+	uint32_t vertexCount;
+	uint32_t triangleOffset;	// into MeshletData::triangles, 3 local indices per triangle
+	uint32_t triangleCount;
+
+	uint32_t firstIndex;
+	uint32_t indexCount;
+
+	// local space center xyz, radius w
+	glm::vec4 boundingSphere;
+
+	// every triangle faces away from the camera when dot(normalize(coneApex - cameraPos), coneAxis) >= coneCutoff
+	// a cutoff of 1 means the normals spread too much and the cluster is never backface culled
+	glm::vec3 coneApex;
+	glm::vec3 coneAxis;
+	float coneCutoff;
+};
+
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> vertices;		// local to mesh vertex index
+	std::vector<uint8_t> triangles;		// local vertex indices
+};
+
+struct IndexRange
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+};
+
+struct MeshletCullStats
+{
+	uint32_t total;
+	uint32_t backface;
+	uint32_t frustum;
+	uint32_t occluded;
+};
+
+class MeshletBuilder
+{
+public:
+	// the usual mesh shader limits, 124 triangles keep the local index bytes a multiple of 4
+	static const uint32_t kMaxVertices = 64;
+	static const uint32_t kMaxTriangles = 124;
+
+	// groups the triangles in [firstIndex, firstIndex + indexCount) into meshlets and
+	// rewrites that range of indices so every meshlet's triangles are contiguous
+	// the grouping itself is serial, threadCount only spreads the bounds and cones
+	static void build(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount, MeshletData& out, uint32_t threadCount = 1);
+
+	// local vertices and triangles again from every meshlet's index range, in meshlet order,
+	// after the triangles inside meshlets, the meshlets or the vertices were reordered
+	static void rebuildLocalData(const std::vector<uint32_t>& indices, uint32_t vertexCount, MeshletData& data);
+};
+
+// CPU per cluster culling, runs after the object itself passed its own visibility test
+class MeshletCuller
+{
+public:
+	// writes the surviving draw ranges, neighbouring meshlets are merged into one range
+	// occlusion can be null, it has to be rasterized for this frame already
+	static void cull(const MeshletData& data, glm::mat4 model, Camera& camera, SoftwareOcclusion* occlusion, std::vector<IndexRange>& outRanges, MeshletCullStats* stats = nullptr);
+};
@@ -0,0 +1,448 @@
+#include "MipGenerator.h"
+#include "Parallel.h"
+#include <emmintrin.h>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <stdexcept>
+
+// rows per parallelFor job
+static const uint32_t kMipBandRows = 32;
+
+// filter radius in destination texels and the shape of the window
+static const float kKaiserRadius = 1.5f;
+static const float kKaiserAlpha = 4.0f;
+
+// -- sRGB
+struct SrgbTables
+{
+	float toLinear[256];
+	uint8_t toSrgb[65536];	// indexed by linear * 65535
+
+	SrgbTables()
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			float c = i / 255.0f;
+			toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+
+		for (int i = 0; i < 65536; i++)
+		{
+			float l = i / 65535.0f;
+			float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+			toSrgb[i] = (uint8_t)std::min(std::max((int)(c * 255.0f + 0.5f), 0), 255);
+		}
+	}
+};
+
+static const SrgbTables& getSrgbTables()
+{
+	static SrgbTables tables;
+	return tables;
+}
+
+static void decodeRow(const uint8_t* bytes, uint32_t width, bool srgb, float* out)
+{
+	const SrgbTables& tables = getSrgbTables();
+
+	__m128i zero = _mm_setzero_si128();
+	__m128 unormScale = _mm_set1_ps(1.0f / 255.0f);
+
+	for (uint32_t x = 0; x < width * 4; x += 4)
+	{
+		uint32_t packed;
+		memcpy(&packed, bytes + x, 4);
+
+		// widen the four bytes to four ints
+		__m128i texel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)packed), zero), zero);
+		_mm_storeu_ps(out + x, _mm_mul_ps(_mm_cvtepi32_ps(texel), unormScale));
+
+		if (srgb)
+		{
+			out[x + 0] = tables.toLinear[bytes[x + 0]];
+			out[x + 1] = tables.toLinear[bytes[x + 1]];
+			out[x + 2] = tables.toLinear[bytes[x + 2]];
+		}
+	}
+}
+
+static void encodeRow(const float* texels, uint32_t width, bool srgb, uint8_t* out)
+{
+	const SrgbTables& tables = getSrgbTables();
+
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 unormScale = _mm_set1_ps(255.0f);
+	__m128 srgbScale = _mm_set1_ps(65535.0f);
+
+	for (uint32_t x = 0; x < width; x++)
+	{
+		// the kaiser filter rings a little past 0 and 1
+		__m128 texel = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(texels + x * 4), zero), one);
+
+		// round to nearest and saturate down to bytes
+		__m128i unorm = _mm_cvtps_epi32(_mm_mul_ps(texel, unormScale));
+		unorm = _mm_packs_epi32(unorm, unorm);
+		unorm = _mm_packus_epi16(unorm, unorm);
+
+		uint32_t packed = (uint32_t)_mm_cvtsi128_si32(unorm);
+		memcpy(out + x * 4, &packed, 4);
+
+		if (srgb)
+		{
+			alignas(16) int32_t index[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(index), _mm_cvtps_epi32(_mm_mul_ps(texel, srgbScale)));
+
+			out[x * 4 + 0] = tables.toSrgb[index[0]];
+			out[x * 4 + 1] = tables.toSrgb[index[1]];
+			out[x * 4 + 2] = tables.toSrgb[index[2]];
+		}
+	}
+}
+
+// -- Filters
+// dst is linear RGBA float, one __m128 per texel
+
+// the level above, level 0 stays in bytes and is decoded a row at a time
+// so a large texture never exists as float
+struct SourceLevel
+{
+	const uint8_t* bytes;
+	const float* texels;
+	uint32_t width;
+	uint32_t height;
+	bool srgb;
+
+	const float* getRow(uint32_t y, float* scratch) const
+	{
+		if (texels != nullptr)
+		{
+			return texels + (size_t)y * width * 4;
+		}
+
+		decodeRow(bytes + (size_t)y * width * 4, width, srgb, scratch);
+		return scratch;
+	}
+};
+
+// 2x2 average, odd sizes clamp so the last row or column is averaged with itself
+static void downsampleBoxRows(const SourceLevel& src, float* dst, uint32_t dstWidth, uint32_t firstRow, uint32_t rowCount)
+{
+	__m128 quarter = _mm_set1_ps(0.25f);
+	std::vector<float> scratch((size_t)src.width * 8);
+
+	for (uint32_t y = firstRow; y < firstRow + rowCount; y++)
+	{
+		const float* row0 = src.getRow(std::min(y * 2, src.height - 1), scratch.data());
+		const float* row1 = src.getRow(std::min(y * 2 + 1, src.height - 1), scratch.data() + src.width * 4);
+		float* out = dst + (size_t)y * dstWidth * 4;
+
+		for (uint32_t x = 0; x < dstWidth; x++)
+		{
+			uint32_t x0 = std::min(x * 2, src.width - 1) * 4;
+			uint32_t x1 = std::min(x * 2 + 1, src.width - 1) * 4;
+
+			__m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1)),
+				_mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)));
+
+			_mm_storeu_ps(out + x * 4, _mm_mul_ps(sum, quarter));
+		}
+	}
+}
+
+// same as above one float at a time, the reference for the benchmark
+static void downsampleBoxScalar(const float* src, uint32_t srcWidth, uint32_t srcHeight, float* dst, uint32_t dstWidth, uint32_t dstHeight)
+{
+	for (uint32_t y = 0; y < dstHeight; y++)
+	{
+		const float* row0 = src + (size_t)std::min(y * 2, srcHeight - 1) * srcWidth * 4;
+		const float* row1 = src + (size_t)std::min(y * 2 + 1, srcHeight - 1) * srcWidth * 4;
+		float* out = dst + (size_t)y * dstWidth * 4;
+
+		for (uint32_t x = 0; x < dstWidth; x++)
+		{
+			uint32_t x0 = std::min(x * 2, srcWidth - 1) * 4;
+			uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1) * 4;
+
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				out[x * 4 + c] = ((row0[x0 + c] + row0[x1 + c]) + (row1[x0 + c] + row1[x1 + c])) * 0.25f;
+			}
+		}
+	}
+}
+
+// zeroth order modified bessel function of the first kind, the series converges fast for small x
+static float besselI0(float x)
+{
+	float sum = 1.0f;
+	float term = 1.0f;
+	float halfX = x * 0.5f;
+
+	for (int k = 1; k < 20; k++)
+	{
+		term *= (halfX / k) * (halfX / k);
+		sum += term;
+	}
+
+	return sum;
+}
+
+// source texels and weights of every destination texel along one axis
+struct FilterTaps
+{
+	uint32_t tapCount;
+	std::vector<uint32_t> indices;	// dstSize * tapCount, clamped to the edge
+	std::vector<float> weights;		// normalized per destination texel
+};
+
+static void buildKaiserTaps(uint32_t srcSize, uint32_t dstSize, FilterTaps& taps)
+{
+	float scale = (float)srcSize / dstSize;
+	float srcRadius = kKaiserRadius * scale;
+	float windowNorm = 1.0f / besselI0(kKaiserAlpha);
+
+	// texels strictly inside the radius, the widest destination texel sets the count
+	taps.tapCount = 1;
+	for (uint32_t i = 0; i < dstSize; i++)
+	{
+		float center = (i + 0.5f) * scale;
+		int first = (int)std::floor(center - srcRadius - 0.5f) + 1;
+		int last = (int)std::ceil(center + srcRadius - 0.5f) - 1;
+		taps.tapCount = std::max(taps.tapCount, (uint32_t)(last - first + 1));
+	}
+
+	taps.indices.assign((size_t)dstSize * taps.tapCount, 0);
+	taps.weights.assign((size_t)dstSize * taps.tapCount, 0.0f);
+
+	for (uint32_t i = 0; i < dstSize; i++)
+	{
+		float center = (i + 0.5f) * scale;
+		int first = (int)std::floor(center - srcRadius - 0.5f) + 1;
+		float sum = 0.0f;
+
+		for (uint32_t t = 0; t < taps.tapCount; t++)
+		{
+			int source = first + (int)t;
+
+			// distance in destination texels
+			float d = (source + 0.5f - center) / scale;
+			float weight = 0.0f;
+
+			if (std::fabs(d) < kKaiserRadius)
+			{
+				float window = d / kKaiserRadius;
+				float sinc = d == 0.0f ? 1.0f : std::sin(3.14159265f * d) / (3.14159265f * d);
+				weight = sinc * besselI0(kKaiserAlpha * std::sqrt(1.0f - window * window)) * windowNorm;
+			}
+
+			taps.indices[i * taps.tapCount + t] = (uint32_t)std::min(std::max(source, 0), (int)srcSize - 1);
+			taps.weights[i * taps.tapCount + t] = weight;
+			sum += weight;
+		}
+
+		for (uint32_t t = 0; t < taps.tapCount; t++)
+		{
+			taps.weights[i * taps.tapCount + t] /= sum;
+		}
+	}
+}
+
+static void filterRowsHorizontal(const SourceLevel& src, float* dst, uint32_t dstWidth, const FilterTaps& taps, uint32_t firstRow, uint32_t rowCount)
+{
+	std::vector<float> scratch((size_t)src.width * 4);
+
+	for (uint32_t y = firstRow; y < firstRow + rowCount; y++)
+	{
+		const float* row = src.getRow(y, scratch.data());
+		float* out = dst + (size_t)y * dstWidth * 4;
+
+		for (uint32_t x = 0; x < dstWidth; x++)
+		{
+			const uint32_t* index = &taps.indices[x * taps.tapCount];
+			const float* weight = &taps.weights[x * taps.tapCount];
+			__m128 sum = _mm_setzero_ps();
+
+			for (uint32_t t = 0; t < taps.tapCount; t++)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + index[t] * 4), _mm_set1_ps(weight[t])));
+			}
+
+			_mm_storeu_ps(out + x * 4, sum);
+		}
+	}
+}
+
+// whole rows at a time, each tap streams through one source row
+static void filterRowsVertical(const float* src, uint32_t width, float* dst, const FilterTaps& taps, uint32_t firstRow, uint32_t rowCount)
+{
+	for (uint32_t y = firstRow; y < firstRow + rowCount; y++)
+	{
+		float* out = dst + (size_t)y * width * 4;
+		memset(out, 0, sizeof(float) * 4 * width);
+
+		for (uint32_t t = 0; t < taps.tapCount; t++)
+		{
+			const float* row = src + (size_t)taps.indices[y * taps.tapCount + t] * width * 4;
+			__m128 weight = _mm_set1_ps(taps.weights[y * taps.tapCount + t]);
+
+			for (uint32_t x = 0; x < width * 4; x += 4)
+			{
+				_mm_storeu_ps(out + x, _mm_add_ps(_mm_loadu_ps(out + x), _mm_mul_ps(_mm_loadu_ps(row + x), weight)));
+			}
+		}
+	}
+}
+
+static uint32_t getBandCount(uint32_t rows)
+{
+	return (rows + kMipBandRows - 1) / kMipBandRows;
+}
+
+// the whole chain down to 1x1, level 0 filled in
+static void layoutLevels(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb, TextureImage& image)
+{
+	image.format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	image.width = width;
+	image.height = height;
+
+	uint64_t size = layoutTextureLevels(image.format, width, height, getTextureMipCount(width, height), image.levels);
+
+	image.data.assign(size, 0);
+	memcpy(image.data.data(), rgba, (size_t)image.levels[0].size);
+}
+
+void MipGenerator::generate(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb, MipFilter filter, TextureImage& image)
+{
+	if (width == 0 || height == 0)
+	{
+		throw std::runtime_error("can't generate mips of an empty image!");
+	}
+
+	layoutLevels(rgba, width, height, srgb, image);
+
+	// levels below 0 in linear float, the next one is filtered into next
+	std::vector<float> current;
+	std::vector<float> next;
+	std::vector<float> horizontal;
+
+	for (uint32_t i = 1; i < image.levels.size(); i++)
+	{
+		const TextureLevel& above = image.levels[i - 1];
+		const TextureLevel& level = image.levels[i];
+		next.resize((size_t)level.width * level.height * 4);
+
+		SourceLevel source = { rgba, i > 1 ? current.data() : nullptr, above.width, above.height, srgb };
+
+		FilterTaps columnTaps;
+		FilterTaps rowTaps;
+
+		if (filter == kMipFilterKaiser)
+		{
+			buildKaiserTaps(above.width, level.width, columnTaps);
+			buildKaiserTaps(above.height, level.height, rowTaps);
+			horizontal.resize((size_t)level.width * above.height * 4);
+
+			parallelFor(getBandCount(above.height), [&](uint32_t band)
+			{
+				uint32_t first = band * kMipBandRows;
+				filterRowsHorizontal(source, horizontal.data(), level.width, columnTaps, first, std::min(kMipBandRows, above.height - first));
+			});
+		}
+
+		parallelFor(getBandCount(level.height), [&](uint32_t band)
+		{
+			uint32_t first = band * kMipBandRows;
+			uint32_t rowCount = std::min(kMipBandRows, level.height - first);
+
+			if (filter == kMipFilterKaiser)
+			{
+				filterRowsVertical(horizontal.data(), level.width, next.data(), rowTaps, first, rowCount);
+			}
+			else
+			{
+				downsampleBoxRows(source, next.data(), level.width, first, rowCount);
+			}
+
+			for (uint32_t y = first; y < first + rowCount; y++)
+			{
+				encodeRow(next.data() + (size_t)y * level.width * 4, level.width, srgb, image.data.data() + level.offset + (size_t)y * level.width * 4);
+			}
+		});
+
+		current.swap(next);
+	}
+}
+
+void MipGenerator::benchmark()
+{
+	const uint32_t kSize = 2048;
+
+	// fine stripes under a soft gradient, the kind of detail that aliases in a bad chain
+	std::vector<uint8_t> pixels((size_t)kSize * kSize * 4);
+	for (uint32_t y = 0; y < kSize; y++)
+	{
+		for (uint32_t x = 0; x < kSize; x++)
+		{
+			uint8_t* texel = &pixels[((size_t)y * kSize + x) * 4];
+			texel[0] = (uint8_t)(((x / 3 + y / 5) & 1) * 200 + 30);
+			texel[1] = (uint8_t)(x * 255 / kSize);
+			texel[2] = (uint8_t)(y * 255 / kSize);
+			texel[3] = (uint8_t)((x ^ y) & 0xff);
+		}
+	}
+
+	auto timeMs = [](const std::function<void()>& run)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		run();
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+
+	// scalar box chain on one thread, same decode and encode
+	TextureImage scalar;
+	double scalarMs = timeMs([&]()
+	{
+		layoutLevels(pixels.data(), kSize, kSize, true, scalar);
+
+		std::vector<float> current((size_t)kSize * kSize * 4);
+		std::vector<float> next;
+		for (uint32_t y = 0; y < kSize; y++)
+		{
+			decodeRow(&pixels[(size_t)y * kSize * 4], kSize, true, &current[(size_t)y * kSize * 4]);
+		}
+
+		for (uint32_t i = 1; i < scalar.levels.size(); i++)
+		{
+			const TextureLevel& above = scalar.levels[i - 1];
+			const TextureLevel& level = scalar.levels[i];
+			next.resize((size_t)level.width * level.height * 4);
+
+			downsampleBoxScalar(current.data(), above.width, above.height, next.data(), level.width, level.height);
+			encodeRow(next.data(), level.width * level.height, true, scalar.data.data() + level.offset);
+			current.swap(next);
+		}
+	});
+
+	TextureImage box;
+	double boxMs = timeMs([&]() { MipGenerator::generate(pixels.data(), kSize, kSize, true, kMipFilterBox, box); });
+
+	TextureImage kaiser;
+	double kaiserMs = timeMs([&]() { MipGenerator::generate(pixels.data(), kSize, kSize, true, kMipFilterKaiser, kaiser); });
+
+	uint32_t mismatches = 0;
+	for (size_t i = 0; i < box.data.size(); i++)
+	{
+		mismatches += box.data[i] != scalar.data[i] ? 1 : 0;
+	}
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "MipGenerator: " << kSize << "x" << kSize << " srgb, " << box.levels.size() << " levels, scalar box " << scalarMs << " ms, sse box " << boxMs
+		<< " ms (" << mismatches << " bytes differ), sse kaiser " << kaiserMs << " ms, " << getWorkerThreadCount() << " threads" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+
+#include "Ktx2.h"
+
+enum MipFilter
+{
+	kMipFilterBox,		// 2x2 average, cheap, a little blurry
+	kMipFilterKaiser	// windowed sinc over 6 texels, keeps detail without ringing much
+};
+
+// -- Mip chains on the cpu
+// RGBA8 in, every level filtered from the one above in linear float with SSE, a texel per register.
+// sRGB colour is decoded before filtering and encoded after, alpha is always linear.
+// Rows are split into bands and filtered on all cores.
+class MipGenerator
+{
+public:
+	// TextureImage of VK_FORMAT_R8G8B8A8_UNORM or _SRGB with the full chain down to 1x1
+	static void generate(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb, MipFilter filter, TextureImage& image);
+
+	// 2048x2048, scalar box against the SSE filters
+	static void benchmark();
+};
\ No newline at end of file
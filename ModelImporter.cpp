@@ -0,0 +1,998 @@
+#include "ModelImporter.h"
+#include "Json.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+
+#include <iostream>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+// -- Shared helpers
+
+static std::string getDirectory(const std::string& path)
+{
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+static std::string getBaseName(const std::string& path)
+{
+	size_t slash = path.find_last_of("/\\");
+	std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+	size_t dot = name.find_last_of('.');
+	return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+static std::string getExtension(const std::string& path)
+{
+	size_t dot = path.find_last_of('.');
+	std::string extension = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+
+	for (char& c : extension)
+	{
+		c = (char)tolower((unsigned char)c);
+	}
+	return extension;
+}
+
+// both formats wind counter clockwise, the engine's front faces are clockwise
+static void flipWinding(std::vector<uint32_t>& indices)
+{
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		std::swap(indices[i + 1], indices[i + 2]);
+	}
+}
+
+std::vector<std::string> ModelImporter::importFile(const std::string& path, const std::string& outputDir, uint32_t threadCount, bool compress)
+{
+	if (threadCount == 0)
+	{
+		threadCount = getWorkerThreadCount();
+	}
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	std::vector<ImportedPrimitive> primitives;
+
+	std::string extension = getExtension(path);
+	if (extension == "gltf" || extension == "glb")
+	{
+		loadGltf(path, primitives, threadCount);
+	}
+	else if (extension == "obj")
+	{
+		loadObj(path, primitives, threadCount);
+	}
+	else
+	{
+		throw std::runtime_error("unsupported model format " + path);
+	}
+
+	auto loadTime = std::chrono::high_resolution_clock::now();
+
+	std::string directory = outputDir;
+	if (!directory.empty() && directory.back() != '/' && directory.back() != '\\')
+	{
+		directory += '/';
+	}
+
+	std::vector<std::string> outputFiles(primitives.size());
+	std::vector<ProcessedMesh> meshes(primitives.size());
+
+	// every primitive is independent, the heavy part of an import is this loop
+	// with fewer primitives than threads the spare ones go to the work inside each primitive
+	uint32_t meshThreadCount = std::max(1u, threadCount / std::max(1u, static_cast<uint32_t>(primitives.size())));
+
+	parallelFor(static_cast<uint32_t>(primitives.size()), [&](uint32_t i)
+	{
+		ImportedPrimitive& primitive = primitives[i];
+		ProcessedMesh& mesh = meshes[i];
+
+		if (!primitive.hasNormals)
+		{
+			generateNormals(primitive);
+		}
+
+		mesh.vertices = std::move(primitive.vertices);
+		mesh.indices = std::move(primitive.indices);
+		MeshProcessing::process(mesh, meshThreadCount);
+
+		outputFiles[i] = directory + getBaseName(path) + "_" + std::to_string(i) + ".mesh";
+		CookedMesh::writeFile(outputFiles[i], MeshProcessing::getCookedSource(mesh, compress));
+
+		// keep only what the report needs
+		mesh.indices.clear();
+		mesh.meshlets = MeshletData();
+		mesh.positionStream.clear();
+		mesh.attributeStream.clear();
+	}, threadCount);
+
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	// printed after the fact so the threads don't interleave their output
+	uint32_t totalTriangles = 0;
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		uint32_t triangleCount = meshes[i].lods[0].indexCount / 3;
+		totalTriangles += triangleCount;
+
+		MeshOptimizer::printStats(primitives[i].name, triangleCount, static_cast<uint32_t>(meshes[i].vertices.size()), meshes[i].cacheStatsBefore, meshes[i].cacheStatsAfter);
+	}
+
+	std::cout << "ModelImporter " << path << ": " << meshes.size() << " primitives, " << totalTriangles << " triangles, "
+		<< threadCount << " threads, load " << std::chrono::duration<double, std::milli>(loadTime - startTime).count() << " ms, "
+		<< "process " << std::chrono::duration<double, std::milli>(endTime - loadTime).count() << " ms" << std::endl;
+
+	return outputFiles;
+}
+
+void ModelImporter::generateNormals(ImportedPrimitive& primitive)
+{
+	for (Vertex& vertex : primitive.vertices)
+	{
+		vertex.normal = glm::vec3(0.0f);
+	}
+
+	// unnormalized cross product weights each face by its area, already in engine winding
+	for (size_t i = 0; i + 2 < primitive.indices.size(); i += 3)
+	{
+		Vertex& v0 = primitive.vertices[primitive.indices[i + 0]];
+		Vertex& v1 = primitive.vertices[primitive.indices[i + 1]];
+		Vertex& v2 = primitive.vertices[primitive.indices[i + 2]];
+
+		glm::vec3 faceNormal = glm::cross(v2.pos - v0.pos, v1.pos - v0.pos);
+		v0.normal += faceNormal;
+		v1.normal += faceNormal;
+		v2.normal += faceNormal;
+	}
+
+	for (Vertex& vertex : primitive.vertices)
+	{
+		float length = glm::length(vertex.normal);
+		vertex.normal = length > 0.0f ? vertex.normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+	}
+
+	primitive.hasNormals = true;
+}
+
+// -- glTF
+
+static const uint32_t kGlbMagic = 0x46546c67;		// "glTF"
+static const uint32_t kGlbChunkJson = 0x4e4f534a;	// "JSON"
+static const uint32_t kGlbChunkBin = 0x004e4942;	// "BIN\0"
+
+struct GltfBuffer
+{
+	const uint8_t* data;
+	size_t size;
+
+	// where data points into, at most one of them is used
+	std::unique_ptr<MappedFile> file;
+	std::vector<uint8_t> decoded;
+};
+
+struct GltfAccessor
+{
+	const uint8_t* data;
+	uint32_t count;
+	uint32_t componentCount;
+	uint32_t componentType;
+	uint32_t stride;
+	bool normalized;
+};
+
+static std::vector<uint8_t> decodeBase64(const char* text, size_t length)
+{
+	auto decodeChar = [](char c) -> int
+	{
+		if (c >= 'A' && c <= 'Z') return c - 'A';
+		if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+		if (c >= '0' && c <= '9') return c - '0' + 52;
+		if (c == '+' || c == '-') return 62;
+		if (c == '/' || c == '_') return 63;
+		return -1;
+	};
+
+	std::vector<uint8_t> bytes;
+	bytes.reserve(length / 4 * 3);
+
+	uint32_t bits = 0;
+	int bitCount = 0;
+
+	for (size_t i = 0; i < length && text[i] != '='; i++)
+	{
+		int value = decodeChar(text[i]);
+		if (value < 0)
+		{
+			throw std::runtime_error("gltf: bad base64 data");
+		}
+
+		bits = (bits << 6) | (uint32_t)value;
+		bitCount += 6;
+
+		if (bitCount >= 8)
+		{
+			bitCount -= 8;
+			bytes.push_back((uint8_t)(bits >> bitCount));
+		}
+	}
+
+	return bytes;
+}
+
+static uint32_t getComponentSize(uint32_t componentType)
+{
+	switch (componentType)
+	{
+	case 5120: // BYTE
+	case 5121: // UNSIGNED_BYTE
+		return 1;
+	case 5122: // SHORT
+	case 5123: // UNSIGNED_SHORT
+		return 2;
+	case 5125: // UNSIGNED_INT
+	case 5126: // FLOAT
+		return 4;
+	}
+
+	throw std::runtime_error("gltf: unknown component type " + std::to_string(componentType));
+}
+
+static uint32_t getComponentCount(const std::string& type)
+{
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+
+	throw std::runtime_error("gltf: unsupported accessor type " + type);
+}
+
+// normalized integers map to [0, 1] or [-1, 1] as the spec says
+static float readComponent(const uint8_t* data, uint32_t componentType, bool normalized)
+{
+	switch (componentType)
+	{
+	case 5120: { int8_t v; memcpy(&v, data, 1); return normalized ? std::max(v / 127.0f, -1.0f) : (float)v; }
+	case 5121: { uint8_t v = *data; return normalized ? v / 255.0f : (float)v; }
+	case 5122: { int16_t v; memcpy(&v, data, 2); return normalized ? std::max(v / 32767.0f, -1.0f) : (float)v; }
+	case 5123: { uint16_t v; memcpy(&v, data, 2); return normalized ? v / 65535.0f : (float)v; }
+	case 5125: { uint32_t v; memcpy(&v, data, 4); return (float)v; }
+	case 5126: { float v; memcpy(&v, data, 4); return v; }
+	}
+	return 0.0f;
+}
+
+static uint32_t readIndex(const uint8_t* data, uint32_t componentType)
+{
+	switch (componentType)
+	{
+	case 5121: return *data;
+	case 5123: { uint16_t v; memcpy(&v, data, 2); return v; }
+	case 5125: { uint32_t v; memcpy(&v, data, 4); return v; }
+	}
+
+	throw std::runtime_error("gltf: bad index component type");
+}
+
+static GltfAccessor getAccessor(const JsonValue& document, const std::vector<GltfBuffer>& buffers, int64_t index)
+{
+	const JsonValue* accessors = document.find("accessors");
+	if (accessors == nullptr || index < 0 || (size_t)index >= accessors->size())
+	{
+		throw std::runtime_error("gltf: accessor out of range");
+	}
+
+	const JsonValue& accessor = (*accessors)[(size_t)index];
+
+	GltfAccessor result;
+	result.count = (uint32_t)accessor.getInt("count", 0);
+	result.componentType = (uint32_t)accessor.getInt("componentType", 0);
+	result.componentCount = getComponentCount(accessor.getString("type", ""));
+	result.normalized = accessor.getBool("normalized", false);
+
+	uint32_t elementSize = getComponentSize(result.componentType) * result.componentCount;
+
+	// sparse accessors and accessors without a view are all zero, neither shows up in real meshes
+	int64_t viewIndex = accessor.getInt("bufferView", -1);
+	const JsonValue* views = document.find("bufferViews");
+	if (viewIndex < 0 || views == nullptr || (size_t)viewIndex >= views->size() || accessor.find("sparse") != nullptr)
+	{
+		throw std::runtime_error("gltf: accessors need a buffer view");
+	}
+
+	const JsonValue& view = (*views)[(size_t)viewIndex];
+
+	int64_t bufferIndex = view.getInt("buffer", -1);
+	if (bufferIndex < 0 || (size_t)bufferIndex >= buffers.size())
+	{
+		throw std::runtime_error("gltf: buffer out of range");
+	}
+
+	const GltfBuffer& buffer = buffers[(size_t)bufferIndex];
+
+	uint64_t viewOffset = (uint64_t)view.getInt("byteOffset", 0);
+	uint64_t viewLength = (uint64_t)view.getInt("byteLength", 0);
+	uint64_t accessorOffset = (uint64_t)accessor.getInt("byteOffset", 0);
+	result.stride = (uint32_t)view.getInt("byteStride", elementSize);
+
+	// the last element only needs its own size, not a full stride
+	uint64_t required = result.count == 0 ? 0 : accessorOffset + (uint64_t)result.stride * (result.count - 1) + elementSize;
+
+	if (viewOffset + viewLength > buffer.size || required > viewLength)
+	{
+		throw std::runtime_error("gltf: accessor outside of its buffer");
+	}
+
+	result.data = buffer.data + viewOffset + accessorOffset;
+	return result;
+}
+
+static void loadGltfBuffers(const JsonValue& document, const std::string& directory, const uint8_t* binChunk, size_t binChunkSize, std::vector<GltfBuffer>& buffers)
+{
+	const JsonValue* bufferList = document.find("buffers");
+	if (bufferList == nullptr)
+	{
+		return;
+	}
+
+	buffers.resize(bufferList->size());
+
+	for (size_t i = 0; i < bufferList->size(); i++)
+	{
+		const JsonValue& source = (*bufferList)[i];
+		GltfBuffer& buffer = buffers[i];
+
+		const JsonValue* uri = source.find("uri");
+
+		if (uri == nullptr)
+		{
+			// only the first buffer of a .glb may leave out its uri
+			if (i != 0 || binChunk == nullptr)
+			{
+				throw std::runtime_error("gltf: buffer without uri");
+			}
+
+			buffer.data = binChunk;
+			buffer.size = binChunkSize;
+		}
+		else if (uri->string.compare(0, 5, "data:") == 0)
+		{
+			size_t comma = uri->string.find(";base64,");
+			if (comma == std::string::npos)
+			{
+				throw std::runtime_error("gltf: only base64 data uris are supported");
+			}
+
+			buffer.decoded = decodeBase64(uri->string.c_str() + comma + 8, uri->string.size() - comma - 8);
+			buffer.data = buffer.decoded.data();
+			buffer.size = buffer.decoded.size();
+		}
+		else
+		{
+			buffer.file.reset(new MappedFile());
+			buffer.file->open(directory + uri->string);
+			buffer.data = buffer.file->data;
+			buffer.size = buffer.file->size;
+		}
+
+		if (buffer.size < (size_t)source.getInt("byteLength", 0))
+		{
+			throw std::runtime_error("gltf: buffer shorter than its byteLength");
+		}
+	}
+}
+
+static void readGltfPrimitive(const JsonValue& document, const std::vector<GltfBuffer>& buffers, const JsonValue& source, ImportedPrimitive& primitive)
+{
+	const JsonValue* attributes = source.find("attributes");
+	if (attributes == nullptr || attributes->find("POSITION") == nullptr)
+	{
+		throw std::runtime_error("gltf: primitive " + primitive.name + " has no positions");
+	}
+
+	GltfAccessor positions = getAccessor(document, buffers, attributes->getInt("POSITION", -1));
+	uint32_t vertexCount = positions.count;
+
+	primitive.vertices.assign(vertexCount, Vertex{ glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f), glm::vec2(0.0f) });
+	primitive.hasNormals = attributes->find("NORMAL") != nullptr;
+
+	uint32_t positionSize = getComponentSize(positions.componentType);
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		const uint8_t* element = positions.data + (size_t)positions.stride * v;
+		for (uint32_t c = 0; c < 3 && c < positions.componentCount; c++)
+		{
+			primitive.vertices[v].pos[c] = readComponent(element + c * positionSize, positions.componentType, positions.normalized);
+		}
+	}
+
+	// optional attributes, read into the matching member of every vertex
+	auto readAttribute = [&](const char* name, uint32_t maxComponents, float* (*member)(Vertex&))
+	{
+		if (attributes->find(name) == nullptr)
+		{
+			return;
+		}
+
+		GltfAccessor accessor = getAccessor(document, buffers, attributes->getInt(name, -1));
+		if (accessor.count != vertexCount)
+		{
+			throw std::runtime_error(std::string("gltf: ") + name + " count doesn't match POSITION");
+		}
+
+		uint32_t componentSize = getComponentSize(accessor.componentType);
+		uint32_t components = std::min(accessor.componentCount, maxComponents);
+
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			const uint8_t* element = accessor.data + (size_t)accessor.stride * v;
+			float* target = member(primitive.vertices[v]);
+
+			for (uint32_t c = 0; c < components; c++)
+			{
+				target[c] = readComponent(element + c * componentSize, accessor.componentType, accessor.normalized);
+			}
+		}
+	};
+
+	readAttribute("NORMAL", 3, [](Vertex& vertex) { return &vertex.normal.x; });
+	readAttribute("TEXCOORD_0", 2, [](Vertex& vertex) { return &vertex.texCoords.x; });
+	readAttribute("COLOR_0", 3, [](Vertex& vertex) { return &vertex.color.x; });
+
+	if (source.find("indices") != nullptr)
+	{
+		GltfAccessor indices = getAccessor(document, buffers, source.getInt("indices", -1));
+		primitive.indices.resize(indices.count);
+
+		for (uint32_t i = 0; i < indices.count; i++)
+		{
+			primitive.indices[i] = readIndex(indices.data + (size_t)indices.stride * i, indices.componentType);
+			if (primitive.indices[i] >= vertexCount)
+			{
+				throw std::runtime_error("gltf: index out of range in " + primitive.name);
+			}
+		}
+	}
+	else
+	{
+		primitive.indices.resize(vertexCount);
+		for (uint32_t i = 0; i < vertexCount; i++)
+		{
+			primitive.indices[i] = i;
+		}
+	}
+
+	primitive.indices.resize(primitive.indices.size() / 3 * 3);
+	flipWinding(primitive.indices);
+}
+
+void ModelImporter::loadGltf(const std::string& path, std::vector<ImportedPrimitive>& primitives, uint32_t threadCount)
+{
+	MappedFile file;
+	file.open(path);
+
+	const char* jsonText = reinterpret_cast<const char*>(file.data);
+	size_t jsonLength = file.size;
+	const uint8_t* binChunk = nullptr;
+	size_t binChunkSize = 0;
+
+	uint32_t magic = 0;
+	if (file.size >= 12)
+	{
+		memcpy(&magic, file.data, 4);
+	}
+
+	if (magic == kGlbMagic)
+	{
+		// 12 byte header then chunks of { length, type, data }, JSON first and an optional BIN
+		jsonText = nullptr;
+		size_t offset = 12;
+
+		while (offset + 8 <= file.size)
+		{
+			uint32_t chunkLength, chunkType;
+			memcpy(&chunkLength, file.data + offset, 4);
+			memcpy(&chunkType, file.data + offset + 4, 4);
+			offset += 8;
+
+			if (chunkLength > file.size - offset)
+			{
+				throw std::runtime_error("glb: chunk outside of the file " + path);
+			}
+
+			if (chunkType == kGlbChunkJson && jsonText == nullptr)
+			{
+				jsonText = reinterpret_cast<const char*>(file.data + offset);
+				jsonLength = chunkLength;
+			}
+			else if (chunkType == kGlbChunkBin && binChunk == nullptr)
+			{
+				binChunk = file.data + offset;
+				binChunkSize = chunkLength;
+			}
+
+			offset += (chunkLength + 3) & ~3u;
+		}
+
+		if (jsonText == nullptr)
+		{
+			throw std::runtime_error("glb: no JSON chunk in " + path);
+		}
+	}
+
+	JsonValue document = JsonValue::parse(jsonText, jsonLength);
+
+	std::vector<GltfBuffer> buffers;
+	loadGltfBuffers(document, getDirectory(path), binChunk, binChunkSize, buffers);
+
+	// node transforms aren't applied, every primitive is cooked in its own mesh space
+	struct PrimitiveSource
+	{
+		const JsonValue* json;
+		std::string name;
+	};
+	std::vector<PrimitiveSource> sources;
+
+	const JsonValue* meshes = document.find("meshes");
+	for (size_t m = 0; meshes != nullptr && m < meshes->size(); m++)
+	{
+		const JsonValue& mesh = (*meshes)[m];
+		const JsonValue* meshPrimitives = mesh.find("primitives");
+
+		for (size_t p = 0; meshPrimitives != nullptr && p < meshPrimitives->size(); p++)
+		{
+			const JsonValue& primitive = (*meshPrimitives)[p];
+
+			// 4 = TRIANGLES, points, lines and strips are left out
+			if (primitive.getInt("mode", 4) != 4)
+			{
+				continue;
+			}
+
+			sources.push_back({ &primitive, mesh.getString("name", "mesh" + std::to_string(m)) + "/" + std::to_string(p) });
+		}
+	}
+
+	size_t firstPrimitive = primitives.size();
+	primitives.resize(firstPrimitive + sources.size());
+
+	// decoding touches every vertex, spread it like the processing
+	parallelFor(static_cast<uint32_t>(sources.size()), [&](uint32_t i)
+	{
+		ImportedPrimitive& primitive = primitives[firstPrimitive + i];
+		primitive.name = sources[i].name;
+		readGltfPrimitive(document, buffers, *sources[i].json, primitive);
+	}, threadCount);
+
+	// nothing to cook from a primitive without triangles
+	primitives.erase(std::remove_if(primitives.begin() + firstPrimitive, primitives.end(),
+		[](const ImportedPrimitive& primitive) { return primitive.indices.empty(); }), primitives.end());
+}
+
+// -- OBJ
+
+// position / texcoord / normal, 0 based, -1 when left out
+struct ObjCorner
+{
+	int32_t position;
+	int32_t texCoord;
+	int32_t normal;
+
+	bool operator==(const ObjCorner& other) const
+	{
+		return position == other.position && texCoord == other.texCoord && normal == other.normal;
+	}
+};
+
+struct ObjCornerHash
+{
+	size_t operator()(const ObjCorner& corner) const
+	{
+		return (size_t)corner.position * 73856093u ^ (size_t)corner.texCoord * 19349663u ^ (size_t)corner.normal * 83492791u;
+	}
+};
+
+struct ObjGroup
+{
+	std::string name;
+	size_t firstCorner;
+};
+
+// a run of whole lines, parsed by one thread
+struct ObjChunk
+{
+	const char* begin;
+	const char* end;
+
+	// counted in the first pass, the prefix sums are where this chunk's elements go
+	uint32_t positionCount, texCoordCount, normalCount;
+	uint32_t positionBase, texCoordBase, normalBase;
+
+	// triangulated, 3 corners per triangle
+	std::vector<ObjCorner> corners;
+	std::vector<ObjGroup> groups;
+};
+
+static const char* skipSpaces(const char* cursor, const char* end)
+{
+	while (cursor < end && (*cursor == ' ' || *cursor == '\t'))
+	{
+		cursor++;
+	}
+	return cursor;
+}
+
+static const char* skipLine(const char* cursor, const char* end)
+{
+	while (cursor < end && *cursor != '\n')
+	{
+		cursor++;
+	}
+	return cursor < end ? cursor + 1 : end;
+}
+
+// strtod wants a terminated string and respects the locale, neither works on a mapped file
+static const char* parseFloat(const char* cursor, const char* end, float& value)
+{
+	cursor = skipSpaces(cursor, end);
+
+	bool negative = false;
+	if (cursor < end && (*cursor == '-' || *cursor == '+'))
+	{
+		negative = *cursor == '-';
+		cursor++;
+	}
+
+	double result = 0.0;
+	while (cursor < end && *cursor >= '0' && *cursor <= '9')
+	{
+		result = result * 10.0 + (*cursor++ - '0');
+	}
+
+	if (cursor < end && *cursor == '.')
+	{
+		cursor++;
+
+		double scale = 0.1;
+		while (cursor < end && *cursor >= '0' && *cursor <= '9')
+		{
+			result += (*cursor++ - '0') * scale;
+			scale *= 0.1;
+		}
+	}
+
+	if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+	{
+		cursor++;
+
+		bool negativeExponent = false;
+		if (cursor < end && (*cursor == '-' || *cursor == '+'))
+		{
+			negativeExponent = *cursor == '-';
+			cursor++;
+		}
+
+		int exponent = 0;
+		while (cursor < end && *cursor >= '0' && *cursor <= '9')
+		{
+			exponent = std::min(exponent * 10 + (*cursor++ - '0'), 400);
+		}
+
+		result *= pow(10.0, negativeExponent ? -exponent : exponent);
+	}
+
+	value = (float)(negative ? -result : result);
+	return cursor;
+}
+
+static const char* parseInt(const char* cursor, const char* end, int32_t& value, bool& found)
+{
+	bool negative = false;
+	if (cursor < end && *cursor == '-')
+	{
+		negative = true;
+		cursor++;
+	}
+
+	found = false;
+	int64_t result = 0;
+	while (cursor < end && *cursor >= '0' && *cursor <= '9')
+	{
+		result = std::min<int64_t>(result * 10 + (*cursor++ - '0'), INT32_MAX);
+		found = true;
+	}
+
+	value = (int32_t)(negative ? -result : result);
+	return cursor;
+}
+
+// obj indices are 1 based, negative ones count back from the last element seen so far
+static int32_t resolveObjIndex(int32_t index, uint32_t countSoFar)
+{
+	if (index > 0)
+	{
+		return index - 1;
+	}
+	if (index < 0)
+	{
+		return (int32_t)countSoFar + index;
+	}
+	return -1;
+}
+
+static void countObjChunk(ObjChunk& chunk)
+{
+	chunk.positionCount = chunk.texCoordCount = chunk.normalCount = 0;
+
+	for (const char* line = chunk.begin; line < chunk.end; line = skipLine(line, chunk.end))
+	{
+		const char* cursor = skipSpaces(line, chunk.end);
+		if (chunk.end - cursor < 2 || cursor[0] != 'v')
+		{
+			continue;
+		}
+
+		if (cursor[1] == ' ' || cursor[1] == '\t') chunk.positionCount++;
+		else if (cursor[1] == 't') chunk.texCoordCount++;
+		else if (cursor[1] == 'n') chunk.normalCount++;
+	}
+}
+
+static void parseObjChunk(ObjChunk& chunk, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& colors, std::vector<glm::vec2>& texCoords, std::vector<glm::vec3>& normals)
+{
+	uint32_t positionIndex = chunk.positionBase;
+	uint32_t texCoordIndex = chunk.texCoordBase;
+	uint32_t normalIndex = chunk.normalBase;
+
+	std::vector<ObjCorner> face;
+
+	for (const char* line = chunk.begin; line < chunk.end; line = skipLine(line, chunk.end))
+	{
+		const char* cursor = skipSpaces(line, chunk.end);
+		if (cursor >= chunk.end)
+		{
+			continue;
+		}
+
+		const char* lineEnd = cursor;
+		while (lineEnd < chunk.end && *lineEnd != '\n' && *lineEnd != '\r' && *lineEnd != '#')
+		{
+			lineEnd++;
+		}
+
+		if (cursor[0] == 'v' && lineEnd - cursor >= 2)
+		{
+			if (cursor[1] == ' ' || cursor[1] == '\t')
+			{
+				glm::vec3& position = positions[positionIndex];
+				cursor = parseFloat(cursor + 1, lineEnd, position.x);
+				cursor = parseFloat(cursor, lineEnd, position.y);
+				cursor = parseFloat(cursor, lineEnd, position.z);
+
+				// vertex colors are a common extension, "v x y z r g b"
+				cursor = skipSpaces(cursor, lineEnd);
+				if (cursor < lineEnd)
+				{
+					glm::vec3& color = colors[positionIndex];
+					cursor = parseFloat(cursor, lineEnd, color.r);
+					cursor = parseFloat(cursor, lineEnd, color.g);
+					cursor = parseFloat(cursor, lineEnd, color.b);
+				}
+
+				positionIndex++;
+			}
+			else if (cursor[1] == 't')
+			{
+				glm::vec2& texCoord = texCoords[texCoordIndex++];
+				cursor = parseFloat(cursor + 2, lineEnd, texCoord.x);
+				cursor = parseFloat(cursor, lineEnd, texCoord.y);
+
+				// obj puts v = 0 at the bottom, vulkan samples it at the top
+				texCoord.y = 1.0f - texCoord.y;
+			}
+			else if (cursor[1] == 'n')
+			{
+				glm::vec3& normal = normals[normalIndex++];
+				cursor = parseFloat(cursor + 2, lineEnd, normal.x);
+				cursor = parseFloat(cursor, lineEnd, normal.y);
+				cursor = parseFloat(cursor, lineEnd, normal.z);
+			}
+		}
+		else if (cursor[0] == 'f' && lineEnd - cursor >= 2 && (cursor[1] == ' ' || cursor[1] == '\t'))
+		{
+			face.clear();
+			cursor += 1;
+
+			for (;;)
+			{
+				cursor = skipSpaces(cursor, lineEnd);
+				if (cursor >= lineEnd)
+				{
+					break;
+				}
+
+				int32_t values[3] = { 0, 0, 0 };
+				bool found;
+
+				// v, v/vt, v//vn or v/vt/vn
+				cursor = parseInt(cursor, lineEnd, values[0], found);
+				if (!found)
+				{
+					throw std::runtime_error("obj: bad face");
+				}
+
+				for (int i = 1; i < 3 && cursor < lineEnd && *cursor == '/'; i++)
+				{
+					cursor = parseInt(cursor + 1, lineEnd, values[i], found);
+				}
+
+				ObjCorner corner;
+				corner.position = resolveObjIndex(values[0], positionIndex);
+				corner.texCoord = resolveObjIndex(values[1], texCoordIndex);
+				corner.normal = resolveObjIndex(values[2], normalIndex);
+				face.push_back(corner);
+			}
+
+			// fan triangulation, fine for the convex polygons obj exporters write
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				chunk.corners.push_back(face[0]);
+				chunk.corners.push_back(face[i - 1]);
+				chunk.corners.push_back(face[i]);
+			}
+		}
+		else if ((cursor[0] == 'o' || cursor[0] == 'g') && lineEnd - cursor >= 1 && (lineEnd - cursor == 1 || cursor[1] == ' ' || cursor[1] == '\t'))
+		{
+			const char* nameBegin = skipSpaces(cursor + 1, lineEnd);
+			const char* nameEnd = lineEnd;
+			while (nameEnd > nameBegin && (nameEnd[-1] == ' ' || nameEnd[-1] == '\t'))
+			{
+				nameEnd--;
+			}
+
+			chunk.groups.push_back({ std::string(nameBegin, nameEnd), chunk.corners.size() });
+		}
+	}
+}
+
+void ModelImporter::loadObj(const std::string& path, std::vector<ImportedPrimitive>& primitives, uint32_t threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = getWorkerThreadCount();
+	}
+
+	MappedFile file;
+	file.open(path);
+
+	const char* text = reinterpret_cast<const char*>(file.data);
+	const char* textEnd = text + file.size;
+
+	// a few chunks per thread so a dense region doesn't leave the others waiting
+	static const size_t kMinChunkSize = 256 * 1024;
+	size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount * 4, file.size / kMinChunkSize));
+
+	std::vector<ObjChunk> chunks(chunkCount);
+	const char* chunkBegin = text;
+
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		// every chunk ends on a line break so no line is split between two threads
+		const char* chunkEnd = i + 1 == chunkCount ? textEnd : std::max(chunkBegin, text + file.size * (i + 1) / chunkCount);
+		while (chunkEnd < textEnd && chunkEnd[-1] != '\n')
+		{
+			chunkEnd++;
+		}
+
+		chunks[i].begin = chunkBegin;
+		chunks[i].end = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+
+	// first pass counts, the prefix sums let the second pass write in place
+	parallelFor(static_cast<uint32_t>(chunkCount), [&](uint32_t i) { countObjChunk(chunks[i]); }, threadCount);
+
+	uint32_t positionCount = 0, texCoordCount = 0, normalCount = 0;
+	for (ObjChunk& chunk : chunks)
+	{
+		chunk.positionBase = positionCount;
+		chunk.texCoordBase = texCoordCount;
+		chunk.normalBase = normalCount;
+
+		positionCount += chunk.positionCount;
+		texCoordCount += chunk.texCoordCount;
+		normalCount += chunk.normalCount;
+	}
+
+	std::vector<glm::vec3> positions(positionCount);
+	std::vector<glm::vec3> colors(positionCount, glm::vec3(1.0f));
+	std::vector<glm::vec2> texCoords(texCoordCount);
+	std::vector<glm::vec3> normals(normalCount);
+
+	parallelFor(static_cast<uint32_t>(chunkCount), [&](uint32_t i) { parseObjChunk(chunks[i], positions, colors, texCoords, normals); }, threadCount);
+
+	// each o / g starts a primitive, faces before the first one go into a default one
+	struct ObjPrimitiveSource
+	{
+		std::string name;
+		std::vector<std::pair<const ObjCorner*, size_t>> ranges;
+	};
+	std::vector<ObjPrimitiveSource> sources(1);
+	sources[0].name = getBaseName(path);
+
+	for (const ObjChunk& chunk : chunks)
+	{
+		size_t corner = 0;
+		for (size_t g = 0; g <= chunk.groups.size(); g++)
+		{
+			size_t groupEnd = g < chunk.groups.size() ? chunk.groups[g].firstCorner : chunk.corners.size();
+			if (groupEnd > corner)
+			{
+				sources.back().ranges.push_back({ chunk.corners.data() + corner, groupEnd - corner });
+			}
+			corner = groupEnd;
+
+			if (g < chunk.groups.size())
+			{
+				sources.push_back(ObjPrimitiveSource());
+				sources.back().name = chunk.groups[g].name.empty() ? getBaseName(path) : chunk.groups[g].name;
+			}
+		}
+	}
+
+	sources.erase(std::remove_if(sources.begin(), sources.end(),
+		[](const ObjPrimitiveSource& source) { return source.ranges.empty(); }), sources.end());
+
+	size_t firstPrimitive = primitives.size();
+	primitives.resize(firstPrimitive + sources.size());
+
+	// corners that repeat the same position / texcoord / normal become one vertex
+	parallelFor(static_cast<uint32_t>(sources.size()), [&](uint32_t i)
+	{
+		ImportedPrimitive& primitive = primitives[firstPrimitive + i];
+		primitive.name = sources[i].name;
+		primitive.hasNormals = true;
+
+		std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> vertexMap;
+
+		for (const auto& range : sources[i].ranges)
+		{
+			for (size_t c = 0; c < range.second; c++)
+			{
+				const ObjCorner& corner = range.first[c];
+
+				if (corner.position < 0 || (uint32_t)corner.position >= positionCount ||
+					corner.texCoord >= (int32_t)texCoordCount || corner.normal >= (int32_t)normalCount)
+				{
+					throw std::runtime_error("obj: index out of range in " + path);
+				}
+
+				auto inserted = vertexMap.insert({ corner, static_cast<uint32_t>(primitive.vertices.size()) });
+				if (inserted.second)
+				{
+					Vertex vertex;
+					vertex.pos = positions[corner.position];
+					vertex.color = colors[corner.position];
+					vertex.texCoords = corner.texCoord >= 0 ? texCoords[corner.texCoord] : glm::vec2(0.0f);
+					vertex.normal = corner.normal >= 0 ? normals[corner.normal] : glm::vec3(0.0f);
+					primitive.vertices.push_back(vertex);
+
+					primitive.hasNormals = primitive.hasNormals && corner.normal >= 0;
+				}
+
+				primitive.indices.push_back(inserted.first->second);
+			}
+		}
+
+		flipWinding(primitive.indices);
+	}, threadCount);
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <string>
+
+#include "MeshProcessing.h"
+
+// one triangle list of the source file, in engine winding
+struct ImportedPrimitive
+{
+	std::string name;
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	bool hasNormals;
+};
+
+// -- Model importer
+// glTF 2.0 (.gltf with external or embedded buffers, .glb) and OBJ.
+// Primitives are processed with MeshProcessing on every core and each one is written
+// as <outputDir>/<file name>_<primitive>.mesh for ObjectBuffers::createFromCookedFile.
+class ModelImporter
+{
+public:
+	// returns the cooked files in primitive order
+	// threadCount 0 uses every core, compress stores vertices and indices with MeshCodec
+	static std::vector<std::string> importFile(const std::string& path, const std::string& outputDir, uint32_t threadCount = 0, bool compress = true);
+
+	static void loadGltf(const std::string& path, std::vector<ImportedPrimitive>& primitives, uint32_t threadCount = 0);
+	static void loadObj(const std::string& path, std::vector<ImportedPrimitive>& primitives, uint32_t threadCount = 0);
+
+private:
+	// area weighted, for sources that come without normals
+	static void generateNormals(ImportedPrimitive& primitive);
+};
\ No newline at end of file
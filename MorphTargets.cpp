@@ -0,0 +1,206 @@
+#include "MorphTargets.h"
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+
+#include "VertexFormat.h"
+
+MorphTargetSet::MorphTargetSet()
+	: vertexCount(0)
+{ }
+
+MorphTargetSet::~MorphTargetSet()
+{ }
+
+void MorphTargetSet::build(uint32_t _vertexCount, const std::vector<MorphTargetDesc>& descs, float threshold)
+{
+	vertexCount = _vertexCount;
+	targets.clear();
+	deltas.clear();
+
+	float thresholdSquared = threshold * threshold;
+
+	for (const MorphTargetDesc& desc : descs)
+	{
+		bool hasNormals = !desc.normalDeltas.empty();
+
+		if (desc.positionDeltas.size() != vertexCount || (hasNormals && desc.normalDeltas.size() != vertexCount))
+		{
+			throw std::runtime_error("morph target " + desc.name + " doesn't match the mesh's vertex count!");
+		}
+
+		MorphTarget target;
+		target.name = desc.name;
+		target.firstDelta = static_cast<uint32_t>(deltas.size());
+
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			glm::vec3 position = desc.positionDeltas[v];
+			glm::vec3 normal = hasNormals ? desc.normalDeltas[v] : glm::vec3(0.0f);
+
+			if (glm::dot(position, position) <= thresholdSquared && glm::dot(normal, normal) <= thresholdSquared)
+			{
+				continue;
+			}
+
+			MorphDelta delta;
+			delta.vertex = v;
+			for (int i = 0; i < 3; i++)
+			{
+				delta.position[i] = VertexPacking::floatToHalf(position[i]);
+				delta.normal[i] = VertexPacking::floatToHalf(normal[i]);
+			}
+
+			deltas.push_back(delta);
+		}
+
+		target.deltaCount = static_cast<uint32_t>(deltas.size()) - target.firstDelta;
+		targets.push_back(target);
+	}
+}
+
+int32_t MorphTargetSet::findTarget(const std::string& name) const
+{
+	for (size_t i = 0; i < targets.size(); i++)
+	{
+		if (targets[i].name == name)
+		{
+			return static_cast<int32_t>(i);
+		}
+	}
+
+	return -1;
+}
+
+uint32_t MorphTargetSet::getActiveDeltaCount(const std::vector<float>& weights) const
+{
+	uint32_t count = 0;
+	size_t targetCount = std::min(weights.size(), targets.size());
+
+	for (size_t t = 0; t < targetCount; t++)
+	{
+		if (std::abs(weights[t]) > kMorphWeightEpsilon)
+		{
+			count += targets[t].deltaCount;
+		}
+	}
+
+	return count;
+}
+
+void MorphTargetSet::evaluate(const std::vector<float>& weights, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals) const
+{
+	size_t targetCount = std::min(weights.size(), targets.size());
+
+	for (size_t t = 0; t < targetCount; t++)
+	{
+		float weight = weights[t];
+		if (std::abs(weight) <= kMorphWeightEpsilon)
+		{
+			continue;
+		}
+
+		const MorphDelta* delta = &deltas[targets[t].firstDelta];
+		const MorphDelta* end = delta + targets[t].deltaCount;
+
+		for (; delta != end; delta++)
+		{
+			glm::vec3 position(VertexPacking::halfToFloat(delta->position[0]), VertexPacking::halfToFloat(delta->position[1]), VertexPacking::halfToFloat(delta->position[2]));
+			glm::vec3 normal(VertexPacking::halfToFloat(delta->normal[0]), VertexPacking::halfToFloat(delta->normal[1]), VertexPacking::halfToFloat(delta->normal[2]));
+
+			positions[delta->vertex] += position * weight;
+			normals[delta->vertex] += normal * weight;
+		}
+	}
+}
+
+void MorphTargetSet::benchmark()
+{
+	const uint32_t kVertexCount = 6000;
+	const uint32_t kTargetCount = 52;
+	const uint32_t kActiveTargets = 6;
+	const int kIterations = 200;
+
+	uint32_t seed = 7;
+	auto random = [&seed]() -> float
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+
+	// every target pulls on a patch around its own center, the rest of the head doesn't move
+	std::vector<glm::vec3> positions(kVertexCount);
+	for (glm::vec3& position : positions)
+	{
+		position = glm::normalize(glm::vec3(random() - 0.5f, random() - 0.5f, random() - 0.5f)) * 0.1f;
+	}
+
+	std::vector<MorphTargetDesc> descs(kTargetCount);
+	for (uint32_t t = 0; t < kTargetCount; t++)
+	{
+		glm::vec3 center = positions[(uint32_t)(random() * kVertexCount) % kVertexCount];
+		glm::vec3 direction = glm::normalize(glm::vec3(random() - 0.5f, random() - 0.5f, random() - 0.5f));
+
+		descs[t].name = "target" + std::to_string(t);
+		descs[t].positionDeltas.resize(kVertexCount);
+		descs[t].normalDeltas.resize(kVertexCount);
+
+		for (uint32_t v = 0; v < kVertexCount; v++)
+		{
+			float falloff = std::max(0.0f, 1.0f - glm::length(positions[v] - center) / 0.03f);
+			descs[t].positionDeltas[v] = direction * 0.005f * falloff;
+			descs[t].normalDeltas[v] = direction * 0.2f * falloff;
+		}
+	}
+
+	MorphTargetSet set;
+	set.build(kVertexCount, descs);
+
+	std::vector<float> weights(kTargetCount, 0.0f);
+	// some negative, correctives often pull the other way
+	for (uint32_t i = 0; i < kActiveTargets; i++)
+	{
+		weights[(i * 7) % kTargetCount] = i % 2 == 0 ? 0.5f : -0.5f;
+	}
+
+	std::vector<glm::vec3> outPositions(kVertexCount);
+	std::vector<glm::vec3> outNormals(kVertexCount, glm::vec3(0.0f));
+
+	// dense, every target's full array, zero weights skipped the same way
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < kIterations; i++)
+	{
+		outPositions = positions;
+		for (uint32_t t = 0; t < kTargetCount; t++)
+		{
+			if (std::abs(weights[t]) <= kMorphWeightEpsilon)
+			{
+				continue;
+			}
+
+			for (uint32_t v = 0; v < kVertexCount; v++)
+			{
+				outPositions[v] += descs[t].positionDeltas[v] * weights[t];
+				outNormals[v] += descs[t].normalDeltas[v] * weights[t];
+			}
+		}
+	}
+	double denseMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / kIterations;
+
+	start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < kIterations; i++)
+	{
+		outPositions = positions;
+		set.evaluate(weights, outPositions, outNormals);
+	}
+	double sparseMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / kIterations;
+
+	std::cout << std::fixed << std::setprecision(3)
+		<< "MorphTargets: " << kVertexCount << " vertices, " << kTargetCount << " targets, "
+		<< set.getDenseSize() / 1024.0 << " KB dense -> " << set.getSparseSize() / 1024.0 << " KB sparse, "
+		<< kActiveTargets << " active touch " << set.getActiveDeltaCount(weights) << " deltas, "
+		<< "dense " << denseMs << " ms, sparse " << sparseMs << " ms" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "Dependencies\glm\glm\glm.hpp"
+
+// a blend shape as authored, one delta per vertex of the mesh
+// normalDeltas can be empty when the target doesn't bend normals
+struct MorphTargetDesc
+{
+	std::string name;
+	std::vector<glm::vec3> positionDeltas;
+	std::vector<glm::vec3> normalDeltas;
+};
+
+// one vertex a target moves, read as a uvec4 by Shaders/morph.comp
+struct MorphDelta
+{
+	uint32_t vertex;
+	uint16_t position[3];	// half floats
+	uint16_t normal[3];		// half floats
+};
+
+struct MorphTarget
+{
+	std::string name;
+	uint32_t firstDelta;
+	uint32_t deltaCount;
+};
+
+// weights at or under this are skipped, both here and in GpuSkinning
+static const float kMorphWeightEpsilon = 1e-4f;
+
+// -- Morph targets
+// Only the vertices a target actually moves are kept, a face shape touches a few hundred
+// vertices of a mesh of thousands. Evaluating walks the deltas of the targets with a weight,
+// so the cost follows the active deltas and not vertices * targets.
+class MorphTargetSet
+{
+public:
+	MorphTargetSet();
+	~MorphTargetSet();
+
+	uint32_t vertexCount;
+	std::vector<MorphTarget> targets;
+	std::vector<MorphDelta> deltas;
+
+	// deltas shorter than threshold ( position and normal both ) are dropped
+	void build(uint32_t _vertexCount, const std::vector<MorphTargetDesc>& descs, float threshold = 1e-5f);
+
+	// -1 when there is no target of that name
+	int32_t findTarget(const std::string& name) const;
+
+	// deltas a set of weights touches, what a gpu evaluation costs
+	uint32_t getActiveDeltaCount(const std::vector<float>& weights) const;
+
+	// cpu reference, adds the weighted deltas to positions and normals ( normals are not renormalized )
+	void evaluate(const std::vector<float>& weights, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals) const;
+
+	size_t getDenseSize() const { return targets.size() * (size_t)vertexCount * sizeof(glm::vec3) * 2; }
+	size_t getSparseSize() const { return deltas.size() * sizeof(MorphDelta); }
+
+	// a 6000 vertex head with 52 targets, a few of them active at a time
+	static void benchmark();
+};
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "Tools.h"
 #include "VulkanContext.h"
+#include "MeshProcessing.h"
 
 ObjectBuffers::ObjectBuffers()
 { }
@@ -28,14 +29,116 @@ void ObjectBuffers::createVertexIndexUniformsBuffers(MeshType modelType)
 		break;
 	}
 
+	ProcessedMesh mesh;
+	mesh.vertices = std::move(vertices);
+	mesh.indices = std::move(indices);
+
+	MeshProcessing::process(mesh);
+
+	static const char* meshNames[] = { "triangle", "quad", "cube", "sphere" };
+	MeshOptimizer::printStats(meshNames[modelType], mesh.lods[0].indexCount / 3, static_cast<uint32_t>(mesh.vertices.size()), mesh.cacheStatsBefore, mesh.cacheStatsAfter);
+
+	createFromProcessedMesh(mesh);
+}
+
+void ObjectBuffers::createFromProcessedMesh(const ProcessedMesh& mesh)
+{
+	// copies, the mesh may be shared through ProceduralMeshCache
+	vertices = mesh.vertices;
+	indices = mesh.indices;
+	lods = mesh.lods;
+	meshlets = mesh.meshlets;
+	positionStream = mesh.positionStream;
+	attributeStream = mesh.attributeStream;
+	indexType = mesh.indexType;
+	boundingSphere = mesh.boundingSphere;
+	boundsMin = mesh.boundsMin;
+	boundsMax = mesh.boundsMax;
+
 	createVertexBuffer();
 	createIndexBuffer();
 	createUniformBuffers();
 }
 
+void ObjectBuffers::createFromCookedFile(const std::string& path)
+{
+	CookedMesh cooked;
+	cooked.open(path);
+
+	const CookedMeshHeader& header = cooked.getHeader();
+
+	// the small tables are needed on the CPU for LOD selection and meshlet culling
+	lods.assign(cooked.getLods(), cooked.getLods() + header.lodCount);
+	meshlets.meshlets.assign(cooked.getMeshlets(), cooked.getMeshlets() + header.meshletCount);
+	meshlets.vertices.assign(cooked.getMeshletVertices(), cooked.getMeshletVertices() + header.meshletVertexCount);
+	meshlets.triangles.assign(cooked.getMeshletTriangles(), cooked.getMeshletTriangles() + header.meshletTriangleByteCount);
+
+	boundingSphere = glm::vec4(header.boundingSphere[0], header.boundingSphere[1], header.boundingSphere[2], header.boundingSphere[3]);
+	boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+	indexType = (VkIndexType)header.indexType;
+
+	for (uint32_t i = 0; i < header.streamCount; i++)
+	{
+		streamOffsets[i] = cooked.getStreams()[i].offset;
+	}
+
+	// the sections already have the gpu layout, they are copied or decoded from the mapping straight into staging memory
+	// a corrupt compressed section throws here, the vertex buffer is released before passing it on
+	vkTools::createDeviceLocalBuffer(cooked.getVertexBufferSize(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		[&](void* staging) { cooked.readVertexData(staging); }, vertexBuffer, vertexBufferMemory);
+
+	try
+	{
+		vkTools::createDeviceLocalBuffer(cooked.getIndexBufferSize(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+			[&](void* staging) { cooked.readIndexData(staging); }, indexBuffer, indexBufferMemory);
+	}
+	catch (...)
+	{
+		vkDestroyBuffer(VulkanContext::getInstance()->getDevice()->logicalDevice, vertexBuffer, nullptr);
+		vkFreeMemory(VulkanContext::getInstance()->getDevice()->logicalDevice, vertexBufferMemory, nullptr);
+		throw;
+	}
+
+	cooked.close();
+
+	createUniformBuffers();
+}
+
+void ObjectBuffers::cookToFile(const std::string& path, bool compress)
+{
+	// a loaded cooked mesh keeps nothing on the CPU to write back
+	if (positionStream.empty())
+	{
+		throw std::runtime_error("only generated meshes can be cooked!");
+	}
+
+	CookedMeshSource source;
+	source.positions = &positionStream;
+	source.attributes = &attributeStream;
+	source.indices = &indices;
+	source.indexType = indexType;
+	source.lods = &lods;
+	source.meshlets = &meshlets;
+	source.boundingSphere = boundingSphere;
+	source.boundsMin = boundsMin;
+	source.boundsMax = boundsMax;
+	source.compress = compress;
+
+	CookedMesh::writeFile(path, source);
+}
+
 void ObjectBuffers::createVertexBuffer()
 {
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+	// positions first, attributes after them on a 16 byte boundary
+	VkDeviceSize positionSize = sizeof(positionStream[0]) * positionStream.size();
+	VkDeviceSize attributeSize = sizeof(attributeStream[0]) * attributeStream.size();
+
+	streamOffsets[kVertexStreamPosition] = 0;
+	streamOffsets[kVertexStreamAttributes] = (positionSize + 15) & ~(VkDeviceSize)15;
+
+	VkDeviceSize bufferSize = streamOffsets[kVertexStreamAttributes] + attributeSize;
 
 	//-- Staging buffer creation
 	VkBuffer stagingBuffer;
@@ -50,7 +153,8 @@ void ObjectBuffers::createVertexBuffer()
 	//-- Allows us to access a region of the specified memory resource
 	vkMapMemory(VulkanContext::getInstance()->getDevice()->logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data); // copy buffer memory to data 
 
-	memcpy(data, vertices.data(), (size_t)bufferSize);
+	memcpy((char*)data + streamOffsets[kVertexStreamPosition], positionStream.data(), (size_t)positionSize);
+	memcpy((char*)data + streamOffsets[kVertexStreamAttributes], attributeStream.data(), (size_t)attributeSize);
 
 	// data may not be copied to the memory immediatly
 	// Or writes to the buffer are not visible to mapped memory 
@@ -72,8 +176,17 @@ void ObjectBuffers::createVertexBuffer()
 // -- Create Index Buffer
 void ObjectBuffers::createIndexBuffer()
 {
+	std::vector<uint16_t> indices16;
+	const void* indexData = indices.data();
 	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
 
+	if (indexType == VK_INDEX_TYPE_UINT16)
+	{
+		indices16.assign(indices.begin(), indices.end());
+		indexData = indices16.data();
+		bufferSize = sizeof(indices16[0]) * indices16.size();
+	}
+
 	VkBuffer stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
 
@@ -81,7 +194,7 @@ void ObjectBuffers::createIndexBuffer()
 
 	void* data;
 	vkMapMemory(VulkanContext::getInstance()->getDevice()->logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, indices.data(), (size_t)bufferSize);
+	memcpy(data, indexData, (size_t)bufferSize);
 	vkUnmapMemory(VulkanContext::getInstance()->getDevice()->logicalDevice, stagingBufferMemory);
 
 	vkTools::createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
@@ -1,7 +1,10 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include <vector>
+#include <string>
 #include "Mesh.h"
+#include "Meshlet.h"
+#include "MeshProcessing.h"
 
 class ObjectBuffers
 {
@@ -9,18 +12,43 @@ public:
 	ObjectBuffers();
 	~ObjectBuffers();
 
+	// full precision copy for the CPU side, the gpu gets the packed streams
 	std::vector<Vertex> vertices;
+	std::vector<PositionStreamVertex> positionStream;
+	std::vector<AttributeStreamVertex> attributeStream;
+
+	// both streams share one buffer, streamOffsets[VertexStream] is where each starts
 	VkBuffer vertexBuffer;
 	VkDeviceMemory vertexBufferMemory;
+	VkDeviceSize streamOffsets[kVertexStreamCount];
 
+	// every LOD lives in the same index buffer, lods holds their ranges
+	// the CPU side is always 32 bit, the gpu copy is 16 bit when every vertex fits, see indexType
 	std::vector<uint32_t> indices;
+	VkIndexType indexType;
+	std::vector<MeshLod> lods;
 	VkBuffer indexBuffer;
 	VkDeviceMemory indexBufferMemory;
 
+	// clusters of LOD 0, their triangles are contiguous in indices
+	MeshletData meshlets;
+
+	// local space center xyz, radius w, and the local space box
+	glm::vec4 boundingSphere;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
 	VkBuffer uniformBuffers;
 	VkDeviceMemory uniformBuffersMemory;
 
 	void createVertexIndexUniformsBuffers(MeshType modelType);
+	void createFromProcessedMesh(const ProcessedMesh& mesh);
+
+	// loads a file written by cookToFile, vertex and index data go from the mapped file
+	// straight into staging memory so vertices and indices stay empty on the CPU side
+	void createFromCookedFile(const std::string& path);
+	void cookToFile(const std::string& path, bool compress = true);
+
 	void destroy();
 
 private:
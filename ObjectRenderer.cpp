@@ -3,18 +3,44 @@
 
 void ObjectRenderer::createObjectRenderer(MeshType modelType, glm::vec3 _position, glm::vec3 _scale)
 {
-	uint32_t swapChainImageCount = VulkanContext::getInstance()->getSwapChain()->swapChainImages.size();
-	VkExtent2D swapChainImageExtent = VulkanContext::getInstance()->getSwapChain()->swapChainImageExtent;
-
 	// Create Vertex, Index and Uniforms Buffer;
 	objBuffers.createVertexIndexUniformsBuffers(modelType);
 
+	createDescriptorAndPipeline(_position, _scale);
+}
+
+void ObjectRenderer::createObjectRenderer(const std::string& cookedMeshFile, glm::vec3 _position, glm::vec3 _scale)
+{
+	objBuffers.createFromCookedFile(cookedMeshFile);
+
+	createDescriptorAndPipeline(_position, _scale);
+}
+
+void ObjectRenderer::createObjectRenderer(const ProceduralMeshDesc& shape, glm::vec3 _position, glm::vec3 _scale)
+{
+	// objects with the same shape share the generated and processed mesh
+	std::shared_ptr<const ProcessedMesh> mesh = ProceduralMeshCache::getInstance()->get(shape);
+	objBuffers.createFromProcessedMesh(*mesh);
+
+	createDescriptorAndPipeline(_position, _scale);
+}
+
+void ObjectRenderer::setTexture(const Texture* _texture)
+{
+	texture = _texture;
+}
+
+void ObjectRenderer::createDescriptorAndPipeline(glm::vec3 _position, glm::vec3 _scale)
+{
+	VkExtent2D swapChainImageExtent = VulkanContext::getInstance()->getSwapChain()->swapChainImageExtent;
+
 	// CreateDescriptorSetLayout
-	descriptor.createDescriptorLayoutSetPoolAndAllocate(swapChainImageCount);
-	descriptor.populateDescriptorSets(swapChainImageCount, objBuffers.uniformBuffers);
+	descriptor.createDescriptorLayoutSetPoolAndAllocate(texture != nullptr);
+	descriptor.populateDescriptorSets(objBuffers.uniformBuffers, texture);
 
 	// CreateGraphicsPipeline
-	gPipeline.createGraphicsPipelineLayoutAndPipeline(swapChainImageExtent, descriptor.descriptorSetLayout, VulkanContext::getInstance()->getRenderPass()->renderPass);
+	gPipeline.createGraphicsPipelineLayoutAndPipeline(swapChainImageExtent, descriptor.descriptorSetLayout, VulkanContext::getInstance()->getRenderPass()->renderPass,
+		"Shaders/SPIRV/basic_compact.vert.spv", texture != nullptr ? "Shaders/SPIRV/textured.frag.spv" : "Shaders/SPIRV/basic.frag.spv", getVertexStreamInput((1 << kVertexStreamPosition) | (1 << kVertexStreamAttributes)));
 
 	position = _position;
 	scale = _scale;
@@ -27,26 +53,43 @@ void ObjectRenderer::draw() {
 	// Bind the pipeline
 	vkCmdBindPipeline(cBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, gPipeline.graphicsPipeline);
 
-	// Bind vertex buffer to command buffer
-	VkBuffer vertexBuffers[] = { objBuffers.vertexBuffer };
-	VkDeviceSize offsets[] = { 0 };
-
-	vkCmdBindVertexBuffers(cBuffer,
-		0, // first binding
-		1, // binding count
-		vertexBuffers,
-		offsets);
-
-	// Bind index buffer to the command buffer
-	vkCmdBindIndexBuffer(cBuffer, objBuffers.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	// Bind the vertex streams the pipeline reads, stream n goes to binding n
+	for (uint32_t stream = 0; stream < kVertexStreamCount; stream++)
+	{
+		if (gPipeline.vertexStreamMask & (1 << stream))
+		{
+			vkCmdBindVertexBuffers(cBuffer,
+				stream, // first binding
+				1, // binding count
+				&objBuffers.vertexBuffer,
+				&objBuffers.streamOffsets[stream]);
+		}
+	}
+
+	// Bind index buffer to the command buffer, 16 or 32 bit depending on the vertex count
+	vkCmdBindIndexBuffer(cBuffer, objBuffers.indexBuffer, 0, objBuffers.indexType);
 
 	//	Bind uniform buffer using descriptorSets
 	vkCmdBindDescriptorSets(cBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, gPipeline.pipelineLayout, 0, 1, &descriptor.descriptorSet, 0, nullptr);
 
+	// cluster culled LOD 0, one draw per run of visible meshlets
+	if (currentLod == 0 && meshletRangesValid)
+	{
+		for (const IndexRange& range : meshletRanges)
+		{
+			vkCmdDrawIndexed(cBuffer, range.indexCount, 1, range.firstIndex, 0, 0);
+		}
+
+		meshletRangesValid = false;
+		return;
+	}
+
+	const MeshLod& lod = objBuffers.lods[currentLod];
+
 	vkCmdDrawIndexed(cBuffer,
-		static_cast<uint32_t>(objBuffers.indices.size()), // no of indices
+		lod.indexCount, // no of indices
 		1, // instance count -- just the 1
-		0, // first index -- start at 0th index
+		lod.firstIndex, // first index -- where the selected LOD starts
 		0, // vertex offet -- any offsets to add
 		0);// first instance -- since no instancing, is set to 0 
 }
@@ -55,14 +98,7 @@ void ObjectRenderer::updateUniformBuffer(Camera camera) {
 
 	UniformBufferObject ubo = {};
 
-	glm::mat4 scaleMatrix = glm::mat4(1.0f);
-	glm::mat4 rotMatrix = glm::mat4(1.0f);
-	glm::mat4 transMatrix = glm::mat4(1.0f);
-
-	scaleMatrix = glm::scale(glm::mat4(1.0f), scale);
-	transMatrix = glm::translate(glm::mat4(1.0f), position);
-
-	ubo.model = transMatrix * rotMatrix * scaleMatrix;
+	ubo.model = getModelMatrix();
 
 	ubo.view = camera.getViewMatrix();
 
@@ -70,12 +106,100 @@ void ObjectRenderer::updateUniformBuffer(Camera camera) {
 
 	ubo.proj[1][1] *= -1; // invert Y as in Opengl it is inverted to begin with
 
+	selectLod(camera);
+
 	void* data;
 	vkMapMemory(VulkanContext::getInstance()->getDevice()->logicalDevice, objBuffers.uniformBuffersMemory, 0, sizeof(ubo), 0, &data);
 
 	memcpy(data, &ubo, sizeof(ubo));
 
 	vkUnmapMemory(VulkanContext::getInstance()->getDevice()->logicalDevice, objBuffers.uniformBuffersMemory);
+
+	// skipped unless something changed, a streamed texture rebuilt in place gets its new view here
+	descriptor.populateDescriptorSets(objBuffers.uniformBuffers, texture);
+}
+
+glm::mat4 ObjectRenderer::getModelMatrix()
+{
+	glm::mat4 scaleMatrix = glm::mat4(1.0f);
+	glm::mat4 rotMatrix = glm::mat4(1.0f);
+	glm::mat4 transMatrix = glm::mat4(1.0f);
+
+	scaleMatrix = glm::scale(glm::mat4(1.0f), scale);
+	transMatrix = glm::translate(glm::mat4(1.0f), position);
+
+	return transMatrix * rotMatrix * scaleMatrix;
+}
+
+// world space axis aligned box of the mesh
+void ObjectRenderer::getWorldBounds(glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+	// no rotation yet, so scale and translate keep the box axis aligned
+	glm::vec3 cornerA = position + scale * objBuffers.boundsMin;
+	glm::vec3 cornerB = position + scale * objBuffers.boundsMax;
+
+	boundsMin = glm::min(cornerA, cornerB);
+	boundsMax = glm::max(cornerA, cornerB);
+}
+
+void ObjectRenderer::submitOccluder(SoftwareOcclusion& occlusion)
+{
+	// cooked meshes have no CPU copy to rasterize
+	if (objBuffers.indices.empty())
+	{
+		return;
+	}
+
+	// coarsest LOD, occluders only need the rough shape
+	const MeshLod& lod = objBuffers.lods.back();
+	occlusion.addOccluder(objBuffers.vertices, objBuffers.indices, getModelMatrix(), lod.firstIndex, lod.indexCount);
+}
+
+void ObjectRenderer::cullMeshlets(Camera camera, SoftwareOcclusion* occlusion)
+{
+	// coarser LODs have no meshlets, they are cheap enough to draw whole
+	if (currentLod != 0)
+	{
+		meshletRangesValid = false;
+		return;
+	}
+
+	MeshletCuller::cull(objBuffers.meshlets, getModelMatrix(), camera, occlusion, meshletRanges, &meshletStats);
+	meshletRangesValid = true;
+}
+
+MeshletCullStats ObjectRenderer::getMeshletCullStats()
+{
+	return meshletStats;
+}
+
+void ObjectRenderer::selectLod(Camera& camera)
+{
+	glm::vec3 center = position + scale * glm::vec3(objBuffers.boundingSphere);
+	float radius = objBuffers.boundingSphere.w * std::max(scale.x, std::max(scale.y, scale.z));
+
+	// view space distance, clamped so objects at the camera pick LOD 0
+	float distance = -(camera.getViewMatrix() * glm::vec4(center, 1.0f)).z;
+	distance = std::max(distance, 1e-3f);
+
+	// pixels per world unit at that distance, proj[1][1] is 1 / tan(fov / 2)
+	float screenHeight = (float)VulkanContext::getInstance()->getSwapChain()->swapChainImageExtent.height;
+	float pixelsPerUnit = camera.getprojectionMatrix()[1][1] * 0.5f * screenHeight / distance;
+
+	// lod errors are relative to the mesh extent, the diagonal of its box is about 2 * radius
+	float extentPixels = 2.0f * radius * pixelsPerUnit;
+
+	// finer while the current one shows too much error
+	while (currentLod > 0 && objBuffers.lods[currentLod].error * extentPixels > lodErrorPixels)
+	{
+		currentLod--;
+	}
+
+	// coarser only with some margin so it doesn't flicker at the threshold
+	while (currentLod + 1 < objBuffers.lods.size() && objBuffers.lods[currentLod + 1].error * extentPixels < lodErrorPixels * (1.0f - lodHysteresis))
+	{
+		currentLod++;
+	}
 }
 
 void ObjectRenderer::destroy()
@@ -4,20 +4,50 @@
 #include "ObjectBuffers.h"
 #include "Descriptor.h"
 #include "Camera.h"
+#include "SoftwareOcclusion.h"
+#include "ProceduralMesh.h"
 
 class ObjectRenderer
 {
 public:
 	void createObjectRenderer(MeshType modelType, glm::vec3 _position, glm::vec3 _scale);
+	void createObjectRenderer(const std::string& cookedMeshFile, glm::vec3 _position, glm::vec3 _scale);
+	void createObjectRenderer(const ProceduralMeshDesc& shape, glm::vec3 _position, glm::vec3 _scale);
+	// before createObjectRenderer, the texture is sampled with the mesh uvs and has to outlive the renderer
+	void setTexture(const Texture* _texture);
 	void draw();
 	void updateUniformBuffer(Camera camera);
 	void destroy();
 
+	glm::mat4 getModelMatrix();
+	void getWorldBounds(glm::vec3& boundsMin, glm::vec3& boundsMax);
+	void submitOccluder(SoftwareOcclusion& occlusion);
+
+	// per meshlet culling for the next draw, only used while LOD 0 is selected
+	// occlusion can be null, otherwise it has to be rasterized already
+	void cullMeshlets(Camera camera, SoftwareOcclusion* occlusion);
+	MeshletCullStats getMeshletCullStats();
+
 private:
 	GraphicsPipeline gPipeline;
 	ObjectBuffers objBuffers;
 	Descriptor descriptor;
+	const Texture* texture = nullptr;
 
 	glm::vec3 position;
 	glm::vec3 scale;
+
+	// LOD selection, a level is used while its error stays under lodErrorPixels on screen
+	// and a coarser one only once it fits under lodErrorPixels * (1 - lodHysteresis)
+	uint32_t currentLod = 0;
+	float lodErrorPixels = 1.0f;
+	float lodHysteresis = 0.25f;
+
+	// surviving meshlet ranges, valid for one draw
+	std::vector<IndexRange> meshletRanges;
+	bool meshletRangesValid = false;
+	MeshletCullStats meshletStats = {};
+
+	void createDescriptorAndPipeline(glm::vec3 _position, glm::vec3 _scale);
+	void selectLod(Camera& camera);
 };
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "Parallel.h"
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <exception>
+#include <algorithm>
+
+uint32_t getWorkerThreadCount()
+{
+	uint32_t cores = std::thread::hardware_concurrency();
+	return cores > 0 ? cores : 1;
+}
+
+void parallelFor(uint32_t count, const std::function<void(uint32_t)>& job, uint32_t threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = getWorkerThreadCount();
+	}
+	threadCount = std::min(threadCount, count);
+
+	if (threadCount <= 1)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			job(i);
+		}
+		return;
+	}
+
+	std::atomic<uint32_t> next(0);
+	std::exception_ptr error;
+	std::mutex errorMutex;
+
+	auto worker = [&]()
+	{
+		for (uint32_t i = next++; i < count; i = next++)
+		{
+			try
+			{
+				job(i);
+			}
+			catch (...)
+			{
+				// first error wins, the rest of the jobs are skipped
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if (!error)
+				{
+					error = std::current_exception();
+				}
+				next = count;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (uint32_t i = 1; i < threadCount; i++)
+	{
+		threads.emplace_back(worker);
+	}
+
+	worker();
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+// runs job(0) .. job(count - 1) on short lived threads, the calling thread works too
+// jobs are handed out one at a time so uneven jobs still balance
+// threadCount 0 uses every core, 1 runs everything on the calling thread
+// an exception thrown by a job is rethrown on the calling thread once all threads are done
+void parallelFor(uint32_t count, const std::function<void(uint32_t)>& job, uint32_t threadCount = 0);
+
+uint32_t getWorkerThreadCount();
\ No newline at end of file
@@ -0,0 +1,679 @@
+#include "ProceduralMesh.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PROCEDURAL_MESH_SSE2
+#include <emmintrin.h>
+#endif
+
+static const float kPi = 3.14159265358979323846f;
+
+// -- Descriptions
+
+ProceduralMeshDesc ProceduralMeshDesc::sphere(float radius, uint32_t segments, uint32_t rings)
+{
+	ProceduralMeshDesc desc = {};
+	desc.shape = kProceduralSphere;
+	desc.radius = radius;
+	desc.segments = segments;
+	desc.rings = rings;
+	return desc;
+}
+
+ProceduralMeshDesc ProceduralMeshDesc::icosphere(float radius, uint32_t subdivisions)
+{
+	ProceduralMeshDesc desc = {};
+	desc.shape = kProceduralIcosphere;
+	desc.radius = radius;
+	desc.subdivisions = subdivisions;
+	return desc;
+}
+
+ProceduralMeshDesc ProceduralMeshDesc::capsule(float radius, float height, uint32_t segments, uint32_t rings)
+{
+	ProceduralMeshDesc desc = {};
+	desc.shape = kProceduralCapsule;
+	desc.radius = radius;
+	desc.height = height;
+	desc.segments = segments;
+	desc.rings = rings;
+	return desc;
+}
+
+ProceduralMeshDesc ProceduralMeshDesc::cylinder(float radius, float height, uint32_t segments)
+{
+	ProceduralMeshDesc desc = {};
+	desc.shape = kProceduralCylinder;
+	desc.radius = radius;
+	desc.height = height;
+	desc.segments = segments;
+	return desc;
+}
+
+ProceduralMeshDesc ProceduralMeshDesc::plane(float width, float depth, uint32_t segmentsX, uint32_t segmentsZ)
+{
+	ProceduralMeshDesc desc = {};
+	desc.shape = kProceduralPlane;
+	desc.width = width;
+	desc.depth = depth;
+	desc.segments = segmentsX;
+	desc.rings = segmentsZ;
+	return desc;
+}
+
+ProceduralMeshDesc ProceduralMeshDesc::torus(float radius, float tubeRadius, uint32_t segments, uint32_t tubeSegments)
+{
+	ProceduralMeshDesc desc = {};
+	desc.shape = kProceduralTorus;
+	desc.radius = radius;
+	desc.tubeRadius = tubeRadius;
+	desc.segments = segments;
+	desc.rings = tubeSegments;
+	return desc;
+}
+
+bool ProceduralMeshDesc::operator==(const ProceduralMeshDesc& other) const
+{
+	return shape == other.shape && radius == other.radius && tubeRadius == other.tubeRadius && height == other.height &&
+		width == other.width && depth == other.depth && segments == other.segments && rings == other.rings && subdivisions == other.subdivisions;
+}
+
+size_t ProceduralMeshDescHash::operator()(const ProceduralMeshDesc& desc) const
+{
+	// FNV-1a over the members, not the struct bytes, padding is not part of the key
+	uint32_t words[9];
+	words[0] = (uint32_t)desc.shape;
+	memcpy(&words[1], &desc.radius, 4);
+	memcpy(&words[2], &desc.tubeRadius, 4);
+	memcpy(&words[3], &desc.height, 4);
+	memcpy(&words[4], &desc.width, 4);
+	memcpy(&words[5], &desc.depth, 4);
+	words[6] = desc.segments;
+	words[7] = desc.rings;
+	words[8] = desc.subdivisions;
+
+	uint32_t hash = 2166136261u;
+	for (uint32_t word : words)
+	{
+		hash = (hash ^ word) * 16777619u;
+	}
+	return hash;
+}
+
+// -- Trig
+
+#ifdef PROCEDURAL_MESH_SSE2
+
+// four sines and cosines at once, the Cephes single precision polynomials
+// range reduction to [-pi/4, pi/4] in three steps keeps the error around 1 ulp for the angles used here
+static void sinCos4(__m128 x, __m128& sines, __m128& cosines)
+{
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+
+	__m128 signSin = _mm_and_ps(x, signMask);
+	x = _mm_andnot_ps(signMask, x);
+
+	// octant, rounded up to even
+	__m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+	octant = _mm_add_epi32(octant, _mm_set1_epi32(1));
+	octant = _mm_and_si128(octant, _mm_set1_epi32(~1));
+	__m128 y = _mm_cvtepi32_ps(octant);
+
+	__m128 swapSignSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29));
+	__m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+	__m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+
+	x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-0.78515625f)));
+	x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-2.4187564849853515625e-4f)));
+	x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-3.77489497744594108e-8f)));
+
+	signSin = _mm_xor_ps(signSin, swapSignSin);
+
+	__m128 z = _mm_mul_ps(x, x);
+
+	__m128 cosine = _mm_set1_ps(2.443315711809948e-5f);
+	cosine = _mm_add_ps(_mm_mul_ps(cosine, z), _mm_set1_ps(-1.388731625493765e-3f));
+	cosine = _mm_add_ps(_mm_mul_ps(cosine, z), _mm_set1_ps(4.166664568298827e-2f));
+	cosine = _mm_mul_ps(_mm_mul_ps(cosine, z), z);
+	cosine = _mm_sub_ps(cosine, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+	cosine = _mm_add_ps(cosine, _mm_set1_ps(1.0f));
+
+	__m128 sine = _mm_set1_ps(-1.9515295891e-4f);
+	sine = _mm_add_ps(_mm_mul_ps(sine, z), _mm_set1_ps(8.3321608736e-3f));
+	sine = _mm_add_ps(_mm_mul_ps(sine, z), _mm_set1_ps(-1.6666654611e-1f));
+	sine = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sine, z), x), x);
+
+	// in odd octants the two polynomials trade places
+	__m128 sinResult = _mm_or_ps(_mm_and_ps(polyMask, sine), _mm_andnot_ps(polyMask, cosine));
+	__m128 cosResult = _mm_or_ps(_mm_and_ps(polyMask, cosine), _mm_andnot_ps(polyMask, sine));
+
+	sines = _mm_xor_ps(sinResult, signSin);
+	cosines = _mm_xor_ps(cosResult, signCos);
+}
+
+#endif
+
+void ProceduralMesh::computeSinCos(uint32_t count, float start, float step, float* sines, float* cosines)
+{
+	uint32_t i = 0;
+
+#ifdef PROCEDURAL_MESH_SSE2
+	const __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		// start + step * i per lane, not accumulated, so the error doesn't grow along the row
+		__m128 index = _mm_add_ps(_mm_set1_ps((float)i), lanes);
+		__m128 angles = _mm_add_ps(_mm_set1_ps(start), _mm_mul_ps(index, _mm_set1_ps(step)));
+
+		__m128 s, c;
+		sinCos4(angles, s, c);
+		_mm_storeu_ps(sines + i, s);
+		_mm_storeu_ps(cosines + i, c);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		float angle = start + step * (float)i;
+		sines[i] = std::sin(angle);
+		cosines[i] = std::cos(angle);
+	}
+}
+
+// -- Sizes
+
+static void validate(const ProceduralMeshDesc& desc)
+{
+	bool valid = true;
+
+	switch (desc.shape)
+	{
+	case kProceduralSphere: valid = desc.segments >= 3 && desc.rings >= 2; break;
+	case kProceduralIcosphere: valid = desc.subdivisions <= 8; break;
+	case kProceduralCapsule: valid = desc.segments >= 3 && desc.rings >= 1; break;
+	case kProceduralCylinder: valid = desc.segments >= 3; break;
+	case kProceduralPlane: valid = desc.segments >= 1 && desc.rings >= 1; break;
+	case kProceduralTorus: valid = desc.segments >= 3 && desc.rings >= 3; break;
+	default: valid = false; break;
+	}
+
+	if (!valid)
+	{
+		throw std::runtime_error("procedural mesh: parameters out of range for shape " + std::to_string((int)desc.shape));
+	}
+}
+
+// icosphere faces are subdivided into a triangular grid of this many steps per edge
+static uint32_t getIcosphereFrequency(const ProceduralMeshDesc& desc)
+{
+	return 1u << desc.subdivisions;
+}
+
+uint32_t ProceduralMesh::getVertexCount(const ProceduralMeshDesc& desc)
+{
+	validate(desc);
+
+	uint32_t f = getIcosphereFrequency(desc);
+
+	switch (desc.shape)
+	{
+	case kProceduralSphere: return (desc.rings + 1) * (desc.segments + 1);
+	case kProceduralCapsule: return 2 * (desc.rings + 1) * (desc.segments + 1);
+	case kProceduralTorus: return (desc.rings + 1) * (desc.segments + 1);
+	case kProceduralCylinder: return 2 * (desc.segments + 1) + 2 * (desc.segments + 1);
+	case kProceduralPlane: return (desc.segments + 1) * (desc.rings + 1);
+	case kProceduralIcosphere: return 20 * (f + 1) * (f + 2) / 2;
+	}
+	return 0;
+}
+
+uint32_t ProceduralMesh::getIndexCount(const ProceduralMeshDesc& desc)
+{
+	validate(desc);
+
+	uint32_t f = getIcosphereFrequency(desc);
+
+	switch (desc.shape)
+	{
+	case kProceduralSphere:
+	case kProceduralCapsule:
+	case kProceduralTorus:
+	{
+		std::vector<LatheRow> rows;
+		getLatheRows(desc, rows);
+		return getLatheIndexCount(rows, desc.segments);
+	}
+	case kProceduralCylinder: return desc.segments * 6 + desc.segments * 6;
+	case kProceduralPlane: return desc.segments * desc.rings * 6;
+	case kProceduralIcosphere: return 20 * f * f * 3;
+	}
+	return 0;
+}
+
+// -- Generation
+
+void ProceduralMesh::generate(const ProceduralMeshDesc& desc, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	validate(desc);
+
+	if (desc.shape == kProceduralIcosphere)
+	{
+		generateIcosphere(desc, vertices, indices);
+		return;
+	}
+
+	// exact sizes, everything below writes in place
+	vertices.resize(getVertexCount(desc));
+	indices.resize(getIndexCount(desc));
+
+	if (desc.shape == kProceduralPlane)
+	{
+		generatePlane(desc, vertices.data(), indices.data());
+		return;
+	}
+
+	std::vector<LatheRow> rows;
+	getLatheRows(desc, rows);
+	generateLathe(rows, desc.segments, vertices.data(), indices.data(), 0);
+
+	if (desc.shape == kProceduralCylinder)
+	{
+		uint32_t sideVertices = static_cast<uint32_t>(rows.size()) * (desc.segments + 1);
+		generateCylinderCaps(desc, vertices.data() + sideVertices, indices.data() + getLatheIndexCount(rows, desc.segments), sideVertices);
+	}
+}
+
+void ProceduralMesh::getLatheRows(const ProceduralMeshDesc& desc, std::vector<LatheRow>& rows)
+{
+	rows.clear();
+
+	std::vector<float> sines, cosines;
+
+	switch (desc.shape)
+	{
+	case kProceduralSphere:
+	{
+		// pole to pole, the poles are exact so their rows collapse to a point
+		sines.resize(desc.rings + 1);
+		cosines.resize(desc.rings + 1);
+		computeSinCos(desc.rings + 1, 0.0f, kPi / desc.rings, sines.data(), cosines.data());
+		sines[0] = sines[desc.rings] = 0.0f;
+		cosines[0] = 1.0f;
+		cosines[desc.rings] = -1.0f;
+
+		for (uint32_t i = 0; i <= desc.rings; i++)
+		{
+			rows.push_back({ desc.radius * sines[i], desc.radius * cosines[i], glm::vec2(sines[i], cosines[i]), i / (float)desc.rings });
+		}
+		break;
+	}
+	case kProceduralCapsule:
+	{
+		// two hemispheres around a cylinder of height, v follows the arc length
+		sines.resize(desc.rings + 1);
+		cosines.resize(desc.rings + 1);
+		computeSinCos(desc.rings + 1, 0.0f, 0.5f * kPi / desc.rings, sines.data(), cosines.data());
+		sines[0] = 0.0f;
+		cosines[0] = 1.0f;
+		sines[desc.rings] = 1.0f;
+		cosines[desc.rings] = 0.0f;
+
+		float halfHeight = desc.height * 0.5f;
+		float arc = 0.5f * kPi * desc.radius;
+		float length = 2.0f * arc + desc.height;
+
+		for (uint32_t i = 0; i <= desc.rings; i++)
+		{
+			float along = arc * i / desc.rings;
+			rows.push_back({ desc.radius * sines[i], halfHeight + desc.radius * cosines[i], glm::vec2(sines[i], cosines[i]), along / length });
+		}
+
+		for (uint32_t i = 0; i <= desc.rings; i++)
+		{
+			float along = arc + desc.height + arc * i / desc.rings;
+			rows.push_back({ desc.radius * cosines[i], -halfHeight - desc.radius * sines[i], glm::vec2(cosines[i], -sines[i]), along / length });
+		}
+		break;
+	}
+	case kProceduralCylinder:
+	{
+		float halfHeight = desc.height * 0.5f;
+		rows.push_back({ desc.radius, halfHeight, glm::vec2(1.0f, 0.0f), 0.0f });
+		rows.push_back({ desc.radius, -halfHeight, glm::vec2(1.0f, 0.0f), 1.0f });
+		break;
+	}
+	case kProceduralTorus:
+	{
+		// around the tube starting at the top, going down the outside so the faces stay clockwise
+		sines.resize(desc.rings + 1);
+		cosines.resize(desc.rings + 1);
+		computeSinCos(desc.rings + 1, 0.5f * kPi, -2.0f * kPi / desc.rings, sines.data(), cosines.data());
+		sines[desc.rings] = sines[0];
+		cosines[desc.rings] = cosines[0];
+
+		for (uint32_t i = 0; i <= desc.rings; i++)
+		{
+			rows.push_back({ desc.radius + desc.tubeRadius * cosines[i], desc.tubeRadius * sines[i], glm::vec2(cosines[i], sines[i]), i / (float)desc.rings });
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+uint32_t ProceduralMesh::getLatheIndexCount(const std::vector<LatheRow>& rows, uint32_t segments)
+{
+	uint32_t count = 0;
+
+	// a band next to a pole has one triangle per segment instead of two
+	for (size_t i = 0; i + 1 < rows.size(); i++)
+	{
+		count += (rows[i].radius != 0.0f ? 3 : 0) * segments;
+		count += (rows[i + 1].radius != 0.0f ? 3 : 0) * segments;
+	}
+
+	return count;
+}
+
+void ProceduralMesh::generateLathe(const std::vector<LatheRow>& rows, uint32_t segments, Vertex* vertices, uint32_t* indices, uint32_t baseVertex)
+{
+	// one table for the whole surface, the seam column repeats the first one exactly
+	std::vector<float> sines(segments + 1), cosines(segments + 1);
+	computeSinCos(segments + 1, 0.0f, 2.0f * kPi / segments, sines.data(), cosines.data());
+	sines[0] = sines[segments] = 0.0f;
+	cosines[0] = cosines[segments] = 1.0f;
+
+	uint32_t columns = segments + 1;
+
+	for (size_t r = 0; r < rows.size(); r++)
+	{
+		const LatheRow& row = rows[r];
+		Vertex* rowVertices = vertices + r * columns;
+
+		for (uint32_t s = 0; s <= segments; s++)
+		{
+			Vertex& vertex = rowVertices[s];
+			vertex.pos = glm::vec3(row.radius * cosines[s], row.y, row.radius * sines[s]);
+			vertex.normal = glm::vec3(row.normal.x * cosines[s], row.normal.y, row.normal.x * sines[s]);
+			vertex.color = glm::vec3(1.0f);
+			vertex.texCoords = glm::vec2(s / (float)segments, row.v);
+			vertex.tangent = glm::vec4(0.0f);
+		}
+	}
+
+	// rows run top to bottom, so first, second, first + 1 is clockwise seen from outside
+	uint32_t* index = indices;
+
+	for (uint32_t r = 0; r + 1 < rows.size(); r++)
+	{
+		for (uint32_t s = 0; s < segments; s++)
+		{
+			uint32_t first = baseVertex + r * columns + s;
+			uint32_t second = first + columns;
+
+			if (rows[r].radius != 0.0f)
+			{
+				*index++ = first;
+				*index++ = second;
+				*index++ = first + 1;
+			}
+
+			if (rows[r + 1].radius != 0.0f)
+			{
+				*index++ = second;
+				*index++ = second + 1;
+				*index++ = first + 1;
+			}
+		}
+	}
+}
+
+void ProceduralMesh::generateCylinderCaps(const ProceduralMeshDesc& desc, Vertex* vertices, uint32_t* indices, uint32_t baseVertex)
+{
+	uint32_t segments = desc.segments;
+
+	std::vector<float> sines(segments), cosines(segments);
+	computeSinCos(segments, 0.0f, 2.0f * kPi / segments, sines.data(), cosines.data());
+
+	uint32_t* index = indices;
+
+	for (int cap = 0; cap < 2; cap++)
+	{
+		float side = cap == 0 ? 1.0f : -1.0f;
+		uint32_t center = baseVertex + cap * (segments + 1);
+		Vertex* capVertices = vertices + cap * (segments + 1);
+
+		capVertices[0].pos = glm::vec3(0.0f, side * desc.height * 0.5f, 0.0f);
+		capVertices[0].texCoords = glm::vec2(0.5f);
+
+		for (uint32_t s = 0; s < segments; s++)
+		{
+			capVertices[s + 1].pos = glm::vec3(desc.radius * cosines[s], side * desc.height * 0.5f, desc.radius * sines[s]);
+			capVertices[s + 1].texCoords = glm::vec2(0.5f + 0.5f * cosines[s], 0.5f + 0.5f * side * sines[s]);
+		}
+
+		for (uint32_t s = 0; s <= segments; s++)
+		{
+			capVertices[s].normal = glm::vec3(0.0f, side, 0.0f);
+			capVertices[s].color = glm::vec3(1.0f);
+			capVertices[s].tangent = glm::vec4(0.0f);
+		}
+
+		// the bottom cap faces the other way, so its triangles run the other way round
+		for (uint32_t s = 0; s < segments; s++)
+		{
+			uint32_t current = center + 1 + s;
+			uint32_t next = center + 1 + (s + 1) % segments;
+
+			*index++ = center;
+			*index++ = cap == 0 ? current : next;
+			*index++ = cap == 0 ? next : current;
+		}
+	}
+}
+
+void ProceduralMesh::generatePlane(const ProceduralMeshDesc& desc, Vertex* vertices, uint32_t* indices)
+{
+	uint32_t columns = desc.segments + 1;
+
+	// on xz facing +y
+	for (uint32_t z = 0; z <= desc.rings; z++)
+	{
+		for (uint32_t x = 0; x <= desc.segments; x++)
+		{
+			float u = x / (float)desc.segments;
+			float v = z / (float)desc.rings;
+
+			Vertex& vertex = vertices[z * columns + x];
+			vertex.pos = glm::vec3((u - 0.5f) * desc.width, 0.0f, (v - 0.5f) * desc.depth);
+			vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+			vertex.color = glm::vec3(1.0f);
+			vertex.texCoords = glm::vec2(u, v);
+			vertex.tangent = glm::vec4(0.0f);
+		}
+	}
+
+	uint32_t* index = indices;
+
+	for (uint32_t z = 0; z < desc.rings; z++)
+	{
+		for (uint32_t x = 0; x < desc.segments; x++)
+		{
+			uint32_t i = z * columns + x;
+
+			*index++ = i;
+			*index++ = i + 1;
+			*index++ = i + columns;
+
+			*index++ = i + 1;
+			*index++ = i + columns + 1;
+			*index++ = i + columns;
+		}
+	}
+}
+
+// -- Icosphere
+
+// every face is its own triangular grid, so every face can unwrap u on its own side of the seam
+// edge points are computed from the two corners in index order, both faces get the same bits
+// and welding merges them wherever the uvs agree
+void ProceduralMesh::generateIcosphere(const ProceduralMeshDesc& desc, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const float t = 1.61803398874989485f;
+
+	const glm::vec3 corners[12] = {
+		glm::vec3(-1, t, 0), glm::vec3(1, t, 0), glm::vec3(-1, -t, 0), glm::vec3(1, -t, 0),
+		glm::vec3(0, -1, t), glm::vec3(0, 1, t), glm::vec3(0, -1, -t), glm::vec3(0, 1, -t),
+		glm::vec3(t, 0, -1), glm::vec3(t, 0, 1), glm::vec3(-t, 0, -1), glm::vec3(-t, 0, 1),
+	};
+
+	// clockwise seen from outside
+	const uint32_t faces[20][3] = {
+		{ 0, 5, 11 }, { 0, 1, 5 }, { 0, 7, 1 }, { 0, 10, 7 }, { 0, 11, 10 },
+		{ 1, 9, 5 }, { 5, 4, 11 }, { 11, 2, 10 }, { 10, 6, 7 }, { 7, 8, 1 },
+		{ 3, 4, 9 }, { 3, 2, 4 }, { 3, 6, 2 }, { 3, 8, 6 }, { 3, 9, 8 },
+		{ 4, 5, 9 }, { 2, 11, 4 }, { 6, 10, 2 }, { 8, 7, 6 }, { 9, 1, 8 },
+	};
+
+	uint32_t f = getIcosphereFrequency(desc);
+	uint32_t faceVertices = (f + 1) * (f + 2) / 2;
+
+	vertices.resize(getVertexCount(desc));
+	indices.resize(getIndexCount(desc));
+
+	// weight * corner summed in corner index order, divided once
+	auto gridPoint = [&](const uint32_t face[3], uint32_t weights[3]) -> glm::vec3
+	{
+		uint32_t order[3] = { 0, 1, 2 };
+		std::sort(order, order + 3, [&](uint32_t a, uint32_t b) { return face[a] < face[b]; });
+
+		glm::vec3 sum = glm::vec3(0.0f);
+		for (uint32_t k : order)
+		{
+			if (weights[k] != 0)
+			{
+				sum += corners[face[k]] * (float)weights[k];
+			}
+		}
+		return glm::normalize(sum / (float)f);
+	};
+
+	// row i walks from corner 0 towards corner 1, j towards corner 2
+	auto gridIndex = [&](uint32_t i, uint32_t j) -> uint32_t
+	{
+		return i * (f + 1) - i * (i - 1) / 2 + j;
+	};
+
+	uint32_t* index = indices.data();
+
+	for (uint32_t faceIndex = 0; faceIndex < 20; faceIndex++)
+	{
+		const uint32_t* face = faces[faceIndex];
+		Vertex* grid = vertices.data() + faceIndex * faceVertices;
+		uint32_t base = faceIndex * faceVertices;
+
+		glm::vec3 centroid = glm::normalize(corners[face[0]] + corners[face[1]] + corners[face[2]]);
+		float centroidU = std::atan2(centroid.z, centroid.x) / (2.0f * kPi);
+
+		for (uint32_t i = 0; i <= f; i++)
+		{
+			for (uint32_t j = 0; i + j <= f; j++)
+			{
+				uint32_t weights[3] = { f - i - j, i, j };
+				glm::vec3 normal = gridPoint(face, weights);
+
+				// same convention as the uv sphere, u around y and v from the top pole
+				float u = std::atan2(normal.z, normal.x) / (2.0f * kPi);
+				if (normal.x * normal.x + normal.z * normal.z < 1e-12f)
+				{
+					u = centroidU;
+				}
+				u += std::floor(centroidU - u + 0.5f);
+
+				Vertex& vertex = grid[gridIndex(i, j)];
+				vertex.pos = normal * desc.radius;
+				vertex.normal = normal;
+				vertex.color = glm::vec3(1.0f);
+				vertex.texCoords = glm::vec2(u, std::acos(glm::clamp(normal.y, -1.0f, 1.0f)) / kPi);
+				vertex.tangent = glm::vec4(0.0f);
+			}
+		}
+
+		// same orientation as the face itself
+		for (uint32_t i = 0; i < f; i++)
+		{
+			for (uint32_t j = 0; i + j < f; j++)
+			{
+				*index++ = base + gridIndex(i, j);
+				*index++ = base + gridIndex(i + 1, j);
+				*index++ = base + gridIndex(i, j + 1);
+
+				if (i + j + 1 < f)
+				{
+					*index++ = base + gridIndex(i + 1, j);
+					*index++ = base + gridIndex(i + 1, j + 1);
+					*index++ = base + gridIndex(i, j + 1);
+				}
+			}
+		}
+	}
+
+	// tangents are generated later per vertex, faces that don't share their edge vertices would shade faceted
+	MeshOptimizer::weldVertices(vertices, indices);
+}
+
+// -- Cache
+
+ProceduralMeshCache* ProceduralMeshCache::instance = NULL;
+
+ProceduralMeshCache* ProceduralMeshCache::getInstance()
+{
+	if (!instance)
+	{
+		instance = new ProceduralMeshCache();
+	}
+	return instance;
+}
+
+std::shared_ptr<const ProcessedMesh> ProceduralMeshCache::get(const ProceduralMeshDesc& desc)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto found = meshes.find(desc);
+		if (found != meshes.end())
+		{
+			hits++;
+			return found->second;
+		}
+	}
+
+	// built outside the lock so other shapes can load meanwhile
+	// two threads racing for the same shape both build it, the first one in wins
+	std::shared_ptr<ProcessedMesh> mesh = std::make_shared<ProcessedMesh>();
+	ProceduralMesh::generate(desc, mesh->vertices, mesh->indices);
+	MeshProcessing::process(*mesh);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	misses++;
+	return meshes.emplace(desc, mesh).first->second;
+}
+
+void ProceduralMeshCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	meshes.clear();
+}
+
+void ProceduralMeshCache::printStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::cout << "ProceduralMeshCache: " << meshes.size() << " meshes, " << hits << " hits, " << misses << " misses" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+
+#include "Mesh.h"
+#include "MeshProcessing.h"
+
+enum ProceduralShape
+{
+	kProceduralSphere = 0,
+	kProceduralIcosphere = 1,
+	kProceduralCapsule = 2,
+	kProceduralCylinder = 3,
+	kProceduralPlane = 4,
+	kProceduralTorus = 5
+};
+
+// everything a shape depends on, also the cache key
+// unused members stay zero so equal shapes always compare equal, use the static constructors
+struct ProceduralMeshDesc
+{
+	ProceduralShape shape;
+	float radius;			// torus: distance from the center to the middle of the tube
+	float tubeRadius;		// torus
+	float height;			// cylinder, capsule: length of the straight part along y
+	float width;			// plane, along x
+	float depth;			// plane, along z
+	uint32_t segments;		// around y, plane: along x
+	uint32_t rings;			// sphere: pole to pole, capsule: per cap, torus: around the tube, plane: along z
+	uint32_t subdivisions;	// icosphere
+
+	static ProceduralMeshDesc sphere(float radius, uint32_t segments, uint32_t rings);
+	static ProceduralMeshDesc icosphere(float radius, uint32_t subdivisions);
+	static ProceduralMeshDesc capsule(float radius, float height, uint32_t segments, uint32_t rings);
+	static ProceduralMeshDesc cylinder(float radius, float height, uint32_t segments);
+	static ProceduralMeshDesc plane(float width, float depth, uint32_t segmentsX, uint32_t segmentsZ);
+	static ProceduralMeshDesc torus(float radius, float tubeRadius, uint32_t segments, uint32_t tubeSegments);
+
+	bool operator==(const ProceduralMeshDesc& other) const;
+};
+
+struct ProceduralMeshDescHash
+{
+	size_t operator()(const ProceduralMeshDesc& desc) const;
+};
+
+// -- Procedural meshes
+// Clockwise front faces and outward normals like the rest of the engine, white vertex color.
+// The output is sized up front from getVertexCount / getIndexCount and written in place,
+// sines and cosines are computed once per row and column, four at a time with SSE2.
+class ProceduralMesh
+{
+public:
+	static void generate(const ProceduralMeshDesc& desc, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// icospheres are welded at the end, they come back with fewer vertices than this
+	static uint32_t getVertexCount(const ProceduralMeshDesc& desc);
+	static uint32_t getIndexCount(const ProceduralMeshDesc& desc);
+
+	// sines[i] and cosines[i] of start + step * i
+	static void computeSinCos(uint32_t count, float start, float step, float* sines, float* cosines);
+
+private:
+	// one row of a surface of revolution around y
+	struct LatheRow
+	{
+		float radius;
+		float y;
+		glm::vec2 normal;	// radial, y
+		float v;
+	};
+
+	static void generateLathe(const std::vector<LatheRow>& rows, uint32_t segments, Vertex* vertices, uint32_t* indices, uint32_t baseVertex);
+	static uint32_t getLatheIndexCount(const std::vector<LatheRow>& rows, uint32_t segments);
+	static void getLatheRows(const ProceduralMeshDesc& desc, std::vector<LatheRow>& rows);
+
+	static void generateIcosphere(const ProceduralMeshDesc& desc, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	static void generatePlane(const ProceduralMeshDesc& desc, Vertex* vertices, uint32_t* indices);
+	static void generateCylinderCaps(const ProceduralMeshDesc& desc, Vertex* vertices, uint32_t* indices, uint32_t baseVertex);
+};
+
+// -- Procedural mesh cache
+// Processed meshes ( tangents, optimization, meshlets, LODs, packed streams ) by their parameters,
+// every object asking for the same shape shares one result instead of building it again.
+// Safe to use from several loading threads.
+class ProceduralMeshCache
+{
+public:
+	static ProceduralMeshCache* getInstance();
+	static ProceduralMeshCache* instance;
+
+	std::shared_ptr<const ProcessedMesh> get(const ProceduralMeshDesc& desc);
+
+	// drops the cache's references, meshes still in use stay alive with their users
+	void clear();
+	void printStats();
+
+private:
+	std::mutex mutex;
+	std::unordered_map<ProceduralMeshDesc, std::shared_ptr<const ProcessedMesh>, ProceduralMeshDescHash> meshes;
+
+	uint32_t hits = 0;
+	uint32_t misses = 0;
+};
\ No newline at end of file
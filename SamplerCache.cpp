@@ -0,0 +1,122 @@
+#include "SamplerCache.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "VulkanContext.h"
+
+SamplerKey::SamplerKey(const VkSamplerCreateInfo& info)
+{
+	words[0] = info.flags;
+	words[1] = info.magFilter;
+	words[2] = info.minFilter;
+	words[3] = info.mipmapMode;
+	words[4] = info.addressModeU;
+	words[5] = info.addressModeV;
+	words[6] = info.addressModeW;
+	memcpy(&words[7], &info.mipLodBias, 4);
+	words[8] = info.anisotropyEnable;
+	memcpy(&words[9], &info.maxAnisotropy, 4);
+	words[10] = info.compareEnable;
+	words[11] = info.compareOp;
+	memcpy(&words[12], &info.minLod, 4);
+	memcpy(&words[13], &info.maxLod, 4);
+	// the border color and unnormalizedCoordinates share the last word
+	words[14] = info.borderColor | (info.unnormalizedCoordinates << 16);
+}
+
+bool SamplerKey::operator==(const SamplerKey& other) const
+{
+	return memcmp(words, other.words, sizeof(words)) == 0;
+}
+
+size_t SamplerKeyHash::operator()(const SamplerKey& key) const
+{
+	// FNV-1a over the words
+	uint32_t hash = 2166136261u;
+	for (uint32_t word : key.words)
+	{
+		hash = (hash ^ word) * 16777619u;
+	}
+	return hash;
+}
+
+SamplerCache::SamplerCache()
+{ }
+
+SamplerCache::~SamplerCache()
+{ }
+
+VkSampler SamplerCache::getSampler(const VkSamplerCreateInfo& info)
+{
+	if (info.pNext != nullptr)
+	{
+		throw std::runtime_error("the sampler cache doesn't take pNext chains!");
+	}
+
+	SamplerKey key(info);
+
+	auto found = samplers.find(key);
+	if (found != samplers.end())
+	{
+		return found->second;
+	}
+
+	VkSampler sampler;
+	if (vkCreateSampler(VulkanContext::getInstance()->getDevice()->logicalDevice, &info, nullptr, &sampler) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create sampler!");
+	}
+
+	samplers.emplace(key, sampler);
+	return sampler;
+}
+
+VkSampler SamplerCache::getTrilinearSampler()
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(VulkanContext::getInstance()->getDevice()->physicalDevice, &properties);
+
+	// the device is only picked when it has samplerAnisotropy
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.anisotropyEnable = VK_TRUE;
+	samplerInfo.maxAnisotropy = std::min(16.0f, properties.limits.maxSamplerAnisotropy);
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	return getSampler(samplerInfo);
+}
+
+VkSampler SamplerCache::getPointClampSampler()
+{
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	return getSampler(samplerInfo);
+}
+
+void SamplerCache::destroy()
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	for (auto& entry : samplers)
+	{
+		vkDestroySampler(logicalDevice, entry.second, nullptr);
+	}
+
+	samplers.clear();
+}
\ No newline at end of file
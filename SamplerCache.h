@@ -0,0 +1,45 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <unordered_map>
+
+// the members of a VkSamplerCreateInfo that make two samplers different, floats as their bits
+struct SamplerKey
+{
+	uint32_t words[15];
+
+	explicit SamplerKey(const VkSamplerCreateInfo& info);
+	bool operator==(const SamplerKey& other) const;
+};
+
+struct SamplerKeyHash
+{
+	size_t operator()(const SamplerKey& key) const;
+};
+
+// -- Sampler cache
+// Every sampler of the engine comes from here and lives until destroy, one per distinct create info,
+// so a handful covers every texture. Samplers that don't change per draw are meant to go into
+// descriptor set layouts as immutable samplers, writes for those bindings then only carry the view.
+// Owned by VulkanContext, destroyed before the device.
+class SamplerCache
+{
+public:
+	SamplerCache();
+	~SamplerCache();
+
+	// pNext chains aren't part of the key and throw
+	VkSampler getSampler(const VkSamplerCreateInfo& info);
+
+	// the two the engine uses, maxLod is unclamped so one sampler fits any mip count
+	// trilinear with up to 16x anisotropy and repeat, for material textures
+	VkSampler getTrilinearSampler();
+	// nearest everything and clamp to edge, for texelFetch and data that must not be blended
+	VkSampler getPointClampSampler();
+
+	uint32_t getSamplerCount() const { return static_cast<uint32_t>(samplers.size()); }
+
+	void destroy();
+
+private:
+	std::unordered_map<SamplerKey, VkSampler, SamplerKeyHash> samplers;
+};
\ No newline at end of file
@@ -0,0 +1,39 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout (binding = 0) uniform UniformBufferOBject
+{
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+// CompactVertex or the position / attribute streams, the fixed function fetch expands half, snorm and unorm to float
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec4 inTangentFrame;
+layout(location = 2) in vec4 inColor;
+layout(location = 3) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+
+// same as VertexPacking::unpackTangentFrame, for when lighting or normal mapping needs the frame
+vec3 quatRotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void decodeTangentFrame(vec4 q, out vec3 normal, out vec3 tangent, out vec3 bitangent)
+{
+    q = normalize(q);
+    normal = quatRotate(q, vec3(0.0, 0.0, 1.0));
+    tangent = quatRotate(q, vec3(1.0, 0.0, 0.0));
+    bitangent = (q.w < 0.0 ? -1.0 : 1.0) * cross(normal, tangent);
+}
+
+void main()
+{
+    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition.xyz, 1.0);
+    fragColor = inColor.rgb;
+    fragTexCoord = inTexCoord;
+}
\ No newline at end of file
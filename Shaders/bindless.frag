@@ -0,0 +1,18 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (set = 1, binding = 0) uniform sampler trilinear;
+layout (set = 1, binding = 1) uniform texture2D textures[];
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragTextureIndex;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    // instances of one draw can use different textures, the index isn't uniform across the draw
+    outColor = texture(sampler2D(textures[nonuniformEXT(fragTextureIndex)], trilinear), fragTexCoord) * vec4(fragColor, 1.0f);
+}
\ No newline at end of file
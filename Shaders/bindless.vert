@@ -0,0 +1,55 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+// set 0 is the MeshPool set, set 1 the BindlessResources set
+layout (set = 0, binding = 0) uniform UniformBufferOBject
+{
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+// CompactVertex, 6 words each, see VertexFormat.h
+layout (std430, set = 0, binding = 1) readonly buffer VertexBuffer
+{
+    uint words[];
+} vertexData;
+
+// BindlessInstance in BindlessResources.h
+struct BindlessInstance
+{
+    mat4 model;
+    uint textureIndex;
+    uint padding[3];
+};
+
+layout (std430, set = 1, binding = 2) readonly buffer InstanceBuffer
+{
+    BindlessInstance instances[];
+} instanceBuffers[];
+
+layout (push_constant) uniform DrawConstants
+{
+    uint instanceBuffer;
+} draw;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragTextureIndex;
+
+void main()
+{
+    // gl_InstanceIndex includes the draw's firstInstance, the record of this instance
+    BindlessInstance instance = instanceBuffers[draw.instanceBuffer].instances[gl_InstanceIndex];
+
+    // words: pos.xy, pos.zw halves, tangent frame quaternion snorm16 x4, color unorm8 x4, uv halves
+    uint base = uint(gl_VertexIndex) * 6;
+    vec2 posXY = unpackHalf2x16(vertexData.words[base + 0]);
+    vec2 posZW = unpackHalf2x16(vertexData.words[base + 1]);
+    vec4 color = unpackUnorm4x8(vertexData.words[base + 4]);
+
+    gl_Position = ubo.proj * ubo.view * instance.model * vec4(posXY, posZW.x, 1.0);
+    fragColor = color.rgb;
+    fragTexCoord = unpackHalf2x16(vertexData.words[base + 5]);
+    fragTextureIndex = instance.textureIndex;
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Crowd agents animated from vertex animation textures, see VertexAnimation.h.
+// Two baked frames are fetched for the vertex and blended, then placed by the instance.
+
+const uint kTextureWidth = 2048; // kVertexAnimationTextureWidth
+const uint kMaxClips = 64;       // kMaxCrowdClips
+
+// VertexAnimationClip
+struct CrowdClip
+{
+    uint firstFrame;
+    uint frameCount;
+    float frameRate;
+    float duration;
+};
+
+layout (push_constant) uniform CrowdConstants
+{
+    mat4 viewProj;
+    float time;
+    uint vertexCount;
+} crowd;
+
+layout (binding = 0) uniform Clips
+{
+    CrowdClip clips[kMaxClips];
+};
+
+layout (binding = 1) uniform sampler2D positions;
+layout (binding = 2) uniform sampler2D normals;
+
+// CrowdInstance
+layout(location = 0) in vec4 inPositionScale;
+layout(location = 1) in float inHeading;
+layout(location = 2) in uint inClip;
+layout(location = 3) in float inTimeOffset;
+layout(location = 4) in float inPlaybackRate;
+layout(location = 5) in vec4 inColor;
+
+layout(location = 0) out vec3 fragColor;
+
+ivec2 texelOf(uint frame)
+{
+    uint texel = frame * crowd.vertexCount + uint(gl_VertexIndex);
+    return ivec2(texel % kTextureWidth, texel / kTextureWidth);
+}
+
+void main()
+{
+    CrowdClip clip = clips[inClip];
+
+    float time = max(crowd.time * inPlaybackRate + inTimeOffset, 0.0);
+    float frame = clip.duration > 0.0 ? mod(time, clip.duration) * clip.frameRate : 0.0;
+
+    uint frame0 = min(uint(frame), clip.frameCount - 2);
+    float blend = clamp(frame - float(frame0), 0.0, 1.0);
+
+    ivec2 texel0 = texelOf(clip.firstFrame + frame0);
+    ivec2 texel1 = texelOf(clip.firstFrame + frame0 + 1);
+
+    vec3 position = mix(texelFetch(positions, texel0, 0).xyz, texelFetch(positions, texel1, 0).xyz, blend);
+    vec3 normal = normalize(mix(texelFetch(normals, texel0, 0).xyz, texelFetch(normals, texel1, 0).xyz, blend));
+
+    // heading around +y, the same rotation CrowdRenderer culls with
+    float s = sin(inHeading);
+    float c = cos(inHeading);
+    mat3 rotation = mat3(c, 0.0, -s, 0.0, 1.0, 0.0, s, 0.0, c);
+
+    vec3 world = rotation * position * inPositionScale.w + inPositionScale.xyz;
+    gl_Position = crowd.viewProj * vec4(world, 1.0);
+
+    // one fixed light, enough to read the animation
+    float light = max(dot(rotation * normal, normalize(vec3(0.4, 1.0, 0.3))), 0.0);
+    fragColor = inColor.rgb * (0.3 + 0.7 * light);
+}
\ No newline at end of file
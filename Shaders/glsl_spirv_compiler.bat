@@ -1,3 +1,3 @@
 @echo off
 echo compiling glsl shaders to spirv 
-for /r %%i in (*.vert;*.frag) do %VULKAN_SDK%\Bin32\glslangValidator.exe -V "%%i" -o  "%%~dpiSPIRV\%%~nxi".spv
\ No newline at end of file
+for /r %%i in (*.vert;*.frag;*.comp) do %VULKAN_SDK%\Bin32\glslangValidator.exe -V "%%i" -o  "%%~dpiSPIRV\%%~nxi".spv
\ No newline at end of file
@@ -0,0 +1,35 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout (binding = 0) uniform UniformBufferOBject
+{
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+// CompactVertex, 6 words each, see VertexFormat.h
+layout (std430, binding = 1) readonly buffer VertexBuffer
+{
+    uint words[];
+} vertexData;
+
+layout (push_constant) uniform DrawConstants
+{
+    mat4 model;
+} draw;
+
+layout(location = 0) out vec3 fragColor;
+
+void main()
+{
+    // gl_VertexIndex already includes the draw's vertexOffset, the mesh base inside MeshPool
+    uint base = uint(gl_VertexIndex) * 6;
+
+    // words: pos.xy, pos.zw halves, tangent frame quaternion snorm16 x4, color unorm8 x4, uv halves
+    vec2 posXY = unpackHalf2x16(vertexData.words[base + 0]);
+    vec2 posZW = unpackHalf2x16(vertexData.words[base + 1]);
+    vec4 color = unpackUnorm4x8(vertexData.words[base + 4]);
+
+    gl_Position = ubo.proj * ubo.view * draw.model * vec4(posXY, posZW.x, 1.0);
+    fragColor = color.rgb;
+}
\ No newline at end of file
@@ -0,0 +1,492 @@
+#include "Skeleton.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SKELETON_SSE2
+#include <emmintrin.h>
+#endif
+
+// -- Pose
+
+void Pose::resize(uint32_t count)
+{
+	jointCount = count;
+	groups.resize((count + 3) / 4);
+
+	for (JointTransforms4& group : groups)
+	{
+		for (int lane = 0; lane < 4; lane++)
+		{
+			group.rotationX[lane] = 0.0f;
+			group.rotationY[lane] = 0.0f;
+			group.rotationZ[lane] = 0.0f;
+			group.rotationW[lane] = 1.0f;
+			group.translationX[lane] = 0.0f;
+			group.translationY[lane] = 0.0f;
+			group.translationZ[lane] = 0.0f;
+			group.scaleX[lane] = 1.0f;
+			group.scaleY[lane] = 1.0f;
+			group.scaleZ[lane] = 1.0f;
+		}
+	}
+}
+
+void Pose::setJoint(uint32_t joint, const glm::quat& rotation, const glm::vec3& translation, const glm::vec3& scale)
+{
+	JointTransforms4& group = groups[joint / 4];
+	uint32_t lane = joint % 4;
+
+	group.rotationX[lane] = rotation.x;
+	group.rotationY[lane] = rotation.y;
+	group.rotationZ[lane] = rotation.z;
+	group.rotationW[lane] = rotation.w;
+	group.translationX[lane] = translation.x;
+	group.translationY[lane] = translation.y;
+	group.translationZ[lane] = translation.z;
+	group.scaleX[lane] = scale.x;
+	group.scaleY[lane] = scale.y;
+	group.scaleZ[lane] = scale.z;
+}
+
+void Pose::getJoint(uint32_t joint, glm::quat& rotation, glm::vec3& translation, glm::vec3& scale) const
+{
+	const JointTransforms4& group = groups[joint / 4];
+	uint32_t lane = joint % 4;
+
+	rotation = glm::quat(group.rotationW[lane], group.rotationX[lane], group.rotationY[lane], group.rotationZ[lane]);
+	translation = glm::vec3(group.translationX[lane], group.translationY[lane], group.translationZ[lane]);
+	scale = glm::vec3(group.scaleX[lane], group.scaleY[lane], group.scaleZ[lane]);
+}
+
+// -- Skeleton
+
+Skeleton::Skeleton()
+{ }
+
+Skeleton::~Skeleton()
+{ }
+
+void Skeleton::create(const std::vector<JointDesc>& joints)
+{
+	uint32_t count = static_cast<uint32_t>(joints.size());
+
+	std::vector<std::vector<uint32_t>> children(count);
+	std::vector<uint32_t> roots;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		int32_t parent = joints[i].parent;
+
+		if (parent < -1 || parent >= (int32_t)count || parent == (int32_t)i)
+		{
+			throw std::runtime_error("skeleton: joint " + joints[i].name + " has a bad parent");
+		}
+
+		if (parent < 0)
+		{
+			roots.push_back(i);
+		}
+		else
+		{
+			children[parent].push_back(i);
+		}
+	}
+
+	// breadth first, so the joints down to any depth are a prefix of the skeleton
+	// and animation LOD can leave out the deep ones by evaluating fewer joints
+	std::vector<uint32_t> order(roots);
+	order.reserve(count);
+
+	std::vector<uint32_t> depths(count, 0);
+
+	for (size_t next = 0; next < order.size(); next++)
+	{
+		uint32_t joint = order[next];
+
+		for (uint32_t child : children[joint])
+		{
+			depths[child] = depths[joint] + 1;
+			order.push_back(child);
+		}
+	}
+
+	// a cycle is never reached from a root
+	if (order.size() != count)
+	{
+		throw std::runtime_error("skeleton: joint hierarchy has a cycle");
+	}
+
+	// a depth's count is every joint at it and above, the last entry is the whole skeleton
+	depthJointCounts.clear();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t depth = depths[order[i]];
+		if (depth >= depthJointCounts.size())
+		{
+			depthJointCounts.resize(depth + 1, i);
+		}
+		depthJointCounts[depth] = i + 1;
+	}
+
+	sourceToJoint.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		sourceToJoint[order[i]] = i;
+	}
+
+	names.resize(count);
+	parents.resize(count);
+	inverseBindMatrices.resize(count);
+	bindPose.resize(count);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const JointDesc& joint = joints[order[i]];
+
+		names[i] = joint.name;
+		parents[i] = joint.parent < 0 ? -1 : (int32_t)sourceToJoint[joint.parent];
+		inverseBindMatrices[i] = joint.inverseBind;
+		bindPose.setJoint(i, joint.rotation, joint.translation, joint.scale);
+	}
+}
+
+uint32_t Skeleton::getJointCountToDepth(uint32_t depth) const
+{
+	if (depthJointCounts.empty())
+	{
+		return 0;
+	}
+
+	return depthJointCounts[std::min<size_t>(depth, depthJointCounts.size() - 1)];
+}
+
+int32_t Skeleton::findJoint(const std::string& name) const
+{
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		if (names[i] == name)
+		{
+			return (int32_t)i;
+		}
+	}
+	return -1;
+}
+
+// -- Pose blending
+
+#ifdef SKELETON_SSE2
+
+static inline __m128 lerp4(__m128 a, __m128 b, __m128 weight)
+{
+	return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), weight));
+}
+
+// out = a + (b - a) * weight per lane
+static inline void lerpLanes(const float* a, const float* b, const float* weights, float* out)
+{
+	_mm_storeu_ps(out, lerp4(_mm_loadu_ps(a), _mm_loadu_ps(b), _mm_loadu_ps(weights)));
+}
+
+// rotations of a and b blended by one weight per lane, b flipped onto a's hemisphere
+static inline void blendRotations(const JointTransforms4& a, const JointTransforms4& b, const float* weights, bool constantRate, JointTransforms4& out)
+{
+	__m128 weight = _mm_loadu_ps(weights);
+
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+
+	__m128 ax = _mm_loadu_ps(a.rotationX), ay = _mm_loadu_ps(a.rotationY), az = _mm_loadu_ps(a.rotationZ), aw = _mm_loadu_ps(a.rotationW);
+	__m128 bx = _mm_loadu_ps(b.rotationX), by = _mm_loadu_ps(b.rotationY), bz = _mm_loadu_ps(b.rotationZ), bw = _mm_loadu_ps(b.rotationW);
+
+	__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+	__m128 flip = _mm_and_ps(dot, signMask);
+
+	bx = _mm_xor_ps(bx, flip);
+	by = _mm_xor_ps(by, flip);
+	bz = _mm_xor_ps(bz, flip);
+	bw = _mm_xor_ps(bw, flip);
+
+	if (constantRate)
+	{
+		// the weight correction from "Approximating slerp" (Kapoulkine), fitted against the angle between a and b
+		__m128 d = _mm_andnot_ps(signMask, dot);
+		__m128 half = _mm_sub_ps(weight, _mm_set1_ps(0.5f));
+
+		__m128 factorA = _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(d, _mm_set1_ps(1.43519f)));
+		factorA = _mm_add_ps(_mm_set1_ps(-3.2452f), _mm_mul_ps(d, factorA));
+		factorA = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d, factorA));
+
+		__m128 factorB = _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(d, _mm_set1_ps(0.215638f)));
+		factorB = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d, factorB));
+
+		__m128 k = _mm_add_ps(_mm_mul_ps(factorA, _mm_mul_ps(half, half)), factorB);
+		__m128 bend = _mm_mul_ps(_mm_mul_ps(weight, half), _mm_sub_ps(weight, _mm_set1_ps(1.0f)));
+		weight = _mm_add_ps(weight, _mm_mul_ps(bend, k));
+	}
+
+	__m128 x = lerp4(ax, bx, weight);
+	__m128 y = lerp4(ay, by, weight);
+	__m128 z = lerp4(az, bz, weight);
+	__m128 w = lerp4(aw, bw, weight);
+
+	__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w))));
+	__m128 inverseLength = _mm_div_ps(_mm_set1_ps(1.0f), length);
+
+	_mm_storeu_ps(out.rotationX, _mm_mul_ps(x, inverseLength));
+	_mm_storeu_ps(out.rotationY, _mm_mul_ps(y, inverseLength));
+	_mm_storeu_ps(out.rotationZ, _mm_mul_ps(z, inverseLength));
+	_mm_storeu_ps(out.rotationW, _mm_mul_ps(w, inverseLength));
+}
+
+#else
+
+static inline void lerpLanes(const float* a, const float* b, const float* weights, float* out)
+{
+	for (int lane = 0; lane < 4; lane++)
+	{
+		out[lane] = a[lane] + (b[lane] - a[lane]) * weights[lane];
+	}
+}
+
+static inline void blendRotations(const JointTransforms4& a, const JointTransforms4& b, const float* weights, bool constantRate, JointTransforms4& out)
+{
+	for (int lane = 0; lane < 4; lane++)
+	{
+		float ax = a.rotationX[lane], ay = a.rotationY[lane], az = a.rotationZ[lane], aw = a.rotationW[lane];
+		float bx = b.rotationX[lane], by = b.rotationY[lane], bz = b.rotationZ[lane], bw = b.rotationW[lane];
+
+		float dot = ax * bx + ay * by + az * bz + aw * bw;
+		if (dot < 0.0f)
+		{
+			bx = -bx;
+			by = -by;
+			bz = -bz;
+			bw = -bw;
+		}
+
+		float weight = weights[lane];
+
+		if (constantRate)
+		{
+			// same correction as the SSE2 path
+			float d = std::fabs(dot);
+			float half = weight - 0.5f;
+			float factorA = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+			float factorB = 0.848013f + d * (-1.06021f + d * 0.215638f);
+			float k = factorA * half * half + factorB;
+			weight += weight * half * (weight - 1.0f) * k;
+		}
+
+		float x = ax + (bx - ax) * weight;
+		float y = ay + (by - ay) * weight;
+		float z = az + (bz - az) * weight;
+		float w = aw + (bw - aw) * weight;
+		float inverseLength = 1.0f / std::sqrt(x * x + y * y + z * z + w * w);
+
+		out.rotationX[lane] = x * inverseLength;
+		out.rotationY[lane] = y * inverseLength;
+		out.rotationZ[lane] = z * inverseLength;
+		out.rotationW[lane] = w * inverseLength;
+	}
+}
+
+#endif
+
+static void blendPoses(const Pose& a, const Pose& b, float weight, bool constantRate, Pose& out)
+{
+	if (a.jointCount != b.jointCount)
+	{
+		throw std::runtime_error("pose blending: poses of different skeletons");
+	}
+
+	if (out.jointCount != a.jointCount)
+	{
+		out.resize(a.jointCount);
+	}
+
+	float weights[4] = { weight, weight, weight, weight };
+
+	for (size_t i = 0; i < a.groups.size(); i++)
+	{
+		const JointTransforms4& groupA = a.groups[i];
+		const JointTransforms4& groupB = b.groups[i];
+		JointTransforms4& result = out.groups[i];
+
+		blendRotations(groupA, groupB, weights, constantRate, result);
+
+		lerpLanes(groupA.translationX, groupB.translationX, weights, result.translationX);
+		lerpLanes(groupA.translationY, groupB.translationY, weights, result.translationY);
+		lerpLanes(groupA.translationZ, groupB.translationZ, weights, result.translationZ);
+		lerpLanes(groupA.scaleX, groupB.scaleX, weights, result.scaleX);
+		lerpLanes(groupA.scaleY, groupB.scaleY, weights, result.scaleY);
+		lerpLanes(groupA.scaleZ, groupB.scaleZ, weights, result.scaleZ);
+	}
+}
+
+void PoseBlending::nlerpGroup(const JointTransforms4& a, const JointTransforms4& b, const float* rotationWeights, const float* translationWeights, const float* scaleWeights, JointTransforms4& out)
+{
+	blendRotations(a, b, rotationWeights, false, out);
+
+	lerpLanes(a.translationX, b.translationX, translationWeights, out.translationX);
+	lerpLanes(a.translationY, b.translationY, translationWeights, out.translationY);
+	lerpLanes(a.translationZ, b.translationZ, translationWeights, out.translationZ);
+
+	lerpLanes(a.scaleX, b.scaleX, scaleWeights, out.scaleX);
+	lerpLanes(a.scaleY, b.scaleY, scaleWeights, out.scaleY);
+	lerpLanes(a.scaleZ, b.scaleZ, scaleWeights, out.scaleZ);
+}
+
+void PoseBlending::nlerp(const Pose& a, const Pose& b, float weight, Pose& out)
+{
+	blendPoses(a, b, weight, false, out);
+}
+
+void PoseBlending::slerp(const Pose& a, const Pose& b, float weight, Pose& out)
+{
+	blendPoses(a, b, weight, true, out);
+}
+
+// out = a * b, column major like glm
+static inline void multiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#ifdef SKELETON_SSE2
+	__m128 a0 = _mm_loadu_ps(&a[0][0]);
+	__m128 a1 = _mm_loadu_ps(&a[1][0]);
+	__m128 a2 = _mm_loadu_ps(&a[2][0]);
+	__m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+	for (int column = 0; column < 4; column++)
+	{
+		__m128 result = _mm_mul_ps(a0, _mm_set1_ps(b[column][0]));
+		result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(b[column][1])));
+		result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(b[column][2])));
+		result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(b[column][3])));
+		_mm_storeu_ps(&out[column][0], result);
+	}
+#else
+	out = a * b;
+#endif
+}
+
+void PoseBlending::localToModel(const Skeleton& skeleton, const Pose& pose, std::vector<glm::mat4>& model)
+{
+	uint32_t jointCount = skeleton.getJointCount();
+	model.resize(jointCount);
+
+#ifdef SKELETON_SSE2
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+#endif
+
+	for (uint32_t groupIndex = 0; groupIndex * 4 < jointCount; groupIndex++)
+	{
+		const JointTransforms4& group = pose.groups[groupIndex];
+
+		// rotation and scale to the upper 3x3 for four joints, [column * 3 + row][lane]
+		float basis[9][4];
+
+#ifdef SKELETON_SSE2
+		__m128 x = _mm_loadu_ps(group.rotationX), y = _mm_loadu_ps(group.rotationY), z = _mm_loadu_ps(group.rotationZ), w = _mm_loadu_ps(group.rotationW);
+		__m128 sx = _mm_loadu_ps(group.scaleX), sy = _mm_loadu_ps(group.scaleY), sz = _mm_loadu_ps(group.scaleZ);
+
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+		_mm_storeu_ps(basis[0], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx));
+		_mm_storeu_ps(basis[1], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx));
+		_mm_storeu_ps(basis[2], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx));
+		_mm_storeu_ps(basis[3], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy));
+		_mm_storeu_ps(basis[4], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy));
+		_mm_storeu_ps(basis[5], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy));
+		_mm_storeu_ps(basis[6], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz));
+		_mm_storeu_ps(basis[7], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz));
+		_mm_storeu_ps(basis[8], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz));
+#else
+		for (int lane = 0; lane < 4; lane++)
+		{
+			float x = group.rotationX[lane], y = group.rotationY[lane], z = group.rotationZ[lane], w = group.rotationW[lane];
+			float sx = group.scaleX[lane], sy = group.scaleY[lane], sz = group.scaleZ[lane];
+
+			basis[0][lane] = (1.0f - 2.0f * (y * y + z * z)) * sx;
+			basis[1][lane] = 2.0f * (x * y + w * z) * sx;
+			basis[2][lane] = 2.0f * (x * z - w * y) * sx;
+			basis[3][lane] = 2.0f * (x * y - w * z) * sy;
+			basis[4][lane] = (1.0f - 2.0f * (x * x + z * z)) * sy;
+			basis[5][lane] = 2.0f * (y * z + w * x) * sy;
+			basis[6][lane] = 2.0f * (x * z + w * y) * sz;
+			basis[7][lane] = 2.0f * (y * z - w * x) * sz;
+			basis[8][lane] = (1.0f - 2.0f * (x * x + y * y)) * sz;
+		}
+#endif
+
+		uint32_t laneCount = std::min(4u, jointCount - groupIndex * 4);
+
+		for (uint32_t lane = 0; lane < laneCount; lane++)
+		{
+			uint32_t joint = groupIndex * 4 + lane;
+			int32_t parent = skeleton.parents[joint];
+			float* out = &model[joint][0][0];
+
+			if (parent < 0)
+			{
+				model[joint] = glm::mat4(
+					basis[0][lane], basis[1][lane], basis[2][lane], 0.0f,
+					basis[3][lane], basis[4][lane], basis[5][lane], 0.0f,
+					basis[6][lane], basis[7][lane], basis[8][lane], 0.0f,
+					group.translationX[lane], group.translationY[lane], group.translationZ[lane], 1.0f);
+				continue;
+			}
+
+			// parent * local without building local, its last row is always 0 0 0 1
+			const float* parentMatrix = &model[parent][0][0];
+
+#ifdef SKELETON_SSE2
+			__m128 p0 = _mm_loadu_ps(parentMatrix);
+			__m128 p1 = _mm_loadu_ps(parentMatrix + 4);
+			__m128 p2 = _mm_loadu_ps(parentMatrix + 8);
+			__m128 p3 = _mm_loadu_ps(parentMatrix + 12);
+
+			for (int column = 0; column < 3; column++)
+			{
+				__m128 result = _mm_mul_ps(p0, _mm_set1_ps(basis[column * 3][lane]));
+				result = _mm_add_ps(result, _mm_mul_ps(p1, _mm_set1_ps(basis[column * 3 + 1][lane])));
+				result = _mm_add_ps(result, _mm_mul_ps(p2, _mm_set1_ps(basis[column * 3 + 2][lane])));
+				_mm_storeu_ps(out + column * 4, result);
+			}
+
+			__m128 translation = _mm_mul_ps(p0, _mm_set1_ps(group.translationX[lane]));
+			translation = _mm_add_ps(translation, _mm_mul_ps(p1, _mm_set1_ps(group.translationY[lane])));
+			translation = _mm_add_ps(translation, _mm_mul_ps(p2, _mm_set1_ps(group.translationZ[lane])));
+			_mm_storeu_ps(out + 12, _mm_add_ps(translation, p3));
+#else
+			float local[4][3] = {
+				{ basis[0][lane], basis[1][lane], basis[2][lane] },
+				{ basis[3][lane], basis[4][lane], basis[5][lane] },
+				{ basis[6][lane], basis[7][lane], basis[8][lane] },
+				{ group.translationX[lane], group.translationY[lane], group.translationZ[lane] },
+			};
+
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					float value = parentMatrix[row] * local[column][0] + parentMatrix[4 + row] * local[column][1] + parentMatrix[8 + row] * local[column][2];
+					out[column * 4 + row] = column == 3 ? value + parentMatrix[12 + row] : value;
+				}
+			}
+#endif
+		}
+	}
+}
+
+void PoseBlending::getSkinningMatrices(const Skeleton& skeleton, const std::vector<glm::mat4>& model, std::vector<glm::mat4>& skinning)
+{
+	skinning.resize(model.size());
+
+	for (size_t i = 0; i < model.size(); i++)
+	{
+		multiplyMatrices(model[i], skeleton.inverseBindMatrices[i], skinning[i]);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "Dependencies\glm\glm\glm.hpp"
+#include <glm\gtc\quaternion.hpp>
+
+// four joints' local transforms, one lane per joint, so SSE works on four joints at a time
+struct JointTransforms4
+{
+	float rotationX[4];
+	float rotationY[4];
+	float rotationZ[4];
+	float rotationW[4];
+	float translationX[4];
+	float translationY[4];
+	float translationZ[4];
+	float scaleX[4];
+	float scaleY[4];
+	float scaleZ[4];
+};
+
+// local transforms of every joint of a skeleton, in skeleton order
+// the last group is padded with identity transforms
+struct Pose
+{
+	uint32_t jointCount = 0;
+	std::vector<JointTransforms4> groups;
+
+	void resize(uint32_t jointCount);
+
+	void setJoint(uint32_t joint, const glm::quat& rotation, const glm::vec3& translation, const glm::vec3& scale);
+	void getJoint(uint32_t joint, glm::quat& rotation, glm::vec3& translation, glm::vec3& scale) const;
+};
+
+// a joint as authored, parent indexes the same array, -1 for roots
+struct JointDesc
+{
+	std::string name;
+	int32_t parent;
+	glm::quat rotation;
+	glm::vec3 translation;
+	glm::vec3 scale;
+	glm::mat4 inverseBind;
+};
+
+// -- Skeleton
+// Joints are reordered so every parent comes before its children, building model space
+// transforms is then one pass front to back with no recursion or stack.
+// The order is by depth, roots first, so the first getJointCountToDepth(d) joints are
+// everything down to depth d.
+class Skeleton
+{
+public:
+	Skeleton();
+	~Skeleton();
+
+	// in skeleton order
+	std::vector<std::string> names;
+	std::vector<int32_t> parents;
+	std::vector<glm::mat4> inverseBindMatrices;
+	Pose bindPose;
+
+	// sourceToJoint[i] is where joints[i] of create() ended up
+	std::vector<uint32_t> sourceToJoint;
+
+	// joints down to each depth, roots are depth 0
+	std::vector<uint32_t> depthJointCounts;
+
+	// throws on cycles and out of range parents
+	void create(const std::vector<JointDesc>& joints);
+
+	uint32_t getJointCount() const { return static_cast<uint32_t>(parents.size()); }
+	int32_t findJoint(const std::string& name) const;
+
+	// depths past the deepest joint give the whole skeleton
+	uint32_t getJointCountToDepth(uint32_t depth) const;
+};
+
+// -- Pose blending
+// All of it on SoA poses, four joints per instruction.
+class PoseBlending
+{
+public:
+	// normalized lerp, rotations take the short way round
+	static void nlerp(const Pose& a, const Pose& b, float weight, Pose& out);
+
+	// nlerp with the weight bent so the rotation moves at a constant rate like slerp,
+	// no acos or sin, error against a real slerp stays under 0.002 radians
+	static void slerp(const Pose& a, const Pose& b, float weight, Pose& out);
+
+	// one group with a weight per lane and channel, the building block of the two above and of clip sampling
+	static void nlerpGroup(const JointTransforms4& a, const JointTransforms4& b, const float* rotationWeights, const float* translationWeights, const float* scaleWeights, JointTransforms4& out);
+
+	// parent before child, so model[parent] is always ready
+	static void localToModel(const Skeleton& skeleton, const Pose& pose, std::vector<glm::mat4>& model);
+
+	// model * inverse bind, what a skinning shader takes
+	static void getSkinningMatrices(const Skeleton& skeleton, const std::vector<glm::mat4>& model, std::vector<glm::mat4>& skinning);
+};
\ No newline at end of file
@@ -0,0 +1,462 @@
+#include "SoftwareOcclusion.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <cmath>
+
+// clip space w below this is treated as crossing the near plane
+static const float kMinW = 1e-5f;
+
+static inline __m128 transformPoint(const __m128 columns[4], const glm::vec3& p)
+{
+	__m128 result = _mm_mul_ps(columns[0], _mm_set1_ps(p.x));
+	result = _mm_add_ps(result, _mm_mul_ps(columns[1], _mm_set1_ps(p.y)));
+	result = _mm_add_ps(result, _mm_mul_ps(columns[2], _mm_set1_ps(p.z)));
+	return _mm_add_ps(result, columns[3]);
+}
+
+static inline void loadColumns(const glm::mat4& m, __m128 columns[4])
+{
+	for (int i = 0; i < 4; i++)
+	{
+		columns[i] = _mm_loadu_ps(&m[i][0]);
+	}
+}
+
+SoftwareOcclusion::SoftwareOcclusion()
+{ }
+
+SoftwareOcclusion::~SoftwareOcclusion()
+{ }
+
+void SoftwareOcclusion::create(uint32_t workerCount)
+{
+	depthBuffer.resize(kWidth * kHeight, 1.0f);
+	tileMaxDepth.resize(kTilesX * kTilesY, 1.0f);
+	tileBins.resize(kTilesX * kTilesY);
+
+	stats = {};
+
+	// the calling thread rasterizes too, so leave one core for it
+	if (workerCount == 0)
+	{
+		uint32_t cores = std::thread::hardware_concurrency();
+		workerCount = cores > 1 ? cores - 1 : 0;
+	}
+	workerCount = std::min(workerCount, kTilesX * kTilesY - 1);
+
+	workGeneration = 0;
+	workersDone = 0;
+	quit = false;
+	nextTile = 0;
+
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		workers.push_back(std::thread(&SoftwareOcclusion::workerLoop, this));
+	}
+}
+
+void SoftwareOcclusion::destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(workMutex);
+		quit = true;
+	}
+	workCondition.notify_all();
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+}
+
+void SoftwareOcclusion::beginFrame(Camera camera)
+{
+	viewProj = camera.getprojectionMatrix() * camera.getViewMatrix();
+
+	occluders.clear();
+	std::fill(depthBuffer.begin(), depthBuffer.end(), 1.0f);
+	std::fill(tileMaxDepth.begin(), tileMaxDepth.end(), 1.0f);
+
+	stats = {};
+}
+
+void SoftwareOcclusion::addOccluder(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, glm::mat4 model, uint32_t firstIndex, uint32_t indexCount)
+{
+	Occluder occluder;
+	occluder.vertices = &vertices;
+	occluder.indices = &indices;
+	occluder.firstIndex = firstIndex;
+	occluder.indexCount = indexCount > 0 ? indexCount : static_cast<uint32_t>(indices.size()) - firstIndex;
+	occluder.model = model;
+
+	occluders.push_back(occluder);
+}
+
+void SoftwareOcclusion::transformAndBin()
+{
+	triangles.clear();
+	for (auto& bin : tileBins)
+	{
+		bin.clear();
+	}
+
+	std::vector<glm::vec4> screenVertices;
+
+	for (const Occluder& occluder : occluders)
+	{
+		__m128 columns[4];
+		loadColumns(viewProj * occluder.model, columns);
+
+		// clip -> screen, w is kept to reject triangles crossing the near plane
+		const std::vector<Vertex>& vertices = *occluder.vertices;
+		screenVertices.resize(vertices.size());
+
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			alignas(16) float clip[4];
+			_mm_store_ps(clip, transformPoint(columns, vertices[i].pos));
+
+			if (clip[3] <= kMinW)
+			{
+				screenVertices[i] = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+				continue;
+			}
+
+			float invW = 1.0f / clip[3];
+			screenVertices[i].x = (clip[0] * invW * 0.5f + 0.5f) * kWidth;
+			screenVertices[i].y = (0.5f - clip[1] * invW * 0.5f) * kHeight;
+			screenVertices[i].z = clip[2] * invW;
+			screenVertices[i].w = 1.0f;
+		}
+
+		const std::vector<uint32_t>& indices = *occluder.indices;
+		const size_t lastIndex = occluder.firstIndex + occluder.indexCount;
+
+		for (size_t i = occluder.firstIndex; i + 2 < lastIndex; i += 3)
+		{
+			glm::vec4 v0 = screenVertices[indices[i]];
+			glm::vec4 v1 = screenVertices[indices[i + 1]];
+			glm::vec4 v2 = screenVertices[indices[i + 2]];
+
+			// dropping an occluder triangle only makes culling less aggressive, never wrong
+			if (v0.w < 0.0f || v1.w < 0.0f || v2.w < 0.0f)
+			{
+				continue;
+			}
+
+			float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+
+			if (std::abs(area) < 1e-6f)
+			{
+				continue;
+			}
+
+			// both windings are drawn, keep the area positive for the edge functions
+			if (area < 0.0f)
+			{
+				std::swap(v1, v2);
+			}
+
+			float minX = std::min(v0.x, std::min(v1.x, v2.x));
+			float maxX = std::max(v0.x, std::max(v1.x, v2.x));
+			float minY = std::min(v0.y, std::min(v1.y, v2.y));
+			float maxY = std::max(v0.y, std::max(v1.y, v2.y));
+
+			if (maxX < 0.0f || maxY < 0.0f || minX >= kWidth || minY >= kHeight)
+			{
+				continue;
+			}
+
+			ScreenTriangle triangle = {
+				{ v0.x, v1.x, v2.x },
+				{ v0.y, v1.y, v2.y },
+				{ v0.z, v1.z, v2.z }
+			};
+
+			uint32_t triangleIndex = static_cast<uint32_t>(triangles.size());
+			triangles.push_back(triangle);
+
+			int tileMinX = std::max(0, (int)minX / (int)kTileWidth);
+			int tileMaxX = std::min((int)kTilesX - 1, (int)maxX / (int)kTileWidth);
+			int tileMinY = std::max(0, (int)minY / (int)kTileHeight);
+			int tileMaxY = std::min((int)kTilesY - 1, (int)maxY / (int)kTileHeight);
+
+			for (int ty = tileMinY; ty <= tileMaxY; ty++)
+			{
+				for (int tx = tileMinX; tx <= tileMaxX; tx++)
+				{
+					tileBins[ty * kTilesX + tx].push_back(triangleIndex);
+				}
+			}
+		}
+	}
+
+	stats.occluderTriangles = static_cast<uint32_t>(triangles.size());
+}
+
+void SoftwareOcclusion::rasterizeTile(uint32_t tile)
+{
+	int tileX = (tile % kTilesX) * kTileWidth;
+	int tileY = (tile / kTilesX) * kTileHeight;
+
+	const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (uint32_t triangleIndex : tileBins[tile])
+	{
+		const ScreenTriangle& t = triangles[triangleIndex];
+
+		// edge functions E(p) = a * px + b * py + c, positive inside
+		float a[3], b[3], c[3];
+		for (int e = 0; e < 3; e++)
+		{
+			int n = (e + 1) % 3;
+			a[e] = -(t.y[n] - t.y[e]);
+			b[e] = t.x[n] - t.x[e];
+			c[e] = -(a[e] * t.x[e] + b[e] * t.y[e]);
+		}
+
+		// depth plane
+		float area = b[0] * (t.y[2] - t.y[0]) + a[0] * (t.x[2] - t.x[0]);
+		float dzdx = ((t.z[1] - t.z[0]) * (t.y[2] - t.y[0]) - (t.z[2] - t.z[0]) * (t.y[1] - t.y[0])) / area;
+		float dzdy = ((t.z[2] - t.z[0]) * (t.x[1] - t.x[0]) - (t.z[1] - t.z[0]) * (t.x[2] - t.x[0])) / area;
+
+		int minX = std::max(tileX, (int)std::floor(std::min(t.x[0], std::min(t.x[1], t.x[2]))));
+		int maxX = std::min(tileX + (int)kTileWidth - 1, (int)std::ceil(std::max(t.x[0], std::max(t.x[1], t.x[2]))));
+		int minY = std::max(tileY, (int)std::floor(std::min(t.y[0], std::min(t.y[1], t.y[2]))));
+		int maxY = std::min(tileY + (int)kTileHeight - 1, (int)std::ceil(std::max(t.y[0], std::max(t.y[1], t.y[2]))));
+
+		// tiles start on a multiple of 4 so aligning down stays inside the tile
+		minX &= ~3;
+
+		__m128 a0 = _mm_set1_ps(a[0]), a1 = _mm_set1_ps(a[1]), a2 = _mm_set1_ps(a[2]);
+		__m128 dzdxs = _mm_set1_ps(dzdx);
+
+		for (int y = minY; y <= maxY; y++)
+		{
+			float py = y + 0.5f;
+
+			__m128 rowE0 = _mm_set1_ps(b[0] * py + c[0]);
+			__m128 rowE1 = _mm_set1_ps(b[1] * py + c[1]);
+			__m128 rowE2 = _mm_set1_ps(b[2] * py + c[2]);
+			__m128 rowZ = _mm_set1_ps(t.z[0] + dzdy * (py - t.y[0]) - dzdx * t.x[0]);
+
+			float* row = &depthBuffer[y * kWidth];
+
+			for (int x = minX; x <= maxX; x += 4)
+			{
+				__m128 px = _mm_add_ps(_mm_set1_ps((float)x), pixelOffsets);
+
+				__m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), rowE0);
+				__m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), rowE1);
+				__m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), rowE2);
+
+				__m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+
+				if (_mm_movemask_ps(inside) == 0)
+				{
+					continue;
+				}
+
+				__m128 z = _mm_add_ps(_mm_mul_ps(dzdxs, px), rowZ);
+				__m128 depth = _mm_loadu_ps(row + x);
+				__m128 nearest = _mm_min_ps(depth, z);
+
+				depth = _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, depth));
+				_mm_storeu_ps(row + x, depth);
+			}
+		}
+	}
+
+	// farthest depth of the tile lets box tests reject whole tiles at once
+	__m128 tileMax = _mm_setzero_ps();
+	for (int y = tileY; y < tileY + (int)kTileHeight; y++)
+	{
+		for (int x = tileX; x < tileX + (int)kTileWidth; x += 4)
+		{
+			tileMax = _mm_max_ps(tileMax, _mm_loadu_ps(&depthBuffer[y * kWidth + x]));
+		}
+	}
+
+	alignas(16) float lanes[4];
+	_mm_store_ps(lanes, tileMax);
+	tileMaxDepth[tile] = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+}
+
+void SoftwareOcclusion::rasterizeTiles()
+{
+	const uint32_t tileCount = kTilesX * kTilesY;
+
+	for (uint32_t tile = nextTile++; tile < tileCount; tile = nextTile++)
+	{
+		rasterizeTile(tile);
+	}
+}
+
+void SoftwareOcclusion::workerLoop()
+{
+	uint64_t seenGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(workMutex);
+			workCondition.wait(lock, [&] { return quit || workGeneration != seenGeneration; });
+
+			if (quit)
+			{
+				return;
+			}
+			seenGeneration = workGeneration;
+		}
+
+		rasterizeTiles();
+
+		{
+			std::lock_guard<std::mutex> lock(workMutex);
+			workersDone++;
+		}
+		doneCondition.notify_one();
+	}
+}
+
+void SoftwareOcclusion::rasterizeOccluders()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	transformAndBin();
+
+	{
+		std::lock_guard<std::mutex> lock(workMutex);
+		nextTile = 0;
+		workersDone = 0;
+		workGeneration++;
+	}
+	workCondition.notify_all();
+
+	// the calling thread takes tiles as well
+	rasterizeTiles();
+
+	{
+		std::unique_lock<std::mutex> lock(workMutex);
+		doneCondition.wait(lock, [&] { return workersDone == workers.size(); });
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	stats.rasterizeMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+bool SoftwareOcclusion::isVisible(glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	stats.testedObjects++;
+
+	__m128 columns[4];
+	loadColumns(viewProj, columns);
+
+	float minX = (float)kWidth, maxX = 0.0f;
+	float minY = (float)kHeight, maxY = 0.0f;
+	float nearestZ = 1.0f;
+	bool crossesNearPlane = false;
+
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z);
+
+		alignas(16) float clip[4];
+		_mm_store_ps(clip, transformPoint(columns, corner));
+
+		if (clip[3] <= kMinW)
+		{
+			crossesNearPlane = true;
+			break;
+		}
+
+		float invW = 1.0f / clip[3];
+		float sx = (clip[0] * invW * 0.5f + 0.5f) * kWidth;
+		float sy = (0.5f - clip[1] * invW * 0.5f) * kHeight;
+
+		minX = std::min(minX, sx);
+		maxX = std::max(maxX, sx);
+		minY = std::min(minY, sy);
+		maxY = std::max(maxY, sy);
+		nearestZ = std::min(nearestZ, clip[2] * invW);
+	}
+
+	bool visible = true;
+
+	if (!crossesNearPlane)
+	{
+		if (maxX < 0.0f || maxY < 0.0f || minX >= kWidth || minY >= kHeight)
+		{
+			// off screen entirely
+			visible = false;
+		}
+		else
+		{
+			int x0 = std::max(0, (int)std::floor(minX)) & ~3;
+			int x1 = std::min((int)kWidth - 1, (int)std::ceil(maxX));
+			int y0 = std::max(0, (int)std::floor(minY));
+			int y1 = std::min((int)kHeight - 1, (int)std::ceil(maxY));
+
+			__m128 boxZ = _mm_set1_ps(nearestZ);
+			visible = false;
+
+			for (int ty = y0 / (int)kTileHeight; ty <= y1 / (int)kTileHeight && !visible; ty++)
+			{
+				for (int tx = x0 / (int)kTileWidth; tx <= x1 / (int)kTileWidth && !visible; tx++)
+				{
+					// every pixel of this tile is nearer than the box
+					if (nearestZ > tileMaxDepth[ty * kTilesX + tx])
+					{
+						continue;
+					}
+
+					int rowStart = std::max(y0, ty * (int)kTileHeight);
+					int rowEnd = std::min(y1, (ty + 1) * (int)kTileHeight - 1);
+					int colStart = std::max(x0, tx * (int)kTileWidth);
+					int colEnd = std::min(x1, (tx + 1) * (int)kTileWidth - 1);
+
+					for (int y = rowStart; y <= rowEnd && !visible; y++)
+					{
+						const float* row = &depthBuffer[y * kWidth];
+
+						for (int x = colStart; x <= colEnd; x += 4)
+						{
+							if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxZ)) != 0)
+							{
+								visible = true;
+								break;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (!visible)
+	{
+		stats.culledObjects++;
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	stats.testMs += std::chrono::duration<double, std::milli>(end - start).count();
+
+	return visible;
+}
+
+OcclusionStats SoftwareOcclusion::getStats()
+{
+	return stats;
+}
+
+void SoftwareOcclusion::printStats()
+{
+	std::cout << "Occlusion: " << stats.culledObjects << "/" << stats.testedObjects << " culled, "
+		<< stats.occluderTriangles << " occluder tris, raster " << stats.rasterizeMs << " ms, test " << stats.testMs << " ms" << std::endl;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include "Mesh.h"
+#include "Camera.h"
+
+struct OcclusionStats
+{
+	uint32_t occluderTriangles;
+	uint32_t testedObjects;
+	uint32_t culledObjects;
+	double rasterizeMs;
+	double testMs;
+};
+
+// CPU occlusion culling
+// A few occluder meshes are drawn into a small depth buffer each frame by worker threads,
+// SSE four pixels at a time. Bounding boxes are tested against it before draws are recorded,
+// no gpu readback and no frame of latency like the Hi-Z path in GpuCulling.
+class SoftwareOcclusion
+{
+public:
+	SoftwareOcclusion();
+	~SoftwareOcclusion();
+
+	static const uint32_t kWidth = 256;
+	static const uint32_t kHeight = 128;
+	static const uint32_t kTileWidth = 32;
+	static const uint32_t kTileHeight = 16;
+	static const uint32_t kTilesX = kWidth / kTileWidth;
+	static const uint32_t kTilesY = kHeight / kTileHeight;
+
+	void create(uint32_t workerCount = 0);
+	void destroy();
+
+	// clears the depth buffer and occluder list
+	void beginFrame(Camera camera);
+
+	// the vertex and index data must stay alive until rasterizeOccluders returns
+	// an indexCount of 0 draws every index from firstIndex on
+	void addOccluder(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, glm::mat4 model, uint32_t firstIndex = 0, uint32_t indexCount = 0);
+	void rasterizeOccluders();
+
+	// world space box, false when it is fully behind the occluders
+	bool isVisible(glm::vec3 boundsMin, glm::vec3 boundsMax);
+
+	OcclusionStats getStats();
+	void printStats();
+
+private:
+	struct Occluder
+	{
+		const std::vector<Vertex>* vertices;
+		const std::vector<uint32_t>* indices;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		glm::mat4 model;
+	};
+
+	// screen space triangle, pixels and depth after the perspective divide
+	struct ScreenTriangle
+	{
+		float x[3];
+		float y[3];
+		float z[3];
+	};
+
+	glm::mat4 viewProj;
+	std::vector<Occluder> occluders;
+	std::vector<ScreenTriangle> triangles;
+	std::vector<std::vector<uint32_t>> tileBins;
+
+	std::vector<float> depthBuffer;
+	std::vector<float> tileMaxDepth;
+
+	OcclusionStats stats;
+
+	// worker threads wait for a new generation and pull tiles off nextTile
+	std::vector<std::thread> workers;
+	std::mutex workMutex;
+	std::condition_variable workCondition;
+	std::condition_variable doneCondition;
+	uint64_t workGeneration;
+	uint32_t workersDone;
+	bool quit;
+	std::atomic<uint32_t> nextTile;
+
+	void workerLoop();
+	void rasterizeTiles();
+	void rasterizeTile(uint32_t tile);
+	void transformAndBin();
+};
@@ -0,0 +1,270 @@
+#include "TangentGenerator.h"
+#include "Parallel.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+
+// faces and vertices are handed to the threads in runs of this many
+static const uint32_t kChunkSize = 4096;
+
+// per face result of the uv derivatives
+struct FaceTangent
+{
+	glm::vec3 tangent;	// normalized, already flipped for mirrored faces like MikkTSpace does
+	bool mirrored;
+	bool valid;
+};
+
+static void forEachChunk(uint32_t count, uint32_t threadCount, const std::function<void(uint32_t, uint32_t)>& job)
+{
+	uint32_t chunkCount = (count + kChunkSize - 1) / kChunkSize;
+
+	parallelFor(chunkCount, [&](uint32_t chunk)
+	{
+		job(chunk * kChunkSize, std::min(count, (chunk + 1) * kChunkSize));
+	}, threadCount);
+}
+
+static FaceTangent computeFaceTangent(const Vertex& v0, const Vertex& v1, const Vertex& v2)
+{
+	// MikkTSpace expects counter clockwise faces, the engine's are clockwise ( GraphicsPipeline )
+	// walking the corners as 0, 2, 1 gives the same orientation flag MikkTSpace would see
+	glm::vec3 d1 = v2.pos - v0.pos;
+	glm::vec3 d2 = v1.pos - v0.pos;
+	glm::vec2 st1 = v2.texCoords - v0.texCoords;
+	glm::vec2 st2 = v1.texCoords - v0.texCoords;
+
+	float signedArea = st1.x * st2.y - st1.y * st2.x;
+	glm::vec3 os = st2.y * d1 - st1.y * d2;
+
+	FaceTangent face;
+	face.mirrored = !(signedArea > 0.0f);
+	face.valid = false;
+	face.tangent = glm::vec3(0.0f);
+
+	float length = glm::length(os);
+	if (std::abs(signedArea) > 1e-20f && length > 1e-20f)
+	{
+		face.tangent = os * ((face.mirrored ? -1.0f : 1.0f) / length);
+		face.valid = true;
+	}
+
+	return face;
+}
+
+static glm::vec3 projectOnPlane(glm::vec3 v, glm::vec3 normal)
+{
+	glm::vec3 projected = v - normal * glm::dot(normal, v);
+	float length = glm::length(projected);
+	return length > 1e-20f ? projected / length : glm::vec3(0.0f);
+}
+
+void TangentGenerator::generate(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t threadCount)
+{
+	uint32_t faceCount = static_cast<uint32_t>(indices.size() / 3);
+
+	// -- face tangents, independent per face
+	std::vector<FaceTangent> faces(faceCount);
+
+	forEachChunk(faceCount, threadCount, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t f = begin; f < end; f++)
+		{
+			faces[f] = computeFaceTangent(vertices[indices[f * 3 + 0]], vertices[indices[f * 3 + 1]], vertices[indices[f * 3 + 2]]);
+		}
+	});
+
+	// -- mirror split, a vertex used by both orientations gets a copy for the mirrored faces
+	static const uint8_t kUsedPreserving = 1;
+	static const uint8_t kUsedMirrored = 2;
+
+	std::vector<uint8_t> usage(vertices.size(), 0);
+	for (uint32_t f = 0; f < faceCount; f++)
+	{
+		if (faces[f].valid)
+		{
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				usage[indices[f * 3 + k]] |= faces[f].mirrored ? kUsedMirrored : kUsedPreserving;
+			}
+		}
+	}
+
+	std::vector<uint32_t> mirroredCopy(vertices.size(), UINT32_MAX);
+	for (uint32_t f = 0; f < faceCount; f++)
+	{
+		if (!faces[f].valid || !faces[f].mirrored)
+		{
+			continue;
+		}
+
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			uint32_t& index = indices[f * 3 + k];
+			if (usage[index] != (kUsedPreserving | kUsedMirrored))
+			{
+				continue;
+			}
+
+			if (mirroredCopy[index] == UINT32_MAX)
+			{
+				mirroredCopy[index] = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(vertices[index]);
+			}
+			index = mirroredCopy[index];
+		}
+	}
+
+	uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+
+	// -- corners of every vertex, so the accumulation is a gather and needs no atomics
+	std::vector<uint32_t> cornerOffsets(vertexCount + 1, 0);
+	for (uint32_t index : indices)
+	{
+		cornerOffsets[index + 1]++;
+	}
+	for (uint32_t v = 0; v < vertexCount; v++)
+	{
+		cornerOffsets[v + 1] += cornerOffsets[v];
+	}
+
+	std::vector<uint32_t> corners(indices.size());
+	std::vector<uint32_t> cursor(cornerOffsets.begin(), cornerOffsets.end() - 1);
+	for (uint32_t corner = 0; corner < indices.size(); corner++)
+	{
+		corners[cursor[indices[corner]]++] = corner;
+	}
+
+	// -- angle weighted sum of the projected face tangents
+	forEachChunk(vertexCount, threadCount, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t v = begin; v < end; v++)
+		{
+			Vertex& vertex = vertices[v];
+			glm::vec3 normal = glm::length(vertex.normal) > 0.0f ? glm::normalize(vertex.normal) : glm::vec3(0.0f, 0.0f, 1.0f);
+			glm::vec3 sum = glm::vec3(0.0f);
+			bool mirrored = false;
+
+			for (uint32_t c = cornerOffsets[v]; c < cornerOffsets[v + 1]; c++)
+			{
+				uint32_t corner = corners[c];
+				const FaceTangent& face = faces[corner / 3];
+				if (!face.valid)
+				{
+					continue;
+				}
+
+				uint32_t first = corner - corner % 3;
+				glm::vec3 next = vertices[indices[first + (corner + 1) % 3]].pos;
+				glm::vec3 previous = vertices[indices[first + (corner + 2) % 3]].pos;
+
+				glm::vec3 edge0 = projectOnPlane(next - vertex.pos, normal);
+				glm::vec3 edge1 = projectOnPlane(previous - vertex.pos, normal);
+				float angle = std::acos(glm::clamp(glm::dot(edge0, edge1), -1.0f, 1.0f));
+
+				sum += projectOnPlane(face.tangent, normal) * angle;
+				mirrored = face.mirrored;
+			}
+
+			glm::vec3 tangent = projectOnPlane(sum, normal);
+			if (tangent == glm::vec3(0.0f))
+			{
+				glm::vec3 axis = std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+				tangent = projectOnPlane(axis, normal);
+			}
+
+			// bitangent = sign * cross(normal, tangent), +1 for faces that keep their uv orientation
+			vertex.tangent = glm::vec4(tangent, mirrored ? -1.0f : 1.0f);
+		}
+	});
+}
+
+// -- Benchmark
+
+static void buildBenchmarkGrid(uint32_t size, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	vertices.clear();
+	indices.clear();
+
+	for (uint32_t y = 0; y < size; y++)
+	{
+		for (uint32_t x = 0; x < size; x++)
+		{
+			Vertex vertex;
+			vertex.pos = glm::vec3(x / (float)size, y / (float)size, 0.0f);
+			vertex.normal = glm::vec3(0.0f, 0.0f, 1.0f);
+			vertex.color = glm::vec3(1.0f);
+			vertex.texCoords = glm::vec2(x / (float)(size - 1), y / (float)(size - 1));
+			vertices.push_back(vertex);
+		}
+	}
+
+	// clockwise seen from +z like the engine's own meshes
+	for (uint32_t y = 0; y + 1 < size; y++)
+	{
+		for (uint32_t x = 0; x + 1 < size; x++)
+		{
+			uint32_t i = y * size + x;
+			uint32_t quad[6] = { i, i + size, i + 1, i + 1, i + size, i + size + 1 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+void TangentGenerator::benchmark()
+{
+	const uint32_t kGridSize = 1024;
+
+	std::vector<Vertex> sourceVertices;
+	std::vector<uint32_t> sourceIndices;
+	buildBenchmarkGrid(kGridSize, sourceVertices, sourceIndices);
+
+	uint32_t triangleCount = static_cast<uint32_t>(sourceIndices.size() / 3);
+
+	auto report = [&](const char* name, uint32_t meshCount, double seconds)
+	{
+		std::cout << std::fixed << std::setprecision(2) << "TangentGenerator " << name << ": " << meshCount << " x " << triangleCount << " triangles, "
+			<< seconds * 1000.0 << " ms, " << meshCount * triangleCount / seconds / 1e6 << " M triangles/s" << std::endl;
+	};
+
+	// one mesh on the calling thread, then the same mesh split across every core
+	uint32_t threadCounts[2] = { 1, getWorkerThreadCount() };
+	const char* names[2] = { "1 thread", "all cores" };
+
+	for (int i = 0; i < 2; i++)
+	{
+		std::vector<Vertex> vertices = sourceVertices;
+		std::vector<uint32_t> indices = sourceIndices;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		generate(vertices, indices, threadCounts[i]);
+		report(names[i], 1, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+
+		// u runs along +x on the grid, so every tangent should be +x with a positive sign
+		float maxError = 0.0f;
+		for (const Vertex& vertex : vertices)
+		{
+			maxError = std::max(maxError, glm::length(vertex.tangent - glm::vec4(1.0f, 0.0f, 0.0f, 1.0f)));
+		}
+
+		if (maxError > 1e-4f)
+		{
+			throw std::runtime_error("tangent generator: grid tangents are off by " + std::to_string(maxError));
+		}
+	}
+
+	// how the importer uses it, one mesh per core
+	uint32_t meshCount = getWorkerThreadCount();
+	std::vector<std::vector<Vertex>> meshVertices(meshCount, sourceVertices);
+	std::vector<std::vector<uint32_t>> meshIndices(meshCount, sourceIndices);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	parallelFor(meshCount, [&](uint32_t i) { generate(meshVertices[i], meshIndices[i]); });
+	report("mesh per core", meshCount, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "Mesh.h"
+
+// -- Tangent generator
+// Per vertex tangents the way MikkTSpace builds them, so normal maps baked against
+// MikkTSpace ( Blender, Substance, xNormal ... ) shade without seams:
+//	- per face tangent and bitangent from the uv derivatives
+//	- projected onto each corner's normal plane, normalized, weighted by the corner angle
+//	- the bitangent sign is the face's uv orientation, vertices shared by mirrored and
+//	  unmirrored faces are split so each side keeps its own sign
+//	- faces with degenerate uvs add nothing, a vertex left without a tangent gets any
+//	  vector perpendicular to its normal
+// Unlike MikkTSpace the input is an indexed mesh, vertices are not welded or split by
+// position here beyond the mirror split, MeshOptimizer::weldVertices runs afterwards.
+class TangentGenerator
+{
+public:
+	// fills Vertex::tangent, may append vertices and rewrite indices for the mirror split
+	// threadCount 1 stays on the calling thread, 0 uses every core
+	static void generate(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t threadCount = 1);
+
+	// tangents of a 1024x1024 grid, timed on one thread, on every core, and one mesh per core
+	// the grid's tangents are known exactly, so the result is checked too
+	static void benchmark();
+};
\ No newline at end of file
@@ -0,0 +1,288 @@
+#include "Texture.h"
+#include <algorithm>
+#include <cstring>
+#include "VulkanContext.h"
+#include "Tools.h"
+
+Texture::Texture()
+	: image(VK_NULL_HANDLE), imageMemory(VK_NULL_HANDLE), imageView(VK_NULL_HANDLE), sampler(VK_NULL_HANDLE),
+	format(VK_FORMAT_UNDEFINED), width(0), height(0), mipLevels(0)
+{ }
+
+Texture::~Texture()
+{ }
+
+void Texture::createFromFile(const std::string& path, TextureMips mips)
+{
+	Ktx2File file;
+	file.open(path);
+
+	VkFormat fileFormat = file.getFormat();
+	uint32_t fileWidth = file.getHeader().pixelWidth;
+	uint32_t fileHeight = file.getHeader().pixelHeight;
+
+	if (file.wantsGeneratedMips() && mips != kTextureMipsNone)
+	{
+		if (fileFormat == VK_FORMAT_R8G8B8A8_UNORM || fileFormat == VK_FORMAT_R8G8B8A8_SRGB)
+		{
+			createFromPixels(file.getLevelData(0), fileWidth, fileHeight, fileFormat == VK_FORMAT_R8G8B8A8_SRGB, mips);
+			return;
+		}
+
+		// other formats can only be blitted, or they stay at one level
+		if (supportsLinearBlit(fileFormat))
+		{
+			std::vector<TextureLevel> levels;
+			uint64_t stagingSize = layoutTextureLevels(fileFormat, fileWidth, fileHeight, 1, levels);
+
+			createImageAndUpload(fileFormat, fileWidth, fileHeight, getTextureMipCount(fileWidth, fileHeight), levels, stagingSize,
+				[&](uint8_t* staging) { memcpy(staging, file.getLevelData(0), (size_t)levels[0].size); }, true);
+			return;
+		}
+	}
+
+	createFromFile(file, 0);
+}
+
+void Texture::createFromFile(const Ktx2File& file, uint32_t firstLevel)
+{
+	if (firstLevel >= file.getLevelCount())
+	{
+		throw std::runtime_error("the texture file has no such level!");
+	}
+
+	uint32_t levelWidth = std::max(file.getHeader().pixelWidth >> firstLevel, 1u);
+	uint32_t levelHeight = std::max(file.getHeader().pixelHeight >> firstLevel, 1u);
+	uint32_t levelCount = file.getLevelCount() - firstLevel;
+
+	std::vector<TextureLevel> levels;
+	uint64_t stagingSize = layoutTextureLevels(file.getFormat(), levelWidth, levelHeight, levelCount, levels);
+
+	createImageAndUpload(file.getFormat(), levelWidth, levelHeight, levelCount, levels, stagingSize, [&](uint8_t* staging)
+	{
+		for (uint32_t i = 0; i < levels.size(); i++)
+		{
+			memcpy(staging + levels[i].offset, file.getLevelData(firstLevel + i), (size_t)levels[i].size);
+		}
+	}, false);
+}
+
+uint64_t Texture::getUploadSize(const Ktx2File& file, uint32_t firstLevel)
+{
+	std::vector<TextureLevel> levels;
+	return layoutTextureLevels(file.getFormat(), std::max(file.getHeader().pixelWidth >> firstLevel, 1u), std::max(file.getHeader().pixelHeight >> firstLevel, 1u),
+		file.getLevelCount() - firstLevel, levels);
+}
+
+void Texture::recordUploadFromFile(const Ktx2File& file, uint32_t firstLevel, VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, uint8_t* staging, uint64_t stagingOffset)
+{
+	if (firstLevel >= file.getLevelCount())
+	{
+		throw std::runtime_error("the texture file has no such level!");
+	}
+
+	checkSampledFormat(file.getFormat());
+
+	format = file.getFormat();
+	width = std::max(file.getHeader().pixelWidth >> firstLevel, 1u);
+	height = std::max(file.getHeader().pixelHeight >> firstLevel, 1u);
+	mipLevels = file.getLevelCount() - firstLevel;
+
+	std::vector<TextureLevel> levels;
+	layoutTextureLevels(format, width, height, mipLevels, levels);
+
+	std::vector<VkBufferImageCopy> regions(levels.size());
+	for (uint32_t i = 0; i < levels.size(); i++)
+	{
+		memcpy(staging + stagingOffset + levels[i].offset, file.getLevelData(firstLevel + i), (size_t)levels[i].size);
+
+		regions[i] = {};
+		regions[i].bufferOffset = stagingOffset + levels[i].offset;
+		regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		regions[i].imageSubresource.mipLevel = i;
+		regions[i].imageSubresource.baseArrayLayer = 0;
+		regions[i].imageSubresource.layerCount = 1;
+		regions[i].imageOffset = { 0, 0, 0 };
+		regions[i].imageExtent = { levels[i].width, levels[i].height, 1 };
+	}
+
+	vkTools::createImage(width, height, mipLevels, format, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = mipLevels;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+	// the second scope covers everything later in submission order on the queue, so frames recorded after this can sample it
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	imageView = vkTools::createImageView(image, format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+	sampler = VulkanContext::getInstance()->getSamplerCache()->getTrilinearSampler();
+}
+
+void Texture::createFromImage(const TextureImage& textureImage)
+{
+	createImageAndUpload(textureImage.format, textureImage.width, textureImage.height, static_cast<uint32_t>(textureImage.levels.size()), textureImage.levels,
+		textureImage.data.size(), [&](uint8_t* staging) { memcpy(staging, textureImage.data.data(), textureImage.data.size()); }, false);
+}
+
+void Texture::createFromPixels(const uint8_t* rgba, uint32_t _width, uint32_t _height, bool srgb, TextureMips mips)
+{
+	VkFormat pixelFormat = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+
+	if (mips == kTextureMipsGpuBlit && !supportsLinearBlit(pixelFormat))
+	{
+		mips = kTextureMipsCpuBox;
+	}
+
+	if (mips == kTextureMipsCpuBox || mips == kTextureMipsCpuKaiser)
+	{
+		TextureImage generated;
+		MipGenerator::generate(rgba, _width, _height, srgb, mips == kTextureMipsCpuKaiser ? kMipFilterKaiser : kMipFilterBox, generated);
+		createFromImage(generated);
+		return;
+	}
+
+	std::vector<TextureLevel> levels;
+	uint64_t stagingSize = layoutTextureLevels(pixelFormat, _width, _height, 1, levels);
+	uint32_t levelCount = mips == kTextureMipsGpuBlit ? getTextureMipCount(_width, _height) : 1;
+
+	createImageAndUpload(pixelFormat, _width, _height, levelCount, levels, stagingSize,
+		[&](uint8_t* staging) { memcpy(staging, rgba, (size_t)levels[0].size); }, levelCount > 1);
+}
+
+void Texture::createImageAndUpload(VkFormat _format, uint32_t _width, uint32_t _height, uint32_t _mipLevels, const std::vector<TextureLevel>& levels,
+	uint64_t stagingSize, const std::function<void(uint8_t*)>& fill, bool blitMips)
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	checkSampledFormat(_format);
+
+	format = _format;
+	width = _width;
+	height = _height;
+	mipLevels = _mipLevels;
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	vkTools::createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+	void* mapped;
+	vkMapMemory(logicalDevice, stagingBufferMemory, 0, stagingSize, 0, &mapped);
+
+	// a throwing fill must not leak the staging buffer
+	try
+	{
+		fill(static_cast<uint8_t*>(mapped));
+	}
+	catch (...)
+	{
+		vkUnmapMemory(logicalDevice, stagingBufferMemory);
+		vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
+		vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
+		throw;
+	}
+
+	vkUnmapMemory(logicalDevice, stagingBufferMemory);
+
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | (blitMips ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
+	vkTools::createImage(width, height, mipLevels, format, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+	// one region per mip in staging
+	std::vector<VkBufferImageCopy> regions(levels.size());
+	for (uint32_t i = 0; i < levels.size(); i++)
+	{
+		regions[i] = {};
+		regions[i].bufferOffset = levels[i].offset;
+		regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		regions[i].imageSubresource.mipLevel = i;
+		regions[i].imageSubresource.baseArrayLayer = 0;
+		regions[i].imageSubresource.layerCount = 1;
+		regions[i].imageOffset = { 0, 0, 0 };
+		regions[i].imageExtent = { levels[i].width, levels[i].height, 1 };
+	}
+
+	vkTools::transitionImageLayout(image, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	vkTools::copyBufferToImage(stagingBuffer, image, regions);
+
+	if (blitMips)
+	{
+		vkTools::blitMipChain(image, width, height, mipLevels);
+	}
+	else
+	{
+		vkTools::transitionImageLayout(image, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+
+	vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
+	vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
+
+	imageView = vkTools::createImageView(image, format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+
+	// shared, the view decides which mips there are
+	sampler = VulkanContext::getInstance()->getSamplerCache()->getTrilinearSampler();
+}
+
+void Texture::checkSampledFormat(VkFormat format)
+{
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(VulkanContext::getInstance()->getDevice()->physicalDevice, format, &formatProperties);
+
+	if ((formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0)
+	{
+		throw std::runtime_error("texture format is not supported by the device!");
+	}
+}
+
+bool Texture::supportsLinearBlit(VkFormat format)
+{
+	TextureFormatInfo info;
+	if (!getTextureFormatInfo(format, info) || info.blockWidth > 1)
+	{
+		return false;
+	}
+
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(VulkanContext::getInstance()->getDevice()->physicalDevice, format, &formatProperties);
+
+	VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (formatProperties.optimalTilingFeatures & needed) == needed;
+}
+
+VkDescriptorImageInfo Texture::getDescriptorInfo() const
+{
+	VkDescriptorImageInfo info = {};
+	info.sampler = sampler;
+	info.imageView = imageView;
+	info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	return info;
+}
+
+void Texture::destroy()
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	vkDestroyImageView(logicalDevice, imageView, nullptr);
+	vkDestroyImage(logicalDevice, image, nullptr);
+	vkFreeMemory(logicalDevice, imageMemory, nullptr);
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <functional>
+
+#include "Ktx2.h"
+#include "MipGenerator.h"
+
+// where the mips of a texture that comes without them are made
+enum TextureMips
+{
+	kTextureMipsNone,
+	kTextureMipsCpuBox,
+	kTextureMipsCpuKaiser,
+	kTextureMipsGpuBlit		// kTextureMipsCpuBox when the device can't filter the format in a blit
+};
+
+// -- Sampled 2D texture
+// A device local image with its mip chain, a view over every mip and the shared trilinear sampler.
+// All mips go through one staging buffer and one copy with a region per mip.
+class Texture
+{
+public:
+	Texture();
+	~Texture();
+
+	VkImage image;
+	VkDeviceMemory imageMemory;
+	VkImageView imageView;
+	VkSampler sampler;	// from the sampler cache, not owned
+
+	VkFormat format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+
+	// KTX2 levels are copied from the mapped file straight into staging memory,
+	// mips only says what happens to a file that asks for them to be generated
+	void createFromFile(const std::string& path, TextureMips mips = kTextureMipsGpuBlit);
+	// the stored levels from firstLevel down, firstLevel becomes mip 0, for streaming
+	void createFromFile(const Ktx2File& file, uint32_t firstLevel);
+	void createFromImage(const TextureImage& textureImage);
+	// the same levels as above without a submit of its own, they are copied to staging at stagingOffset and
+	// the upload is recorded into commandBuffer, the texture can be sampled by anything submitted after it
+	void recordUploadFromFile(const Ktx2File& file, uint32_t firstLevel, VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, uint8_t* staging, uint64_t stagingOffset);
+	// staging the above needs, a multiple of kTextureLevelAlignment
+	static uint64_t getUploadSize(const Ktx2File& file, uint32_t firstLevel);
+	void createFromPixels(const uint8_t* rgba, uint32_t _width, uint32_t _height, bool srgb, TextureMips mips);
+
+	VkDescriptorImageInfo getDescriptorInfo() const;
+
+	void destroy();
+
+private:
+	// levels are where fill puts the mips in staging memory, the rest of the chain is blitted when blitMips is set
+	void createImageAndUpload(VkFormat _format, uint32_t _width, uint32_t _height, uint32_t _mipLevels, const std::vector<TextureLevel>& levels,
+		uint64_t stagingSize, const std::function<void(uint8_t*)>& fill, bool blitMips);
+
+	static bool supportsLinearBlit(VkFormat format);
+	static void checkSampledFormat(VkFormat format);
+};
\ No newline at end of file
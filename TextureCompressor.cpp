@@ -0,0 +1,932 @@
+#include "TextureCompressor.h"
+#include "Parallel.h"
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+// -- Block fitting
+
+// 4x4 texels of a level, the edge repeats for levels smaller than a block
+static void loadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, uint8_t block[64])
+{
+	for (uint32_t y = 0; y < 4; y++)
+	{
+		uint32_t sourceY = std::min(blockY * 4 + y, height - 1);
+
+		for (uint32_t x = 0; x < 4; x++)
+		{
+			uint32_t sourceX = std::min(blockX * 4 + x, width - 1);
+			memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sourceY * width + sourceX) * 4, 4);
+		}
+	}
+}
+
+// mean and principal axis of the 16 points by power iteration
+template<int N>
+static void principalAxis(const float points[16][N], float mean[N], float axis[N])
+{
+	for (int k = 0; k < N; k++)
+	{
+		mean[k] = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			mean[k] += points[i][k];
+		}
+		mean[k] /= 16.0f;
+	}
+
+	float covariance[N][N] = {};
+	for (int i = 0; i < 16; i++)
+	{
+		for (int j = 0; j < N; j++)
+		{
+			for (int k = 0; k < N; k++)
+			{
+				covariance[j][k] += (points[i][j] - mean[j]) * (points[i][k] - mean[k]);
+			}
+		}
+	}
+
+	// start along the channel with the most spread, a few steps are enough for a 4x4 block
+	int widest = 0;
+	for (int k = 1; k < N; k++)
+	{
+		widest = covariance[k][k] > covariance[widest][widest] ? k : widest;
+	}
+
+	for (int k = 0; k < N; k++)
+	{
+		axis[k] = covariance[widest][k];
+	}
+
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[N] = {};
+		float largest = 0.0f;
+
+		for (int j = 0; j < N; j++)
+		{
+			for (int k = 0; k < N; k++)
+			{
+				next[j] += covariance[j][k] * axis[k];
+			}
+			largest = std::max(largest, std::fabs(next[j]));
+		}
+
+		// flat block, any axis does
+		if (largest < 1e-6f)
+		{
+			break;
+		}
+
+		for (int k = 0; k < N; k++)
+		{
+			axis[k] = next[k] / largest;
+		}
+	}
+
+	float length = 0.0f;
+	for (int k = 0; k < N; k++)
+	{
+		length += axis[k] * axis[k];
+	}
+
+	length = std::sqrt(length);
+	for (int k = 0; k < N; k++)
+	{
+		axis[k] = length > 1e-6f ? axis[k] / length : 0.0f;
+	}
+}
+
+// the points furthest apart along the axis
+template<int N>
+static void extremeEndpoints(const float points[16][N], const float mean[N], const float axis[N], float e0[N], float e1[N])
+{
+	float minT = FLT_MAX;
+	float maxT = -FLT_MAX;
+
+	for (int i = 0; i < 16; i++)
+	{
+		float t = 0.0f;
+		for (int k = 0; k < N; k++)
+		{
+			t += (points[i][k] - mean[k]) * axis[k];
+		}
+
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	for (int k = 0; k < N; k++)
+	{
+		e0[k] = mean[k] + axis[k] * maxT;
+		e1[k] = mean[k] + axis[k] * minT;
+	}
+}
+
+// least squares endpoints for fixed interpolation weights, false when every texel has the same weight
+template<int N>
+static bool fitEndpoints(const float points[16][N], const float weights[16], float e0[N], float e1[N])
+{
+	float aa = 0.0f;
+	float ab = 0.0f;
+	float bb = 0.0f;
+	float ax[N] = {};
+	float bx[N] = {};
+
+	for (int i = 0; i < 16; i++)
+	{
+		float b = weights[i];
+		float a = 1.0f - b;
+
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+
+		for (int k = 0; k < N; k++)
+		{
+			ax[k] += a * points[i][k];
+			bx[k] += b * points[i][k];
+		}
+	}
+
+	float determinant = aa * bb - ab * ab;
+	if (std::fabs(determinant) < 1e-6f)
+	{
+		return false;
+	}
+
+	for (int k = 0; k < N; k++)
+	{
+		e0[k] = (bb * ax[k] - ab * bx[k]) / determinant;
+		e1[k] = (aa * bx[k] - ab * ax[k]) / determinant;
+	}
+
+	return true;
+}
+
+static int clampInt(int value, int low, int high)
+{
+	return std::min(std::max(value, low), high);
+}
+
+// -- BC1 colour
+
+static const float kColorWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+static uint16_t packRgb565(const float color[3])
+{
+	int r = clampInt((int)(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+	int g = clampInt((int)(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+	int b = clampInt((int)(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpackRgb565(uint16_t packed, int color[3])
+{
+	int r = packed >> 11;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+// four colour palette, the decoder uses it whenever c0 > c1
+static void buildColorPalette(uint16_t c0, uint16_t c1, int palette[4][3])
+{
+	unpackRgb565(c0, palette[0]);
+	unpackRgb565(c1, palette[1]);
+
+	for (int k = 0; k < 3; k++)
+	{
+		palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+		palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+	}
+}
+
+// nearest palette entry per texel, returns the squared error
+static float chooseColorIndices(const float points[16][3], uint16_t c0, uint16_t c1, uint8_t indices[16])
+{
+	int palette[4][3];
+	buildColorPalette(c0, c1, palette);
+
+	float total = 0.0f;
+	for (int i = 0; i < 16; i++)
+	{
+		float best = FLT_MAX;
+
+		for (int j = 0; j < 4; j++)
+		{
+			float error = 0.0f;
+			for (int k = 0; k < 3; k++)
+			{
+				float d = points[i][k] - palette[j][k];
+				error += d * d;
+			}
+
+			if (error < best)
+			{
+				best = error;
+				indices[i] = (uint8_t)j;
+			}
+		}
+
+		total += best;
+	}
+
+	return total;
+}
+
+static void encodeColorBlock(const uint8_t block[64], uint8_t* out)
+{
+	float points[16][3];
+	for (int i = 0; i < 16; i++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			points[i][k] = block[i * 4 + k];
+		}
+	}
+
+	float mean[3], axis[3], e0[3], e1[3];
+	principalAxis<3>(points, mean, axis);
+	extremeEndpoints<3>(points, mean, axis, e0, e1);
+
+	uint16_t best0 = packRgb565(e0);
+	uint16_t best1 = packRgb565(e1);
+	uint8_t bestIndices[16];
+	float bestError = chooseColorIndices(points, best0, best1, bestIndices);
+
+	// refit to the texels each palette entry ended up with
+	for (int iteration = 0; iteration < 2 && bestError > 0.0f; iteration++)
+	{
+		float weights[16];
+		for (int i = 0; i < 16; i++)
+		{
+			weights[i] = kColorWeights[bestIndices[i]];
+		}
+
+		if (!fitEndpoints<3>(points, weights, e0, e1))
+		{
+			break;
+		}
+
+		uint16_t c0 = packRgb565(e0);
+		uint16_t c1 = packRgb565(e1);
+		uint8_t indices[16];
+		float error = chooseColorIndices(points, c0, c1, indices);
+
+		if (error >= bestError)
+		{
+			break;
+		}
+
+		best0 = c0;
+		best1 = c1;
+		bestError = error;
+		memcpy(bestIndices, indices, sizeof(indices));
+	}
+
+	// four colour mode needs c0 > c1, swapping the endpoints swaps indices 0 1 and 2 3
+	if (best0 < best1)
+	{
+		std::swap(best0, best1);
+		for (int i = 0; i < 16; i++)
+		{
+			bestIndices[i] ^= 1;
+		}
+	}
+
+	// equal endpoints decode in three colour mode where index 3 is black
+	uint32_t indexBits = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		indexBits |= (uint32_t)(best0 == best1 ? 0 : bestIndices[i]) << (i * 2);
+	}
+
+	memcpy(out, &best0, 2);
+	memcpy(out + 2, &best1, 2);
+	memcpy(out + 4, &indexBits, 4);
+}
+
+static void decodeColorBlock(const uint8_t* in, bool alwaysFourColor, uint8_t block[64])
+{
+	uint16_t c0, c1;
+	uint32_t indexBits;
+	memcpy(&c0, in, 2);
+	memcpy(&c1, in + 2, 2);
+	memcpy(&indexBits, in + 4, 4);
+
+	int palette[4][3];
+	buildColorPalette(c0, c1, palette);
+
+	if (!alwaysFourColor && c0 <= c1)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+			palette[3][k] = 0;
+		}
+	}
+
+	for (int i = 0; i < 16; i++)
+	{
+		uint32_t index = (indexBits >> (i * 2)) & 3;
+		for (int k = 0; k < 3; k++)
+		{
+			block[i * 4 + k] = (uint8_t)palette[index][k];
+		}
+	}
+}
+
+// -- BC4 single channel, the alpha of BC3 and both channels of BC5
+
+static void buildAlphaPalette(int a0, int a1, int palette[8])
+{
+	palette[0] = a0;
+	palette[1] = a1;
+
+	if (a0 > a1)
+	{
+		for (int i = 1; i < 7; i++)
+		{
+			palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+		}
+	}
+	else
+	{
+		for (int i = 1; i < 5; i++)
+		{
+			palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+static uint32_t chooseAlphaIndices(const uint8_t values[16], int a0, int a1, uint8_t indices[16])
+{
+	int palette[8];
+	buildAlphaPalette(a0, a1, palette);
+
+	uint32_t total = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int best = INT32_MAX;
+
+		for (int j = 0; j < 8; j++)
+		{
+			int error = (values[i] - palette[j]) * (values[i] - palette[j]);
+			if (error < best)
+			{
+				best = error;
+				indices[i] = (uint8_t)j;
+			}
+		}
+
+		total += best;
+	}
+
+	return total;
+}
+
+// the eight value ramp, or the six value one with exact 0 and 255, whichever fits
+static void encodeAlphaBlock(const uint8_t values[16], uint8_t* out)
+{
+	int minValue = 255;
+	int maxValue = 0;
+	int innerMin = 255;
+	int innerMax = 0;
+
+	for (int i = 0; i < 16; i++)
+	{
+		minValue = std::min(minValue, (int)values[i]);
+		maxValue = std::max(maxValue, (int)values[i]);
+
+		if (values[i] != 0 && values[i] != 255)
+		{
+			innerMin = std::min(innerMin, (int)values[i]);
+			innerMax = std::max(innerMax, (int)values[i]);
+		}
+	}
+
+	int best0 = maxValue;
+	int best1 = minValue;
+	uint8_t bestIndices[16];
+	uint32_t bestError = chooseAlphaIndices(values, best0, best1, bestIndices);
+
+	if (bestError > 0)
+	{
+		// a0 <= a1 selects the six value ramp, a block of only 0 and 255 is exact with any endpoints
+		if (innerMin > innerMax)
+		{
+			innerMin = innerMax = 0;
+		}
+
+		uint8_t indices[16];
+		uint32_t error = chooseAlphaIndices(values, innerMin, innerMax, indices);
+
+		if (error < bestError)
+		{
+			best0 = innerMin;
+			best1 = innerMax;
+			memcpy(bestIndices, indices, sizeof(indices));
+		}
+	}
+
+	uint64_t indexBits = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		indexBits |= (uint64_t)bestIndices[i] << (i * 3);
+	}
+
+	out[0] = (uint8_t)best0;
+	out[1] = (uint8_t)best1;
+	for (int i = 0; i < 6; i++)
+	{
+		out[2 + i] = (uint8_t)(indexBits >> (i * 8));
+	}
+}
+
+static void decodeAlphaBlock(const uint8_t* in, uint8_t values[16])
+{
+	int palette[8];
+	buildAlphaPalette(in[0], in[1], palette);
+
+	uint64_t indexBits = 0;
+	for (int i = 0; i < 6; i++)
+	{
+		indexBits |= (uint64_t)in[2 + i] << (i * 8);
+	}
+
+	for (int i = 0; i < 16; i++)
+	{
+		values[i] = (uint8_t)palette[(indexBits >> (i * 3)) & 7];
+	}
+}
+
+// -- BC7 mode 6
+// 7 bit rgba endpoints with a shared low bit each, 4 bit indices, texel 0 is the anchor with an implied 0 top bit
+
+static const int kBc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct Bc7Endpoint
+{
+	int quantized[4];
+	int pBit;
+	int value[4];	// quantized * 2 + pBit
+};
+
+// the p bit that lands closer wins
+static Bc7Endpoint quantizeBc7Endpoint(const float color[4])
+{
+	Bc7Endpoint best = {};
+	float bestError = FLT_MAX;
+
+	for (int pBit = 0; pBit < 2; pBit++)
+	{
+		Bc7Endpoint endpoint;
+		endpoint.pBit = pBit;
+		float error = 0.0f;
+
+		for (int k = 0; k < 4; k++)
+		{
+			endpoint.quantized[k] = clampInt((int)std::floor((color[k] - pBit) * 0.5f + 0.5f), 0, 127);
+			endpoint.value[k] = endpoint.quantized[k] * 2 + pBit;
+			error += (endpoint.value[k] - color[k]) * (endpoint.value[k] - color[k]);
+		}
+
+		if (error < bestError)
+		{
+			bestError = error;
+			best = endpoint;
+		}
+	}
+
+	return best;
+}
+
+static void buildBc7Palette(const Bc7Endpoint& e0, const Bc7Endpoint& e1, int palette[16][4])
+{
+	for (int i = 0; i < 16; i++)
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			palette[i][k] = ((64 - kBc7Weights[i]) * e0.value[k] + kBc7Weights[i] * e1.value[k] + 32) >> 6;
+		}
+	}
+}
+
+static float chooseBc7Indices(const float points[16][4], const Bc7Endpoint& e0, const Bc7Endpoint& e1, uint8_t indices[16])
+{
+	int palette[16][4];
+	buildBc7Palette(e0, e1, palette);
+
+	float total = 0.0f;
+	for (int i = 0; i < 16; i++)
+	{
+		float best = FLT_MAX;
+
+		for (int j = 0; j < 16; j++)
+		{
+			float error = 0.0f;
+			for (int k = 0; k < 4; k++)
+			{
+				float d = points[i][k] - palette[j][k];
+				error += d * d;
+			}
+
+			if (error < best)
+			{
+				best = error;
+				indices[i] = (uint8_t)j;
+			}
+		}
+
+		total += best;
+	}
+
+	return total;
+}
+
+// little endian bit stream over a 16 byte block
+static void writeBits(uint8_t* block, uint32_t& position, uint32_t value, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++, position++)
+	{
+		block[position >> 3] |= (uint8_t)(((value >> i) & 1) << (position & 7));
+	}
+}
+
+static uint32_t readBits(const uint8_t* block, uint32_t& position, uint32_t count)
+{
+	uint32_t value = 0;
+	for (uint32_t i = 0; i < count; i++, position++)
+	{
+		value |= (uint32_t)((block[position >> 3] >> (position & 7)) & 1) << i;
+	}
+	return value;
+}
+
+static void encodeBc7Block(const uint8_t block[64], uint8_t* out)
+{
+	float points[16][4];
+	for (int i = 0; i < 16; i++)
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			points[i][k] = block[i * 4 + k];
+		}
+	}
+
+	float mean[4], axis[4], c0[4], c1[4];
+	principalAxis<4>(points, mean, axis);
+	extremeEndpoints<4>(points, mean, axis, c0, c1);
+
+	Bc7Endpoint best0 = quantizeBc7Endpoint(c0);
+	Bc7Endpoint best1 = quantizeBc7Endpoint(c1);
+	uint8_t bestIndices[16];
+	float bestError = chooseBc7Indices(points, best0, best1, bestIndices);
+
+	for (int iteration = 0; iteration < 2 && bestError > 0.0f; iteration++)
+	{
+		float weights[16];
+		for (int i = 0; i < 16; i++)
+		{
+			weights[i] = kBc7Weights[bestIndices[i]] / 64.0f;
+		}
+
+		if (!fitEndpoints<4>(points, weights, c0, c1))
+		{
+			break;
+		}
+
+		Bc7Endpoint e0 = quantizeBc7Endpoint(c0);
+		Bc7Endpoint e1 = quantizeBc7Endpoint(c1);
+		uint8_t indices[16];
+		float error = chooseBc7Indices(points, e0, e1, indices);
+
+		if (error >= bestError)
+		{
+			break;
+		}
+
+		best0 = e0;
+		best1 = e1;
+		bestError = error;
+		memcpy(bestIndices, indices, sizeof(indices));
+	}
+
+	// the anchor's top index bit isn't stored, flip the ramp when it would be set
+	if (bestIndices[0] >= 8)
+	{
+		std::swap(best0, best1);
+		for (int i = 0; i < 16; i++)
+		{
+			bestIndices[i] = 15 - bestIndices[i];
+		}
+	}
+
+	memset(out, 0, 16);
+	uint32_t position = 0;
+
+	writeBits(out, position, 1 << 6, 7);
+
+	for (int k = 0; k < 4; k++)
+	{
+		writeBits(out, position, best0.quantized[k], 7);
+		writeBits(out, position, best1.quantized[k], 7);
+	}
+
+	writeBits(out, position, best0.pBit, 1);
+	writeBits(out, position, best1.pBit, 1);
+
+	for (int i = 0; i < 16; i++)
+	{
+		writeBits(out, position, bestIndices[i], i == 0 ? 3 : 4);
+	}
+}
+
+// mode 6 only, which is all the encoder writes
+static void decodeBc7Block(const uint8_t* in, uint8_t block[64])
+{
+	uint32_t position = 0;
+	if (readBits(in, position, 7) != 1 << 6)
+	{
+		throw std::runtime_error("only BC7 mode 6 blocks can be decoded!");
+	}
+
+	Bc7Endpoint e0, e1;
+	for (int k = 0; k < 4; k++)
+	{
+		e0.quantized[k] = readBits(in, position, 7);
+		e1.quantized[k] = readBits(in, position, 7);
+	}
+
+	e0.pBit = readBits(in, position, 1);
+	e1.pBit = readBits(in, position, 1);
+
+	for (int k = 0; k < 4; k++)
+	{
+		e0.value[k] = e0.quantized[k] * 2 + e0.pBit;
+		e1.value[k] = e1.quantized[k] * 2 + e1.pBit;
+	}
+
+	int palette[16][4];
+	buildBc7Palette(e0, e1, palette);
+
+	for (int i = 0; i < 16; i++)
+	{
+		uint32_t index = readBits(in, position, i == 0 ? 3 : 4);
+		for (int k = 0; k < 4; k++)
+		{
+			block[i * 4 + k] = (uint8_t)palette[index][k];
+		}
+	}
+}
+
+// -- Blocks of each format
+
+static uint32_t getBlockSize(TextureCompression compression)
+{
+	return compression == kTextureCompressionBC1 ? 8 : 16;
+}
+
+static void encodeBlock(const uint8_t block[64], TextureCompression compression, uint8_t* out)
+{
+	uint8_t channel[16];
+
+	switch (compression)
+	{
+	case kTextureCompressionBC1:
+		encodeColorBlock(block, out);
+		break;
+	case kTextureCompressionBC3:
+		for (int i = 0; i < 16; i++)
+		{
+			channel[i] = block[i * 4 + 3];
+		}
+		encodeAlphaBlock(channel, out);
+		encodeColorBlock(block, out + 8);
+		break;
+	case kTextureCompressionBC5:
+		for (int c = 0; c < 2; c++)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				channel[i] = block[i * 4 + c];
+			}
+			encodeAlphaBlock(channel, out + c * 8);
+		}
+		break;
+	case kTextureCompressionBC7:
+		encodeBc7Block(block, out);
+		break;
+	}
+}
+
+// channels the format doesn't store come back as 0 for colour and 255 for alpha
+static void decodeBlock(const uint8_t* in, TextureCompression compression, uint8_t block[64])
+{
+	uint8_t channel[16];
+
+	for (int i = 0; i < 16; i++)
+	{
+		block[i * 4 + 2] = 0;
+		block[i * 4 + 3] = 255;
+	}
+
+	switch (compression)
+	{
+	case kTextureCompressionBC1:
+		decodeColorBlock(in, false, block);
+		break;
+	case kTextureCompressionBC3:
+		decodeColorBlock(in + 8, true, block);
+		decodeAlphaBlock(in, channel);
+		for (int i = 0; i < 16; i++)
+		{
+			block[i * 4 + 3] = channel[i];
+		}
+		break;
+	case kTextureCompressionBC5:
+		for (int c = 0; c < 2; c++)
+		{
+			decodeAlphaBlock(in + c * 8, channel);
+			for (int i = 0; i < 16; i++)
+			{
+				block[i * 4 + c] = channel[i];
+			}
+		}
+		break;
+	case kTextureCompressionBC7:
+		decodeBc7Block(in, block);
+		break;
+	}
+}
+
+VkFormat TextureCompressor::getCompressedFormat(TextureCompression compression, bool srgb)
+{
+	switch (compression)
+	{
+	case kTextureCompressionBC1:
+		return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	case kTextureCompressionBC3:
+		return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+	case kTextureCompressionBC5:
+		return VK_FORMAT_BC5_UNORM_BLOCK;
+	case kTextureCompressionBC7:
+		return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+	}
+
+	throw std::runtime_error("unknown texture compression!");
+}
+
+void TextureCompressor::compress(const TextureImage& source, TextureCompression compression, TextureImage& compressed, uint32_t threadCount)
+{
+	if (source.format != VK_FORMAT_R8G8B8A8_UNORM && source.format != VK_FORMAT_R8G8B8A8_SRGB)
+	{
+		throw std::runtime_error("block compression needs an RGBA8 source!");
+	}
+
+	compressed.format = getCompressedFormat(compression, source.format == VK_FORMAT_R8G8B8A8_SRGB);
+	compressed.width = source.width;
+	compressed.height = source.height;
+
+	uint64_t size = layoutTextureLevels(compressed.format, source.width, source.height, static_cast<uint32_t>(source.levels.size()), compressed.levels);
+	compressed.data.assign(size, 0);
+
+	// a job per block row of every level, the rows of the big levels keep all threads busy
+	struct BlockRow
+	{
+		uint32_t level;
+		uint32_t blockY;
+	};
+
+	std::vector<BlockRow> rows;
+	for (uint32_t level = 0; level < source.levels.size(); level++)
+	{
+		for (uint32_t blockY = 0; blockY < (source.levels[level].height + 3) / 4; blockY++)
+		{
+			rows.push_back({ level, blockY });
+		}
+	}
+
+	uint32_t blockSize = getBlockSize(compression);
+
+	parallelFor(static_cast<uint32_t>(rows.size()), [&](uint32_t job)
+	{
+		const BlockRow& row = rows[job];
+		const TextureLevel& sourceLevel = source.levels[row.level];
+		uint32_t blocksX = (sourceLevel.width + 3) / 4;
+
+		uint8_t* out = compressed.data.data() + compressed.levels[row.level].offset + (size_t)row.blockY * blocksX * blockSize;
+		uint8_t block[64];
+
+		for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+		{
+			loadBlock(source.data.data() + sourceLevel.offset, sourceLevel.width, sourceLevel.height, blockX, row.blockY, block);
+			encodeBlock(block, compression, out + blockX * blockSize);
+		}
+	}, threadCount);
+}
+
+void TextureCompressor::cookToFile(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb, TextureCompression compression, MipFilter filter,
+	const std::string& path, uint32_t threadCount)
+{
+	TextureImage chain;
+	MipGenerator::generate(rgba, width, height, srgb, filter, chain);
+
+	TextureImage compressed;
+	compress(chain, compression, compressed, threadCount);
+
+	Ktx2File::writeFile(path, compressed);
+}
+
+void TextureCompressor::benchmark()
+{
+	const uint32_t kSize = 1024;
+
+	// gradients, hard edged shapes and some noise, alpha fades across
+	std::vector<uint8_t> pixels((size_t)kSize * kSize * 4);
+	uint32_t noise = 12345;
+
+	for (uint32_t y = 0; y < kSize; y++)
+	{
+		for (uint32_t x = 0; x < kSize; x++)
+		{
+			noise = noise * 1664525u + 1013904223u;
+			int grain = (int)(noise >> 28) - 8;
+
+			bool disc = ((x / 64 + y / 64) & 1) && ((x % 64) - 32) * ((x % 64) - 32) + ((y % 64) - 32) * ((y % 64) - 32) < 600;
+
+			uint8_t* texel = &pixels[((size_t)y * kSize + x) * 4];
+			texel[0] = (uint8_t)clampInt(disc ? 220 : (int)(x * 255 / kSize) + grain, 0, 255);
+			texel[1] = (uint8_t)clampInt(disc ? 40 : (int)(y * 255 / kSize) + grain, 0, 255);
+			texel[2] = (uint8_t)clampInt(disc ? 60 : (int)((x + y) * 127 / kSize) + grain, 0, 255);
+			texel[3] = (uint8_t)((x * 255 / kSize + (disc ? 128 : 0)) & 0xff);
+		}
+	}
+
+	TextureImage source;
+	source.format = VK_FORMAT_R8G8B8A8_UNORM;
+	source.width = kSize;
+	source.height = kSize;
+	source.data = pixels;
+	layoutTextureLevels(source.format, kSize, kSize, 1, source.levels);
+
+	const char* names[] = { "bc1", "bc3", "bc5", "bc7" };
+	// the channels each format is meant to keep
+	const uint32_t channelCounts[] = { 3, 4, 2, 4 };
+
+	std::cout << std::fixed << std::setprecision(2) << "TextureCompressor: " << kSize << "x" << kSize << ", " << getWorkerThreadCount() << " threads";
+
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		TextureCompression compression = static_cast<TextureCompression>(c);
+		TextureImage compressed;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		compress(source, compression, compressed);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		// decode everything back and compare
+		double squaredError = 0.0;
+		uint32_t blocksX = kSize / 4;
+		uint32_t blockSize = getBlockSize(compression);
+		uint8_t block[64];
+
+		for (uint32_t blockY = 0; blockY < kSize / 4; blockY++)
+		{
+			for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+			{
+				decodeBlock(compressed.data.data() + ((size_t)blockY * blocksX + blockX) * blockSize, compression, block);
+
+				for (uint32_t i = 0; i < 16; i++)
+				{
+					const uint8_t* original = &pixels[(((size_t)blockY * 4 + i / 4) * kSize + blockX * 4 + i % 4) * 4];
+					for (uint32_t k = 0; k < channelCounts[c]; k++)
+					{
+						double d = (double)block[i * 4 + k] - original[k];
+						squaredError += d * d;
+					}
+				}
+			}
+		}
+
+		double rmse = std::sqrt(squaredError / ((double)kSize * kSize * channelCounts[c]));
+
+		std::cout << ", " << names[c] << " " << ms << " ms (" << (kSize * kSize / 1000.0) / ms << " Mpix/s) rmse " << rmse
+			<< " at " << (double)(kSize * kSize * 4) / compressed.data.size() << ":1";
+	}
+
+	std::cout << std::endl;
+}
\ No newline at end of file
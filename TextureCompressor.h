@@ -0,0 +1,38 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <cstdint>
+
+#include "Ktx2.h"
+#include "MipGenerator.h"
+
+enum TextureCompression
+{
+	kTextureCompressionBC1,		// rgb, 4 bits per texel
+	kTextureCompressionBC3,		// rgb with smooth alpha, 8 bits per texel
+	kTextureCompressionBC5,		// red and green on their own, normal maps
+	kTextureCompressionBC7		// rgba, 8 bits per texel, best quality
+};
+
+// -- Block compression for the asset cooker
+// Turns RGBA8 mip chains into GPU ready BCn chains offline, so loading a texture is a memcpy
+// of the KTX2 levels into staging memory. Every 4x4 block is fitted on its own: endpoints along
+// the principal axis of its colours, then refined by least squares against the chosen indices.
+// BC7 always uses mode 6, one subset with rgba endpoints and 4 bit indices.
+// Blocks are split across threads by block row over all levels.
+class TextureCompressor
+{
+public:
+	// srgb only changes BC1, BC3 and BC7, BC5 data is never colour
+	static VkFormat getCompressedFormat(TextureCompression compression, bool srgb);
+
+	// source is an RGBA8 chain, MipGenerator output or a KTX2 read, threadCount 0 uses every core
+	static void compress(const TextureImage& source, TextureCompression compression, TextureImage& compressed, uint32_t threadCount = 0);
+
+	// mips, compression and the KTX2 file in one go
+	static void cookToFile(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb, TextureCompression compression, MipFilter filter,
+		const std::string& path, uint32_t threadCount = 0);
+
+	// 1024x1024, time and error of every format
+	static void benchmark();
+};
\ No newline at end of file
@@ -0,0 +1,625 @@
+#include "TextureStreamer.h"
+#include "VulkanContext.h"
+#include "Tools.h"
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+const float TextureResidency::kMipBiasStep = 0.25f;
+
+TextureResidency::TextureResidency()
+	: budgetBytes(512ull << 20), uploadBytesPerFrame(16ull << 20), maxMipBias(4.0f),
+	lruHead(kNone), lruTail(kNone), frame(0), mipBias(0.0f), residentBytes(0), stats()
+{ }
+
+TextureResidency::~TextureResidency()
+{ }
+
+uint32_t TextureResidency::addTexture(VkFormat format, uint32_t width, uint32_t height, uint32_t mipCount)
+{
+	StreamedMips mips;
+	mips.texelsAtMip0 = (float)std::max(width, height);
+	mips.tailMip = mipCount - 1;
+
+	for (uint32_t i = 0; i < mipCount; i++)
+	{
+		uint32_t levelWidth = std::max(width >> i, 1u);
+		uint32_t levelHeight = std::max(height >> i, 1u);
+		mips.levelSizes.push_back(getTextureLevelSize(format, levelWidth, levelHeight));
+
+		if (std::max(levelWidth, levelHeight) <= kStreamingTailSize)
+		{
+			mips.tailMip = std::min(mips.tailMip, i);
+		}
+	}
+
+	mips.residentMip = mips.tailMip;
+	mips.wantedMip = mips.tailMip;
+	mips.wantedLod = 0.0f;
+	mips.requestFrame = kNone;
+	mips.waitingSince = kNone;
+
+	for (uint32_t i = mips.tailMip; i < mipCount; i++)
+	{
+		residentBytes += mips.levelSizes[i];
+	}
+
+	// new textures go to the back of the list, nothing has drawn them yet
+	uint32_t id = static_cast<uint32_t>(textures.size());
+	mips.previous = lruTail;
+	mips.next = kNone;
+	textures.push_back(mips);
+
+	if (lruTail != kNone)
+	{
+		textures[lruTail].next = id;
+	}
+	else
+	{
+		lruHead = id;
+	}
+	lruTail = id;
+
+	return id;
+}
+
+void TextureResidency::request(uint32_t texture, glm::vec4 worldBoundingSphere, float uvPerWorldUnit)
+{
+	requests.push_back({ texture, worldBoundingSphere, uvPerWorldUnit });
+}
+
+void TextureResidency::unlink(uint32_t texture)
+{
+	StreamedMips& mips = textures[texture];
+
+	if (mips.previous != kNone) textures[mips.previous].next = mips.next; else lruHead = mips.next;
+	if (mips.next != kNone) textures[mips.next].previous = mips.previous; else lruTail = mips.previous;
+}
+
+void TextureResidency::touch(uint32_t texture)
+{
+	if (lruHead == texture)
+	{
+		return;
+	}
+
+	unlink(texture);
+
+	textures[texture].previous = kNone;
+	textures[texture].next = lruHead;
+	textures[lruHead].previous = texture;
+	lruHead = texture;
+}
+
+uint32_t TextureResidency::getWantedMip(const StreamedMips& mips, float bias) const
+{
+	// texels smaller than pixels want the finer mip, trilinear blends towards it
+	float lod = std::floor(mips.wantedLod + bias);
+	return (uint32_t)std::min(std::max(lod, 0.0f), (float)mips.tailMip);
+}
+
+uint64_t TextureResidency::getWantedBytes(float bias) const
+{
+	uint64_t bytes = 0;
+
+	for (uint32_t id : requested)
+	{
+		const StreamedMips& mips = textures[id];
+		for (uint32_t i = getWantedMip(mips, bias); i < mips.tailMip; i++)
+		{
+			bytes += mips.levelSizes[i];
+		}
+	}
+
+	return bytes;
+}
+
+bool TextureResidency::makeRoom(uint64_t bytes, uint32_t loading, std::vector<TextureResidencyChange>& changes)
+{
+	uint32_t candidate = lruTail;
+
+	while (residentBytes + bytes > budgetBytes && candidate != kNone)
+	{
+		StreamedMips& mips = textures[candidate];
+
+		if (candidate != loading && mips.residentMip < mips.wantedMip)
+		{
+			residentBytes -= mips.levelSizes[mips.residentMip];
+			mips.residentMip++;
+
+			stats.evictions++;
+			changes.push_back({ candidate, mips.residentMip });
+			continue;
+		}
+
+		candidate = mips.previous;
+	}
+
+	return residentBytes + bytes <= budgetBytes;
+}
+
+void TextureResidency::update(Camera camera, float viewportHeight, std::vector<TextureResidencyChange>& changes)
+{
+	changes.clear();
+	frame++;
+
+	stats = {};
+	stats.textures = static_cast<uint32_t>(textures.size());
+
+	glm::mat4 view = camera.getViewMatrix();
+	glm::vec3 cameraPosition = glm::vec3(glm::inverse(view)[3]);
+	float pixelsPerUnitAtOne = camera.getprojectionMatrix()[1][1] * 0.5f * viewportHeight;
+
+	// the lowest lod over every surface a texture is drawn on this frame
+	requested.clear();
+	for (const Request& request : requests)
+	{
+		StreamedMips& mips = textures[request.texture];
+
+		float distance = std::max(glm::length(glm::vec3(request.worldBoundingSphere) - cameraPosition) - request.worldBoundingSphere.w, 1e-2f);
+		float texelsPerPixel = mips.texelsAtMip0 * request.uvPerWorldUnit / (pixelsPerUnitAtOne / distance);
+		// magnified is as fine as it gets, clamped so the bias still works on the closest surfaces
+		float lod = std::max(std::log2(texelsPerPixel), 0.0f);
+
+		if (mips.requestFrame != frame)
+		{
+			mips.requestFrame = frame;
+			mips.wantedLod = lod;
+			requested.push_back(request.texture);
+			touch(request.texture);
+		}
+		else
+		{
+			mips.wantedLod = std::min(mips.wantedLod, lod);
+		}
+	}
+	requests.clear();
+
+	// mip bias feedback, straight up while the wanted mips can't fit, down a step at a time once they would with room to spare
+	uint64_t tailBytes = 0;
+	for (const StreamedMips& mips : textures)
+	{
+		for (uint32_t i = mips.tailMip; i < mips.levelSizes.size(); i++)
+		{
+			tailBytes += mips.levelSizes[i];
+		}
+	}
+
+	uint64_t available = budgetBytes > tailBytes ? budgetBytes - tailBytes : 0;
+
+	while (mipBias < maxMipBias && getWantedBytes(mipBias) > available)
+	{
+		mipBias += kMipBiasStep;
+	}
+
+	if (mipBias > 0.0f && getWantedBytes(mipBias - kMipBiasStep) < available * 9 / 10)
+	{
+		mipBias -= kMipBiasStep;
+	}
+
+	stats.mipBias = mipBias;
+	stats.wantedBytes = getWantedBytes(0.0f);
+
+	for (StreamedMips& mips : textures)
+	{
+		mips.wantedMip = mips.requestFrame == frame ? getWantedMip(mips, mipBias) : mips.tailMip;
+	}
+
+	// blurriest first, then one mip per texture per pass so everything sharpens together
+	std::vector<uint32_t> waiting;
+	for (uint32_t id : requested)
+	{
+		if (textures[id].residentMip > textures[id].wantedMip)
+		{
+			waiting.push_back(id);
+		}
+	}
+
+	std::stable_sort(waiting.begin(), waiting.end(), [&](uint32_t a, uint32_t b)
+	{
+		return textures[a].residentMip - textures[a].wantedMip > textures[b].residentMip - textures[b].wantedMip;
+	});
+
+	uint64_t uploadLeft = uploadBytesPerFrame;
+	bool loaded = true;
+
+	while (loaded)
+	{
+		loaded = false;
+
+		for (uint32_t id : waiting)
+		{
+			StreamedMips& mips = textures[id];
+			if (mips.residentMip <= mips.wantedMip)
+			{
+				continue;
+			}
+
+			uint64_t size = mips.levelSizes[mips.residentMip - 1];
+
+			// the allowance is spent, a mip bigger than all of it only goes first thing in a frame
+			if (size > uploadLeft && uploadLeft < uploadBytesPerFrame)
+			{
+				loaded = false;
+				break;
+			}
+
+			if (!makeRoom(size, id, changes))
+			{
+				continue;
+			}
+
+			mips.residentMip--;
+			residentBytes += size;
+			uploadLeft -= std::min(size, uploadLeft);
+
+			stats.loads++;
+			stats.uploadedBytes += size;
+			changes.push_back({ id, mips.residentMip });
+			loaded = true;
+		}
+	}
+
+	for (uint32_t id : requested)
+	{
+		StreamedMips& mips = textures[id];
+
+		if (mips.residentMip > mips.wantedMip)
+		{
+			mips.waitingSince = mips.waitingSince == kNone ? frame : mips.waitingSince;
+			stats.longestWaitFrames = std::max(stats.longestWaitFrames, frame - mips.waitingSince);
+			stats.stalled += mips.residentMip > mips.wantedMip + kStreamingStallMips ? 1 : 0;
+		}
+		else
+		{
+			mips.waitingSince = kNone;
+		}
+	}
+
+	stats.requested = static_cast<uint32_t>(requested.size());
+	stats.residentBytes = residentBytes;
+}
+
+void TextureResidency::benchmark()
+{
+	const uint32_t kTextureCount = 600;
+	const uint32_t kObjectCount = 4000;
+	const float kStreetLength = 4000.0f;
+	const float kSpeed = 30.0f;			// world units per second
+	const float kFrameTime = 1.0f / 60.0f;
+	const float kViewportHeight = 1080.0f;
+
+	struct SceneObject
+	{
+		glm::vec4 boundingSphere;
+		uint32_t texture;
+		float uvPerWorldUnit;
+	};
+
+	// deterministic scatter along both sides of the street
+	uint32_t seed = 2024;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+
+	std::vector<uint32_t> sizes(kTextureCount);
+	for (uint32_t i = 0; i < kTextureCount; i++)
+	{
+		sizes[i] = 1024u << (uint32_t)(random() * 3.0f); // 1k to 4k
+	}
+
+	std::vector<SceneObject> objects(kObjectCount);
+	for (SceneObject& object : objects)
+	{
+		float side = random() < 0.5f ? -1.0f : 1.0f;
+		float radius = 1.0f + random() * 8.0f;
+		object.boundingSphere = glm::vec4(side * (3.0f + random() * 20.0f), random() * 10.0f, -random() * kStreetLength, radius);
+		object.texture = (uint32_t)(random() * kTextureCount) % kTextureCount;
+		object.uvPerWorldUnit = 0.25f + random();
+	}
+
+	const uint64_t budgets[] = { 512ull << 20, 64ull << 20 };
+
+	for (uint64_t budget : budgets)
+	{
+		TextureResidency residency;
+		residency.budgetBytes = budget;
+		residency.uploadBytesPerFrame = 4ull << 20;
+
+		for (uint32_t i = 0; i < kTextureCount; i++)
+		{
+			residency.addTexture(VK_FORMAT_BC7_UNORM_BLOCK, sizes[i], sizes[i], getTextureMipCount(sizes[i], sizes[i]));
+		}
+
+		Camera camera;
+		camera.init(glm::radians(60.0f), 1920.0f, kViewportHeight, 0.1f, 1000.0f);
+
+		std::vector<TextureResidencyChange> changes;
+		uint32_t frames = (uint32_t)(kStreetLength / kSpeed / kFrameTime);
+		uint32_t stallFrames = 0;
+		uint64_t stalledTextureFrames = 0;
+		uint32_t longestWait = 0;
+		uint64_t uploaded = 0;
+		uint64_t peakResident = 0;
+		float peakBias = 0.0f;
+		double updateMs = 0.0;
+
+		// TextureStreamer copies every rebuilt texture's resident chain into staging, done here
+		// with plain memory so the upload cost is counted too, the gpu copy itself doesn't block
+		std::vector<uint8_t> fileData(getTextureLevelSize(VK_FORMAT_BC7_UNORM_BLOCK, 4096, 4096), 1);
+		std::vector<uint8_t> staging;
+		std::vector<uint32_t> rebuilt;
+		uint64_t copied = 0;
+		double copyMs = 0.0;
+		double peakCopyMs = 0.0;
+
+		for (uint32_t f = 0; f < frames; f++)
+		{
+			// down the street with a slow look from side to side
+			float z = -kSpeed * kFrameTime * f;
+			float yaw = std::sin(f * 0.01f) * 0.6f;
+			glm::vec3 position(0.0f, 2.0f, z);
+			camera.lookAt(position, position + glm::vec3(std::sin(yaw), 0.0f, -std::cos(yaw)));
+
+			glm::vec4 planes[6];
+			camera.getFrustumPlanes(planes);
+
+			auto start = std::chrono::high_resolution_clock::now();
+
+			for (const SceneObject& object : objects)
+			{
+				bool visible = true;
+				for (int p = 0; p < 6 && visible; p++)
+				{
+					visible = glm::dot(glm::vec3(planes[p]), glm::vec3(object.boundingSphere)) + planes[p].w >= -object.boundingSphere.w;
+				}
+
+				if (visible)
+				{
+					residency.request(object.texture, object.boundingSphere, object.uvPerWorldUnit);
+				}
+			}
+
+			residency.update(camera, kViewportHeight, changes);
+
+			updateMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+			start = std::chrono::high_resolution_clock::now();
+
+			rebuilt.clear();
+			uint64_t stagingSize = 0;
+			for (const TextureResidencyChange& change : changes)
+			{
+				if (std::find(rebuilt.begin(), rebuilt.end(), change.texture) == rebuilt.end())
+				{
+					rebuilt.push_back(change.texture);
+
+					const StreamedMips& mips = residency.textures[change.texture];
+					for (uint32_t i = mips.residentMip; i < mips.levelSizes.size(); i++)
+					{
+						stagingSize += mips.levelSizes[i];
+					}
+				}
+			}
+
+			staging.resize(std::max<size_t>(staging.size(), (size_t)stagingSize));
+			for (uint64_t offset = 0; offset < stagingSize; offset += fileData.size())
+			{
+				memcpy(staging.data() + offset, fileData.data(), (size_t)std::min<uint64_t>(fileData.size(), stagingSize - offset));
+			}
+			copied += stagingSize;
+
+			double frameCopyMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			copyMs += frameCopyMs;
+			peakCopyMs = std::max(peakCopyMs, frameCopyMs);
+
+			TextureStreamingStats stats = residency.getStats();
+			stallFrames += stats.stalled > 0 ? 1 : 0;
+			stalledTextureFrames += stats.stalled;
+			longestWait = std::max(longestWait, stats.longestWaitFrames);
+			uploaded += stats.uploadedBytes;
+			peakResident = std::max(peakResident, stats.residentBytes);
+			peakBias = std::max(peakBias, stats.mipBias);
+		}
+
+		std::cout << std::fixed << std::setprecision(2)
+			<< "TextureResidency: " << kTextureCount << " textures on " << kObjectCount << " objects, " << frames << " frames, budget " << (budget >> 20)
+			<< " MB, " << stallFrames << " frames with stalls (" << stalledTextureFrames << " texture frames), longest wait " << longestWait
+			<< " frames, peak resident " << (peakResident >> 20) << " MB, uploaded " << (uploaded >> 20) << " MB, peak bias " << peakBias
+			<< ", " << updateMs / frames << " ms per frame, staging copies " << (copied >> 20) << " MB, " << copyMs / frames
+			<< " ms per frame, " << peakCopyMs << " ms worst frame" << std::endl;
+	}
+}
+
+TextureStreamer::TextureStreamer()
+	: commandPool(VK_NULL_HANDLE), uploadMs(0.0)
+{ }
+
+TextureStreamer::~TextureStreamer()
+{ }
+
+uint32_t TextureStreamer::addTexture(const std::string& path)
+{
+	std::unique_ptr<StreamedTexture> streamed(new StreamedTexture());
+	streamed->file.open(path);
+
+	const Ktx2Header& header = streamed->file.getHeader();
+	uint32_t id = residency.addTexture(streamed->file.getFormat(), header.pixelWidth, header.pixelHeight, streamed->file.getLevelCount());
+
+	// the tail is small and needed before the first frame, it waits like the rest of vkTools
+	streamed->residentMip = residency.getResidentMip(id);
+	streamed->texture.createFromFile(streamed->file, streamed->residentMip);
+	streamed->version = 1;
+
+	textures.push_back(std::move(streamed));
+	return id;
+}
+
+void TextureStreamer::request(uint32_t texture, glm::vec4 worldBoundingSphere, float uvPerWorldUnit)
+{
+	residency.request(texture, worldBoundingSphere, uvPerWorldUnit);
+}
+
+void TextureStreamer::update(Camera camera, float viewportHeight)
+{
+	releaseFinishedUploads(false);
+
+	residency.update(camera, viewportHeight, changes);
+
+	// only the last change of each texture matters, anything else would upload mips that are dropped again
+	rebuilds.clear();
+	for (const TextureResidencyChange& change : changes)
+	{
+		if (textures[change.texture]->residentMip != residency.getResidentMip(change.texture) &&
+			std::find(rebuilds.begin(), rebuilds.end(), change.texture) == rebuilds.end())
+		{
+			rebuilds.push_back(change.texture);
+		}
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	if (!rebuilds.empty())
+	{
+		uploadRebuilds();
+	}
+
+	uploadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void TextureStreamer::uploadRebuilds()
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	if (commandPool == VK_NULL_HANDLE)
+	{
+		VkCommandPoolCreateInfo cpInfo = {};
+		cpInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		cpInfo.queueFamilyIndex = VulkanContext::getInstance()->getDevice()->getQueueFamiliesIndicesOfCurrentDevice().graphicsFamily;
+		cpInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		if (vkCreateCommandPool(logicalDevice, &cpInfo, nullptr, &commandPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create the texture streaming command pool!");
+		}
+	}
+
+	// every texture's levels back to back, the sizes keep each start aligned
+	std::vector<uint64_t> offsets(rebuilds.size());
+	uint64_t stagingSize = 0;
+
+	for (size_t i = 0; i < rebuilds.size(); i++)
+	{
+		offsets[i] = stagingSize;
+		stagingSize += Texture::getUploadSize(textures[rebuilds[i]]->file, residency.getResidentMip(rebuilds[i]));
+	}
+
+	PendingUpload upload;
+	vkTools::createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		upload.stagingBuffer, upload.stagingBufferMemory);
+
+	void* mapped;
+	vkMapMemory(logicalDevice, upload.stagingBufferMemory, 0, stagingSize, 0, &mapped);
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = commandPool;
+	allocInfo.commandBufferCount = 1;
+	vkAllocateCommandBuffers(logicalDevice, &allocInfo, &upload.commandBuffer);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(upload.commandBuffer, &beginInfo);
+
+	for (size_t i = 0; i < rebuilds.size(); i++)
+	{
+		StreamedTexture& streamed = *textures[rebuilds[i]];
+		uint32_t residentMip = residency.getResidentMip(rebuilds[i]);
+
+		Texture texture;
+		texture.recordUploadFromFile(streamed.file, residentMip, upload.commandBuffer, upload.stagingBuffer, static_cast<uint8_t*>(mapped), offsets[i]);
+
+		upload.replaced.push_back(streamed.texture);
+		streamed.texture = texture;
+		streamed.residentMip = residentMip;
+		streamed.version++;
+	}
+
+	vkUnmapMemory(logicalDevice, upload.stagingBufferMemory);
+	vkEndCommandBuffer(upload.commandBuffer);
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	vkCreateFence(logicalDevice, &fenceInfo, nullptr, &upload.fence);
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &upload.commandBuffer;
+
+	if (vkQueueSubmit(VulkanContext::getInstance()->getDevice()->graphicsQueue, 1, &submitInfo, upload.fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to submit the texture uploads!");
+	}
+
+	pendingUploads.push_back(upload);
+}
+
+void TextureStreamer::releaseFinishedUploads(bool wait)
+{
+	VkDevice logicalDevice = VulkanContext::getInstance()->getDevice()->logicalDevice;
+
+	// submitted in order, they finish in order
+	size_t finished = 0;
+	for (; finished < pendingUploads.size(); finished++)
+	{
+		PendingUpload& upload = pendingUploads[finished];
+
+		if (wait)
+		{
+			vkWaitForFences(logicalDevice, 1, &upload.fence, VK_TRUE, UINT64_MAX);
+		}
+		else if (vkGetFenceStatus(logicalDevice, upload.fence) != VK_SUCCESS)
+		{
+			break;
+		}
+
+		for (Texture& texture : upload.replaced)
+		{
+			texture.destroy();
+		}
+
+		vkDestroyFence(logicalDevice, upload.fence, nullptr);
+		vkFreeCommandBuffers(logicalDevice, commandPool, 1, &upload.commandBuffer);
+		vkDestroyBuffer(logicalDevice, upload.stagingBuffer, nullptr);
+		vkFreeMemory(logicalDevice, upload.stagingBufferMemory, nullptr);
+	}
+
+	pendingUploads.erase(pendingUploads.begin(), pendingUploads.begin() + finished);
+}
+
+void TextureStreamer::destroy()
+{
+	releaseFinishedUploads(true);
+
+	if (commandPool != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(VulkanContext::getInstance()->getDevice()->logicalDevice, commandPool, nullptr);
+		commandPool = VK_NULL_HANDLE;
+	}
+
+	for (std::unique_ptr<StreamedTexture>& streamed : textures)
+	{
+		streamed->texture.destroy();
+		streamed->file.close();
+	}
+
+	textures.clear();
+}
\ No newline at end of file
@@ -0,0 +1,185 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <memory>
+#include <string>
+
+#include "Camera.h"
+#include "Ktx2.h"
+#include "Texture.h"
+
+// mips this size and smaller stay resident from the moment a texture is added
+static const uint32_t kStreamingTailSize = 128;
+// a drawn texture more mips than this coarser than it wants counts as a stall
+static const uint32_t kStreamingStallMips = 1;
+
+struct TextureStreamingStats
+{
+	uint32_t textures;
+	uint32_t requested;			// drawn this frame
+	uint32_t stalled;			// of those, more than kStreamingStallMips coarser than wanted
+	uint32_t loads;				// mips uploaded this frame
+	uint32_t evictions;			// mips dropped this frame
+	uint32_t longestWaitFrames;	// of the textures still waiting for their wanted mip
+	float mipBias;
+	uint64_t residentBytes;
+	uint64_t wantedBytes;		// what the requested textures want without the bias
+	uint64_t uploadedBytes;
+};
+
+// the finest resident mip of a texture after a load or an eviction
+struct TextureResidencyChange
+{
+	uint32_t texture;
+	uint32_t residentMip;
+};
+
+// -- Texture residency
+// Which mips of every streamed texture should be in VRAM, decided without touching the gpu so the
+// same policy runs under TextureStreamer and in simulation.
+// A drawn texture wants the mip whose texels come out about a pixel on screen at the closest point
+// of what it's drawn on. Missing mips load one level at a time from coarse to fine, the blurriest
+// textures first, within a per frame upload allowance. A load that doesn't fit the budget drops
+// mips the least recently drawn textures don't want right now, and when even the wanted mips don't
+// fit, the mip bias goes up until they do and comes back down once there is room again.
+class TextureResidency
+{
+public:
+	TextureResidency();
+	~TextureResidency();
+
+	uint64_t budgetBytes;
+	uint64_t uploadBytesPerFrame;	// a single mip larger than this still goes, alone
+	float maxMipBias;
+
+	// the mip tail is resident from the start, returns the texture id
+	uint32_t addTexture(VkFormat format, uint32_t width, uint32_t height, uint32_t mipCount);
+
+	// the texture is drawn this frame on a surface inside worldBoundingSphere,
+	// uvPerWorldUnit is how often it repeats per world unit there
+	void request(uint32_t texture, glm::vec4 worldBoundingSphere, float uvPerWorldUnit);
+
+	// wanted mips of this frame's requests, then loads and evictions in the order they happen,
+	// a texture can change more than once and its last change is the one that counts
+	void update(Camera camera, float viewportHeight, std::vector<TextureResidencyChange>& changes);
+
+	uint32_t getResidentMip(uint32_t texture) const { return textures[texture].residentMip; }
+	uint32_t getWantedMip(uint32_t texture) const { return textures[texture].wantedMip; }
+	TextureStreamingStats getStats() const { return stats; }
+
+	// a camera flying down a long street of textured objects, reports stalls at two budgets
+	static void benchmark();
+
+private:
+	static const uint32_t kNone = UINT32_MAX;
+	static const float kMipBiasStep;
+
+	struct StreamedMips
+	{
+		std::vector<uint64_t> levelSizes;
+		float texelsAtMip0;		// the longer side
+		uint32_t tailMip;		// this mip and everything coarser never leaves
+		uint32_t residentMip;
+		uint32_t wantedMip;
+
+		// log2 of texels per pixel, the lowest of this frame's requests
+		float wantedLod;
+		uint32_t requestFrame;
+		uint32_t waitingSince;	// frame the wanted mip went missing, kNone while it's there
+
+		// least recently used list, the most recently drawn at the head
+		uint32_t previous;
+		uint32_t next;
+	};
+
+	struct Request
+	{
+		uint32_t texture;
+		glm::vec4 worldBoundingSphere;
+		float uvPerWorldUnit;
+	};
+
+	std::vector<StreamedMips> textures;
+	std::vector<Request> requests;
+	std::vector<uint32_t> requested;	// this frame, each once
+	uint32_t lruHead;
+	uint32_t lruTail;
+
+	uint32_t frame;
+	float mipBias;
+	uint64_t residentBytes;
+	TextureStreamingStats stats;
+
+	void unlink(uint32_t texture);
+	void touch(uint32_t texture);
+
+	uint32_t getWantedMip(const StreamedMips& mips, float bias) const;
+	uint64_t getWantedBytes(float bias) const;
+
+	// drops unwanted mips from the back of the list until bytes more fit, never from the one being loaded
+	bool makeRoom(uint64_t bytes, uint32_t loading, std::vector<TextureResidencyChange>& changes);
+};
+
+// -- Texture streamer
+// KTX2 textures streamed through TextureResidency. Each image only holds the resident mips and is
+// rebuilt from the mapped file when its residency changes, so the coarser mips are uploaded again
+// with the new one, together a third of its size. A rebuild bumps the version so whoever holds a
+// descriptor of the texture knows to rewrite it.
+// All rebuilds of a frame share one staging buffer and one submit that nobody waits for. The images
+// they replace may still be read by frames in flight, they are destroyed once the submit's fence
+// has signalled, and the fence covers everything submitted before it.
+class TextureStreamer
+{
+public:
+	TextureStreamer();
+	~TextureStreamer();
+
+	TextureResidency residency;
+
+	// the file needs its mips, the tail is uploaded right away
+	uint32_t addTexture(const std::string& path);
+	void request(uint32_t texture, glm::vec4 worldBoundingSphere, float uvPerWorldUnit);
+
+	// before recording the frame, on the graphics queue the frame is submitted to
+	void update(Camera camera, float viewportHeight);
+
+	const Texture& getTexture(uint32_t texture) const { return textures[texture]->texture; }
+	uint32_t getVersion(uint32_t texture) const { return textures[texture]->version; }
+
+	// cpu time the last update spent on uploads, staging copies and recording, and the submits still in flight
+	double getUploadMs() const { return uploadMs; }
+	uint32_t getPendingUploadCount() const { return static_cast<uint32_t>(pendingUploads.size()); }
+
+	void destroy();
+
+private:
+	struct StreamedTexture
+	{
+		Ktx2File file;
+		Texture texture;
+		uint32_t residentMip;
+		uint32_t version;
+	};
+
+	// one frame's rebuilds, everything here is released once the fence has signalled
+	struct PendingUpload
+	{
+		VkFence fence;
+		VkCommandBuffer commandBuffer;
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		std::vector<Texture> replaced;
+	};
+
+	std::vector<std::unique_ptr<StreamedTexture>> textures;
+	std::vector<TextureResidencyChange> changes;
+	std::vector<uint32_t> rebuilds;
+
+	VkCommandPool commandPool;
+	std::vector<PendingUpload> pendingUploads;
+	double uploadMs;
+
+	void uploadRebuilds();
+	// wait to release them all, at destroy
+	void releaseFinishedUploads(bool wait);
+};
\ No newline at end of file
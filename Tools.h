@@ -2,18 +2,39 @@
 #include <vulkan/vulkan.h>
 #include <stdexcept>
 #include <vector>
+#include <string>
+#include <fstream>
+#include <functional>
 
 namespace vkTools
 {
-	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
+	// view of mips 0 .. mipLevels - 1
+	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels = 1);
 
 	uint32_t findMemoryTypeIndex(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
 	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+	void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
 
 	VkCommandBuffer beginSingleTimeCommands(VkCommandPool commandPool);
 	void endSingleTimeCommands(VkCommandBuffer commandBuffer, VkCommandPool commandPool);
 
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+	// mip 0 of an image in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, the buffer tightly packed
+	void copyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height);
+	// any number of regions in one submit, a whole mip chain at once
+	void copyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, const std::vector<VkBufferImageCopy>& regions);
+	// fills mips 1 .. mipLevels - 1 from mip 0 with linear blits, every mip starts in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+	// and ends in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, the format has to support linear filtering
+	void blitMipChain(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels);
+
+	// device local buffer filled through a temporary staging buffer, data is copied straight into the staging memory
+	void createDeviceLocalBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+	// same, fill writes the contents into the mapped staging memory, for data that is decoded on load
+	void createDeviceLocalBuffer(VkDeviceSize size, VkBufferUsageFlags usage, const std::function<void(void*)>& fill, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+	void transitionImageLayout(VkImage image, VkImageAspectFlags aspectFlags, uint32_t mipLevels, VkImageLayout oldLayout, VkImageLayout newLayout);
+
+	std::vector<char> readFile(const std::string& filename);
+	VkShaderModule createShaderModule(const std::vector<char>& code);
 };
 
@@ -0,0 +1,229 @@
+#include "VertexAnimation.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+
+#include "MappedFile.h"
+#include "Parallel.h"
+
+static uint32_t packSnorm8(glm::vec3 value)
+{
+	uint32_t packed = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		int32_t component = (int32_t)std::lround(glm::clamp(value[i], -1.0f, 1.0f) * 127.0f);
+		packed |= (uint32_t)(component & 0xff) << (i * 8);
+	}
+	return packed;
+}
+
+// the same blend and frame decode as skinning.comp
+static void skinVertex(const SkinningVertex& vertex, const std::vector<glm::mat4>& skinning, glm::vec3& position, glm::vec3& normal)
+{
+	glm::mat4 skin(0.0f);
+	for (int i = 0; i < 4; i++)
+	{
+		float weight = ((vertex.weights >> (i * 8)) & 0xff) / 255.0f;
+		if (weight > 0.0f)
+		{
+			skin += skinning[(vertex.joints >> (i * 8)) & 0xff] * weight;
+		}
+	}
+
+	glm::quat frame = glm::normalize(glm::quat(vertex.tangentFrame.w, vertex.tangentFrame.x, vertex.tangentFrame.y, vertex.tangentFrame.z));
+
+	position = glm::vec3(skin * glm::vec4(glm::vec3(vertex.position), 1.0f));
+	normal = glm::normalize(glm::mat3(skin) * (frame * glm::vec3(0.0f, 0.0f, 1.0f)));
+}
+
+void VertexAnimationBaker::bake(const Skeleton& skeleton, const std::vector<SkinningVertex>& vertices, const std::vector<const AnimationClip*>& clips,
+	float frameRate, BakedVertexAnimation& baked)
+{
+	if (vertices.empty() || clips.empty() || !(frameRate > 0.0f))
+	{
+		throw std::runtime_error("vertex animation needs vertices, clips and a frame rate!");
+	}
+
+	uint32_t jointCount = skeleton.getJointCount();
+
+	for (const SkinningVertex& vertex : vertices)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			if (((vertex.joints >> (i * 8)) & 0xff) >= jointCount && ((vertex.weights >> (i * 8)) & 0xff) != 0)
+			{
+				throw std::runtime_error("vertex animation vertex uses a joint the skeleton doesn't have!");
+			}
+		}
+	}
+
+	baked.vertexCount = static_cast<uint32_t>(vertices.size());
+	baked.clips.resize(clips.size());
+
+	// clip lengths decide the layout, so the clip table comes first
+	uint32_t frameCount = 0;
+	for (size_t i = 0; i < clips.size(); i++)
+	{
+		VertexAnimationClip& clip = baked.clips[i];
+		clip.duration = clips[i]->duration;
+		clip.frameCount = std::max(2u, (uint32_t)std::ceil(clip.duration * frameRate) + 1);
+		clip.frameRate = clip.duration > 0.0f ? (clip.frameCount - 1) / clip.duration : 0.0f;
+		clip.firstFrame = frameCount;
+
+		frameCount += clip.frameCount;
+	}
+
+	baked.frameCount = frameCount;
+
+	uint64_t texelCount = (uint64_t)frameCount * baked.vertexCount;
+	baked.textureHeight = static_cast<uint32_t>((texelCount + kVertexAnimationTextureWidth - 1) / kVertexAnimationTextureWidth);
+
+	size_t paddedTexelCount = (size_t)baked.textureHeight * kVertexAnimationTextureWidth;
+	baked.positions.assign(paddedTexelCount * 4, 0);
+	baked.normals.assign(paddedTexelCount, 0);
+
+	// a clip per job, its cursor only ever plays forward
+	std::vector<float> clipRadii(clips.size(), 0.0f);
+
+	glm::vec3 center(0.0f);
+	for (const SkinningVertex& vertex : vertices)
+	{
+		center += glm::vec3(vertex.position);
+	}
+	center /= (float)vertices.size();
+
+	parallelFor(static_cast<uint32_t>(clips.size()), [&](uint32_t clipIndex)
+	{
+		const AnimationClip& source = *clips[clipIndex];
+		const VertexAnimationClip& clip = baked.clips[clipIndex];
+
+		AnimationCursor cursor;
+		Pose pose;
+		std::vector<glm::mat4> model;
+		std::vector<glm::mat4> skinning;
+
+		float radius = 0.0f;
+
+		for (uint32_t frame = 0; frame < clip.frameCount; frame++)
+		{
+			// sample wraps at duration, the last frame has to stay the end of the clip
+			float time = clip.frameRate > 0.0f ? frame / clip.frameRate : 0.0f;
+			time = std::min(time, std::nextafter(source.duration, 0.0f));
+
+			source.sample(std::max(time, 0.0f), cursor, pose);
+			PoseBlending::localToModel(skeleton, pose, model);
+			PoseBlending::getSkinningMatrices(skeleton, model, skinning);
+
+			size_t texel = (size_t)(clip.firstFrame + frame) * baked.vertexCount;
+
+			for (uint32_t v = 0; v < baked.vertexCount; v++, texel++)
+			{
+				glm::vec3 position, normal;
+				skinVertex(vertices[v], skinning, position, normal);
+
+				uint16_t* packed = &baked.positions[texel * 4];
+				packed[0] = VertexPacking::floatToHalf(position.x);
+				packed[1] = VertexPacking::floatToHalf(position.y);
+				packed[2] = VertexPacking::floatToHalf(position.z);
+				packed[3] = VertexPacking::floatToHalf(1.0f);
+
+				baked.normals[texel] = packSnorm8(normal);
+
+				radius = std::max(radius, glm::length(position - center));
+			}
+		}
+
+		clipRadii[clipIndex] = radius;
+	});
+
+	baked.boundingSphere = glm::vec4(center, *std::max_element(clipRadii.begin(), clipRadii.end()));
+}
+
+void VertexAnimationBaker::writeFile(const std::string& path, const BakedVertexAnimation& baked)
+{
+	VertexAnimationFileHeader header = {};
+	header.magic = kVertexAnimationMagic;
+	header.version = kVertexAnimationVersion;
+	header.vertexCount = baked.vertexCount;
+	header.frameCount = baked.frameCount;
+	header.clipCount = static_cast<uint32_t>(baked.clips.size());
+	header.textureWidth = kVertexAnimationTextureWidth;
+	header.textureHeight = baked.textureHeight;
+	memcpy(header.boundingSphere, &baked.boundingSphere, sizeof(float) * 4);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to create vertex animation " + path);
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(baked.clips.data()), sizeof(VertexAnimationClip) * baked.clips.size());
+	file.write(reinterpret_cast<const char*>(baked.positions.data()), sizeof(uint16_t) * baked.positions.size());
+	file.write(reinterpret_cast<const char*>(baked.normals.data()), sizeof(uint32_t) * baked.normals.size());
+
+	if (!file.good())
+	{
+		throw std::runtime_error("failed to write vertex animation " + path);
+	}
+}
+
+void VertexAnimationBaker::readFile(const std::string& path, BakedVertexAnimation& baked)
+{
+	MappedFile file;
+	file.open(path);
+
+	if (file.size < sizeof(VertexAnimationFileHeader))
+	{
+		throw std::runtime_error("not a vertex animation " + path);
+	}
+
+	VertexAnimationFileHeader header;
+	memcpy(&header, file.data, sizeof(header));
+
+	if (header.magic != kVertexAnimationMagic)
+	{
+		throw std::runtime_error("not a vertex animation " + path);
+	}
+
+	if (header.version != kVertexAnimationVersion || header.textureWidth != kVertexAnimationTextureWidth)
+	{
+		throw std::runtime_error("vertex animation version mismatch, rebake " + path);
+	}
+
+	uint64_t texelCount = (uint64_t)header.textureHeight * kVertexAnimationTextureWidth;
+	uint64_t expectedSize = sizeof(header) + sizeof(VertexAnimationClip) * (uint64_t)header.clipCount + texelCount * (sizeof(uint16_t) * 4 + sizeof(uint32_t));
+
+	if (file.size != expectedSize || (uint64_t)header.frameCount * header.vertexCount > texelCount)
+	{
+		throw std::runtime_error("vertex animation is corrupt " + path);
+	}
+
+	baked.vertexCount = header.vertexCount;
+	baked.frameCount = header.frameCount;
+	baked.textureHeight = header.textureHeight;
+	memcpy(&baked.boundingSphere, header.boundingSphere, sizeof(float) * 4);
+
+	const uint8_t* cursor = file.data + sizeof(header);
+
+	baked.clips.resize(header.clipCount);
+	memcpy(baked.clips.data(), cursor, sizeof(VertexAnimationClip) * header.clipCount);
+	cursor += sizeof(VertexAnimationClip) * header.clipCount;
+
+	for (const VertexAnimationClip& clip : baked.clips)
+	{
+		if (clip.frameCount < 2 || (uint64_t)clip.firstFrame + clip.frameCount > header.frameCount)
+		{
+			throw std::runtime_error("vertex animation is corrupt " + path);
+		}
+	}
+
+	baked.positions.resize((size_t)texelCount * 4);
+	memcpy(baked.positions.data(), cursor, sizeof(uint16_t) * baked.positions.size());
+	cursor += sizeof(uint16_t) * baked.positions.size();
+
+	baked.normals.resize((size_t)texelCount);
+	memcpy(baked.normals.data(), cursor, sizeof(uint32_t) * baked.normals.size());
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "Skeleton.h"
+#include "AnimationClip.h"
+#include "GpuSkinning.h"
+
+// -- Vertex animation textures
+// Skeletal clips skinned offline, every frame of every clip stored as the skinned position and
+// normal of each vertex. The crowd vertex shader looks up two frames and blends them, so an agent
+// costs nothing on the cpu beyond its transform and where it is in its clip.
+//
+// Texel (frame * vertexCount + vertex) holds a vertex, rows are kVertexAnimationTextureWidth wide
+// so meshes with more vertices than a texture is wide still fit. Frames of all clips are back to back.
+
+static const uint32_t kVertexAnimationMagic = 0x54415655; // "UVAT"
+static const uint32_t kVertexAnimationVersion = 1;
+static const uint32_t kVertexAnimationTextureWidth = 2048;
+
+// matches CrowdClip in Shaders/crowd.vert (std140)
+struct VertexAnimationClip
+{
+	uint32_t firstFrame;
+	uint32_t frameCount;	// at least 2, the last one is the end of the clip
+	float frameRate;		// frames per second of clip time, (frameCount - 1) / duration
+	float duration;
+};
+
+struct BakedVertexAnimation
+{
+	uint32_t vertexCount;
+	uint32_t frameCount;	// all clips
+	uint32_t textureHeight;
+
+	std::vector<VertexAnimationClip> clips;
+
+	// one texel per vertex and frame
+	std::vector<uint16_t> positions;	// half4, w is 1	VK_FORMAT_R16G16B16A16_SFLOAT
+	std::vector<uint32_t> normals;		// snorm8 xyz		VK_FORMAT_R8G8B8A8_SNORM
+
+	// holds every frame of every clip, local space center xyz and radius w
+	glm::vec4 boundingSphere;
+};
+
+struct VertexAnimationFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t frameCount;
+	uint32_t clipCount;
+	uint32_t textureWidth;
+	uint32_t textureHeight;
+	uint32_t padding;
+	float boundingSphere[4];
+};
+
+class VertexAnimationBaker
+{
+public:
+	// vertices as GpuSkinning takes them, joint indices in skeleton order
+	// every clip is sampled at frameRate and skinned, clips are baked in parallel
+	static void bake(const Skeleton& skeleton, const std::vector<SkinningVertex>& vertices, const std::vector<const AnimationClip*>& clips,
+		float frameRate, BakedVertexAnimation& baked);
+
+	// header, clip table, positions then normals
+	static void writeFile(const std::string& path, const BakedVertexAnimation& baked);
+	static void readFile(const std::string& path, BakedVertexAnimation& baked);
+};
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include "VertexFormat.h"
+#include "Mesh.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+uint16_t VertexPacking::floatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int32_t exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = bits & 0x007fffff;
+
+	// inf and nan, nan keeps a mantissa bit so it stays a nan
+	if (((bits >> 23) & 0xff) == 0xff)
+	{
+		return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+	}
+
+	// too large, clamp to inf
+	if (exponent >= 31)
+	{
+		return (uint16_t)(sign | 0x7c00);
+	}
+
+	// denormal or zero, shift the implicit one in and round to nearest even
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+		{
+			return (uint16_t)sign;
+		}
+
+		mantissa |= 0x00800000;
+		uint32_t shift = (uint32_t)(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+		{
+			half++;
+		}
+
+		return (uint16_t)(sign | half);
+	}
+
+	// normal, round to nearest even, a carry out of the mantissa bumps the exponent which is correct
+	uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1fff;
+
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+	{
+		half++;
+	}
+
+	return (uint16_t)half;
+}
+
+float VertexPacking::halfToFloat(uint16_t value)
+{
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+	uint32_t bits;
+
+	if (exponent == 0x1f)
+	{
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	}
+	else if (exponent == 0)
+	{
+		// denormal, mantissa * 2^-24
+		float result = (float)mantissa * (1.0f / 16777216.0f);
+		return sign ? -result : result;
+	}
+	else
+	{
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+// snorm16 can't hold a zero w with a sign, keep |w| at least one step away from it
+static const float kTangentFrameBias = 1.0f / 32767.0f;
+
+glm::quat VertexPacking::packTangentFrame(glm::vec3 normal, glm::vec4 tangent)
+{
+	glm::vec3 n = glm::normalize(normal);
+
+	// Gram-Schmidt, and any perpendicular when the tangent is missing or parallel to the normal
+	glm::vec3 t = glm::vec3(tangent) - n * glm::dot(n, glm::vec3(tangent));
+	if (glm::dot(t, t) < 1e-12f)
+	{
+		t = std::abs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		t = t - n * glm::dot(n, t);
+	}
+	t = glm::normalize(t);
+
+	// always a rotation, the reflection is kept in the sign of w
+	glm::quat frame = glm::normalize(glm::quat_cast(glm::mat3(t, glm::cross(n, t), n)));
+
+	if (frame.w < 0.0f)
+	{
+		frame = -frame;
+	}
+
+	if (frame.w < kTangentFrameBias)
+	{
+		float scale = std::sqrt(1.0f - kTangentFrameBias * kTangentFrameBias);
+		frame = glm::quat(kTangentFrameBias, frame.x * scale, frame.y * scale, frame.z * scale);
+	}
+
+	return tangent.w < 0.0f ? -frame : frame;
+}
+
+void VertexPacking::unpackTangentFrame(glm::quat frame, glm::vec3& normal, glm::vec4& tangent)
+{
+	frame = glm::normalize(frame);
+
+	normal = frame * glm::vec3(0.0f, 0.0f, 1.0f);
+	tangent = glm::vec4(frame * glm::vec3(1.0f, 0.0f, 0.0f), frame.w < 0.0f ? -1.0f : 1.0f);
+}
+
+static int16_t toSnorm16(float value)
+{
+	return (int16_t)std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+static uint8_t toUnorm8(float value)
+{
+	return (uint8_t)std::lround(glm::clamp(value, 0.0f, 1.0f) * 255.0f);
+}
+
+CompactVertex VertexPacking::packVertex(const Vertex& vertex)
+{
+	CompactVertex packed;
+
+	packed.pos[0] = floatToHalf(vertex.pos.x);
+	packed.pos[1] = floatToHalf(vertex.pos.y);
+	packed.pos[2] = floatToHalf(vertex.pos.z);
+	packed.pos[3] = floatToHalf(1.0f);
+
+	glm::quat frame = packTangentFrame(vertex.normal, vertex.tangent);
+	packed.tangentFrame[0] = toSnorm16(frame.x);
+	packed.tangentFrame[1] = toSnorm16(frame.y);
+	packed.tangentFrame[2] = toSnorm16(frame.z);
+	packed.tangentFrame[3] = toSnorm16(frame.w);
+
+	packed.color[0] = toUnorm8(vertex.color.r);
+	packed.color[1] = toUnorm8(vertex.color.g);
+	packed.color[2] = toUnorm8(vertex.color.b);
+	packed.color[3] = 255;
+
+	packed.texCoords[0] = floatToHalf(vertex.texCoords.x);
+	packed.texCoords[1] = floatToHalf(vertex.texCoords.y);
+
+	return packed;
+}
+
+void VertexPacking::packVertices(const std::vector<Vertex>& vertices, std::vector<CompactVertex>& outVertices)
+{
+	outVertices.resize(vertices.size());
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		outVertices[i] = packVertex(vertices[i]);
+	}
+}
+
+void VertexPacking::packStreams(const std::vector<Vertex>& vertices, std::vector<PositionStreamVertex>& outPositions, std::vector<AttributeStreamVertex>& outAttributes)
+{
+	outPositions.resize(vertices.size());
+	outAttributes.resize(vertices.size());
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		CompactVertex packed = packVertex(vertices[i]);
+
+		memcpy(outPositions[i].pos, packed.pos, sizeof(packed.pos));
+		memcpy(outAttributes[i].tangentFrame, packed.tangentFrame, sizeof(packed.tangentFrame));
+		memcpy(outAttributes[i].color, packed.color, sizeof(packed.color));
+		memcpy(outAttributes[i].texCoords, packed.texCoords, sizeof(packed.texCoords));
+	}
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "Dependencies\glm\glm\glm.hpp"
+#include <glm\gtc\quaternion.hpp>
+
+// -- Vertex formats
+// A format is a vertex struct plus a list of VertexAttribute, the binding and
+// attribute descriptions the pipeline needs are generated from that at compile time.
+//
+//	typedef VertexFormat<MyVertex,
+//		VertexAttribute<0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(MyVertex, pos)>,
+//		VertexAttribute<1, VK_FORMAT_R8G8B8A8_UNORM, offsetof(MyVertex, color)>> MyVertexFormat;
+
+// split mesh streams, a stream is always read from the binding of the same number
+enum VertexStream
+{
+	kVertexStreamPosition = 0,
+	kVertexStreamAttributes = 1,
+	kVertexStreamCount = 2
+};
+
+// what a pipeline reads, built from one or more formats
+// streamMask has bit (1 << VertexStream) set for every mesh stream it needs bound
+struct VertexInputDescription
+{
+	std::vector<VkVertexInputBindingDescription> bindings;
+	std::vector<VkVertexInputAttributeDescription> attributes;
+	uint32_t streamMask = 0;
+};
+
+// location in the vertex shader, format of the data and offsetof the member it reads
+template<uint32_t Location, VkFormat Format, uint32_t Offset>
+struct VertexAttribute
+{
+	static constexpr VkVertexInputAttributeDescription describe(uint32_t binding)
+	{
+		return { Location, binding, Format, Offset };
+	}
+};
+
+template<typename VertexType, typename... Attributes>
+struct VertexFormat
+{
+	static constexpr uint32_t kStride = sizeof(VertexType);
+	static constexpr uint32_t kAttributeCount = sizeof...(Attributes);
+
+	// --Describes the rate at which rate to load data from memory
+	//-- Specifies Number of bytes
+	//-- Whether to move to next data entry after each vertex or instance
+	static constexpr VkVertexInputBindingDescription getBindingDescription(uint32_t binding = 0, VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX)
+	{
+		return { binding, kStride, inputRate };
+	}
+
+	//-- How to handle vertex input
+	static constexpr std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> getAttributeDescriptions(uint32_t binding = 0)
+	{
+		return {{ Attributes::describe(binding)... }};
+	}
+
+	// adds this format to a pipeline's vertex input on the given binding
+	// VK_VERTEX_INPUT_RATE_INSTANCE for per instance data
+	static void addToInputDescription(VertexInputDescription& description, uint32_t binding = 0, VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX)
+	{
+		description.bindings.push_back(getBindingDescription(binding, inputRate));
+
+		for (const VkVertexInputAttributeDescription& attribute : getAttributeDescriptions(binding))
+		{
+			description.attributes.push_back(attribute);
+		}
+	}
+
+	static VertexInputDescription getInputDescription(uint32_t binding = 0, VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX)
+	{
+		VertexInputDescription description;
+		addToInputDescription(description, binding, inputRate);
+		return description;
+	}
+};
+
+// 24 bytes against the 60 of Vertex
+// the tangent frame is a quaternion rotating x, y, z onto tangent, bitangent and normal,
+// w is never zero and its sign is the bitangent sign, see VertexPacking::packTangentFrame
+struct CompactVertex
+{
+	uint16_t pos[4];			// half floats, w is 1
+	int16_t tangentFrame[4];	// quaternion, snorm
+	uint8_t color[4];			// unorm, alpha is 255
+	uint16_t texCoords[2];		// half floats
+};
+
+typedef VertexFormat<CompactVertex,
+	VertexAttribute<0, VK_FORMAT_R16G16B16A16_SFLOAT, offsetof(CompactVertex, pos)>,
+	VertexAttribute<1, VK_FORMAT_R16G16B16A16_SNORM, offsetof(CompactVertex, tangentFrame)>,
+	VertexAttribute<2, VK_FORMAT_R8G8B8A8_UNORM, offsetof(CompactVertex, color)>,
+	VertexAttribute<3, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactVertex, texCoords)>> CompactVertexFormat;
+
+// the same data as CompactVertex split in two, position only passes ( depth, shadows, picking ) fetch 8 bytes
+struct PositionStreamVertex
+{
+	uint16_t pos[4];		// half floats, w is 1
+};
+
+struct AttributeStreamVertex
+{
+	int16_t tangentFrame[4];	// quaternion, snorm
+	uint8_t color[4];			// unorm, alpha is 255
+	uint16_t texCoords[2];		// half floats
+};
+
+typedef VertexFormat<PositionStreamVertex,
+	VertexAttribute<0, VK_FORMAT_R16G16B16A16_SFLOAT, offsetof(PositionStreamVertex, pos)>> PositionStreamFormat;
+
+typedef VertexFormat<AttributeStreamVertex,
+	VertexAttribute<1, VK_FORMAT_R16G16B16A16_SNORM, offsetof(AttributeStreamVertex, tangentFrame)>,
+	VertexAttribute<2, VK_FORMAT_R8G8B8A8_UNORM, offsetof(AttributeStreamVertex, color)>,
+	VertexAttribute<3, VK_FORMAT_R16G16_SFLOAT, offsetof(AttributeStreamVertex, texCoords)>> AttributeStreamFormat;
+
+// vertex input for a pipeline that reads the given streams, e.g. (1 << kVertexStreamPosition) for a depth pass
+inline VertexInputDescription getVertexStreamInput(uint32_t streamMask)
+{
+	VertexInputDescription description;
+
+	if (streamMask & (1 << kVertexStreamPosition))
+	{
+		PositionStreamFormat::addToInputDescription(description, kVertexStreamPosition);
+	}
+
+	if (streamMask & (1 << kVertexStreamAttributes))
+	{
+		AttributeStreamFormat::addToInputDescription(description, kVertexStreamAttributes);
+	}
+
+	description.streamMask = streamMask;
+	return description;
+}
+
+struct Vertex;
+
+// conversion from the full float Vertex the generators and importers produce
+class VertexPacking
+{
+public:
+	static uint16_t floatToHalf(float value);
+	static float halfToFloat(uint16_t value);
+
+	// normal and tangent ( w is the bitangent sign ) to a quaternion and back, basic_compact.vert has the same decode
+	static glm::quat packTangentFrame(glm::vec3 normal, glm::vec4 tangent);
+	static void unpackTangentFrame(glm::quat frame, glm::vec3& normal, glm::vec4& tangent);
+
+	static CompactVertex packVertex(const Vertex& vertex);
+	static void packVertices(const std::vector<Vertex>& vertices, std::vector<CompactVertex>& outVertices);
+	static void packStreams(const std::vector<Vertex>& vertices, std::vector<PositionStreamVertex>& outPositions, std::vector<AttributeStreamVertex>& outAttributes);
+};
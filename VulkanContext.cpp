@@ -27,17 +27,17 @@ void VulkanContext::initVulkan(GLFWwindow* window)
 	// Validation and Extension Layers
 	valLayersAndExt = new AppValidationLayersAndExtensions();
 
-	if (isValidationLayersEnabled && !valLayersAndExt->checkValidationLayerSupport())
+	if (validationLayersEnabled && !valLayersAndExt->checkValidationLayerSupport())
 	{
 		throw std::runtime_error("Validation Layers Not Available!");
 	}
 
 	// Create App and Vulkan Instance
 	vInstance = new VulkanInstance();
-	vInstance->createAppAndVkInstance(isValidationLayersEnabled, valLayersAndExt);
+	vInstance->createAppAndVkInstance(validationLayersEnabled, valLayersAndExt);
 
 	// Debug callback
-	valLayersAndExt->setupDebugCallback(isValidationLayersEnabled, vInstance->vkInstance); // names not make sense.
+	valLayersAndExt->setupDebugCallback(validationLayersEnabled, vInstance->vkInstance); // names not make sense.
 
 	// Create surface
 	if (glfwCreateWindowSurface(vInstance->vkInstance, window, nullptr, &surface) != VK_SUCCESS)
@@ -47,7 +47,10 @@ void VulkanContext::initVulkan(GLFWwindow* window)
 
 	device = new Device();
 	device->pickPhysicalDevice(vInstance, surface);
-	device->createLogicalDevice(surface, isValidationLayersEnabled, valLayersAndExt);
+	device->createLogicalDevice(surface, validationLayersEnabled, valLayersAndExt);
+
+	// Samplers are shared by everything created after the device
+	samplerCache = new SamplerCache();
 
 	// Create SwapChain
 	swapChain = new SwapChain();
@@ -91,7 +94,38 @@ void VulkanContext::initVulkan(GLFWwindow* window)
 	}
 }
 
+void VulkanContext::initHeadless(bool enableValidationLayers)
+{
+	headless = true;
+	validationLayersEnabled = enableValidationLayers;
+
+	valLayersAndExt = new AppValidationLayersAndExtensions();
+
+	if (validationLayersEnabled && !valLayersAndExt->checkValidationLayerSupport())
+	{
+		throw std::runtime_error("Validation Layers Not Available!");
+	}
+
+	vInstance = new VulkanInstance();
+	vInstance->createAppAndVkInstance(validationLayersEnabled, valLayersAndExt, false);
+
+	valLayersAndExt->setupDebugCallback(validationLayersEnabled, vInstance->vkInstance);
+
+	// no surface, any device with a graphics queue will do
+	device = new Device();
+	device->pickPhysicalDevice(vInstance, VK_NULL_HANDLE);
+	device->createLogicalDevice(VK_NULL_HANDLE, validationLayersEnabled, valLayersAndExt);
+
+	samplerCache = new SamplerCache();
+}
+
 void VulkanContext::drawBegin()
+{
+	frameBegin();
+	renderPassBegin();
+}
+
+void VulkanContext::frameBegin()
 {
 	//vkAcquireNextImageKHR(device->logicalDevice, swapChain->swapChain, std::numeric_limits<uint64_t>::max(), NULL, VK_NULL_HANDLE, &imageIndex);
 	vkAcquireNextImageKHR(device->logicalDevice, swapChain->swapChain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
@@ -104,7 +138,10 @@ void VulkanContext::drawBegin()
 
 	// Begin command buffer recording
 	drawCommandBuffer->beginCommandBuffer(currentCommandBuffer);
+}
 
+void VulkanContext::renderPassBegin()
+{
 	// Begin renderpass
 	VkClearValue clearcolor = { 1.0f, 0.0f, 1.0f, 1.0f };
 
@@ -163,6 +200,16 @@ void VulkanContext::cleanup()
 {
 	vkDeviceWaitIdle(device->logicalDevice);
 
+	if (headless)
+	{
+		samplerCache->destroy();
+		device->destroy();
+
+		valLayersAndExt->destroy(vInstance->vkInstance, validationLayersEnabled);
+		vkDestroyInstance(vInstance->vkInstance, nullptr);
+		return;
+	}
+
 	vkDestroySemaphore(device->logicalDevice, renderFinishedSemaphore, nullptr);
 	vkDestroySemaphore(device->logicalDevice, imageAvailableSemaphore, nullptr);
 
@@ -177,9 +224,10 @@ void VulkanContext::cleanup()
 	renderPass->destroy();
 	swapChain->destroy();
 
+	samplerCache->destroy();
 	device->destroy();
 
-	valLayersAndExt->destroy(vInstance->vkInstance, isValidationLayersEnabled);
+	valLayersAndExt->destroy(vInstance->vkInstance, validationLayersEnabled);
 
 	vkDestroySurfaceKHR(vInstance->vkInstance, surface, nullptr);
 	vkDestroyInstance(vInstance->vkInstance, nullptr);
@@ -202,6 +250,11 @@ RenderPass* VulkanContext::getRenderPass()
 	return renderPass;
 }
 
+SamplerCache* VulkanContext::getSamplerCache()
+{
+	return samplerCache;
+}
+
 VkCommandBuffer VulkanContext::getCurrentCommandBuffer()
 {
 	return currentCommandBuffer;
@@ -9,6 +9,7 @@
 #include "RenderPass.h"
 #include "RenderTarget.h"
 #include "DrawCommandBuffer.h"
+#include "SamplerCache.h"
 
 #ifdef _DEBUG
 const bool isValidationLayersEnabled = true;
@@ -24,22 +25,41 @@ public:
 
 	~VulkanContext();
 	void initVulkan(GLFWwindow* window);
+	// instance, device and samplers only, no window, swapchain or frames, for tests and tools
+	void initHeadless(bool enableValidationLayers);
 
 	Device* getDevice();
 	SwapChain* getSwapChain();
 	RenderPass* getRenderPass();
+	SamplerCache* getSamplerCache();
+	// the instance's, a device can report more than the instance lets the app use
+	uint32_t getApiVersion() { return vInstance->apiVersion; }
 	VkCommandBuffer getCurrentCommandBuffer();
 
+	// the swapchain image being recorded, per frame data indexed by it is free to overwrite after frameBegin
+	uint32_t getCurrentImageIndex() { return imageIndex; }
+
+	// drawBegin = frameBegin + renderPassBegin
+	// split them to record compute work before the render pass starts
 	void drawBegin();
+	void frameBegin();
+	void renderPassBegin();
 	void drawEnd();
 	void cleanup();
+
+	// validation errors reported so far, 0 when validation is off
+	uint32_t getValidationErrorCount() { return valLayersAndExt->getErrorCount(); }
 private:
 	AppValidationLayersAndExtensions* valLayersAndExt;
 	VulkanInstance* vInstance;
 	Device* device;
+	SamplerCache* samplerCache;
+
+	bool headless = false;
+	bool validationLayersEnabled = isValidationLayersEnabled;
 
 	// surface
-	VkSurfaceKHR surface;
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
 
 	SwapChain* swapChain;
 	RenderPass* renderPass;
@@ -6,17 +6,28 @@ VulkanInstance::VulkanInstance()
 VulkanInstance::~VulkanInstance()
 { }
 
-void VulkanInstance::createAppAndVkInstance(bool enableValidationLayers, AppValidationLayersAndExtensions* valLayersAndExtensions)
+void VulkanInstance::createAppAndVkInstance(bool enableValidationLayers, AppValidationLayersAndExtensions* valLayersAndExtensions, bool windowed)
 {
 	// links the application to the Vulkan library
 
+	// vkEnumerateInstanceVersion only exists from 1.1 on, a 1.0 loader has no entry for it
+	apiVersion = VK_API_VERSION_1_0;
+
+	PFN_vkEnumerateInstanceVersion enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+	uint32_t loaderVersion = VK_API_VERSION_1_0;
+
+	if (enumerateInstanceVersion && enumerateInstanceVersion(&loaderVersion) == VK_SUCCESS && loaderVersion >= VK_API_VERSION_1_1)
+	{
+		apiVersion = VK_API_VERSION_1_1;
+	}
+
 	VkApplicationInfo appInfo = {};
 	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
 	appInfo.pApplicationName = "Hello Vulkan";
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0); // ?
 	appInfo.pEngineName = "No Engine";
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+	appInfo.apiVersion = apiVersion; // vkGetPhysicalDeviceFeatures2 for descriptor indexing needs 1.1
 
 	VkInstanceCreateInfo vkInstanceInfo = {};
 	vkInstanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -25,7 +36,7 @@ void VulkanInstance::createAppAndVkInstance(bool enableValidationLayers, AppVali
 	// specify extensions and validation layers
 	// these are global meaning they are applicable to whole program not just the device
 
-	auto extensions = valLayersAndExtensions->getRequiredExtensions(enableValidationLayers);
+	auto extensions = valLayersAndExtensions->getRequiredExtensions(enableValidationLayers, windowed);
 	vkInstanceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
 	vkInstanceInfo.ppEnabledExtensionNames = extensions.data();
 
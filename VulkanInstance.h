@@ -10,6 +10,8 @@ public:
 	~VulkanInstance();
 
 	VkInstance vkInstance;
-	void createAppAndVkInstance(bool enableValidationLayers, AppValidationLayersAndExtensions* valLayersAndExtensions);
+	// 1.1 when the loader has it, 1.0 drivers refuse an instance that asks for more
+	uint32_t apiVersion;
+	void createAppAndVkInstance(bool enableValidationLayers, AppValidationLayersAndExtensions* valLayersAndExtensions, bool windowed = true);
 };
 
@@ -4,9 +4,116 @@
 #include "VulkanContext.h"
 #include "Camera.h"
 #include "ObjectRenderer.h"
+#include "GpuCulling.h"
+#include "TextureStreamer.h"
+#include "DescriptorTemplate.h"
+#include "AnimationScheduler.h"
+#include "AnimationClip.h"
+#include "TangentGenerator.h"
+#include "MeshCodec.h"
+#include "MorphTargets.h"
+#include "MipGenerator.h"
+#include "TextureCompressor.h"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
 
-int main()
+// no window or swapchain, runs under the validation layers so it works on lavapipe / ci
+static int headlessCullTest()
 {
+	VulkanContext::getInstance()->initHeadless(true);
+
+	bool passed = GpuCulling::validate(1000) && GpuCulling::validate(65536);
+
+	VulkanContext::getInstance()->cleanup();
+
+	return passed ? 0 : 1;
+}
+
+struct Benchmark
+{
+	const char* name;
+	void (*run)();
+	bool needsDevice;
+};
+
+static const Benchmark kBenchmarks[] =
+{
+	{ "TextureResidency", TextureResidency::benchmark, false },
+	{ "DescriptorTemplate", DescriptorTemplate::benchmark, true },
+	{ "AnimationScheduler", AnimationScheduler::benchmark, false },
+	{ "AnimationClip", AnimationClip::benchmark, false },
+	{ "TangentGenerator", TangentGenerator::benchmark, false },
+	{ "MeshCodec", MeshCodec::benchmark, false },
+	{ "MorphTargetSet", MorphTargetSet::benchmark, false },
+	{ "MipGenerator", MipGenerator::benchmark, false },
+	{ "TextureCompressor", TextureCompressor::benchmark, false },
+};
+
+// one by name or "all", the ones that need a device get a headless one without validation so it doesn't skew the timings
+static int runBenchmarks(const char* name)
+{
+	bool found = false;
+	bool deviceReady = false;
+	int result = 0;
+
+	try
+	{
+		for (const Benchmark& benchmark : kBenchmarks)
+		{
+			if (strcmp(name, "all") != 0 && strcmp(name, benchmark.name) != 0)
+			{
+				continue;
+			}
+
+			found = true;
+
+			if (benchmark.needsDevice && !deviceReady)
+			{
+				VulkanContext::getInstance()->initHeadless(false);
+				deviceReady = true;
+			}
+
+			benchmark.run();
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		result = 1;
+	}
+
+	if (deviceReady)
+	{
+		VulkanContext::getInstance()->cleanup();
+	}
+
+	if (!found)
+	{
+		std::cerr << "unknown benchmark " << name << ", one of: all";
+		for (const Benchmark& benchmark : kBenchmarks)
+		{
+			std::cerr << " " << benchmark.name;
+		}
+		std::cerr << std::endl;
+		return 1;
+	}
+
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && strcmp(argv[1], "--headless-cull-test") == 0)
+	{
+		return headlessCullTest();
+	}
+
+	if (argc > 1 && strcmp(argv[1], "--benchmark") == 0)
+	{
+		return runBenchmarks(argc > 2 ? argv[2] : "all");
+	}
+
 	glfwInit();
 
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -23,19 +130,53 @@ int main()
 	ObjectRenderer object;
 	object.createObjectRenderer(MeshType::kTriangle, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.5f));
 
+	// small cube right behind the triangle, the occlusion test should drop it
+	ObjectRenderer hidden;
+	hidden.createObjectRenderer(MeshType::kCube, glm::vec3(0.0f, 0.0f, -2.0f), glm::vec3(0.1f));
+
+	ObjectRenderer* objects[] = { &object, &hidden };
+
+	SoftwareOcclusion occlusion;
+	occlusion.create();
+
+	glm::vec3 boundsMin, boundsMax;
+	uint32_t frame = 0;
+
 	// engine loop: game loop
 	while (!glfwWindowShouldClose(window))
 	{
+		// the triangle is the only large object, it is the occluder
+		occlusion.beginFrame(camera);
+		object.submitOccluder(occlusion);
+		occlusion.rasterizeOccluders();
+
 		VulkanContext::getInstance()->drawBegin();
 		// draw command 
-		object.updateUniformBuffer(camera);
-		object.draw();
+		for (ObjectRenderer* renderer : objects)
+		{
+			renderer->updateUniformBuffer(camera);
+
+			renderer->getWorldBounds(boundsMin, boundsMax);
+			if (occlusion.isVisible(boundsMin, boundsMax))
+			{
+				renderer->cullMeshlets(camera, &occlusion);
+				renderer->draw();
+			}
+		}
 
 		VulkanContext::getInstance()->drawEnd();
 
+		// stats are per frame, print one every few seconds
+		if (frame++ % 300 == 0)
+		{
+			occlusion.printStats();
+		}
+
 		glfwPollEvents();
 	}
 
+	occlusion.destroy();
+	hidden.destroy();
 	object.destroy();
 
 	VulkanContext::getInstance()->cleanup();